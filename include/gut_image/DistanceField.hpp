@@ -0,0 +1,43 @@
+//
+// Project: GraphicsUtils
+// File: DistanceField.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_DISTANCEFIELD_HPP
+#define GRAPHICSUTILS_DISTANCEFIELD_HPP
+
+
+#include "Image.hpp"
+
+
+namespace gut {
+
+    /** @brief  Generate a signed distance field from a mask image
+     *  @param  mask        Mask image, GRAY format of any data type
+     *  @param  dest        Destination image, recreated as GRAY image of type dataType
+     *  @param  spread      Distance (in pixels) at which the output saturates
+     *  @param  dataType    Output data type, U8 or F32
+     *  @param  threshold   Mask values at or above threshold (in normalized [0, 1] range) are inside
+     *  @note   Distances are exact Euclidean distances, computed with the separable algorithm by
+     *          Felzenszwalb and Huttenlocher. Rows and columns are processed in parallel.
+     *  @note   Distance is positive inside and negative outside, the boundary lies halfway
+     *          between inside and outside pixels.
+     *          F32: signed distance in pixels, clamped to [-spread, spread]
+     *          U8: [-spread, spread] mapped to [0, 255], boundary at 127.5
+     */
+    void generateSignedDistanceField(
+        const Image& mask,
+        Image& dest,
+        float spread,
+        Image::DataType dataType = Image::DataType::U8,
+        float threshold = 0.5f);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_DISTANCEFIELD_HPP
@@ -19,6 +19,9 @@
 
 namespace gut {
 
+    template <typename T_Derived>
+    class ImageExpression;
+
     /** @brief  Image class for generic 2D image data storage and I/O
      */
     class Image {
@@ -116,6 +119,13 @@ namespace gut {
         Image& operator=(Image&& other) noexcept;
         ~Image();
 
+        /** @brief  Evaluate an image expression into the image (see ImageExpression.hpp)
+         *  @note   The image is recreated with format and dimensions of the expression if they
+         *          differ, data type of the image is retained
+         */
+        template <typename T_Expression>
+        Image& operator=(const ImageExpression<T_Expression>& expression);
+
         /** @brief  Create an empty image
          *  @param  width    Width of the image
          *  @param  height   Height of the image
@@ -124,9 +134,11 @@ namespace gut {
         void create(int width, int height);
 
         /** @brief Load image from a file
-         *  @param fileName Name of the file to load the image from
+         *  @param fileName         Name of the file to load the image from
+         *  @param flipVertically   Store the rows bottom-up (as expected by OpenGL texture coordinates)
+         *  @note  Flipping is done while copying the decoded data, it requires no additional pass
          */
-        void loadFromFile(const std::string& fileName);
+        void loadFromFile(const std::string& fileName, bool flipVertically = false);
 
         /** @brief  Write image to a file
          *  @param  fileName    Name of the file to write the image to
@@ -141,6 +153,8 @@ namespace gut {
         void writeToFile(const std::string& fileName);
 
         /** @brief  Convert image to a new data type
+         *  @note   F32 values are clamped to [0, 1] when converting to integer types,
+         *          use tonemap() for HDR data
          */
         void convertDataType(Image::DataType dataType);
 
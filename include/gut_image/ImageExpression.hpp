@@ -0,0 +1,266 @@
+//
+// Project: GraphicsUtils
+// File: ImageExpression.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_IMAGEEXPRESSION_HPP
+#define GRAPHICSUTILS_IMAGEEXPRESSION_HPP
+
+
+#include "Image.hpp"
+
+#include <gut_utils/ParallelFor.hpp>
+
+#include <algorithm>
+#include <type_traits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_IMAGEEXPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace gut {
+
+    /** @brief  Four consecutive image components, the unit image expressions are evaluated in
+     */
+    struct ImagePacket {
+#ifdef GUT_IMAGEEXPRESSION_SSE2
+        __m128  v;
+#else
+        float   v[4];
+#endif
+
+        inline static ImagePacket load(const float* p);
+        inline static ImagePacket set(float a);
+        inline static ImagePacket set(float a, float b, float c, float d);
+        inline void store(float* p) const;
+    };
+
+    /** @brief  Shape of an image expression
+     */
+    struct ImageExpressionShape {
+        int                 width;
+        int                 height;
+        Image::DataFormat   dataFormat;
+        bool                scalar; // expression contains no images
+        bool                valid;  // all images in the expression have the same shape
+
+        // Combine shapes of two operands
+        inline static ImageExpressionShape combine(
+            const ImageExpressionShape& a, const ImageExpressionShape& b);
+    };
+
+    /** @brief  Base class for lazy image expressions
+     *  @tparam T_Derived   Expression type (CRTP)
+     *  @note   Expressions are evaluated component-wise in normalized float precision (integer
+     *          data is mapped to [0, 1] as in Image::convertDataType) when assigned to an Image.
+     *          The evaluation reads every operand image once and writes the target once,
+     *          4 components at a time and in parallel.
+     *  @note   Expression nodes store their operands by value, images are referenced and must
+     *          outlive the expression.
+     *  @note   Every expression node provides:
+     *          ImageExpressionShape shape() const;
+     *          float value(int64_t i) const;           // component i of the flat data array
+     *          ImagePacket packet(int64_t i) const;    // components [i, i+4), i divisible by 4
+     */
+    template <typename T_Derived>
+    class ImageExpression {
+    public:
+        const T_Derived& derived() const noexcept { return static_cast<const T_Derived&>(*this); }
+
+        /** @brief  Clamp components to range [min, max]
+         */
+        auto clamp(float min, float max) const;
+
+        /** @brief  Component-wise minimum / maximum with a constant
+         */
+        auto min(float v) const;
+        auto max(float v) const;
+
+        /** @brief  Component-wise absolute value / square root
+         */
+        auto abs() const;
+        auto sqrt() const;
+
+        /** @brief  Multiply channels with per-channel factors
+         *  @note   Factors of channels not present in the data format are ignored
+         */
+        auto multiplyChannels(float r, float g, float b, float a = 1.0f) const;
+
+        /** @brief  Add per-channel offsets to channels
+         *  @note   Offsets of channels not present in the data format are ignored
+         */
+        auto addChannels(float r, float g, float b, float a = 0.0f) const;
+    };
+
+    /** @brief  Image operand, reads the image data of any data type
+     */
+    class ImageOperand : public ImageExpression<ImageOperand> {
+    public:
+        explicit ImageOperand(const Image& image);
+
+        inline ImageExpressionShape shape() const;
+        inline float value(int64_t i) const;
+        inline ImagePacket packet(int64_t i) const;
+
+    private:
+        const void*             _data;
+        Image::DataType         _dataType;
+        ImageExpressionShape    _shape;
+    };
+
+    /** @brief  Constant operand
+     */
+    class ScalarOperand : public ImageExpression<ScalarOperand> {
+    public:
+        explicit ScalarOperand(float v);
+
+        inline ImageExpressionShape shape() const;
+        inline float value(int64_t i) const;
+        inline ImagePacket packet(int64_t i) const;
+
+    private:
+        float   _v;
+    };
+
+    /** @brief  Component-wise unary operation
+     *  @tparam T_Operation Operation with static float apply(float) and ImagePacket apply(ImagePacket)
+     */
+    template <typename T_Expression, typename T_Operation>
+    class UnaryImageExpression : public ImageExpression<UnaryImageExpression<T_Expression, T_Operation>> {
+    public:
+        explicit UnaryImageExpression(const T_Expression& e);
+
+        ImageExpressionShape shape() const;
+        float value(int64_t i) const;
+        ImagePacket packet(int64_t i) const;
+
+    private:
+        T_Expression    _e;
+    };
+
+    /** @brief  Component-wise binary operation
+     *  @tparam T_Operation Operation with static float apply(float, float) and
+     *                      ImagePacket apply(ImagePacket, ImagePacket)
+     */
+    template <typename T_Left, typename T_Right, typename T_Operation>
+    class BinaryImageExpression : public ImageExpression<BinaryImageExpression<T_Left, T_Right, T_Operation>> {
+    public:
+        BinaryImageExpression(const T_Left& left, const T_Right& right);
+
+        ImageExpressionShape shape() const;
+        float value(int64_t i) const;
+        ImagePacket packet(int64_t i) const;
+
+    private:
+        T_Left  _left;
+        T_Right _right;
+    };
+
+    /** @brief  Per-channel affine transformation, x*scale[c] + offset[c]
+     */
+    template <typename T_Expression>
+    class ChannelImageExpression : public ImageExpression<ChannelImageExpression<T_Expression>> {
+    public:
+        ChannelImageExpression(const T_Expression& e, const float (&scale)[4], const float (&offset)[4]);
+
+        ImageExpressionShape shape() const;
+        float value(int64_t i) const;
+        ImagePacket packet(int64_t i) const;
+
+    private:
+        // Components repeat with a period of 4 (GRAY, RGBA) or 12 (RGB) when grouped in packets
+        static constexpr int patternSize = 12;
+
+        T_Expression    _e;
+        int             _nChannels;
+        int             _period;
+        float           _scale[patternSize];
+        float           _offset[patternSize];
+    };
+
+
+    // Component-wise operations
+    struct ImageAddOperation;
+    struct ImageSubtractOperation;
+    struct ImageMultiplyOperation;
+    struct ImageDivideOperation;
+    struct ImageMinOperation;
+    struct ImageMaxOperation;
+    struct ImageNegateOperation;
+    struct ImageAbsOperation;
+    struct ImageSqrtOperation;
+
+
+    template <typename T>
+    struct IsImageExpression : std::is_base_of<ImageExpression<std::decay_t<T>>, std::decay_t<T>> {};
+
+    // Types that turn an arithmetic operator into an image expression
+    template <typename T>
+    concept ImageExpressionOperand = IsImageExpression<T>::value || std::is_same_v<std::decay_t<T>, Image>;
+
+    // Types that can appear on either side of an image expression operator
+    template <typename T>
+    concept ImageExpressionArgument = ImageExpressionOperand<T> || std::is_arithmetic_v<std::decay_t<T>>;
+
+    // Convert operator argument to an expression node
+    inline ImageOperand toImageExpression(const Image& image);
+    template <typename T_Value> requires std::is_arithmetic_v<T_Value>
+    ScalarOperand toImageExpression(T_Value v);
+    template <typename T_Derived>
+    const T_Derived& toImageExpression(const ImageExpression<T_Derived>& e);
+
+    template <typename T>
+    using ImageExpressionNode = std::decay_t<decltype(toImageExpression(std::declval<const T&>()))>;
+
+
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto operator+(const T_Left& left, const T_Right& right);
+
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto operator-(const T_Left& left, const T_Right& right);
+
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto operator*(const T_Left& left, const T_Right& right);
+
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto operator/(const T_Left& left, const T_Right& right);
+
+    template <ImageExpressionOperand T_Operand>
+    auto operator-(const T_Operand& operand);
+
+    /** @brief  Component-wise minimum / maximum of two operands
+     */
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto min(const T_Left& left, const T_Right& right);
+
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)
+    auto max(const T_Left& left, const T_Right& right);
+
+    /** @brief  Start an expression from an image, enables the member operations on plain images
+     *  @note   For example: expr(img).clamp(0.0f, 0.5f)
+     */
+    inline ImageOperand expr(const Image& image);
+
+
+    #include "ImageExpression.inl"
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_IMAGEEXPRESSION_HPP
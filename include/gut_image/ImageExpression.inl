@@ -0,0 +1,492 @@
+//
+// Project: GraphicsUtils
+// File: ImageExpression.inl
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+// ImagePacket
+#ifdef GUT_IMAGEEXPRESSION_SSE2
+ImagePacket ImagePacket::load(const float* p)
+{
+    return { _mm_loadu_ps(p) };
+}
+
+ImagePacket ImagePacket::set(float a)
+{
+    return { _mm_set1_ps(a) };
+}
+
+ImagePacket ImagePacket::set(float a, float b, float c, float d)
+{
+    return { _mm_setr_ps(a, b, c, d) };
+}
+
+void ImagePacket::store(float* p) const
+{
+    _mm_storeu_ps(p, v);
+}
+#else
+ImagePacket ImagePacket::load(const float* p)
+{
+    return { { p[0], p[1], p[2], p[3] } };
+}
+
+ImagePacket ImagePacket::set(float a)
+{
+    return { { a, a, a, a } };
+}
+
+ImagePacket ImagePacket::set(float a, float b, float c, float d)
+{
+    return { { a, b, c, d } };
+}
+
+void ImagePacket::store(float* p) const
+{
+    for (int j=0; j<4; ++j)
+        p[j] = v[j];
+}
+#endif
+
+
+// ImageExpressionShape
+ImageExpressionShape ImageExpressionShape::combine(
+    const ImageExpressionShape& a, const ImageExpressionShape& b)
+{
+    if (a.scalar)
+        return { b.width, b.height, b.dataFormat, b.scalar, a.valid && b.valid };
+    if (b.scalar)
+        return { a.width, a.height, a.dataFormat, a.scalar, a.valid && b.valid };
+
+    bool match = a.width == b.width && a.height == b.height && a.dataFormat == b.dataFormat;
+    return { a.width, a.height, a.dataFormat, false, a.valid && b.valid && match };
+}
+
+
+// Component-wise operations
+#ifdef GUT_IMAGEEXPRESSION_SSE2
+#define GUT_IMAGEEXPRESSION_BINARY_OPERATION(NAME, SCALAR_EXPR, SSE_EXPR)                   \
+    struct NAME {                                                                           \
+        static float apply(float a, float b) { return SCALAR_EXPR; }                        \
+        static ImagePacket apply(ImagePacket a, ImagePacket b) { return { SSE_EXPR }; }     \
+    };
+#define GUT_IMAGEEXPRESSION_UNARY_OPERATION(NAME, SCALAR_EXPR, SSE_EXPR)                    \
+    struct NAME {                                                                           \
+        static float apply(float a) { return SCALAR_EXPR; }                                 \
+        static ImagePacket apply(ImagePacket a) { return { SSE_EXPR }; }                    \
+    };
+#else
+#define GUT_IMAGEEXPRESSION_BINARY_OPERATION(NAME, SCALAR_EXPR, SSE_EXPR)                   \
+    struct NAME {                                                                           \
+        static float apply(float a, float b) { return SCALAR_EXPR; }                        \
+        static ImagePacket apply(ImagePacket a, ImagePacket b) {                            \
+            ImagePacket r;                                                                  \
+            for (int j=0; j<4; ++j)                                                         \
+                r.v[j] = apply(a.v[j], b.v[j]);                                             \
+            return r;                                                                       \
+        }                                                                                   \
+    };
+#define GUT_IMAGEEXPRESSION_UNARY_OPERATION(NAME, SCALAR_EXPR, SSE_EXPR)                    \
+    struct NAME {                                                                           \
+        static float apply(float a) { return SCALAR_EXPR; }                                 \
+        static ImagePacket apply(ImagePacket a) {                                           \
+            ImagePacket r;                                                                  \
+            for (int j=0; j<4; ++j)                                                         \
+                r.v[j] = apply(a.v[j]);                                                     \
+            return r;                                                                       \
+        }                                                                                   \
+    };
+#endif
+
+// Scalar min / max written to match the SSE semantics (second operand returned on NaN)
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageAddOperation, a + b, _mm_add_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageSubtractOperation, a - b, _mm_sub_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageMultiplyOperation, a * b, _mm_mul_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageDivideOperation, a / b, _mm_div_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageMinOperation, a < b ? a : b, _mm_min_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_BINARY_OPERATION(ImageMaxOperation, a > b ? a : b, _mm_max_ps(a.v, b.v))
+GUT_IMAGEEXPRESSION_UNARY_OPERATION(ImageNegateOperation, -a, _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)))
+GUT_IMAGEEXPRESSION_UNARY_OPERATION(ImageAbsOperation, std::fabs(a), _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v))
+GUT_IMAGEEXPRESSION_UNARY_OPERATION(ImageSqrtOperation, std::sqrt(a), _mm_sqrt_ps(a.v))
+
+#undef GUT_IMAGEEXPRESSION_BINARY_OPERATION
+#undef GUT_IMAGEEXPRESSION_UNARY_OPERATION
+
+
+// ImageExpression
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::clamp(float min, float max) const
+{
+    return this->max(min).min(max);
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::min(float v) const
+{
+    return BinaryImageExpression<T_Derived, ScalarOperand, ImageMinOperation>(derived(), ScalarOperand(v));
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::max(float v) const
+{
+    return BinaryImageExpression<T_Derived, ScalarOperand, ImageMaxOperation>(derived(), ScalarOperand(v));
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::abs() const
+{
+    return UnaryImageExpression<T_Derived, ImageAbsOperation>(derived());
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::sqrt() const
+{
+    return UnaryImageExpression<T_Derived, ImageSqrtOperation>(derived());
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::multiplyChannels(float r, float g, float b, float a) const
+{
+    const float scale[4] = { r, g, b, a };
+    const float offset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    return ChannelImageExpression<T_Derived>(derived(), scale, offset);
+}
+
+template <typename T_Derived>
+auto ImageExpression<T_Derived>::addChannels(float r, float g, float b, float a) const
+{
+    const float scale[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float offset[4] = { r, g, b, a };
+    return ChannelImageExpression<T_Derived>(derived(), scale, offset);
+}
+
+
+// ImageOperand
+inline ImageOperand::ImageOperand(const Image& image) :
+    _data       (image.data<void>()),
+    _dataType   (image.dataType()),
+    _shape      { image.width(), image.height(), image.dataFormat(), false, image.data<void>() != nullptr }
+{
+}
+
+ImageExpressionShape ImageOperand::shape() const
+{
+    return _shape;
+}
+
+float ImageOperand::value(int64_t i) const
+{
+    switch (_dataType) {
+        case Image::DataType::U8:
+            return (float)static_cast<const uint8_t*>(_data)[i]*0.0039215686f;
+        case Image::DataType::U16:
+            return (float)static_cast<const uint16_t*>(_data)[i]*0.000015259021893f;
+        case Image::DataType::F32:
+            return static_cast<const float*>(_data)[i];
+        default:
+            return 0.0f;
+    }
+}
+
+ImagePacket ImageOperand::packet(int64_t i) const
+{
+#ifdef GUT_IMAGEEXPRESSION_SSE2
+    // Data type is the same for every packet, the branch is predicted perfectly
+    switch (_dataType) {
+        case Image::DataType::U8: {
+            int32_t w;
+            memcpy(&w, static_cast<const uint8_t*>(_data)+i, sizeof(int32_t));
+            __m128i zero = _mm_setzero_si128();
+            __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(w), zero), zero);
+            return { _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(0.0039215686f)) };
+        }
+        case Image::DataType::U16: {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(
+                static_cast<const uint16_t*>(_data)+i));
+            v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+            return { _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(0.000015259021893f)) };
+        }
+        case Image::DataType::F32:
+            return { _mm_loadu_ps(static_cast<const float*>(_data)+i) };
+        default:
+            return { _mm_setzero_ps() };
+    }
+#else
+    return { { value(i), value(i+1), value(i+2), value(i+3) } };
+#endif
+}
+
+
+// ScalarOperand
+inline ScalarOperand::ScalarOperand(float v) :
+    _v  (v)
+{
+}
+
+ImageExpressionShape ScalarOperand::shape() const
+{
+    return { 0, 0, Image::DataFormat::GRAY, true, true };
+}
+
+float ScalarOperand::value(int64_t) const
+{
+    return _v;
+}
+
+ImagePacket ScalarOperand::packet(int64_t) const
+{
+    return ImagePacket::set(_v);
+}
+
+
+// UnaryImageExpression
+template <typename T_Expression, typename T_Operation>
+UnaryImageExpression<T_Expression, T_Operation>::UnaryImageExpression(const T_Expression& e) :
+    _e  (e)
+{
+}
+
+template <typename T_Expression, typename T_Operation>
+ImageExpressionShape UnaryImageExpression<T_Expression, T_Operation>::shape() const
+{
+    return _e.shape();
+}
+
+template <typename T_Expression, typename T_Operation>
+float UnaryImageExpression<T_Expression, T_Operation>::value(int64_t i) const
+{
+    return T_Operation::apply(_e.value(i));
+}
+
+template <typename T_Expression, typename T_Operation>
+ImagePacket UnaryImageExpression<T_Expression, T_Operation>::packet(int64_t i) const
+{
+    return T_Operation::apply(_e.packet(i));
+}
+
+
+// BinaryImageExpression
+template <typename T_Left, typename T_Right, typename T_Operation>
+BinaryImageExpression<T_Left, T_Right, T_Operation>::BinaryImageExpression(
+    const T_Left& left, const T_Right& right) :
+    _left   (left),
+    _right  (right)
+{
+}
+
+template <typename T_Left, typename T_Right, typename T_Operation>
+ImageExpressionShape BinaryImageExpression<T_Left, T_Right, T_Operation>::shape() const
+{
+    return ImageExpressionShape::combine(_left.shape(), _right.shape());
+}
+
+template <typename T_Left, typename T_Right, typename T_Operation>
+float BinaryImageExpression<T_Left, T_Right, T_Operation>::value(int64_t i) const
+{
+    return T_Operation::apply(_left.value(i), _right.value(i));
+}
+
+template <typename T_Left, typename T_Right, typename T_Operation>
+ImagePacket BinaryImageExpression<T_Left, T_Right, T_Operation>::packet(int64_t i) const
+{
+    return T_Operation::apply(_left.packet(i), _right.packet(i));
+}
+
+
+// ChannelImageExpression
+template <typename T_Expression>
+ChannelImageExpression<T_Expression>::ChannelImageExpression(
+    const T_Expression& e, const float (&scale)[4], const float (&offset)[4]) :
+    _e          (e),
+    _nChannels  (e.shape().scalar ? 1 : Image::nChannels(e.shape().dataFormat)),
+    _period     (_nChannels == 3 ? 12 : 4)
+{
+    // Expand the factors to a pattern starting at a pixel boundary
+    for (int j=0; j<patternSize; ++j) {
+        _scale[j] = scale[j % _nChannels];
+        _offset[j] = offset[j % _nChannels];
+    }
+}
+
+template <typename T_Expression>
+ImageExpressionShape ChannelImageExpression<T_Expression>::shape() const
+{
+    return _e.shape();
+}
+
+template <typename T_Expression>
+float ChannelImageExpression<T_Expression>::value(int64_t i) const
+{
+    int c = (int)(i % _nChannels);
+    return _e.value(i)*_scale[c] + _offset[c];
+}
+
+template <typename T_Expression>
+ImagePacket ChannelImageExpression<T_Expression>::packet(int64_t i) const
+{
+    int p = (int)(i % _period);
+    return ImageAddOperation::apply(
+        ImageMultiplyOperation::apply(_e.packet(i), ImagePacket::load(_scale+p)),
+        ImagePacket::load(_offset+p));
+}
+
+
+// Operators
+ImageOperand toImageExpression(const Image& image)
+{
+    return ImageOperand(image);
+}
+
+template <typename T_Value> requires std::is_arithmetic_v<T_Value>
+ScalarOperand toImageExpression(T_Value v)
+{
+    return ScalarOperand((float)v);
+}
+
+template <typename T_Derived>
+const T_Derived& toImageExpression(const ImageExpression<T_Derived>& e)
+{
+    return e.derived();
+}
+
+#define GUT_IMAGEEXPRESSION_BINARY_OPERATOR(OPERATOR, OPERATION)                            \
+    template <ImageExpressionArgument T_Left, ImageExpressionArgument T_Right>             \
+        requires (ImageExpressionOperand<T_Left> || ImageExpressionOperand<T_Right>)       \
+    auto OPERATOR(const T_Left& left, const T_Right& right)                                 \
+    {                                                                                       \
+        return BinaryImageExpression<ImageExpressionNode<T_Left>,                           \
+            ImageExpressionNode<T_Right>, OPERATION>(                                       \
+            toImageExpression(left), toImageExpression(right));                             \
+    }
+
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(operator+, ImageAddOperation)
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(operator-, ImageSubtractOperation)
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(operator*, ImageMultiplyOperation)
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(operator/, ImageDivideOperation)
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(min, ImageMinOperation)
+GUT_IMAGEEXPRESSION_BINARY_OPERATOR(max, ImageMaxOperation)
+
+#undef GUT_IMAGEEXPRESSION_BINARY_OPERATOR
+
+template <ImageExpressionOperand T_Operand>
+auto operator-(const T_Operand& operand)
+{
+    return UnaryImageExpression<ImageExpressionNode<T_Operand>, ImageNegateOperation>(
+        toImageExpression(operand));
+}
+
+ImageOperand expr(const Image& image)
+{
+    return ImageOperand(image);
+}
+
+
+// Evaluation
+inline void storeImageValue(float* dest, float v)
+{
+    *dest = v;
+}
+
+inline void storeImageValue(uint8_t* dest, float v)
+{
+    *dest = (uint8_t)(std::clamp(v, 0.0f, 1.0f)*255.0f + 0.5f);
+}
+
+inline void storeImageValue(uint16_t* dest, float v)
+{
+    *dest = (uint16_t)(std::clamp(v, 0.0f, 1.0f)*65535.0f + 0.5f);
+}
+
+#ifdef GUT_IMAGEEXPRESSION_SSE2
+inline void storeImagePacket(float* dest, ImagePacket p)
+{
+    p.store(dest);
+}
+
+inline void storeImagePacket(uint8_t* dest, ImagePacket p)
+{
+    __m128 v = _mm_min_ps(_mm_max_ps(p.v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    __m128i w = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+    w = _mm_packs_epi32(w, w);
+    w = _mm_packus_epi16(w, w);
+    int32_t b = _mm_cvtsi128_si32(w);
+    memcpy(dest, &b, sizeof(int32_t));
+}
+
+inline void storeImagePacket(uint16_t* dest, ImagePacket p)
+{
+    __m128 v = _mm_min_ps(_mm_max_ps(p.v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    __m128i w = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f)));
+    // No unsigned 32->16 bit pack in SSE2, bias to signed range and back
+    w = _mm_sub_epi32(w, _mm_set1_epi32(32768));
+    w = _mm_packs_epi32(w, w);
+    w = _mm_xor_si128(w, _mm_set1_epi16((int16_t)0x8000));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), w);
+}
+#else
+template <typename T_Data>
+inline void storeImagePacket(T_Data* dest, ImagePacket p)
+{
+    for (int j=0; j<4; ++j)
+        storeImageValue(dest+j, p.v[j]);
+}
+#endif
+
+template <typename T_Data, typename T_Expression>
+void evaluateImageExpression(const T_Expression& e, T_Data* dest, int64_t n)
+{
+    // Multiple of packet size and the per-channel pattern period
+    constexpr int64_t chunkSize = 48;
+
+    parallelFor(0, (n+chunkSize-1) / chunkSize, [&](int64_t chunkBegin, int64_t chunkEnd, int) {
+        int64_t begin = chunkBegin*chunkSize;
+        int64_t end = std::min(chunkEnd*chunkSize, n);
+
+        int64_t i = begin;
+        for (; i+4 <= end; i+=4)
+            storeImagePacket(dest+i, e.packet(i));
+        for (; i<end; ++i)
+            storeImageValue(dest+i, e.value(i));
+    }, 1024);
+}
+
+template <typename T_Expression>
+Image& Image::operator=(const ImageExpression<T_Expression>& expression)
+{
+    const T_Expression& e = expression.derived();
+    ImageExpressionShape shape = e.shape();
+    if (!shape.valid || shape.scalar) {
+        fprintf(stderr, "ERROR: Invalid image expression (empty or mismatching operand images)\n"); // TODO logging
+        return *this;
+    }
+
+    // Operand images cannot alias the image here: their shape matches the expression
+    if (_dataFormat != shape.dataFormat || _width != shape.width || _height != shape.height) {
+        *this = Image(shape.dataFormat, _dataType);
+        create(shape.width, shape.height);
+    }
+
+    // Every component depends only on the same component of the operands, so evaluating
+    // in place (target also being an operand) is safe
+    int64_t n = (int64_t)_width*_height*nChannels(_dataFormat);
+    switch (_dataType) {
+        case DataType::U8:
+            evaluateImageExpression(e, static_cast<uint8_t*>(_data), n);
+            break;
+        case DataType::U16:
+            evaluateImageExpression(e, static_cast<uint16_t*>(_data), n);
+            break;
+        case DataType::F32:
+            evaluateImageExpression(e, static_cast<float*>(_data), n);
+            break;
+        default:
+            fprintf(stderr, "ERROR: Invalid image data type\n"); // TODO logging
+            break;
+    }
+
+    return *this;
+}
@@ -0,0 +1,76 @@
+//
+// Project: GraphicsUtils
+// File: ImageHash.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_IMAGEHASH_HPP
+#define GRAPHICSUTILS_IMAGEHASH_HPP
+
+
+#include "Image.hpp"
+
+#include <gut_utils/Hash.hpp>
+
+
+namespace gut {
+
+    /** @brief  Streaming hasher for image content, for images processed in parts
+     *  @note   Data format, data type and dimensions are included in the hash
+     *  @note   Parts must be fed in the row-major order of the complete image (for example
+     *          horizontal strips), the result then equals hashImage64() / hashImage128()
+     *          of the complete image
+     */
+    class ImageHasher {
+    public:
+        /** @brief  Construct an ImageHasher object
+         *  @param  dataFormat  Pixel data format of the complete image
+         *  @param  dataType    Pixel data type of the complete image
+         *  @param  width       Width of the complete image
+         *  @param  height      Height of the complete image
+         *  @param  seed        Hash seed
+         */
+        ImageHasher(
+            Image::DataFormat dataFormat,
+            Image::DataType dataType,
+            int width,
+            int height,
+            uint64_t seed = 0);
+
+        /** @brief  Feed raw pixel data
+         *  @param  data    Pointer to the pixel data
+         *  @param  size    Size of the pixel data in bytes
+         */
+        void update(const void* data, size_t size);
+
+        /** @brief  Feed all pixel data of an image part
+         *  @param  part    Image containing the next rows of the complete image
+         *  @note   Format and type of the part must match the ones given in the constructor
+         */
+        void update(const Image& part);
+
+        uint64_t digest64() const;
+        Hash128 digest128() const;
+
+    private:
+        Image::DataFormat   _dataFormat;
+        Image::DataType     _dataType;
+        Hasher              _hasher;
+    };
+
+    /** @brief  Hash image content
+     *  @param  image   Image to hash
+     *  @param  seed    Hash seed
+     *  @return Hash of the pixel data, data format, data type and dimensions
+     */
+    uint64_t hashImage64(const Image& image, uint64_t seed = 0);
+    Hash128 hashImage128(const Image& image, uint64_t seed = 0);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_IMAGEHASH_HPP
@@ -0,0 +1,58 @@
+//
+// Project: GraphicsUtils
+// File: ImageTransform.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_IMAGETRANSFORM_HPP
+#define GRAPHICSUTILS_IMAGETRANSFORM_HPP
+
+
+namespace gut {
+
+    class Image;
+
+    /** @brief  Flip image upside down
+     *  @param  image   Image to flip, operation is performed in place
+     */
+    void flipVertical(Image& image);
+
+    /** @brief  Mirror image horizontally
+     *  @param  image   Image to flip, operation is performed in place
+     */
+    void flipHorizontal(Image& image);
+
+    /** @brief  Rotate image by 180 degrees
+     *  @param  image   Image to rotate, operation is performed in place
+     */
+    void rotate180(Image& image);
+
+    /** @brief  Transpose image (swap x and y axes)
+     *  @param  src     Source image
+     *  @param  dest    Destination image, recreated with format and type of the source image
+     *  @note   src and dest must not be the same object
+     */
+    void transpose(const Image& src, Image& dest);
+
+    /** @brief  Rotate image by 90 degrees clockwise
+     *  @param  src     Source image
+     *  @param  dest    Destination image, recreated with format and type of the source image
+     *  @note   src and dest must not be the same object
+     */
+    void rotate90(const Image& src, Image& dest);
+
+    /** @brief  Rotate image by 270 degrees clockwise (90 degrees counterclockwise)
+     *  @param  src     Source image
+     *  @param  dest    Destination image, recreated with format and type of the source image
+     *  @note   src and dest must not be the same object
+     */
+    void rotate270(const Image& src, Image& dest);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_IMAGETRANSFORM_HPP
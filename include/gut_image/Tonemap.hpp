@@ -0,0 +1,65 @@
+//
+// Project: GraphicsUtils
+// File: Tonemap.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_TONEMAP_HPP
+#define GRAPHICSUTILS_TONEMAP_HPP
+
+
+namespace gut {
+
+    class Image;
+
+    /** @brief  Supported tonemapping curves
+     */
+    enum class TonemapCurve {
+        LINEAR,         // clamp to [0, 1]
+        REINHARD,       // x / (1 + x)
+        ACES_FITTED,    // Narkowicz's fit of the ACES filmic curve
+        HABLE           // Uncharted 2 filmic curve, normalized to the white point
+    };
+
+    /** @brief  Tonemapping settings struct
+     */
+    struct TonemapSettings {
+        float           exposure;   ///< Exposure adjustment in stops, applied before the curve
+        TonemapCurve    curve;      ///< Tonemapping curve
+        float           whitePoint; ///< Linear value mapped to white, used by HABLE curve
+        bool            srgbEncode; ///< Apply sRGB transfer function after the curve
+        bool            dither;     ///< Apply ordered dithering before quantization
+
+        explicit TonemapSettings(
+            float exposure      = 0.0f,
+            TonemapCurve curve  = TonemapCurve::ACES_FITTED,
+            float whitePoint    = 11.2f,
+            bool srgbEncode     = true,
+            bool dither         = true) :
+            exposure(exposure),
+            curve(curve),
+            whitePoint(whitePoint),
+            srgbEncode(srgbEncode),
+            dither(dither)
+        {}
+    };
+
+    /** @brief  Tonemap a HDR image to display-ready 8-bit image
+     *  @param  src         Source image, must be of F32 data type
+     *  @param  dest        Destination image, recreated with format of the source image and U8 data type
+     *  @param  settings    Tonemapping settings
+     *  @note   Exposure, curve, sRGB encoding, dithering and quantization are fused into a single
+     *          SIMD pass over the image, rows are processed in parallel
+     *  @note   Alpha channel is only clamped and quantized
+     *  @note   src and dest must not be the same object
+     */
+    void tonemap(const Image& src, Image& dest, const TonemapSettings& settings = TonemapSettings());
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_TONEMAP_HPP
@@ -12,6 +12,7 @@
 #define GRAPHICSUTILS_GLTFLOADER_HPP
 
 
+#include <memory_resource>
 #include <string>
 
 #include <gut_utils/MathTypes.hpp>
@@ -29,13 +30,17 @@ class VertexData;
 
 class GLTFLoader {
 public:
-    GLTFLoader() = default;
+    // Vertex data of the mesh primitives is allocated from resource when given (see
+    // VertexData::allocateData), e.g. an arena released after constructObjects()
+    explicit GLTFLoader(std::pmr::memory_resource* resource = nullptr);
 
     // Deserialize from files
     void loadFromFile(const std::string& filename);
 
     // Construct objects from deserialized data and place them into containers provided
-    void constructObjects(gut::Node& root, Vector<gut::Mesh>& meshes);
+    // With batch set, mesh primitives with compatible vertex data are merged into one
+    // gut::Mesh (see mergeVertexData) and the nodes render them as its sub-meshes
+    void constructObjects(gut::Node& root, Vector<gut::Mesh>& meshes, bool batch = false);
 
 private:
     struct BufferView {
@@ -85,6 +90,9 @@ private:
     Vector<Scene>           _scenes;
 
     Vector<Vector<size_t>>  _meshPrimitiveFlattenedIds; // mesh primitives are turned into gut::Meshes, so their ID's need to be flattened
+    Vector<Vector<int64_t>> _meshPrimitiveSubMeshIds; // sub-mesh ids of the primitives in batched gut::Meshes, -1 when not batched
+
+    std::pmr::memory_resource*  _resource; // resource for the vertex data, nullptr for owned vectors
 
     // clear internal state
     void clear();
@@ -13,14 +13,24 @@
 
 
 #include "gut_utils/MathTypes.hpp"
+#include "gut_utils/TypeUtils.hpp"
+#include "gut_utils/Bounds.hpp"
+#include "gut_utils/VertexLayout.hpp"
+#include "gut_utils/MeshBatching.hpp"
 #include <glad/glad.h>
 
+#include <array>
+#include <functional>
+#include <string_view>
+#include <utility>
+
 
 namespace gut {
 
     class Shader;
     class Camera;
     class VertexData;
+    struct PackedVertexBuffer;
 
 
     class Mesh {
@@ -33,8 +43,37 @@ namespace gut {
         Mesh& operator=(const Mesh& other) = delete;
         Mesh& operator=(Mesh&& other) noexcept;
 
-        // Load from VertexData
-        void loadFromVertexData(const VertexData& vertexData);
+        // Load from VertexData, interleaved data is uploaded into a single vertex buffer
+        // instead of one buffer per attribute. The attributes are interleaved directly into
+        // the mapped vertex buffer, external (memory-mapped) data is not copied on the CPU
+        // side in either case. Quantized data (see QuantizeVertexData.hpp)
+        // is uploaded as is: positionTransform maps the position data to object space
+        // (dequantization transform of 16-bit positions), octahedral normals are decoded
+        // in shaders having bool uniform octahedralNormals
+        void loadFromVertexData(const VertexData& vertexData, bool interleaved = true,
+                                const Mat4f& positionTransform = Mat4f::Identity());
+
+        // Load from an interleaved vertex buffer (see packVertexData). Attributes position,
+        // normal, texCoord and color are bound to locations 0, 1, 2 and 3, others are ignored.
+        // Indices are uploaded in the narrowest type holding the maximum index
+        void loadFromPackedVertexBuffer(const PackedVertexBuffer& vertexBuffer,
+                                        const Vector<unsigned>& indices,
+                                        const Mat4f& positionTransform = Mat4f::Identity());
+
+        // Load from a compile-time vertex layout, attribute locations and offsets are resolved
+        // at compile time. Attributes position, normal, texCoord and color are bound to
+        // locations 0, 1, 2 and 3, others are ignored.
+        template <typename... T_Attributes>
+        void loadFromVertexLayout(const VertexLayout<T_Attributes...>& layout,
+                                  const Mat4f& positionTransform = Mat4f::Identity());
+
+        // Object space bounds of the mesh (positions mapped with positionTransform), retained
+        // after upload for culling
+        const Bounds& getBounds() const noexcept;
+
+        // Transform mapping the uploaded positions to object space (e.g. dequantization of
+        // quantized positions), Identity for positions uploaded as is
+        const Mat4f& getPositionTransform() const noexcept;
 
         // Render the mesh
         void render(Shader& shader,
@@ -42,26 +81,99 @@ namespace gut {
                     const Mat4f& orientation = Mat4f::Identity(),
                     GLenum mode = GL_TRIANGLES) const;
 
-        // Render the mesh without camera or orientation
+        // Render the mesh without camera or orientation, the caller sets the transform uniforms
+        // (objectToWorld has to include getPositionTransform())
         void render(Shader& shader, GLenum mode = GL_TRIANGLES) const;
 
+        // Set ranges of the uploaded data drawable separately, e.g. the meshes merged with
+        // mergeVertexData. Sub-meshes share the vertex array object and the buffers.
+        void setSubMeshes(const Vector<SubMesh>& subMeshes);
+
+        // Access the sub-mesh ranges
+        const Vector<SubMesh>& getSubMeshes() const noexcept;
+
+        // Render a sub-mesh
+        void renderSubMesh(size_t subMeshId,
+                           Shader& shader,
+                           const Camera& camera,
+                           const Mat4f& orientation = Mat4f::Identity(),
+                           GLenum mode = GL_TRIANGLES) const;
+
+        // Render (sub-mesh id, orientation) pairs, the vertex array object is bound once
+        void renderSubMeshes(const Vector<std::pair<size_t, Mat4f>>& instances,
+                             Shader& shader,
+                             const Camera& camera,
+                             GLenum mode = GL_TRIANGLES) const;
+
     private:
+        // Interleaved vertex attribute binding
+        struct AttributeBinding {
+            int             location;   // -1 for attributes not bound by Mesh
+            MathTypeEnum    type;
+            uint32_t        offset;
+        };
+
+        // Locations of the optional uniforms in the last shader used for rendering
+        struct UniformLocations {
+            GLuint          programId           = 0;
+            GLint           octahedralNormals   = -1;
+        };
+
         GLuint      _vertexArrayObjectId;
         GLuint      _positionBufferId;
         GLuint      _normalBufferId;
         GLuint      _texCoordBufferId;
         GLuint      _colorBufferId;
+        GLuint      _vertexBufferId;
         GLuint      _elementBufferId;
 
         uint64_t    _nIndices;
+        GLenum      _indexType; // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
         bool        _usingNormals;
         bool        _usingTexCoords;
         bool        _usingColors;
+        bool        _octahedralNormals;
+        Mat4f       _positionTransform;
+        Bounds      _bounds;
+        Vector<SubMesh> _subMeshes;
+        mutable UniformLocations _uniformLocations;
+
+        // Vertex attribute location for an attribute name, -1 for attributes not bound by Mesh
+        static constexpr int attributeLocation(std::string_view name) noexcept;
+
+        // Upload interleaved vertex data with the attribute bindings, index type and bounds of
+        // Vec3f positions are determined from the data
+        void loadInterleaved(const uint8_t* data, int64_t nVertices, uint32_t stride,
+                             const AttributeBinding* bindings, int nBindings,
+                             const Vector<unsigned>& indices, const Mat4f& positionTransform);
+
+        // Same as above but with index type and position bounds known (e.g. by VertexData::validate).
+        // In case data is nullptr, writeVertices writes the vertices to the mapped vertex buffer.
+        void loadInterleaved(const uint8_t* data, int64_t nVertices, uint32_t stride,
+                             const AttributeBinding* bindings, int nBindings,
+                             const Vector<unsigned>& indices, VertexData::IndexType indexType,
+                             const Bounds& positionBounds, const Mat4f& positionTransform,
+                             const std::function<void(void*)>& writeVertices = nullptr);
+
+        // Attribute bindings of an interleaved vertex buffer in location order
+        static int packedBindings(const PackedVertexBuffer& vertexBuffer, AttributeBinding* bindings);
+
+        // Uniform locations of the shader, looked up again only when the shader changes
+        const UniformLocations& uniformLocations(const Shader& shader) const;
+
+        // Set the shader uniforms for rendering with camera and orientation
+        void setUniforms(Shader& shader, const Camera& camera, const Mat4f& orientation) const;
+
+        // Draw a sub-mesh with the vertex array object bound
+        void drawSubMesh(const SubMesh& subMesh, GLenum mode) const;
 
         // Function for releasing the OpenGL handles
         void reset();
     };
 
+
+    #include "Mesh.inl"
+
 } // namespace gut
 
 
@@ -0,0 +1,36 @@
+//
+// Project: GraphicsUtils
+// File: Mesh.inl
+//
+// Copyright (c) 2019 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+
+template <typename... T_Attributes>
+void Mesh::loadFromVertexLayout(const VertexLayout<T_Attributes...>& layout, const Mat4f& positionTransform)
+{
+    using Layout = VertexLayout<T_Attributes...>;
+    static_assert(Layout::attributeIndex("position") >= 0, "VertexLayout has no position attribute");
+
+    static constexpr std::array<AttributeBinding, Layout::nAttributes> bindings {
+        AttributeBinding{
+            attributeLocation(T_Attributes::name),
+            T_Attributes::typeEnum,
+            (uint32_t)Layout::offsets[Layout::attributeIndex(T_Attributes::name)] }...
+    };
+
+    loadInterleaved(layout.data(), layout.size(), Layout::stride, bindings.data(), Layout::nAttributes,
+        layout.indices(), positionTransform);
+}
+
+constexpr int Mesh::attributeLocation(std::string_view name) noexcept
+{
+    constexpr std::string_view names[] = { "position", "normal", "texCoord", "color" };
+    for (int i=0; i<4; ++i)
+        if (names[i] == name)
+            return i;
+    return -1;
+}
@@ -15,6 +15,8 @@
 #include <gut_utils/TypeUtils.hpp>
 #include <gut_utils/MathTypes.hpp>
 
+#include <utility>
+
 
 namespace gut {
 
@@ -31,11 +33,17 @@ public:
     // TODO refactor shader into material, and material into mesh primitive
     void render(const Mat4f& tParent, const Vector<Mesh>& meshes, Shader& shader, const Camera& camera) const;
 
+    // Append (mesh id, object-to-world transformation) pairs of the subtree, e.g. for ray query instances.
+    // Sub-mesh ids of the instances (-1 for whole meshes) are appended to subMeshIds when given.
+    void collectMeshInstances(const Mat4f& tParent, Vector<std::pair<size_t, Mat4f>>& instances,
+        Vector<int64_t>* subMeshIds = nullptr) const;
+
     friend class GLTFLoader;
 
 private:
     Mat4f           _t; // transformation relative to parent node
     Vector<size_t>  _meshIds;
+    Vector<int64_t> _subMeshIds; // sub-mesh of each mesh id (see Mesh::setSubMeshes), -1 for the whole mesh
     Vector<Node>    _children;
 };
 
@@ -44,6 +44,9 @@ namespace gut {
 
         void use() const;
 
+        // OpenGL program id, unique to the loaded program
+        GLuint id() const noexcept;
+
         /** @brief  Set uniform variable using name
          *  @tparam T_Uniform   Uniform type
          *  @param  name        Uniform name
@@ -108,10 +108,12 @@ namespace gut {
         void updateFromBuffer(const T_Data* buffer, GLenum format, int width=-1, int height=-1);
 
         /** @brief  Read the texture from the GPU and copy it to an image
-         *  @param  image   Target Image object
-         *  @param  level   Level of texture to copy
+         *  @param  image           Target Image object
+         *  @param  level           Level of texture to copy
+         *  @param  flipVertically  Flip the image in place after readback, so that the first
+         *                          row of the image is the top row of the texture
          */
-        void copyToImage(Image& image, GLint level = 0) const;
+        void copyToImage(Image& image, GLint level = 0, bool flipVertically = false) const;
 
         /** @brief  Initiate pixel transfer from GPU via PBO for mapToImage(). Non-blocking operation.
          */
@@ -16,6 +16,7 @@ namespace gut {
 
     int testOpenGL();
     int testImage();
+    int testUtils();
 
 } // namespace gut
 
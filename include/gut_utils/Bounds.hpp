@@ -0,0 +1,61 @@
+//
+// Project: GraphicsUtils
+// File: Bounds.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_BOUNDS_HPP
+#define GRAPHICSUTILS_BOUNDS_HPP
+
+
+#include "MathTypes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace gut {
+
+    /** @brief  Axis-aligned bounding box and bounding sphere of a point set
+     */
+    struct Bounds {
+        Vec3f   minimum;
+        Vec3f   maximum;
+        Vec4f   sphere; // xyz: center, w: radius
+
+        /** @brief  Construct empty bounds (minimum > maximum, negative radius)
+         */
+        Bounds();
+
+        /** @brief  Check whether the bounds contain no points
+         */
+        bool empty() const noexcept;
+    };
+
+    /** @brief  Compute bounds of positions
+     *  @param  positions   Pointer to the first position
+     *  @param  n           Number of positions
+     *  @param  stride      Distance between consecutive positions in bytes
+     *  @return Bounds of the positions, empty for n <= 0
+     *  @note   The bounding box is computed in parallel with SSE min/max over blocks of four
+     *          positions transposed to SoA. The sphere is the smaller of Ritter's sphere and
+     *          the sphere centered at the bounding box center.
+     */
+    Bounds computeBounds(const Vec3f* positions, int64_t n, size_t stride = sizeof(Vec3f));
+
+    /** @brief  Transform bounds with an affine transformation
+     *  @param  bounds      Bounds to transform
+     *  @param  transform   Affine transformation
+     *  @return Bounds enclosing the transformed bounds (box of the transformed box corners,
+     *          sphere radius scaled by the largest axis scale)
+     */
+    Bounds transformBounds(const Bounds& bounds, const Mat4f& transform);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_BOUNDS_HPP
@@ -0,0 +1,122 @@
+//
+// Project: GraphicsUtils
+// File: Bvh.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_BVH_HPP
+#define GRAPHICSUTILS_BVH_HPP
+
+
+#include "MathTypes.hpp"
+#include "TypeUtils.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  32-byte BVH node
+     *  @note   Nodes are stored depth-first: the left child of an interior node follows it
+     *          directly and offset skips the whole subtree (the right child is the node after
+     *          the left subtree). Traversal continues at index+1 after a hit and at the skip
+     *          index after a miss, leaves always continue at index+1.
+     */
+    struct BvhNode {
+        Vec3f       minimum;
+        uint32_t    offset; ///< Interior: index of the node after the subtree, leaf: first triangle in Bvh::triangles
+        Vec3f       maximum;
+        uint32_t    count;  ///< Number of triangles in a leaf, 0 for interior nodes
+
+        bool isLeaf() const noexcept { return count > 0; }
+    };
+
+    static_assert(sizeof(BvhNode) == 32, "BvhNode is expected to be 32 bytes");
+
+    /** @brief  Bounding volume hierarchy over the triangles of a mesh
+     */
+    struct Bvh {
+        Vector<BvhNode>     nodes;      ///< Depth-first node array, root at index 0
+        Vector<unsigned>    triangles;  ///< Triangle ids (first index / 3) in leaf order
+    };
+
+    /** @brief  BVH building settings struct
+     */
+    struct BvhSettings {
+        int     nBins;              ///< Number of SAH bins per axis
+        int     maxLeafSize;        ///< Largest leaf the SAH may choose, larger ranges are always split
+        float   traversalCost;      ///< SAH cost of traversing an interior node
+        float   intersectionCost;   ///< SAH cost of intersecting a triangle
+
+        explicit BvhSettings(
+            int     nBins               = 16,
+            int     maxLeafSize         = 8,
+            float   traversalCost       = 1.0f,
+            float   intersectionCost    = 1.0f) :
+            nBins               (nBins),
+            maxLeafSize         (maxLeafSize),
+            traversalCost       (traversalCost),
+            intersectionCost    (intersectionCost)
+        {}
+    };
+
+    /** @brief  BVH statistics
+     */
+    struct BvhStatistics {
+        int64_t nNodes;
+        int64_t nLeaves;
+        int     maxDepth;           ///< Depth of the deepest leaf (root has depth 0)
+        int     maxLeafSize;
+        float   averageLeafSize;
+        float   sahCost;            ///< SAH cost relative to the root area
+        double  buildTime;          ///< Build time in seconds, 0 when not built by buildBvh()
+
+        BvhStatistics() :
+            nNodes          (0),
+            nLeaves         (0),
+            maxDepth        (0),
+            maxLeafSize     (0),
+            averageLeafSize (0.0f),
+            sahCost         (0.0f),
+            buildTime       (0.0)
+        {}
+    };
+
+    /** @brief  Build a BVH over the triangles of a mesh with binned SAH
+     *  @param  vertexData  Valid vertex data with Vec3f "position" container
+     *  @param  bvh         BVH to write to
+     *  @param  settings    BVH settings
+     *  @param  statistics  Optional output for statistics of the built BVH
+     *  @return Flag indicating whether the building succeeded
+     *  @note   The top of the tree is split with parallel binning until there are enough
+     *          subtrees for the worker threads, the subtrees are then built in parallel.
+     *          The result does not depend on the number of threads.
+     */
+    bool buildBvh(const VertexData& vertexData, Bvh& bvh, const BvhSettings& settings = BvhSettings(),
+        BvhStatistics* statistics = nullptr);
+
+    /** @brief  Update node bounds after the positions have changed, keeping the topology
+     *  @param  vertexData  Vertex data the BVH was built from, with modified positions
+     *  @param  bvh         BVH to refit
+     *  @return Flag indicating whether the refitting succeeded
+     *  @note   Tree quality degrades with large deformations, rebuild in such case
+     */
+    bool refitBvh(const VertexData& vertexData, Bvh& bvh);
+
+    /** @brief  Compute statistics of a BVH
+     *  @param  bvh         BVH
+     *  @param  settings    Settings providing the SAH costs
+     *  @return BVH statistics (buildTime is 0)
+     */
+    BvhStatistics computeBvhStatistics(const Bvh& bvh, const BvhSettings& settings = BvhSettings());
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_BVH_HPP
@@ -0,0 +1,131 @@
+//
+// Project: GraphicsUtils
+// File: Deduplicate.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_DEDUPLICATE_HPP
+#define GRAPHICSUTILS_DEDUPLICATE_HPP
+
+
+#include "TypeUtils.hpp"
+#include "ParallelFor.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    /** @brief  Find unique elements of a range using open-addressing hash tables
+     *  @param  n       Number of elements
+     *  @param  hash    Function with signature uint64_t(int64_t i), returns hash of element i
+     *  @param  equal   Function with signature bool(int64_t i, int64_t j), compares elements i and j
+     *  @param  remap   Output: unique id of each element, ids are assigned in order of first occurrence
+     *  @param  unique  Output: first element of each unique id
+     *  @return Number of unique elements
+     *  @note   The hash space is partitioned between threads, each partition having its own
+     *          table, so the result is identical regardless of the number of threads
+     */
+    template <typename T_Hash, typename T_Equal>
+    int64_t deduplicate(int64_t n, const T_Hash& hash, const T_Equal& equal,
+        Vector<unsigned>& remap, Vector<unsigned>& unique);
+
+
+    template <typename T_Hash, typename T_Equal>
+    int64_t deduplicate(int64_t n, const T_Hash& hash, const T_Equal& equal,
+        Vector<unsigned>& remap, Vector<unsigned>& unique)
+    {
+        constexpr unsigned empty = 0xFFFFFFFFu;
+
+        remap.resize(n);
+        unique.clear();
+        if (n <= 0)
+            return 0;
+
+        Vector<uint64_t> hashes(n);
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                hashes[i] = hash(i);
+        }, 16384);
+
+        // Index of the first equal element for every element, partitions are selected
+        // with high bits of the hash and table slots with low bits
+        Vector<unsigned> first(n);
+        int nPartitions = parallelForBlocks(n, 65536);
+        parallelFor(0, nPartitions, [&](int64_t partitionBegin, int64_t partitionEnd, int) {
+            for (int64_t partition=partitionBegin; partition<partitionEnd; ++partition) {
+                auto inPartition = [&](int64_t i) {
+                    return (int64_t)((hashes[i] >> 32)*nPartitions >> 32) == partition;
+                };
+
+                int64_t m = 0;
+                for (int64_t i=0; i<n; ++i)
+                    m += inPartition(i);
+
+                uint64_t capacity = 16;
+                while (capacity < (uint64_t)m*2)
+                    capacity *= 2;
+                const uint64_t mask = capacity-1;
+                Vector<unsigned> table(capacity, empty);
+
+                for (int64_t i=0; i<n; ++i) {
+                    if (!inPartition(i))
+                        continue;
+
+                    for (uint64_t slot = hashes[i] & mask;; slot = (slot+1) & mask) {
+                        unsigned e = table[slot];
+                        if (e == empty) {
+                            table[slot] = (unsigned)i;
+                            first[i] = (unsigned)i;
+                            break;
+                        }
+                        if (hashes[e] == hashes[i] && equal(e, i)) {
+                            first[i] = e;
+                            break;
+                        }
+                    }
+                }
+            }
+        }, 1);
+
+        // Dense ids in order of first occurrence, block-wise prefix sum
+        int nBlocks = parallelForBlocks(n, 65536);
+        Vector<int64_t> blockCounts(nBlocks+1, 0);
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int blockId) {
+            int64_t count = 0;
+            for (int64_t i=begin; i<end; ++i)
+                count += first[i] == (unsigned)i;
+            blockCounts[blockId+1] = count;
+        }, 65536);
+        for (int i=0; i<nBlocks; ++i)
+            blockCounts[i+1] += blockCounts[i];
+
+        int64_t nUnique = blockCounts[nBlocks];
+        unique.resize(nUnique);
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int blockId) {
+            int64_t id = blockCounts[blockId];
+            for (int64_t i=begin; i<end; ++i) {
+                if (first[i] == (unsigned)i) {
+                    remap[i] = (unsigned)id;
+                    unique[id++] = (unsigned)i;
+                }
+            }
+        }, 65536);
+
+        // First occurrences precede the duplicates, their ids are all assigned above
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                remap[i] = remap[first[i]];
+        }, 65536);
+
+        return nUnique;
+    }
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_DEDUPLICATE_HPP
@@ -0,0 +1,85 @@
+//
+// Project: GraphicsUtils
+// File: HalfEdgeMesh.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_HALFEDGEMESH_HPP
+#define GRAPHICSUTILS_HALFEDGEMESH_HPP
+
+
+#include "TypeUtils.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Array-based half-edge structure of a triangle mesh
+     *  @note   Half-edge h = 3t+k is the edge of triangle t from its corner k to corner (k+1)%3,
+     *          so the triangle, next and previous half-edges are implicit. Edges shared by
+     *          exactly two triangles of opposite orientation are manifold and their half-edges
+     *          are twins. Edges of one triangle are borders, others (shared by more than two
+     *          triangles, by two of the same orientation, or degenerate) are non-manifold, and
+     *          both have no twins.
+     */
+    struct HalfEdgeMesh {
+        static constexpr unsigned none = 0xFFFFFFFFu;
+
+        Vector<unsigned>    vertices;           ///< Origin vertex of each half-edge (mesh indices)
+        Vector<unsigned>    twins;              ///< Opposite half-edge of each half-edge, none if there is no twin
+        Vector<unsigned>    vertexHalfEdges;    ///< Outgoing half-edge of each vertex, one without a twin
+                                                ///< if there is such, none for unreferenced vertices
+        Vector<unsigned>    nonManifoldEdges;   ///< Lowest half-edge of each non-manifold edge
+        int64_t             nBorderEdges;
+
+        HalfEdgeMesh() :
+            nBorderEdges    (0)
+        {}
+
+        static unsigned triangle(unsigned h) noexcept { return h / 3; }
+        static unsigned next(unsigned h) noexcept { return h%3 == 2 ? h-2 : h+1; }
+        static unsigned prev(unsigned h) noexcept { return h%3 == 0 ? h+2 : h-1; }
+
+        unsigned twin(unsigned h) const noexcept { return twins[h]; }
+        unsigned from(unsigned h) const noexcept { return vertices[h]; }
+        unsigned to(unsigned h) const noexcept { return vertices[next(h)]; }
+
+        // Triangle across half-edge h, none if there is no twin
+        unsigned adjacentTriangle(unsigned h) const noexcept
+        {
+            return twins[h] == none ? none : twins[h] / 3;
+        }
+
+        // Next outgoing half-edge of vertex from(h) in the order of the triangle winding, none
+        // past a border. Starting from vertexHalfEdges[v] visits the whole fan of a manifold vertex.
+        unsigned nextOutgoing(unsigned h) const noexcept
+        {
+            return twins[prev(h)];
+        }
+
+        int64_t nHalfEdges() const noexcept { return vertices.size(); }
+        int64_t nTriangles() const noexcept { return vertices.size() / 3; }
+    };
+
+    /** @brief  Build the half-edge structure of a triangle mesh
+     *  @param  vertexData      Valid vertex data, indices of a triangle list
+     *  @param  halfEdgeMesh    Half-edge mesh to write to
+     *  @return Flag indicating whether the building succeeded
+     *  @note   Half-edges are matched by radix sorting their undirected edge keys in parallel,
+     *          with the lower vertex as a single digit (a counting sort into per-vertex buckets),
+     *          the buckets are then sorted by the higher vertex. The result is identical
+     *          regardless of the number of threads.
+     */
+    bool buildHalfEdgeMesh(const VertexData& vertexData, HalfEdgeMesh& halfEdgeMesh);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_HALFEDGEMESH_HPP
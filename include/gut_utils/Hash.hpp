@@ -0,0 +1,103 @@
+//
+// Project: GraphicsUtils
+// File: Hash.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_HASH_HPP
+#define GRAPHICSUTILS_HASH_HPP
+
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace gut {
+
+    /** @brief  128-bit hash value
+     */
+    struct Hash128 {
+        uint64_t    low;
+        uint64_t    high;
+
+        bool operator==(const Hash128& other) const noexcept { return low == other.low && high == other.high; }
+        bool operator!=(const Hash128& other) const noexcept { return !(*this == other); }
+    };
+
+    /** @brief  Streaming non-cryptographic hash for bulk data
+     *  @note   Data is consumed in 64-byte stripes by 8 independent 64-bit accumulators using
+     *          32x32->64 bit multiplies, which map directly to SSE2/AVX2 instructions.
+     *  @note   Hash of data fed in several update() calls equals hash of the concatenated data.
+     *  @note   Hash values are stable across runs and platforms with same endianness (little-endian).
+     */
+    class Hasher {
+    public:
+        /** @brief  Construct a Hasher object
+         *  @param  seed    Seed value, different seeds produce independent hashes
+         */
+        explicit Hasher(uint64_t seed = 0);
+
+        /** @brief  Reset the hasher state
+         *  @param  seed    Seed value
+         */
+        void reset(uint64_t seed = 0);
+
+        /** @brief  Feed data to the hasher
+         *  @param  data    Pointer to the data
+         *  @param  size    Size of the data in bytes
+         */
+        void update(const void* data, size_t size);
+
+        /** @brief  Feed a trivially copyable value to the hasher
+         *  @param  value   Value to be hashed, hashed as its object representation
+         */
+        template <typename T_Value>
+        void updateValue(const T_Value& value);
+
+        /** @brief  Get 64-bit hash of the data fed so far
+         *  @note   Does not modify the state, more data can be fed afterwards
+         */
+        uint64_t digest64() const;
+
+        /** @brief  Get 128-bit hash of the data fed so far
+         *  @note   Does not modify the state, more data can be fed afterwards
+         */
+        Hash128 digest128() const;
+
+        static constexpr size_t stripeSize = 64; // bytes consumed by the accumulators at once
+        static constexpr size_t blockSize = 16; // stripes between accumulator scrambles
+
+    private:
+        uint64_t    _acc[8];
+        uint8_t     _buffer[stripeSize];
+        size_t      _bufferSize;
+        size_t      _nStripes; // stripes consumed in the current block
+        uint64_t    _totalSize;
+        uint64_t    _seed;
+
+        // Merge accumulators and the (scrambled) total size into a 64-bit value
+        static uint64_t merge(const uint64_t (&acc)[8], uint64_t sizeTerm, uint64_t seed, int keyOffset);
+        // Consume the buffered tail into a copy of the accumulators
+        void finalAccumulators(uint64_t (&acc)[8]) const;
+    };
+
+    /** @brief  Hash data in one call
+     */
+    uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+    Hash128 hash128(const void* data, size_t size, uint64_t seed = 0);
+
+
+    template <typename T_Value>
+    void Hasher::updateValue(const T_Value& value)
+    {
+        update(&value, sizeof(T_Value));
+    }
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_HASH_HPP
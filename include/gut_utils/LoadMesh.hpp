@@ -12,6 +12,7 @@
 #define GRAPHICSUTILS_LOADMESH_HPP
 
 
+#include <memory_resource>
 #include <string>
 
 
@@ -20,7 +21,30 @@ namespace gut {
     class VertexData;
 
     // Load mesh from .obj file to VertexData
-    void loadMeshFromOBJ(const std::string& fileName, VertexData& vertexData);
+    // Parsing scratch lives in a per-load monotonic arena freed in one shot at return. With
+    // resource given, the arena allocates from it and the vertex data is allocated from it as
+    // well (see VertexData::allocateData), otherwise the vertex data is stored in owned vectors.
+    // The resource is allocated from by the worker threads and has to be thread-safe.
+    void loadMeshFromOBJ(const std::string& fileName, VertexData& vertexData,
+        std::pmr::memory_resource* resource = nullptr);
+
+    // Load mesh from .ply file (ASCII, binary little or big endian) to VertexData
+    // Vertex properties x/y/z, nx/ny/nz, u/v (or s/t) and red/green/blue are stored to
+    // containers position, normal, texCoord and color, integer colors normalized to [0, 1].
+    // Faces are triangulated as fans, point clouds without faces get one index per vertex.
+    // Binary vertex records consisting only of float x, y, z (or another single attribute) in
+    // the native byte order and starting at a 4-byte aligned offset (writers may pad the header
+    // with a comment) are not copied: the container references the memory-mapped file (see
+    // VertexData::addExternalData). Other data is converted in parallel, foreign byte order
+    // swapped with SIMD, and allocated from resource when given.
+    void loadMeshFromPLY(const std::string& fileName, VertexData& vertexData,
+        std::pmr::memory_resource* resource = nullptr);
+
+    // Load mesh from binary .stl file to VertexData
+    // Each triangle gets its own vertices with the facet normal (computed from the vertices
+    // when zero) in containers position and normal, use weldVertices to merge them.
+    void loadMeshFromSTL(const std::string& fileName, VertexData& vertexData,
+        std::pmr::memory_resource* resource = nullptr);
 
 } //namespace gut
 
@@ -0,0 +1,76 @@
+//
+// Project: GraphicsUtils
+// File: MappedFile.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MAPPEDFILE_HPP
+#define GRAPHICSUTILS_MAPPEDFILE_HPP
+
+
+#include <string>
+#include <cstddef>
+
+
+namespace gut {
+
+    /** @brief  Read-only memory-mapped file
+     *  @note   Mapping is released when the object is destroyed
+     */
+    class MappedFile {
+    public:
+        MappedFile();
+
+        /** @brief  Construct a MappedFile object and map a file
+         *  @param  fileName    Name of the file to map, use isOpen() to check for success
+         */
+        explicit MappedFile(const std::string& fileName);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        /** @brief  Map a file, closes the previously mapped file
+         *  @param  fileName    Name of the file to map
+         *  @return Flag indicating whether the mapping succeeded
+         */
+        bool open(const std::string& fileName);
+
+        /** @brief  Release the mapping
+         */
+        void close();
+
+        /** @brief  Check whether a file is mapped
+         */
+        bool isOpen() const noexcept;
+
+        /** @brief  Access the mapped bytes
+         *  @return Pointer to the file contents, nullptr for empty files
+         */
+        const char* data() const noexcept;
+
+        /** @brief  Get size of the mapped file
+         *  @return Size of the file in bytes
+         */
+        size_t size() const noexcept;
+
+    private:
+        const char* _data;
+        size_t      _size;
+        bool        _open;
+#ifdef _WIN32
+        void*       _fileHandle;
+        void*       _mappingHandle;
+#endif
+    };
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MAPPEDFILE_HPP
@@ -25,6 +25,7 @@ template <> struct MathTypeReflection<TYPE> {                                \
 
 namespace gut {
 
+    // New types are appended, the values are stored in .gutmesh files
     enum class MathTypeEnum {
         FLOAT,
         DOUBLE,
@@ -47,7 +48,11 @@ namespace gut {
         MAT3I,
         MAT4I,
         QUATF,
-        QUATD
+        QUATD,
+        VEC2B,
+        VEC2S,
+        VEC4US,
+        VEC2H
     };
 
     template <typename T_Matrix>
@@ -77,6 +82,63 @@ namespace gut {
     GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Mat4i, MathTypeEnum::MAT4I, "");
     GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Quatf, MathTypeEnum::QUATF, "");
     GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Quatd, MathTypeEnum::QUATD, "");
+    GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Vec2b, MathTypeEnum::VEC2B, "");
+    GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Vec2s, MathTypeEnum::VEC2S, "");
+    GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Vec4us, MathTypeEnum::VEC4US, "");
+    GRAPHICSUTILS_MATHTYPEREFLECTION_REFLECTION(Vec2h, MathTypeEnum::VEC2H, "");
+
+    // Scalar type of a math type (float for Vec3f etc.)
+    template <typename T_Matrix>
+    struct MathTypeScalar {
+        using type = typename T_Matrix::Scalar;
+    };
+
+    template <>
+    struct MathTypeScalar<float> {
+        using type = float;
+    };
+
+    template <>
+    struct MathTypeScalar<double> {
+        using type = double;
+    };
+
+    // Call function f with a null pointer of the type corresponding to the type enum
+    // (for type-aware processing of type-erased data)
+    template <typename T_Function>
+    inline decltype(auto) dispatchMathType(MathTypeEnum type, T_Function&& f)
+    {
+        switch (type) {
+            case MathTypeEnum::FLOAT:   return f(static_cast<float*>(nullptr));
+            case MathTypeEnum::DOUBLE:  return f(static_cast<double*>(nullptr));
+            case MathTypeEnum::VEC2F:   return f(static_cast<Vec2f*>(nullptr));
+            case MathTypeEnum::VEC3F:   return f(static_cast<Vec3f*>(nullptr));
+            case MathTypeEnum::VEC4F:   return f(static_cast<Vec4f*>(nullptr));
+            case MathTypeEnum::MAT2F:   return f(static_cast<Mat2f*>(nullptr));
+            case MathTypeEnum::MAT3F:   return f(static_cast<Mat3f*>(nullptr));
+            case MathTypeEnum::MAT4F:   return f(static_cast<Mat4f*>(nullptr));
+            case MathTypeEnum::VEC2D:   return f(static_cast<Vec2d*>(nullptr));
+            case MathTypeEnum::VEC3D:   return f(static_cast<Vec3d*>(nullptr));
+            case MathTypeEnum::VEC4D:   return f(static_cast<Vec4d*>(nullptr));
+            case MathTypeEnum::MAT2D:   return f(static_cast<Mat2d*>(nullptr));
+            case MathTypeEnum::MAT3D:   return f(static_cast<Mat3d*>(nullptr));
+            case MathTypeEnum::MAT4D:   return f(static_cast<Mat4d*>(nullptr));
+            case MathTypeEnum::VEC2I:   return f(static_cast<Vec2i*>(nullptr));
+            case MathTypeEnum::VEC3I:   return f(static_cast<Vec3i*>(nullptr));
+            case MathTypeEnum::VEC4I:   return f(static_cast<Vec4i*>(nullptr));
+            case MathTypeEnum::MAT2I:   return f(static_cast<Mat2i*>(nullptr));
+            case MathTypeEnum::MAT3I:   return f(static_cast<Mat3i*>(nullptr));
+            case MathTypeEnum::MAT4I:   return f(static_cast<Mat4i*>(nullptr));
+            case MathTypeEnum::QUATF:   return f(static_cast<Quatf*>(nullptr));
+            case MathTypeEnum::QUATD:   return f(static_cast<Quatd*>(nullptr));
+            case MathTypeEnum::VEC2B:   return f(static_cast<Vec2b*>(nullptr));
+            case MathTypeEnum::VEC2S:   return f(static_cast<Vec2s*>(nullptr));
+            case MathTypeEnum::VEC4US:  return f(static_cast<Vec4us*>(nullptr));
+            case MathTypeEnum::VEC2H:   return f(static_cast<Vec2h*>(nullptr));
+        }
+
+        return f(static_cast<float*>(nullptr));
+    }
 
 } // namespace gut
 
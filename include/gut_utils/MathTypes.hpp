@@ -40,5 +40,11 @@ using Mat4i = Eigen::Matrix4i;
 using Quatf = Eigen::Quaternionf;
 using Quatd = Eigen::Quaterniond;
 
+// Compact vertex attribute storage types
+using Vec2b = Eigen::Matrix<int8_t, 2, 1>;
+using Vec2s = Eigen::Matrix<int16_t, 2, 1>;
+using Vec4us = Eigen::Matrix<uint16_t, 4, 1>;
+using Vec2h = Eigen::Matrix<Eigen::half, 2, 1>;
+
 
 #endif //GRAPHICSUTILS_MATHTYPES_HPP
@@ -0,0 +1,70 @@
+//
+// Project: GraphicsUtils
+// File: MemoryResource.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MEMORYRESOURCE_HPP
+#define GRAPHICSUTILS_MEMORYRESOURCE_HPP
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+
+
+namespace gut {
+
+    /** @brief  Memory resource counting the allocations passed to an upstream resource
+     *  @note   Counters are atomic, the resource is thread-safe when the upstream is
+     */
+    class CountingMemoryResource : public std::pmr::memory_resource {
+    public:
+        /** @brief  Construct a CountingMemoryResource object
+         *  @param  upstream    Resource the allocations are passed to
+         */
+        explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+        CountingMemoryResource(const CountingMemoryResource&) = delete;
+        CountingMemoryResource& operator=(const CountingMemoryResource&) = delete;
+
+        /** @brief  Get number of allocations since construction or resetCounters()
+         */
+        int64_t nAllocations() const noexcept;
+
+        /** @brief  Get number of deallocations since construction or resetCounters()
+         */
+        int64_t nDeallocations() const noexcept;
+
+        /** @brief  Get number of bytes currently allocated
+         */
+        int64_t allocatedBytes() const noexcept;
+
+        /** @brief  Get maximum of allocatedBytes() since construction or resetCounters()
+         */
+        int64_t peakBytes() const noexcept;
+
+        /** @brief  Reset allocation counts, peak is reset to the currently allocated bytes
+         */
+        void resetCounters() noexcept;
+
+    private:
+        std::pmr::memory_resource*  _upstream;
+        std::atomic<int64_t>        _nAllocations;
+        std::atomic<int64_t>        _nDeallocations;
+        std::atomic<int64_t>        _allocatedBytes;
+        std::atomic<int64_t>        _peakBytes;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MEMORYRESOURCE_HPP
@@ -0,0 +1,58 @@
+//
+// Project: GraphicsUtils
+// File: MeshBatching.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MESHBATCHING_HPP
+#define GRAPHICSUTILS_MESHBATCHING_HPP
+
+
+#include "TypeUtils.hpp"
+#include "Bounds.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Range of a source mesh in merged vertex data
+     */
+    struct SubMesh {
+        uint64_t    firstIndex;     ///< Offset of the first index in the merged indices
+        uint64_t    indexCount;     ///< Number of indices
+        int64_t     baseVertex;     ///< Value added to the indices when drawing, 0 for rebased indices
+        int64_t     firstVertex;    ///< Offset of the first vertex in the merged containers
+        int64_t     vertexCount;    ///< Number of vertices
+        Bounds      bounds;         ///< Bounds of the source mesh positions, e.g. for culling
+    };
+
+    /** @brief  Check whether two meshes can be merged
+     *  @return Flag indicating whether the meshes have containers of the same names and types
+     */
+    bool isBatchCompatible(const VertexData& a, const VertexData& b);
+
+    /** @brief  Merge meshes into one vertex data sharing the containers and indices
+     *  @param  sources         Valid vertex data of the meshes, compatible with each other
+     *  @param  merged          Vertex data to write the merged meshes to
+     *  @param  subMeshes       Range of each source mesh in the merged data
+     *  @param  rebaseIndices   Offset the indices by the first vertex of their mesh. Without
+     *                          rebasing the indices stay local to their mesh, which keeps the
+     *                          index type narrow, and the offset is stored in
+     *                          SubMesh::baseVertex for base vertex draws instead.
+     *  @return Flag indicating whether the merging succeeded
+     *  @note   Containers and indices are copied in parallel over the sources.
+     */
+    bool mergeVertexData(const Vector<const VertexData*>& sources, VertexData& merged,
+        Vector<SubMesh>& subMeshes, bool rebaseIndices = true);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MESHBATCHING_HPP
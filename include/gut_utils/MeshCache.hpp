@@ -0,0 +1,50 @@
+//
+// Project: GraphicsUtils
+// File: MeshCache.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MESHCACHE_HPP
+#define GRAPHICSUTILS_MESHCACHE_HPP
+
+
+#include <string>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Write vertex data to a binary .gutmesh file
+     *  @param  fileName    Name of the file to write
+     *  @param  vertexData  Vertex data to write, all data containers and indices are stored
+     *  @note   Data payloads are stored raw (little-endian) and aligned to 64 bytes
+     *  @note   The file is written to a temporary file which then replaces fileName, existing
+     *          mappings of a previous file (VertexData loaded from it) stay intact
+     */
+    void writeMeshCache(const std::string& fileName, const VertexData& vertexData);
+
+    /** @brief  Load vertex data from a .gutmesh file
+     *  @param  fileName    Name of the file to load
+     *  @param  vertexData  Empty VertexData object to load the data to
+     *  @note   The file is memory-mapped and the data containers reference the mapped bytes
+     *          directly, the mapping is released when the last container referencing it is
+     *          destroyed. Indices are copied.
+     */
+    void loadMeshFromCache(const std::string& fileName, VertexData& vertexData);
+
+    /** @brief  Load mesh from .obj file through a cache file <fileName>.gutmesh
+     *  @param  fileName    Name of the .obj file
+     *  @param  vertexData  Empty VertexData object to load the data to
+     *  @note   The cache file is (re)generated when it is missing or older than the .obj file
+     */
+    void loadMeshFromOBJCached(const std::string& fileName, VertexData& vertexData);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MESHCACHE_HPP
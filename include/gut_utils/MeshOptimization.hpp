@@ -0,0 +1,97 @@
+//
+// Project: GraphicsUtils
+// File: MeshOptimization.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MESHOPTIMIZATION_HPP
+#define GRAPHICSUTILS_MESHOPTIMIZATION_HPP
+
+
+#include "TypeUtils.hpp"
+#include "MathTypes.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Post-transform vertex cache statistics of an index buffer
+     */
+    struct VertexCacheStatistics {
+        int64_t nTransformed;   ///< Number of vertex shader invocations (cache misses)
+        double  acmr;           ///< Average cache miss ratio, transformed vertices per triangle
+        double  atvr;           ///< Average transformed vertex ratio, transformed per referenced vertex
+    };
+
+    /** @brief  Mesh optimization settings struct
+     */
+    struct MeshOptimizationSettings {
+        bool    optimizeOverdraw;   ///< Reorder triangle clusters front-to-back (requires Vec3f positions)
+        float   overdrawThreshold;  ///< Allowed ACMR increase factor for splitting clusters
+        bool    optimizeVertexFetch;///< Reorder vertices to the order of first use
+
+        explicit MeshOptimizationSettings(
+            bool optimizeOverdraw       = true,
+            float overdrawThreshold     = 1.05f,
+            bool optimizeVertexFetch    = true) :
+            optimizeOverdraw    (optimizeOverdraw),
+            overdrawThreshold   (overdrawThreshold),
+            optimizeVertexFetch (optimizeVertexFetch)
+        {}
+    };
+
+    /** @brief  Simulate a FIFO post-transform vertex cache
+     *  @param  indices     Triangle list indices
+     *  @param  nVertices   Number of vertices, all indices must be smaller
+     *  @param  cacheSize   Number of vertices in the simulated cache
+     *  @return Cache statistics
+     */
+    VertexCacheStatistics analyzeVertexCache(const Vector<unsigned>& indices, int64_t nVertices,
+        int cacheSize = 16);
+
+    /** @brief  Reorder triangles for post-transform vertex cache efficiency
+     *  @param  indices     Triangle list indices to reorder
+     *  @param  nVertices   Number of vertices, all indices must be smaller
+     *  @note   Uses Forsyth's linear-speed algorithm with a 32-entry LRU cache model,
+     *          which also performs well on smaller FIFO caches
+     */
+    void optimizeVertexCache(Vector<unsigned>& indices, int64_t nVertices);
+
+    /** @brief  Reorder triangle clusters to reduce overdraw
+     *  @param  indices     Vertex cache optimized triangle list indices to reorder
+     *  @param  positions   Vertex positions
+     *  @param  nVertices   Number of vertices, all indices must be smaller
+     *  @param  threshold   Allowed ACMR increase factor, clusters are split where the
+     *                      ACMR stays within threshold times the ACMR of the original cluster
+     *  @note   Clusters start where the vertex cache is flushed and are sorted by
+     *          occlusion potential (outward-facing clusters first), as in Tipsify
+     */
+    void optimizeOverdraw(Vector<unsigned>& indices, const Vec3f* positions, int64_t nVertices,
+        float threshold = 1.05f);
+
+    /** @brief  Reorder vertices to the order in which they are first referenced
+     *  @param  vertexData  Vertex data to reorder, all data containers and indices are updated
+     *  @return Number of referenced vertices, -1 on error
+     *  @note   Unreferenced vertices are retained after the referenced ones
+     */
+    int64_t optimizeVertexFetch(VertexData& vertexData);
+
+    /** @brief  Optimize vertex cache, overdraw and vertex fetch efficiency of a mesh
+     *  @param  vertexData  Valid vertex data to optimize
+     *  @param  settings    Optimization settings
+     *  @return Flag indicating whether the optimization succeeded
+     */
+    bool optimizeMesh(VertexData& vertexData,
+        const MeshOptimizationSettings& settings = MeshOptimizationSettings());
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MESHOPTIMIZATION_HPP
@@ -0,0 +1,88 @@
+//
+// Project: GraphicsUtils
+// File: Meshlets.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_MESHLETS_HPP
+#define GRAPHICSUTILS_MESHLETS_HPP
+
+
+#include "TypeUtils.hpp"
+#include "VertexData.hpp"
+
+#include <cstdint>
+
+
+namespace gut {
+
+    /** @brief  Meshlet ranges in MeshletData
+     */
+    struct Meshlet {
+        uint32_t    vertexOffset;   ///< Offset of the first vertex in MeshletData::vertices
+        uint32_t    triangleOffset; ///< Offset of the first triangle in MeshletData::triangles (in indices)
+        uint32_t    nVertices;
+        uint32_t    nTriangles;
+    };
+
+    /** @brief  Mesh partitioned into meshlets
+     *  @note   Per-meshlet culling data is stored in bounds, a VertexData with one element
+     *          per meshlet and one index per meshlet (0, 1, ..., n-1) so that it is valid and can
+     *          be stored along the mesh (e.g. with writeMeshCache):
+     *          - "boundingSphere"  Vec4f   center (xyz) and radius (w)
+     *          - "coneApex"        Vec3f   apex of the normal cone
+     *          - "coneAxis"        Vec4f   axis (xyz) and cutoff (w) of the normal cone
+     *          A meshlet is backfacing if
+     *          dot(normalize(coneApex - cameraPosition), coneAxis.xyz) >= coneAxis.w,
+     *          meshlets with cutoff 1 are never rejected
+     */
+    struct MeshletData {
+        Vector<Meshlet>     meshlets;
+        Vector<unsigned>    vertices;   ///< Mesh vertex indices referenced by the meshlets
+        Vector<uint8_t>     triangles;  ///< Meshlet-local vertex indices, 3 per triangle
+        VertexData          bounds;
+    };
+
+    /** @brief  Meshlet building settings struct
+     */
+    struct MeshletSettings {
+        int maxVertices;    ///< Maximum number of vertices per meshlet, at most 256
+        int maxTriangles;   ///< Maximum number of triangles per meshlet
+
+        explicit MeshletSettings(
+            int maxVertices     = 64,
+            int maxTriangles    = 124) :
+            maxVertices     (maxVertices),
+            maxTriangles    (maxTriangles)
+        {}
+    };
+
+    /** @brief  Partition a mesh into meshlets
+     *  @param  vertexData  Valid vertex data with Vec3f "position" container
+     *  @param  meshletData Meshlet data to write to
+     *  @param  settings    Meshlet settings
+     *  @return Flag indicating whether the meshlet building succeeded
+     *  @note   Meshlets are grown greedily by adding the adjacent triangle introducing the fewest
+     *          new vertices, closest to the meshlet center. New meshlets are seeded next to the
+     *          previous one. The result depends only on the input.
+     */
+    bool buildMeshlets(const VertexData& vertexData, MeshletData& meshletData,
+        const MeshletSettings& settings = MeshletSettings());
+
+    /** @brief  Partition multiple meshes into meshlets in parallel
+     *  @param  meshes      Valid vertex data of the meshes
+     *  @param  meshletData Meshlet data for each mesh
+     *  @param  settings    Meshlet settings
+     *  @return Flag indicating whether the meshlet building succeeded for all meshes
+     */
+    bool buildMeshlets(const Vector<const VertexData*>& meshes, Vector<MeshletData>& meshletData,
+        const MeshletSettings& settings = MeshletSettings());
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_MESHLETS_HPP
@@ -0,0 +1,92 @@
+//
+// Project: GraphicsUtils
+// File: ParallelFor.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_PARALLELFOR_HPP
+#define GRAPHICSUTILS_PARALLELFOR_HPP
+
+
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+namespace gut {
+
+    /** @brief  Get number of threads used by the parallel utilities
+     *  @return Number of hardware threads, at least 1
+     */
+    inline int nWorkerThreads();
+
+    /** @brief  Get number of blocks parallelFor() splits a range into
+     *  @param  n               Number of elements in the range
+     *  @param  minBlockSize    Minimum number of elements in a block
+     *  @return Number of blocks, use for allocating per-block accumulators
+     */
+    inline int parallelForBlocks(int64_t n, int64_t minBlockSize = 1);
+
+    /** @brief  Execute a function in parallel over contiguous blocks of range [begin, end)
+     *  @param  begin           First element of the range
+     *  @param  end             One past the last element of the range
+     *  @param  f               Function with signature void(int64_t blockBegin, int64_t blockEnd, int blockId)
+     *  @param  minBlockSize    Minimum number of elements in a block
+     *  @note   Block ids are in range [0, parallelForBlocks(end-begin, minBlockSize)) and ordered
+     *          in the same order as the blocks. Calling thread executes the last block.
+     */
+    template <typename T_Function>
+    void parallelFor(int64_t begin, int64_t end, const T_Function& f, int64_t minBlockSize = 1);
+
+
+    inline int nWorkerThreads()
+    {
+        static const int n = std::max(1u, std::thread::hardware_concurrency());
+        return n;
+    }
+
+    inline int parallelForBlocks(int64_t n, int64_t minBlockSize)
+    {
+        if (n <= 0)
+            return 0;
+
+        minBlockSize = std::max(minBlockSize, (int64_t)1);
+        return (int)std::min((int64_t)nWorkerThreads(), (n+minBlockSize-1) / minBlockSize);
+    }
+
+    template <typename T_Function>
+    void parallelFor(int64_t begin, int64_t end, const T_Function& f, int64_t minBlockSize)
+    {
+        int64_t n = end-begin;
+        int nBlocks = parallelForBlocks(n, minBlockSize);
+        if (nBlocks <= 0)
+            return;
+
+        if (nBlocks == 1) {
+            f(begin, end, 0);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(nBlocks-1);
+        for (int i=0; i<nBlocks-1; ++i) {
+            int64_t b = begin + n*i/nBlocks;
+            int64_t e = begin + n*(i+1)/nBlocks;
+            threads.emplace_back([&f, b, e, i](){ f(b, e, i); });
+        }
+
+        f(begin + n*(nBlocks-1)/nBlocks, end, nBlocks-1);
+
+        for (auto& t : threads)
+            t.join();
+    }
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_PARALLELFOR_HPP
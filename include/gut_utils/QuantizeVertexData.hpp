@@ -0,0 +1,66 @@
+//
+// Project: GraphicsUtils
+// File: QuantizeVertexData.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_QUANTIZEVERTEXDATA_HPP
+#define GRAPHICSUTILS_QUANTIZEVERTEXDATA_HPP
+
+
+#include "MathTypes.hpp"
+
+#include <string>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Quantize Vec3f positions to 16-bit unsigned normalized integers (Vec4us)
+     *  @param  vertexData      Vertex data to quantize
+     *  @param  dequantization  Output: transform from normalized [0, 1] positions back to
+     *                          the original space
+     *  @param  name            Name of the position container
+     *  @return Flag indicating whether the quantization succeeded
+     *  @note   The bounding box of the positions is mapped to the full 16-bit range per axis,
+     *          the fourth component is zero
+     */
+    bool quantizePositions(VertexData& vertexData, Mat4f& dequantization,
+        const std::string& name = "position");
+
+    /** @brief  Quantize Vec3f unit normals to octahedral encoding
+     *  @param  vertexData  Vertex data to quantize
+     *  @param  bits        Bits per component: 8 (Vec2b) or 16 (Vec2s), signed normalized
+     *  @param  name        Name of the normal container
+     *  @return Flag indicating whether the quantization succeeded
+     */
+    bool quantizeNormals(VertexData& vertexData, int bits = 8, const std::string& name = "normal");
+
+    /** @brief  Convert Vec2f texture coordinates to half-precision floats (Vec2h)
+     *  @param  vertexData  Vertex data to convert
+     *  @param  name        Name of the texture coordinate container
+     *  @return Flag indicating whether the conversion succeeded
+     */
+    bool quantizeTexCoords(VertexData& vertexData, const std::string& name = "texCoord");
+
+    /** @brief  Octahedral encoding of a unit vector
+     *  @param  n   Unit vector
+     *  @return Encoded vector in [-1, 1]^2
+     */
+    Vec2f octahedralEncode(const Vec3f& n);
+
+    /** @brief  Decode an octahedral-encoded vector
+     *  @param  e   Encoded vector in [-1, 1]^2
+     *  @return Unit vector
+     */
+    Vec3f octahedralDecode(const Vec2f& e);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_QUANTIZEVERTEXDATA_HPP
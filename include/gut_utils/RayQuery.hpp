@@ -0,0 +1,150 @@
+//
+// Project: GraphicsUtils
+// File: RayQuery.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_RAYQUERY_HPP
+#define GRAPHICSUTILS_RAYQUERY_HPP
+
+
+#include "Bvh.hpp"
+
+#include <cfloat>
+
+
+namespace gut {
+
+    class VertexData;
+
+    constexpr uint32_t rayNoHit = 0xFFFFFFFFu;
+    constexpr int rayPacketSize = 4;
+
+    /** @brief  Ray with parametric range [tMin, tMax]
+     *  @note   Direction does not need to be normalized, distances are in units of direction
+     */
+    struct Ray {
+        Vec3f   origin;
+        Vec3f   direction;
+        float   tMin;
+        float   tMax;
+
+        Ray(const Vec3f& origin = Vec3f::Zero(), const Vec3f& direction = Vec3f(0.0f, 0.0f, 1.0f),
+            float tMin = 0.0f, float tMax = FLT_MAX) :
+            origin      (origin),
+            direction   (direction),
+            tMin        (tMin),
+            tMax        (tMax)
+        {}
+    };
+
+    /** @brief  Ray query result
+     */
+    struct RayHit {
+        float       t;
+        float       u;          ///< Barycentric coordinate of the second triangle vertex
+        float       v;          ///< Barycentric coordinate of the third triangle vertex
+        uint32_t    triangle;   ///< Triangle id (first index / 3), rayNoHit for a miss
+        uint32_t    instance;   ///< Instance index for instance queries, 0 otherwise
+
+        RayHit() :
+            t           (FLT_MAX),
+            u           (0.0f),
+            v           (0.0f),
+            triangle    (rayNoHit),
+            instance    (0)
+        {}
+
+        bool hit() const noexcept { return triangle != rayNoHit; }
+    };
+
+    /** @brief  Mesh prepared for ray queries
+     */
+    struct RayQueryMesh {
+        Bvh             bvh;
+        Vector<float>   triangleData;   ///< Triangles in leaf order as SoA arrays: v0.x, v0.y, v0.z,
+                                        ///< e1.x, ..., e2.z (e1 = v1-v0, e2 = v2-v0), each triangleStride long
+        int64_t         triangleStride;
+
+        RayQueryMesh() :
+            triangleStride  (0)
+        {}
+    };
+
+    /** @brief  Mesh instance in a ray query scene
+     */
+    struct RayQueryInstance {
+        const RayQueryMesh* mesh;
+        Mat4f               objectToWorld;
+        Mat4f               worldToObject;
+
+        RayQueryInstance(const RayQueryMesh* mesh, const Mat4f& objectToWorld = Mat4f::Identity()) :
+            mesh            (mesh),
+            objectToWorld   (objectToWorld),
+            worldToObject   (objectToWorld.inverse())
+        {}
+    };
+
+    /** @brief  Prepare a mesh for ray queries
+     *  @param  vertexData  Valid vertex data with Vec3f "position" container
+     *  @param  mesh        Ray query mesh to write to
+     *  @param  settings    BVH settings
+     *  @return Flag indicating whether the preparation succeeded
+     */
+    bool buildRayQueryMesh(const VertexData& vertexData, RayQueryMesh& mesh,
+        const BvhSettings& settings = BvhSettings());
+
+    /** @brief  Update a ray query mesh after the positions have changed (see refitBvh)
+     *  @param  vertexData  Vertex data the mesh was built from, with modified positions
+     *  @param  mesh        Ray query mesh to update
+     *  @return Flag indicating whether the update succeeded
+     */
+    bool refitRayQueryMesh(const VertexData& vertexData, RayQueryMesh& mesh);
+
+    /** @brief  Find the closest intersection of a ray
+     *  @note   Triangles are tested four at a time with SIMD Möller-Trumbore. Both sides of the
+     *          triangles are hit.
+     */
+    RayHit intersectClosest(const RayQueryMesh& mesh, const Ray& ray);
+
+    /** @brief  Check whether a ray intersects any triangle (occlusion query)
+     */
+    bool intersectAny(const RayQueryMesh& mesh, const Ray& ray);
+
+    /** @brief  Closest intersections of a coherent packet of rays
+     *  @note   The rays traverse the BVH together, nodes and triangles are tested against all
+     *          the rays of the packet at once with SIMD
+     */
+    void intersectClosest(const RayQueryMesh& mesh, const Ray (&rays)[rayPacketSize],
+        RayHit (&hits)[rayPacketSize]);
+
+    /** @brief  Occlusion query for a coherent packet of rays
+     */
+    void intersectAny(const RayQueryMesh& mesh, const Ray (&rays)[rayPacketSize],
+        bool (&occluded)[rayPacketSize]);
+
+    /** @brief  Closest intersections of n rays in parallel, consecutive rays are traced as packets
+     */
+    void intersectClosest(const RayQueryMesh& mesh, const Ray* rays, RayHit* hits, int64_t n);
+
+    /** @brief  Occlusion queries of n rays in parallel, consecutive rays are traced as packets
+     */
+    void intersectAny(const RayQueryMesh& mesh, const Ray* rays, bool* occluded, int64_t n);
+
+    /** @brief  Find the closest intersection of a ray with mesh instances
+     *  @note   The ray is transformed to the object space of each instance
+     */
+    RayHit intersectClosest(const Vector<RayQueryInstance>& instances, const Ray& ray);
+
+    /** @brief  Check whether a ray intersects any of the mesh instances
+     */
+    bool intersectAny(const Vector<RayQueryInstance>& instances, const Ray& ray);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_RAYQUERY_HPP
@@ -0,0 +1,82 @@
+//
+// Project: GraphicsUtils
+// File: SimplifyMesh.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_SIMPLIFYMESH_HPP
+#define GRAPHICSUTILS_SIMPLIFYMESH_HPP
+
+
+#include "TypeUtils.hpp"
+
+#include <cstdint>
+#include <limits>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Mesh simplification settings struct
+     */
+    struct SimplificationSettings {
+        int64_t targetTriangles;    ///< Stop when the triangle count reaches this, 0 for no limit
+        float   targetError;        ///< Maximum approximate (quadric) error relative to the mesh extent
+        bool    lockBorders;        ///< Keep the vertices on open borders in place
+
+        explicit SimplificationSettings(
+            int64_t targetTriangles = 0,
+            float targetError       = std::numeric_limits<float>::max(),
+            bool lockBorders        = false) :
+            targetTriangles (targetTriangles),
+            targetError     (targetError),
+            lockBorders     (lockBorders)
+        {}
+    };
+
+    /** @brief  Level of detail of a mesh, indices to the vertices of the original mesh
+     */
+    struct MeshLOD {
+        Vector<unsigned>    indices;
+        float               error;  ///< Approximate (quadric) error relative to the mesh extent
+    };
+
+    /** @brief  Simplify a mesh with quadric error metric guided edge collapses
+     *  @param  vertexData  Vertex data with Vec3f "position" container
+     *  @param  indices     Triangle list indices to simplify, replaced with the simplified ones
+     *  @param  settings    Simplification settings
+     *  @return Approximate error of the simplified mesh relative to the mesh extent (square root
+     *          of the largest quadric cost of the collapses), -1 on failure
+     *  @note   The quadric error estimates the distance to the original surface, the actual
+     *          deviation can be larger
+     *  @note   Vertices are collapsed onto their neighbours (no new vertices are created)
+     *          so all levels of detail share the vertex data
+     *  @note   Attribute seams (vertices sharing a position but differing in other data)
+     *          are preserved: a seam vertex only collapses along the seam so that every
+     *          attribute variant of it has a matching variant to collapse onto
+     */
+    float simplifyMesh(const VertexData& vertexData, Vector<unsigned>& indices,
+        const SimplificationSettings& settings);
+
+    /** @brief  Generate a chain of levels of detail
+     *  @param  vertexData      Valid vertex data with Vec3f "position" container
+     *  @param  nLevels         Maximum number of levels, including the original mesh
+     *  @param  reductionFactor Triangle count of each level relative to the previous one
+     *  @param  settings        Simplification settings, targetTriangles is ignored
+     *  @return Levels of detail from the original mesh to the coarsest one, error of each
+     *          level is the sum of the errors of the simplification steps leading to it
+     *  @note   Generation stops early when a level cannot be simplified further
+     */
+    Vector<MeshLOD> generateLODs(const VertexData& vertexData, int nLevels,
+        float reductionFactor = 0.5f,
+        const SimplificationSettings& settings = SimplificationSettings());
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_SIMPLIFYMESH_HPP
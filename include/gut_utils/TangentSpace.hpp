@@ -0,0 +1,53 @@
+//
+// Project: GraphicsUtils
+// File: TangentSpace.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_TANGENTSPACE_HPP
+#define GRAPHICSUTILS_TANGENTSPACE_HPP
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Weighting of the triangle normals in vertex normal generation
+     */
+    enum class NormalWeighting {
+        AREA,       // triangle area
+        ANGLE,      // triangle corner angle
+        AREA_ANGLE  // product of the two
+    };
+
+    /** @brief  Generate smooth vertex normals from Vec3f position data
+     *  @param  vertexData  Validated vertex data, normals are added as Vec3f "normal" container
+     *                      (an existing container is replaced)
+     *  @param  weighting   Weighting of the triangle normals
+     *  @return Flag indicating whether the normals were generated
+     *  @note   Vertices with equal positions get the same normal, so texture coordinate seams
+     *          do not show as creases. Vertices without non-degenerate triangles get normal (0, 0, 1)
+     */
+    bool generateNormals(VertexData& vertexData, NormalWeighting weighting = NormalWeighting::ANGLE);
+
+    /** @brief  Generate tangents for normal mapping from "position", "normal" and "texCoord" data
+     *  @param  vertexData  Validated vertex data with Vec3f positions, Vec3f normals and Vec2f
+     *                      texture coordinates, tangents are added as Vec4f "tangent" container
+     *                      (an existing container is replaced)
+     *  @return Flag indicating whether the tangents were generated
+     *  @note   Follows the MikkTSpace conventions: per-corner tangents are projected to the plane
+     *          of the vertex normal and weighted by the corner angle, and the w component holds
+     *          the handedness, bitangent = w * cross(normal, tangent). Unlike MikkTSpace, vertices
+     *          are not split, vertices shared by triangles of opposite texture space orientation
+     *          get the majority handedness.
+     */
+    bool generateTangents(VertexData& vertexData);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_TANGENTSPACE_HPP
@@ -12,34 +12,82 @@
 #define GRAPHICSUTILS_VERTEXDATA_HPP
 
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <memory_resource>
 
 #include "TypeUtils.hpp"
 #include "MathTypeReflection.hpp"
+#include "Bounds.hpp"
 
 
 namespace gut {
 
     class VertexData {
     public:
-        // Container struct storing the vertex data
-        struct Container {
+        // Container storing the vertex data
+        // Copies share the data vector (atomically reference counted), non-const access
+        // detaches a shared vector by copying it first. Data allocated from a memory resource
+        // is detached to a new allocation from the same resource.
+        class Container {
+        public:
             std::string     name;
             MathTypeEnum    type;
-            int64_t         size; // size of the vector below (to be used in non-type-aware contexts)
-            void*           v; // pointer to data vector
-            void            (*deleter)(void*); // data vector deleter function
-            void*           (*copier)(void*); // data vector copier function
 
             template <typename T_Data>
-            Container(const std::string& name, T_Data* p); // pointer for type deduction
+            Container(const std::string& name, T_Data* p, bool owned = true); // pointer for type deduction
 
-            Container(const Container&);
+            Container(const Container&) = default;
             Container(Container&&) noexcept;
-            Container& operator=(const Container&);
+            Container& operator=(const Container&) = default;
             Container& operator=(Container&&) noexcept;
 
-            ~Container();
+            // Number of elements
+            int64_t size() const noexcept;
+
+            // Access raw vector data (size() elements of elementSize() bytes each)
+            // Non-const access detaches shared data and copies read-only external data to
+            // an owned vector first
+            void* data();
+            const void* data() const noexcept;
+            size_t elementSize() const noexcept;
+
+            // Typed access to the data, T_Data has to match the container type
+            template <typename T_Data>
+            T_Data* data();
+            template <typename T_Data>
+            const T_Data* data() const noexcept;
+
+            // Check whether the container references external data
+            bool isExternal() const noexcept;
+
+            // Check whether the data vector is shared with another container
+            bool isShared() const noexcept;
+
+            // Detach shared data and copy read-only external data to an owned vector (no-op for
+            // unshared owned or resource-allocated data)
+            void materialize();
+
+            // Replace the data with elements indices[0], ..., indices[n-1] of the current data
+            void gather(const unsigned* indices, int64_t n);
+
+        private:
+            friend class VertexData;
+
+            int64_t         _size; // size of the data (to be used in non-type-aware contexts)
+            std::shared_ptr<void> _v; // shared data vector (nullptr when referencing external data)
+            std::shared_ptr<void> (*_copier)(const void*); // data vector copier function
+            const void*     _external; // read-only external data (e.g. memory-mapped file), _size elements
+            std::shared_ptr<const void> _externalOwner; // keeps the external data alive
+            std::pmr::memory_resource* _resource; // resource of writable external data (nullptr for read-only data)
+        };
+
+        // Index storage type, narrowest type holding the maximum index
+        enum class IndexType {
+            U8,
+            U16,
+            U32
         };
 
         VertexData();
@@ -57,10 +105,34 @@ namespace gut {
         template <typename T_Data>
         bool addDataVector(const std::string& name, Vector<T_Data>&& v);
 
+        // Replace the data vector of a container (added in case it does not exist), vertex data
+        // validated before the replacement is validated again
+        // Returns flag indicating whether the replacement was successful
+        template <typename T_Data>
+        bool replaceDataVector(const std::string& name, Vector<T_Data>&& v);
+
+        // Add vertex data container referencing external read-only memory without copying,
+        // owner is kept alive as long as the container (or any copy of it) exists
+        // Returns flag indicating whether the container creation was successful
+        bool addExternalData(const std::string& name, MathTypeEnum type, const void* data,
+            int64_t size, std::shared_ptr<const void> owner);
+
+        // Add vertex data container of size elements allocated from resource (e.g. an arena
+        // shared by a batch of meshes), or an owned vector when resource is nullptr. Returns
+        // pointer to the uninitialized data for filling, nullptr on failure. Resource-allocated
+        // data is referenced like external data, the resource has to outlive the container
+        // and its copies. Modified data stays on the resource.
+        template <typename T_Data>
+        T_Data* allocateData(const std::string& name, int64_t size, std::pmr::memory_resource* resource = nullptr);
+
         // Add data to existing data vector (does nothing in case the vector does not exist)
         template <typename T_Data>
         void addData(const std::string& name, const Vector<T_Data>& v);
         
+        // Remove data container
+        // Returns flag indicating whether a container with the name existed
+        bool removeData(const std::string& name);
+
         // Get names of the vertex data vectors
         Vector<std::string> getDataNames() const;
 
@@ -70,33 +142,60 @@ namespace gut {
         // Access data container (return nullptr if container with such name does not exist)
         Container* accessData(const std::string& name) noexcept;
 
-        // Set the indices vector
+        // Set the indices vector (copies of the VertexData keep the previous indices)
         void setIndices(const Vector<unsigned>& indices);
         void setIndices(Vector<unsigned>&& indices);
 
         // Access the indices vector
         const Vector<unsigned>& getIndices() const noexcept;
 
-        // Validate the vertex data, ie. check that all data vectors are long enough
+        // Get the index type determined by validate() (U32 for data not validated)
+        IndexType getIndexType() const noexcept;
+
+        // Copy the indices to dest converted to the index type
+        // (dest has to have space for getIndices().size()*indexTypeSize(getIndexType()) bytes)
+        void packIndices(void* dest) const;
+
+        // Copy indices to dest converted to indexType (indices have to fit in the type)
+        static void packIndices(const Vector<unsigned>& indices, IndexType indexType, void* dest);
+
+        // Narrowest index type for maximum index value
+        static IndexType indexTypeFor(unsigned maxIndex) noexcept;
+
+        // Size of index type in bytes
+        static size_t indexTypeSize(IndexType indexType) noexcept;
+
+        // Validate the vertex data, ie. check that there are indices and that all data vectors
+        // contain the maximum index. Data without shared vertices (point clouds, per-element
+        // data etc.) needs indices 0, 1, ..., n-1. Number of degenerate triangles (ones with repeated indices)
+        // is written to nDegenerateTriangles when given.
         // Returns flag indicating whether the vertex data was successfully validated
-        bool validate();
+        bool validate(int64_t* nDegenerateTriangles = nullptr);
+
+        // Get bounds of Vec3f "position" data, computed by validate() and reset when containers
+        // are added or modified through VertexData (empty without validation or position data)
+        const Bounds& getBounds() const noexcept;
 
         // Check whether the the vertex data has been validated
         bool isValid() const noexcept;
 
     private:
         Vector<Container>   _containers; // vertex data containers
-        Vector<unsigned>    _indices; // mesh indices
-        unsigned            _maxIndex; // maximum index value (all data vectors have to be this long for validity)
+        std::shared_ptr<const Vector<unsigned>> _indices; // mesh indices, shared between copies
+        unsigned            _maxIndex; // maximum index value (all data vectors have to be longer for validity)
+        IndexType           _indexType; // index type for the maximum index
         bool                _valid; // flag indicating whether the vertexdata has been validated
-
-        // Function for deleting the data vectors
-        template <typename T_Data>
-        static void vectorDeleter(void* v);
+        Bounds              _bounds; // bounds of the position data
 
         // Function for copying the data vectors
         template <typename T_Data>
-        static void* vectorCopier(void* v);
+        static std::shared_ptr<void> vectorCopier(const void* v);
+
+        // Allocate bytes from resource, the storage is returned to the resource when the
+        // last reference to the owner is gone (the control block is allocated from the
+        // resource as well)
+        static std::shared_ptr<const void> allocateShared(std::pmr::memory_resource* resource,
+            size_t bytes, size_t alignment);
     };
 
     // Inline template member function declarations in VertexData.inl
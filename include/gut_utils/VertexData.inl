@@ -11,34 +11,45 @@
 template<typename T_Data>
 inline VertexData::Container::Container(
     const std::string& name,
-    T_Data* p
+    T_Data* p,
+    bool owned
 ) :
     name    (name),
     type    (MathTypeReflection<T_Data>::typeEnum),
-    size    (0),
-    v       (new Vector<T_Data>),
-    deleter (&VertexData::vectorDeleter<T_Data>),
-    copier  (&VertexData::vectorCopier<T_Data>)
+    _size       (0),
+    _v          (owned ? std::make_shared<Vector<T_Data>>() : nullptr),
+    _copier     (&VertexData::vectorCopier<T_Data>),
+    _external   (nullptr),
+    _resource   (nullptr)
 {
 }
 
-inline VertexData::Container::~Container()
+template <typename T_Data>
+inline T_Data* VertexData::Container::data()
+{
+    assert(type == MathTypeReflection<T_Data>::typeEnum);
+    return static_cast<T_Data*>(data());
+}
+
+template <typename T_Data>
+inline const T_Data* VertexData::Container::data() const noexcept
 {
-    if (deleter != nullptr)
-        deleter(v);
+    assert(type == MathTypeReflection<T_Data>::typeEnum);
+    return static_cast<const T_Data*>(data());
 }
 
 template <typename T_Data>
 constexpr bool VertexData::isValidDataType()
 {
-    return false;
+    // Types with reflection have a type enum, the unspecialized template has none
+    return requires { MathTypeReflection<T_Data>::typeEnum; };
 }
 
 template <typename T_Data>
 inline bool VertexData::addDataVector(const std::string& name)
 {
     // Check data type validity
-    static_assert(MathTypeReflection<T_Data>::typeString != "", "Not a valid vertex data type\n");
+    static_assert(isValidDataType<T_Data>(), "Not a valid vertex data type\n");
 
     // Check if container with same name exists
     for (auto& c : _containers) {
@@ -54,6 +65,7 @@ inline bool VertexData::addDataVector(const std::string& name)
     _containers.emplace_back(name, p);
 
     _valid = false;
+    _bounds = Bounds();
 
     return true;
 }
@@ -62,7 +74,7 @@ template <typename T_Data>
 inline bool VertexData::addDataVector(const std::string& name, Vector<T_Data>&& v)
 {
     // Check data type validity
-    static_assert(MathTypeReflection<T_Data>::typeString != "", "Not a valid vertex data type\n");
+    static_assert(isValidDataType<T_Data>(), "Not a valid vertex data type\n");
 
     // Check if container with same name exists
     for (auto& c : _containers) {
@@ -77,14 +89,61 @@ inline bool VertexData::addDataVector(const std::string& name, Vector<T_Data>&&
     _containers.emplace_back(name, p);
 
     auto& c = _containers.back();
-    c.size = v.size();
-    *static_cast<Vector<T_Data>*>(c.v) = std::move(v);
+    c._size = v.size();
+    *static_cast<Vector<T_Data>*>(c._v.get()) = std::move(v);
 
     _valid = false;
+    _bounds = Bounds();
 
     return true;
 }
 
+template <typename T_Data>
+inline T_Data* VertexData::allocateData(const std::string& name, int64_t size, std::pmr::memory_resource* resource)
+{
+    if (resource == nullptr) {
+        if (!addDataVector<T_Data>(name, Vector<T_Data>(size)))
+            return nullptr;
+        return static_cast<Vector<T_Data>*>(_containers.back()._v.get())->data();
+    }
+
+    for (auto& c : _containers) {
+        if (c.name == name) {
+            fprintf(stderr, "ERROR: Vertex data container with name %s already exists\n",
+                name.c_str());
+            return nullptr;
+        }
+    }
+
+    // Storage is returned to the resource when the last container copy referencing it is gone
+    auto owner = allocateShared(resource, size*sizeof(T_Data), alignof(T_Data));
+    auto* data = static_cast<T_Data*>(const_cast<void*>(owner.get()));
+
+    T_Data* p = nullptr; // pointer for constructor type deduction
+    _containers.emplace_back(name, p, false);
+
+    auto& c = _containers.back();
+    c._size = size;
+    c._external = data;
+    c._externalOwner = std::move(owner);
+    c._resource = resource;
+
+    _valid = false;
+    _bounds = Bounds();
+
+    return data;
+}
+
+template <typename T_Data>
+inline bool VertexData::replaceDataVector(const std::string& name, Vector<T_Data>&& v)
+{
+    bool wasValid = _valid;
+    removeData(name);
+    if (!addDataVector<T_Data>(name, std::move(v)))
+        return false;
+    return wasValid ? validate() : true;
+}
+
 template <typename T_Data>
 inline void VertexData::addData(const std::string& name, const Vector<T_Data>& v)
 {
@@ -93,31 +152,36 @@ inline void VertexData::addData(const std::string& name, const Vector<T_Data>& v
             // Check for correct data type
             assert(c.type == MathTypeReflection<T_Data>::typeEnum);
             
-            // Add data to back of the vector
-            auto& cv = *static_cast<Vector<T_Data>*>(c.v);
-            cv.insert(cv.end(), v.begin(), v.end());
-            c.size = cv.size();
+            if (c._resource != nullptr) {
+                // Resource-allocated data is moved to a larger allocation from the resource
+                auto owner = allocateShared(c._resource, (c._size+v.size())*sizeof(T_Data), alignof(T_Data));
+                auto* data = static_cast<T_Data*>(const_cast<void*>(owner.get()));
+                std::copy_n(static_cast<const T_Data*>(c._external), c._size, data);
+                std::copy(v.begin(), v.end(), data+c._size);
+                c._size += v.size();
+                c._external = data;
+                c._externalOwner = std::move(owner);
+            }
+            else {
+                // Add data to back of the vector
+                c.materialize();
+                auto& cv = *static_cast<Vector<T_Data>*>(c._v.get());
+                cv.insert(cv.end(), v.begin(), v.end());
+                c._size = cv.size();
+            }
 
             _valid = false;
+            _bounds = Bounds();
         }
     }
 }
 
 template <typename T_Data>
-inline void VertexData::vectorDeleter(void* v)
-{
-    if (v != nullptr)
-        delete static_cast<Vector<T_Data>*>(v);
-}
-
-template <typename T_Data>
-inline void* VertexData::vectorCopier(void* v)
+inline std::shared_ptr<void> VertexData::vectorCopier(const void* v)
 {
-    void* r = nullptr;
-
     // Copy the vector
     if (v != nullptr)
-        r = new Vector<T_Data>(*static_cast<Vector<T_Data>*>(v));
+        return std::make_shared<Vector<T_Data>>(*static_cast<const Vector<T_Data>*>(v));
 
-    return r;
+    return nullptr;
 }
@@ -0,0 +1,307 @@
+//
+// Project: GraphicsUtils
+// File: VertexLayout.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_VERTEXLAYOUT_HPP
+#define GRAPHICSUTILS_VERTEXLAYOUT_HPP
+
+
+#include "VertexData.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+
+namespace gut {
+
+    /** @brief  Compile-time attribute name, usable as a template argument
+     */
+    template <size_t N>
+    struct AttributeName {
+        char    value[N];
+
+        constexpr AttributeName(const char (&name)[N])
+        {
+            std::copy_n(name, N, value);
+        }
+
+        constexpr std::string_view view() const noexcept { return std::string_view(value, N-1); }
+    };
+
+    /** @brief  Statically typed vertex attribute
+     *  @tparam T_Name  Attribute name, matches the VertexData container name
+     *  @tparam T_Data  Attribute data type
+     */
+    template <AttributeName T_Name, typename T_Data>
+    struct VertexAttribute {
+        static_assert(VertexData::isValidDataType<T_Data>(), "Not a valid vertex data type");
+
+        using Type = T_Data;
+
+        static constexpr std::string_view   name        {T_Name.view()};
+        static constexpr MathTypeEnum       typeEnum    {MathTypeReflection<T_Data>::typeEnum};
+    };
+
+    using PositionAttribute = VertexAttribute<"position", Vec3f>;
+    using NormalAttribute = VertexAttribute<"normal", Vec3f>;
+    using TexCoordAttribute = VertexAttribute<"texCoord", Vec2f>;
+    using ColorAttribute = VertexAttribute<"color", Vec3f>;
+
+    /** @brief  Interleaved vertex storage with a compile-time attribute layout
+     *  @tparam T_Attributes    VertexAttribute types in the order of their offsets
+     *  @note   Attribute offsets are aligned to the alignment of their type and the stride to
+     *          the largest alignment. Attribute access resolves to a constant offset at compile
+     *          time, no string lookups or indirect calls are involved.
+     */
+    template <typename... T_Attributes>
+    class VertexLayout {
+    public:
+        static constexpr int    nAttributes {sizeof...(T_Attributes)};
+
+        static constexpr std::array<std::string_view, nAttributes>  names       { T_Attributes::name... };
+        static constexpr std::array<MathTypeEnum, nAttributes>      types       { T_Attributes::typeEnum... };
+        static constexpr std::array<size_t, nAttributes>            sizes       { sizeof(typename T_Attributes::Type)... };
+        static constexpr std::array<size_t, nAttributes>            alignments  { alignof(typename T_Attributes::Type)... };
+
+    private:
+        static constexpr std::array<size_t, nAttributes> computeOffsets()
+        {
+            std::array<size_t, nAttributes> offsets {};
+            size_t offset = 0;
+            for (int i=0; i<nAttributes; ++i) {
+                offset = (offset + alignments[i] - 1) / alignments[i] * alignments[i];
+                offsets[i] = offset;
+                offset += sizes[i];
+            }
+            return offsets;
+        }
+
+        static constexpr size_t computeAlignment()
+        {
+            size_t alignment = 1;
+            for (auto a : alignments)
+                alignment = std::max(alignment, a);
+            return alignment;
+        }
+
+    public:
+        static constexpr std::array<size_t, nAttributes>    offsets     {computeOffsets()};
+        static constexpr size_t                             alignment   {computeAlignment()};
+        static constexpr size_t                             stride      {nAttributes == 0 ? 0 :
+            (offsets[nAttributes-1] + sizes[nAttributes-1] + alignment - 1) / alignment * alignment};
+
+        // Index of attribute with name, -1 if the layout does not have such attribute
+        static constexpr int attributeIndex(std::string_view name) noexcept
+        {
+            for (int i=0; i<nAttributes; ++i)
+                if (names[i] == name)
+                    return i;
+            return -1;
+        }
+
+        template <AttributeName T_Name>
+        static constexpr bool hasAttribute() noexcept { return attributeIndex(T_Name.view()) >= 0; }
+
+        // Data type of attribute with name
+        template <AttributeName T_Name>
+        using AttributeType = std::tuple_element_t<(size_t)attributeIndex(T_Name.view()),
+            std::tuple<typename T_Attributes::Type...>>;
+
+        VertexLayout(int64_t nVertices = 0);
+
+        // Number of vertices
+        int64_t size() const noexcept;
+
+        // Resize the vertex storage, new vertices are zeroed
+        void resize(int64_t nVertices);
+
+        // Typed attribute access
+        template <AttributeName T_Name>
+        AttributeType<T_Name>& get(int64_t vertex) noexcept;
+
+        template <AttributeName T_Name>
+        const AttributeType<T_Name>& get(int64_t vertex) const noexcept;
+
+        // Raw interleaved data (size()*stride bytes)
+        uint8_t* data() noexcept;
+        const uint8_t* data() const noexcept;
+
+        Vector<unsigned>& indices() noexcept;
+        const Vector<unsigned>& indices() const noexcept;
+
+        // Interleave the attributes from vertex data containers of the same names and types
+        // Returns flag indicating whether the conversion succeeded
+        bool fromVertexData(const VertexData& vertexData);
+
+        // Write the attributes to vertexData as separate containers, existing containers
+        // with the same names are replaced. vertexData is validated.
+        // Returns flag indicating whether the conversion succeeded
+        bool toVertexData(VertexData& vertexData) const;
+
+    private:
+        struct alignas(alignment) Vertex {
+            uint8_t bytes[stride == 0 ? 1 : stride];
+        };
+
+        Vector<Vertex>      _vertices;
+        Vector<unsigned>    _indices;
+
+        template <size_t T_Index>
+        void copyFromContainer(const VertexData::Container& container);
+
+        template <size_t T_Index>
+        void copyToVertexData(VertexData& vertexData) const;
+    };
+
+    /** @brief  VertexLayout of the attributes Mesh binds by default (locations 0-3)
+     */
+    using StandardVertexLayout = VertexLayout<PositionAttribute, NormalAttribute, TexCoordAttribute, ColorAttribute>;
+
+
+    template <typename... T_Attributes>
+    VertexLayout<T_Attributes...>::VertexLayout(int64_t nVertices)
+    {
+        resize(nVertices);
+    }
+
+    template <typename... T_Attributes>
+    inline int64_t VertexLayout<T_Attributes...>::size() const noexcept
+    {
+        return _vertices.size();
+    }
+
+    template <typename... T_Attributes>
+    inline void VertexLayout<T_Attributes...>::resize(int64_t nVertices)
+    {
+        size_t oldSize = _vertices.size();
+        _vertices.resize(nVertices);
+        if ((size_t)nVertices > oldSize)
+            memset(_vertices.data()+oldSize, 0, (nVertices-oldSize)*sizeof(Vertex));
+    }
+
+    template <typename... T_Attributes>
+    template <AttributeName T_Name>
+    inline typename VertexLayout<T_Attributes...>::template AttributeType<T_Name>&
+        VertexLayout<T_Attributes...>::get(int64_t vertex) noexcept
+    {
+        constexpr size_t offset = offsets[attributeIndex(T_Name.view())];
+        return *reinterpret_cast<AttributeType<T_Name>*>(_vertices[vertex].bytes + offset);
+    }
+
+    template <typename... T_Attributes>
+    template <AttributeName T_Name>
+    inline const typename VertexLayout<T_Attributes...>::template AttributeType<T_Name>&
+        VertexLayout<T_Attributes...>::get(int64_t vertex) const noexcept
+    {
+        constexpr size_t offset = offsets[attributeIndex(T_Name.view())];
+        return *reinterpret_cast<const AttributeType<T_Name>*>(_vertices[vertex].bytes + offset);
+    }
+
+    template <typename... T_Attributes>
+    inline uint8_t* VertexLayout<T_Attributes...>::data() noexcept
+    {
+        return reinterpret_cast<uint8_t*>(_vertices.data());
+    }
+
+    template <typename... T_Attributes>
+    inline const uint8_t* VertexLayout<T_Attributes...>::data() const noexcept
+    {
+        return reinterpret_cast<const uint8_t*>(_vertices.data());
+    }
+
+    template <typename... T_Attributes>
+    inline Vector<unsigned>& VertexLayout<T_Attributes...>::indices() noexcept
+    {
+        return _indices;
+    }
+
+    template <typename... T_Attributes>
+    inline const Vector<unsigned>& VertexLayout<T_Attributes...>::indices() const noexcept
+    {
+        return _indices;
+    }
+
+    template <typename... T_Attributes>
+    bool VertexLayout<T_Attributes...>::fromVertexData(const VertexData& vertexData)
+    {
+        if (!vertexData.isValid()) {
+            fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+            return false;
+        }
+
+        // Look up the containers once, all of them are long enough for the indices
+        const VertexData::Container* containers[nAttributes == 0 ? 1 : nAttributes];
+        int64_t nVertices = nAttributes == 0 ? 0 : INT64_MAX;
+        for (int i=0; i<nAttributes; ++i) {
+            containers[i] = vertexData.accessData(std::string(names[i]));
+            if (containers[i] == nullptr || containers[i]->type != types[i]) {
+                fprintf(stderr, "ERROR: No %s data of layout type in VertexData\n",
+                    std::string(names[i]).c_str()); // TODO logging
+                return false;
+            }
+            nVertices = std::min(nVertices, containers[i]->size());
+        }
+
+        _vertices.clear();
+        resize(nVertices);
+        [&]<size_t... T_Indices>(std::index_sequence<T_Indices...>) {
+            (copyFromContainer<T_Indices>(*containers[T_Indices]), ...);
+        }(std::make_index_sequence<nAttributes>());
+        _indices = vertexData.getIndices();
+
+        return true;
+    }
+
+    template <typename... T_Attributes>
+    bool VertexLayout<T_Attributes...>::toVertexData(VertexData& vertexData) const
+    {
+        [&]<size_t... T_Indices>(std::index_sequence<T_Indices...>) {
+            (copyToVertexData<T_Indices>(vertexData), ...);
+        }(std::make_index_sequence<nAttributes>());
+        vertexData.setIndices(_indices);
+
+        return vertexData.validate();
+    }
+
+    template <typename... T_Attributes>
+    template <size_t T_Index>
+    inline void VertexLayout<T_Attributes...>::copyFromContainer(const VertexData::Container& container)
+    {
+        constexpr size_t offset = offsets[T_Index];
+        constexpr size_t size = sizes[T_Index];
+        auto* src = static_cast<const uint8_t*>(container.data());
+        for (size_t i=0; i<_vertices.size(); ++i)
+            memcpy(_vertices[i].bytes + offset, src + i*size, size); // constant size, compiles to moves
+    }
+
+    template <typename... T_Attributes>
+    template <size_t T_Index>
+    inline void VertexLayout<T_Attributes...>::copyToVertexData(VertexData& vertexData) const
+    {
+        using Data = std::tuple_element_t<T_Index, std::tuple<typename T_Attributes::Type...>>;
+        constexpr size_t offset = offsets[T_Index];
+
+        Vector<Data> v(_vertices.size());
+        for (size_t i=0; i<_vertices.size(); ++i)
+            v[i] = *reinterpret_cast<const Data*>(_vertices[i].bytes + offset);
+
+        std::string name(names[T_Index]);
+        vertexData.replaceDataVector<Data>(name, std::move(v));
+    }
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_VERTEXLAYOUT_HPP
@@ -0,0 +1,102 @@
+//
+// Project: GraphicsUtils
+// File: VertexPacking.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_VERTEXPACKING_HPP
+#define GRAPHICSUTILS_VERTEXPACKING_HPP
+
+
+#include "TypeUtils.hpp"
+#include "MathTypeReflection.hpp"
+
+#include <string>
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Attribute in an interleaved vertex buffer
+     */
+    struct PackedAttribute {
+        std::string     name;   ///< Name of the source data container
+        MathTypeEnum    type;   ///< Data type of the attribute
+        uint32_t        offset; ///< Byte offset of the attribute within a vertex
+        uint32_t        size;   ///< Size of the attribute in bytes
+    };
+
+    /** @brief  Interleaved (array of structures) vertex buffer
+     */
+    struct PackedVertexBuffer {
+        Vector<PackedAttribute> attributes; ///< Attributes in the order of their offsets
+        uint32_t                stride;     ///< Size of a vertex in bytes
+        int64_t                 nVertices;  ///< Number of vertices
+        Vector<uint8_t>         data;       ///< nVertices*stride bytes of vertex data
+
+        PackedVertexBuffer() :
+            stride      (0),
+            nVertices   (0)
+        {}
+
+        // Find attribute by name (return nullptr if attribute with such name does not exist)
+        const PackedAttribute* findAttribute(const std::string& name) const noexcept;
+    };
+
+    /** @brief  Vertex packing settings struct
+     */
+    struct VertexPackingSettings {
+        Vector<std::string> attributes; ///< Containers to pack in order, empty packs all containers
+        uint32_t            alignment;  ///< Alignment of attribute offsets and the stride in bytes
+        uint32_t            stride;     ///< Vertex stride in bytes, 0 for tightly packed (aligned) vertices
+
+        explicit VertexPackingSettings(
+            const Vector<std::string>& attributes   = Vector<std::string>(),
+            uint32_t alignment                      = 4,
+            uint32_t stride                         = 0) :
+            attributes  (attributes),
+            alignment   (alignment),
+            stride      (stride)
+        {}
+    };
+
+    /** @brief  Pack vertex data containers into one interleaved buffer
+     *  @param  vertexData  Source vertex data (structure of arrays)
+     *  @param  dest        Destination buffer
+     *  @param  settings    Packing settings
+     *  @return Flag indicating whether the packing succeeded
+     *  @note   Vertices are packed in parallel blocks, attribute copies are of fixed size
+     *          per attribute type and compile to vector moves. Padding bytes are zeroed.
+     */
+    bool packVertexData(const VertexData& vertexData, PackedVertexBuffer& dest,
+        const VertexPackingSettings& settings = VertexPackingSettings());
+
+    /** @brief  Lay out an interleaved buffer without packing the data
+     *  @param  vertexData  Source vertex data (structure of arrays)
+     *  @param  layout      Destination layout, data is left empty
+     *  @param  settings    Packing settings
+     *  @return Flag indicating whether the layout succeeded
+     */
+    bool layoutVertexData(const VertexData& vertexData, PackedVertexBuffer& layout,
+        const VertexPackingSettings& settings = VertexPackingSettings());
+
+    /** @brief  Pack vertex data containers to memory laid out with layoutVertexData
+     *  @param  vertexData  Source vertex data, the same the layout was created from
+     *  @param  layout      Interleaved buffer layout
+     *  @param  dest        Destination with space for layout.nVertices*layout.stride bytes
+     *  @note   Vertex blocks are assembled in a cache-resident buffer and written to dest
+     *          sequentially, dest can be write-combined memory (e.g. a mapped OpenGL buffer).
+     *          External (memory-mapped) containers are read in place.
+     */
+    void packVertexData(const VertexData& vertexData, const PackedVertexBuffer& layout, void* dest);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_VERTEXPACKING_HPP
@@ -0,0 +1,41 @@
+//
+// Project: GraphicsUtils
+// File: WeldVertices.hpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#ifndef GRAPHICSUTILS_WELDVERTICES_HPP
+#define GRAPHICSUTILS_WELDVERTICES_HPP
+
+
+#include <cstdint>
+
+
+namespace gut {
+
+    class VertexData;
+
+    /** @brief  Merge equal vertices and update the indices accordingly
+     *  @param  vertexData  Vertex data to weld, vertices are compared over all data containers
+     *  @param  epsilon     Maximum per-component difference of merged vertices,
+     *                      0 merges only bit-identical vertices
+     *  @return Number of vertices after welding, -1 on error
+     *  @note   Bit-identical vertices are found by hashing whole vertices, near-equal ones by
+     *          spatial hashing of the "position" container (Vec3f), both in parallel
+     *  @note   With epsilon > 0 the merging is transitive: chains of vertices each within
+     *          epsilon of the next are merged to the first vertex of the chain
+     *  @note   With epsilon > 0 vertices with non-finite positions are left unwelded, epsilon
+     *          has to be finite
+     *  @note   Remaining vertices keep their relative order, the first vertex of each merged
+     *          group is retained
+     */
+    int64_t weldVertices(VertexData& vertexData, float epsilon = 0.0f);
+
+} // namespace gut
+
+
+#endif //GRAPHICSUTILS_WELDVERTICES_HPP
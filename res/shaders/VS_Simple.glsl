@@ -21,10 +21,21 @@ out vec2 texc;
 uniform mat4 objectToWorld;
 uniform mat3 normalToWorld;
 uniform mat4 worldToClip;
+uniform bool octahedralNormals;
+
+// Decode octahedral-encoded normal (stored in xy)
+vec3 decodeNormal(vec3 n) {
+    if (!octahedralNormals)
+        return n;
+    vec3 v = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return v;
+}
 
 void main() {
     pos = (objectToWorld * vec4(position, 1.0)).xyz;
-    norm = normalize(normalToWorld * normal);
+    norm = normalize(normalToWorld * decodeNormal(normal));
     texc = texCoord;
     gl_Position = worldToClip * vec4(pos, 1.0);
 }
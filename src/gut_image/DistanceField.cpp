@@ -0,0 +1,244 @@
+//
+// Project: GraphicsUtils
+// File: DistanceField.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "DistanceField.hpp"
+
+#include <gut_utils/ParallelFor.hpp>
+
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Squared distance assigned to pixels with no feature
+    constexpr float distanceInfinity = 1.0e20f;
+
+    // Number of columns gathered at once in the column pass, one cache line of floats
+    constexpr int columnGroupSize = 16;
+
+    // Scratch buffers for the 1D transform
+    struct DistanceTransformBuffers {
+        std::vector<float>  d;
+        std::vector<int>    v;
+        std::vector<double> z;
+
+        explicit DistanceTransformBuffers(int n) :
+            d   (n),
+            v   (n),
+            z   (n+1)
+        {
+        }
+    };
+
+    // 1D squared Euclidean distance transform of sampled function f, lower envelope of parabolas
+    // rooted at (q, f(q)). See Felzenszwalb & Huttenlocher: Distance Transforms of Sampled Functions
+    void distanceTransform1D(const float* f, int n, float* d, int* v, double* z)
+    {
+        int k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+        z[1] = std::numeric_limits<double>::infinity();
+
+        auto intersection = [&](int q, int p) {
+            return ((f[q] + (double)q*q) - (f[p] + (double)p*p)) / (2.0*(q-p));
+        };
+
+        for (int q=1; q<n; ++q) {
+            double s = intersection(q, v[k]);
+            while (s <= z[k]) {
+                --k;
+                s = intersection(q, v[k]);
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = std::numeric_limits<double>::infinity();
+        }
+
+        k = 0;
+        for (int q=0; q<n; ++q) {
+            while (z[k+1] < q)
+                ++k;
+            double dq = q-v[k];
+            d[q] = (float)(dq*dq + f[v[k]]);
+        }
+    }
+
+    // Squared distances to the nearest feature on a binary row, computed with two linear sweeps
+    // (the first pass of the transform does not need the parabola envelope)
+    void distanceTransformBinaryRow(const uint8_t* feature, int w, float* d)
+    {
+        float dist = distanceInfinity;
+        for (int x=0; x<w; ++x) {
+            dist = feature[x] ? 0.0f : dist+1.0f;
+            d[x] = dist;
+        }
+
+        dist = distanceInfinity;
+        for (int x=w-1; x>=0; --x) {
+            dist = feature[x] ? 0.0f : dist+1.0f;
+            float dx = std::min(dist, d[x]);
+            d[x] = dx >= distanceInfinity ? distanceInfinity : dx*dx;
+        }
+    }
+
+    // Row pass: transform rows of the mask to squared distances to nearest inside (fg) and
+    // outside (bg) pixels on the same row
+    template <typename T_Data>
+    void distanceTransformRows(const Image& mask, float threshold, float* fg, float* bg)
+    {
+        int w = mask.width();
+        int h = mask.height();
+        const T_Data* data = mask.data<T_Data>();
+
+        T_Data maxValue = std::is_floating_point<T_Data>::value ?
+            (T_Data)1 : std::numeric_limits<T_Data>::max();
+        float t = threshold*maxValue;
+
+        parallelFor(0, h, [&](int64_t yBegin, int64_t yEnd, int) {
+            std::vector<uint8_t> inside(w);
+            std::vector<uint8_t> outside(w);
+
+            for (int64_t y=yBegin; y<yEnd; ++y) {
+                const T_Data* row = data + y*w;
+                for (int x=0; x<w; ++x) {
+                    inside[x] = (float)row[x] >= t;
+                    outside[x] = !inside[x];
+                }
+
+                distanceTransformBinaryRow(inside.data(), w, fg + y*w);
+                distanceTransformBinaryRow(outside.data(), w, bg + y*w);
+            }
+        }, 16);
+    }
+
+    // Column pass: transform columns in place, columns are gathered in groups to keep
+    // the accesses cache line sized
+    void distanceTransformColumns(float* grid, int w, int h)
+    {
+        int nGroups = (w+columnGroupSize-1) / columnGroupSize;
+
+        parallelFor(0, nGroups, [&](int64_t groupBegin, int64_t groupEnd, int) {
+            std::vector<float> columns((size_t)h*columnGroupSize);
+            DistanceTransformBuffers buffers(h);
+
+            for (int64_t g=groupBegin; g<groupEnd; ++g) {
+                int x0 = g*columnGroupSize;
+                int nColumns = std::min(columnGroupSize, w-x0);
+
+                // Gather
+                for (int y=0; y<h; ++y) {
+                    const float* row = grid + (int64_t)y*w + x0;
+                    for (int i=0; i<nColumns; ++i)
+                        columns[(size_t)i*h + y] = row[i];
+                }
+
+                for (int i=0; i<nColumns; ++i) {
+                    float* column = columns.data() + (size_t)i*h;
+                    distanceTransform1D(column, h, buffers.d.data(), buffers.v.data(), buffers.z.data());
+                    std::copy(buffers.d.begin(), buffers.d.end(), column);
+                }
+
+                // Scatter
+                for (int y=0; y<h; ++y) {
+                    float* row = grid + (int64_t)y*w + x0;
+                    for (int i=0; i<nColumns; ++i)
+                        row[i] = columns[(size_t)i*h + y];
+                }
+            }
+        }, 1);
+    }
+
+    template <typename T_Data>
+    void writeDistanceField(const float* fg, const float* bg, float spread, Image& dest)
+    {
+        int64_t n = (int64_t)dest.width()*dest.height();
+        T_Data* data = dest.data<T_Data>();
+
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                // One of the squared distances is zero, boundary is half a pixel from the pixel center
+                float d = fg[i] > 0.0f ? 0.5f-std::sqrt(fg[i]) : std::sqrt(bg[i])-0.5f;
+                d = std::clamp(d, -spread, spread);
+
+                if constexpr (std::is_same<T_Data, float>::value)
+                    data[i] = d;
+                else
+                    data[i] = (T_Data)((0.5f + 0.5f*d/spread)*255.0f + 0.5f);
+            }
+        }, 65536);
+    }
+
+} // namespace
+
+
+void gut::generateSignedDistanceField(
+    const Image& mask,
+    Image& dest,
+    float spread,
+    Image::DataType dataType,
+    float threshold)
+{
+    if (mask.dataFormat() != Image::DataFormat::GRAY) {
+        fprintf(stderr, "ERROR: Unable to generate distance field: mask must be a GRAY image\n"); // TODO logging
+        return;
+    }
+    if (dataType != Image::DataType::U8 && dataType != Image::DataType::F32) {
+        fprintf(stderr, "ERROR: Unable to generate distance field: invalid output data type\n"); // TODO logging
+        return;
+    }
+    if (spread <= 0.0f) {
+        fprintf(stderr, "ERROR: Unable to generate distance field: spread must be positive\n"); // TODO logging
+        return;
+    }
+
+    dest = Image(Image::DataFormat::GRAY, dataType);
+    if (mask.data<void>() == nullptr)
+        return;
+
+    int w = mask.width();
+    int h = mask.height();
+    dest.create(w, h);
+
+    // Squared distances to nearest inside and outside pixels
+    std::vector<float> fg((size_t)w*h);
+    std::vector<float> bg((size_t)w*h);
+
+    switch (mask.dataType()) {
+        case Image::DataType::U8:
+            distanceTransformRows<uint8_t>(mask, threshold, fg.data(), bg.data());
+            break;
+        case Image::DataType::U16:
+            distanceTransformRows<uint16_t>(mask, threshold, fg.data(), bg.data());
+            break;
+        case Image::DataType::F32:
+            distanceTransformRows<float>(mask, threshold, fg.data(), bg.data());
+            break;
+        default:
+            fprintf(stderr, "ERROR: Unable to generate distance field: invalid mask data type\n"); // TODO logging
+            return;
+    }
+
+    distanceTransformColumns(fg.data(), w, h);
+    distanceTransformColumns(bg.data(), w, h);
+
+    if (dataType == Image::DataType::F32)
+        writeDistanceField<float>(fg.data(), bg.data(), spread, dest);
+    else
+        writeDistanceField<uint8_t>(fg.data(), bg.data(), spread, dest);
+}
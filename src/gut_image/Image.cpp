@@ -10,6 +10,7 @@
 
 #include "Image.hpp"
 #include <stdexcept>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -29,6 +30,14 @@
     DST = new TYPE[SIZE]; \
     memcpy(static_cast<TYPE*>(DST), static_cast<TYPE*>(SRC), (SIZE)*sizeof(TYPE));
 
+#define CREATE_ARRAY_COPY_FLIP(TYPE, DST, SRC, ROW_SIZE, N_ROWS)                              \
+    DST = new TYPE[(uint64_t)(ROW_SIZE)*(N_ROWS)];                                          \
+    for (int i=0; i<(N_ROWS); ++i) {                                                        \
+        memcpy(static_cast<TYPE*>(DST) + (uint64_t)i*(ROW_SIZE),                            \
+            static_cast<TYPE*>(SRC) + (uint64_t)((N_ROWS)-1-i)*(ROW_SIZE),                  \
+            (ROW_SIZE)*sizeof(TYPE));                                                       \
+    }
+
 #define CREATE_ARRAY_COPY_CONVERT(DST_TYPE, DST, SRC_TYPE, SRC, SIZE)                       \
     DST = new DST_TYPE[SIZE];                                                               \
     for (int i=0; i<SIZE; ++i) {                                                            \
@@ -82,6 +91,16 @@ namespace {
         dest = (float)src*0.000015259021893f;
     }
 
+    template <>
+    INLINE void convertPixelValue(float& src, uint8_t& dest) {
+        dest = (uint8_t)(std::clamp(src, 0.0f, 1.0f)*255.0f + 0.5f);
+    }
+
+    template <>
+    INLINE void convertPixelValue(float& src, uint16_t& dest) {
+        dest = (uint16_t)(std::clamp(src, 0.0f, 1.0f)*65535.0f + 0.5f);
+    }
+
 };
 
 
@@ -288,7 +307,7 @@ void Image::create(int width, int height)
     _height = height;
 }
 
-void Image::loadFromFile(const std::string& fileName)
+void Image::loadFromFile(const std::string& fileName, bool flipVertically)
 {
     int imgChannels;
     void* imgData = nullptr;
@@ -332,20 +351,36 @@ void Image::loadFromFile(const std::string& fileName)
             break;
     }
 
-    // Copy image data and release resources
+    // Copy image data (flipping the row order during the copy if requested) and release resources
+    int rowSize = _width * imgChannels;
     switch (_dataType) {
         case DataType::U8:
-            CREATE_ARRAY_COPY(uint8_t, _data, imgData, _width * _height * imgChannels);
+            if (flipVertically) {
+                CREATE_ARRAY_COPY_FLIP(uint8_t, _data, imgData, rowSize, _height);
+            }
+            else {
+                CREATE_ARRAY_COPY(uint8_t, _data, imgData, _width * _height * imgChannels);
+            }
             _deleter = dataDeleter<uint8_t>;
             stbi_image_free((stbi_uc*)imgData);
             break;
         case DataType::U16:
-            CREATE_ARRAY_COPY(uint16_t, _data, imgData, _width * _height * imgChannels);
+            if (flipVertically) {
+                CREATE_ARRAY_COPY_FLIP(uint16_t, _data, imgData, rowSize, _height);
+            }
+            else {
+                CREATE_ARRAY_COPY(uint16_t, _data, imgData, _width * _height * imgChannels);
+            }
             _deleter = dataDeleter<uint16_t>;
             stbi_image_free((stbi_us*)imgData);
             break;
         case DataType::F32:
-            CREATE_ARRAY_COPY(float, _data, imgData, _width * _height * imgChannels);
+            if (flipVertically) {
+                CREATE_ARRAY_COPY_FLIP(float, _data, imgData, rowSize, _height);
+            }
+            else {
+                CREATE_ARRAY_COPY(float, _data, imgData, _width * _height * imgChannels);
+            }
             _deleter = dataDeleter<float>;
             stbi_image_free((float*)imgData);
             break;
@@ -0,0 +1,91 @@
+//
+// Project: GraphicsUtils
+// File: ImageHash.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "ImageHash.hpp"
+
+#include <cstdio>
+
+
+using namespace gut;
+
+
+namespace {
+
+    size_t imageDataSize(const Image& image)
+    {
+        if (image.data<void>() == nullptr)
+            return 0;
+
+        return (size_t)image.width()*image.height()*
+            Image::nChannels(image.dataFormat())*Image::dataTypeSize(image.dataType());
+    }
+
+} // namespace
+
+
+ImageHasher::ImageHasher(
+    Image::DataFormat dataFormat,
+    Image::DataType dataType,
+    int width,
+    int height,
+    uint64_t seed
+) :
+    _dataFormat (dataFormat),
+    _dataType   (dataType),
+    _hasher     (seed)
+{
+    // Fixed-width header so that the hash does not depend on enum or int sizes
+    int32_t header[4] = {
+        (int32_t)dataFormat,
+        (int32_t)dataType,
+        (int32_t)width,
+        (int32_t)height
+    };
+    _hasher.update(header, sizeof(header));
+}
+
+void ImageHasher::update(const void* data, size_t size)
+{
+    _hasher.update(data, size);
+}
+
+void ImageHasher::update(const Image& part)
+{
+    if (part.dataFormat() != _dataFormat || part.dataType() != _dataType) {
+        fprintf(stderr, "ERROR: Image part format does not match the hashed image\n"); // TODO logging
+        return;
+    }
+
+    _hasher.update(part.data<void>(), imageDataSize(part));
+}
+
+uint64_t ImageHasher::digest64() const
+{
+    return _hasher.digest64();
+}
+
+Hash128 ImageHasher::digest128() const
+{
+    return _hasher.digest128();
+}
+
+uint64_t gut::hashImage64(const Image& image, uint64_t seed)
+{
+    ImageHasher hasher(image.dataFormat(), image.dataType(), image.width(), image.height(), seed);
+    hasher.update(image);
+    return hasher.digest64();
+}
+
+Hash128 gut::hashImage128(const Image& image, uint64_t seed)
+{
+    ImageHasher hasher(image.dataFormat(), image.dataType(), image.width(), image.height(), seed);
+    hasher.update(image);
+    return hasher.digest128();
+}
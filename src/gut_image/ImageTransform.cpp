@@ -0,0 +1,379 @@
+//
+// Project: GraphicsUtils
+// File: ImageTransform.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "ImageTransform.hpp"
+#include "Image.hpp"
+
+#include <gut_utils/ParallelFor.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_IMAGETRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#ifdef __GNUG__
+#define INLINE inline __attribute__((always_inline))
+#else
+#define INLINE inline
+#endif
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Size of a square tile (in pixels) processed at once by the transpose kernels
+    template <int T_PixelSize>
+    constexpr int transposeTileSize()
+    {
+        return T_PixelSize <= 4 ? 64 : 32;
+    }
+
+    // Pixel sizes with a SIMD kernel, 16 bytes in a register
+    template <int T_PixelSize>
+    constexpr bool hasSIMDKernel()
+    {
+#ifdef GUT_IMAGETRANSFORM_SSE2
+        return T_PixelSize == 1 || T_PixelSize == 2 || T_PixelSize == 4 || T_PixelSize == 8;
+#else
+        return false;
+#endif
+    }
+
+    INLINE void copyPixel(uint8_t* dest, const uint8_t* src, int pixelSize)
+    {
+        memcpy(dest, src, pixelSize);
+    }
+
+#ifdef GUT_IMAGETRANSFORM_SSE2
+    template <int T_LaneSize>
+    INLINE __m128i unpackLo(__m128i a, __m128i b)
+    {
+        if constexpr (T_LaneSize == 1) return _mm_unpacklo_epi8(a, b);
+        else if constexpr (T_LaneSize == 2) return _mm_unpacklo_epi16(a, b);
+        else if constexpr (T_LaneSize == 4) return _mm_unpacklo_epi32(a, b);
+        else return _mm_unpacklo_epi64(a, b);
+    }
+
+    template <int T_LaneSize>
+    INLINE __m128i unpackHi(__m128i a, __m128i b)
+    {
+        if constexpr (T_LaneSize == 1) return _mm_unpackhi_epi8(a, b);
+        else if constexpr (T_LaneSize == 2) return _mm_unpackhi_epi16(a, b);
+        else if constexpr (T_LaneSize == 4) return _mm_unpackhi_epi32(a, b);
+        else return _mm_unpackhi_epi64(a, b);
+    }
+
+    // Reverse order of the lanes in a register
+    template <int T_LaneSize>
+    INLINE __m128i reverseLanes(__m128i v)
+    {
+        if constexpr (T_LaneSize == 1)
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if constexpr (T_LaneSize <= 2) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+        else if constexpr (T_LaneSize == 4)
+            return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        else
+            return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    }
+
+    // One interleaving stage of the register transpose
+    template <int T_N, int T_LaneSize>
+    INLINE void transposeStage(const __m128i (&in)[T_N], __m128i (&out)[T_N])
+    {
+        for (int i=0; i<T_N/2; ++i) {
+            out[i] = unpackLo<T_LaneSize>(in[2*i], in[2*i+1]);
+            out[i+T_N/2] = unpackHi<T_LaneSize>(in[2*i], in[2*i+1]);
+        }
+    }
+
+    // Index of the register holding column i after transposeRegisters(), the interleaving
+    // stages leave the columns in bit-reversed order
+    template <int T_N>
+    constexpr int transposedColumn(int i)
+    {
+        int r = 0;
+        for (int b=1; b<T_N; b<<=1)
+            r = (r << 1) | ((i & b) ? 1 : 0);
+        return r;
+    }
+
+    // Transpose N x N block of pixels held in N registers, N = 16 / T_PixelSize
+    template <int T_PixelSize>
+    INLINE void transposeRegisters(__m128i (&r)[16/T_PixelSize])
+    {
+        constexpr int n = 16/T_PixelSize;
+        __m128i t[n];
+
+        if constexpr (T_PixelSize == 1) {
+            transposeStage<n, 1>(r, t);
+            transposeStage<n, 2>(t, r);
+            transposeStage<n, 4>(r, t);
+            transposeStage<n, 8>(t, r);
+        }
+        else if constexpr (T_PixelSize == 2) {
+            transposeStage<n, 2>(r, t);
+            transposeStage<n, 4>(t, r);
+            transposeStage<n, 8>(r, t);
+            for (int i=0; i<n; ++i)
+                r[i] = t[i];
+        }
+        else if constexpr (T_PixelSize == 4) {
+            transposeStage<n, 4>(r, t);
+            transposeStage<n, 8>(t, r);
+        }
+        else {
+            transposeStage<n, 8>(r, t);
+            for (int i=0; i<n; ++i)
+                r[i] = t[i];
+        }
+    }
+#endif
+
+    // Transpose the source image to destination, optionally reversing the destination rows
+    // and/or columns. Source pixel (x, y) is written to destination row x, column y (before flips).
+    // Destination is of width h and height w.
+    template <int T_PixelSize, bool T_FlipRows, bool T_FlipCols>
+    void transposeTiled(const uint8_t* src, int w, int h, uint8_t* dest)
+    {
+        constexpr int tile = transposeTileSize<T_PixelSize>();
+        constexpr int micro = hasSIMDKernel<T_PixelSize>() ? 16/T_PixelSize : 1;
+
+        auto destRow = [&](int x) {
+            return dest + (int64_t)(T_FlipRows ? w-1-x : x)*h*T_PixelSize;
+        };
+        auto destCol = [&](int y) {
+            return (int64_t)(T_FlipCols ? h-1-y : y)*T_PixelSize;
+        };
+        auto srcPixel = [&](int x, int y) {
+            return src + ((int64_t)y*w + x)*T_PixelSize;
+        };
+        auto copyRect = [&](int x0, int x1, int y0, int y1) {
+            for (int y=y0; y<y1; ++y) {
+                int64_t c = destCol(y);
+                for (int x=x0; x<x1; ++x)
+                    copyPixel(destRow(x) + c, srcPixel(x, y), T_PixelSize);
+            }
+        };
+
+        int nTileRows = (h+tile-1) / tile;
+        parallelFor(0, nTileRows, [&](int64_t tileRowBegin, int64_t tileRowEnd, int) {
+            for (int64_t ty=tileRowBegin; ty<tileRowEnd; ++ty) {
+                int y0 = ty*tile;
+                int y1 = std::min(y0+tile, h);
+
+                for (int x0=0; x0<w; x0+=tile) {
+                    int x1 = std::min(x0+tile, w);
+
+                    int y = y0;
+#ifdef GUT_IMAGETRANSFORM_SSE2
+                    if constexpr (micro > 1) {
+                        for (; y+micro<=y1; y+=micro) {
+                            int x = x0;
+                            for (; x+micro<=x1; x+=micro) {
+                                __m128i r[micro];
+                                for (int i=0; i<micro; ++i)
+                                    r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcPixel(x, y+i)));
+
+                                transposeRegisters<T_PixelSize>(r);
+
+                                int64_t c = destCol(T_FlipCols ? y+micro-1 : y);
+                                for (int i=0; i<micro; ++i) {
+                                    __m128i v = r[transposedColumn<micro>(i)];
+                                    if constexpr (T_FlipCols)
+                                        v = reverseLanes<T_PixelSize>(v);
+                                    _mm_storeu_si128(reinterpret_cast<__m128i*>(destRow(x+i) + c), v);
+                                }
+                            }
+                            copyRect(x, x1, y, y+micro);
+                        }
+                    }
+#endif
+                    copyRect(x0, x1, y, y1);
+                }
+            }
+        }, 1);
+    }
+
+    // Swap pixels left[i] and rightEnd[-1-i] for i in [0, n), the ranges must not overlap
+    template <int T_PixelSize>
+    void swapReversed(uint8_t* left, uint8_t* rightEnd, int64_t n)
+    {
+        int64_t i = 0;
+#ifdef GUT_IMAGETRANSFORM_SSE2
+        if constexpr (hasSIMDKernel<T_PixelSize>()) {
+            constexpr int64_t step = 16/T_PixelSize;
+            for (; i+step<=n; i+=step) {
+                auto* l = reinterpret_cast<__m128i*>(left + i*T_PixelSize);
+                auto* r = reinterpret_cast<__m128i*>(rightEnd - (i+step)*T_PixelSize);
+                __m128i lv = reverseLanes<T_PixelSize>(_mm_loadu_si128(l));
+                __m128i rv = reverseLanes<T_PixelSize>(_mm_loadu_si128(r));
+                _mm_storeu_si128(l, rv);
+                _mm_storeu_si128(r, lv);
+            }
+        }
+#endif
+        uint8_t tmp[T_PixelSize];
+        for (; i<n; ++i) {
+            uint8_t* l = left + i*T_PixelSize;
+            uint8_t* r = rightEnd - (i+1)*T_PixelSize;
+            copyPixel(tmp, l, T_PixelSize);
+            copyPixel(l, r, T_PixelSize);
+            copyPixel(r, tmp, T_PixelSize);
+        }
+    }
+
+    template <int T_PixelSize>
+    void flipHorizontalImpl(uint8_t* data, int w, int h)
+    {
+        int64_t rowSize = (int64_t)w*T_PixelSize;
+        parallelFor(0, h, [&](int64_t yBegin, int64_t yEnd, int) {
+            for (int64_t y=yBegin; y<yEnd; ++y) {
+                uint8_t* row = data + y*rowSize;
+                swapReversed<T_PixelSize>(row, row+rowSize, w/2);
+            }
+        }, 64);
+    }
+
+    template <int T_PixelSize>
+    void rotate180Impl(uint8_t* data, int w, int h)
+    {
+        // Rotation by 180 degrees is reversal of the pixel array
+        int64_t n = (int64_t)w*h;
+        uint8_t* end = data + n*T_PixelSize;
+        parallelFor(0, n/2, [&](int64_t begin, int64_t blockEnd, int) {
+            swapReversed<T_PixelSize>(data + begin*T_PixelSize, end - begin*T_PixelSize, blockEnd-begin);
+        }, 65536);
+    }
+
+    // Call function templated on pixel size, returns false on unsupported pixel size
+    template <template <int> typename T_Dispatcher, typename... T_Args>
+    bool dispatchPixelSize(int pixelSize, T_Args&&... args)
+    {
+        switch (pixelSize) {
+            case 1:     T_Dispatcher<1>::call(args...);  return true;
+            case 2:     T_Dispatcher<2>::call(args...);  return true;
+            case 3:     T_Dispatcher<3>::call(args...);  return true;
+            case 4:     T_Dispatcher<4>::call(args...);  return true;
+            case 6:     T_Dispatcher<6>::call(args...);  return true;
+            case 8:     T_Dispatcher<8>::call(args...);  return true;
+            case 12:    T_Dispatcher<12>::call(args...); return true;
+            case 16:    T_Dispatcher<16>::call(args...); return true;
+            default:    return false;
+        }
+    }
+
+    template <int T_PixelSize>
+    struct FlipHorizontalDispatcher {
+        static void call(uint8_t* data, int w, int h) { flipHorizontalImpl<T_PixelSize>(data, w, h); }
+    };
+
+    template <int T_PixelSize>
+    struct Rotate180Dispatcher {
+        static void call(uint8_t* data, int w, int h) { rotate180Impl<T_PixelSize>(data, w, h); }
+    };
+
+    template <bool T_FlipRows, bool T_FlipCols>
+    struct TransposeDispatcher {
+        template <int T_PixelSize>
+        struct Type {
+            static void call(const uint8_t* src, int w, int h, uint8_t* dest)
+            {
+                transposeTiled<T_PixelSize, T_FlipRows, T_FlipCols>(src, w, h, dest);
+            }
+        };
+    };
+
+    INLINE int pixelSize(const Image& image)
+    {
+        return Image::nChannels(image.dataFormat()) * (int)Image::dataTypeSize(image.dataType());
+    }
+
+    template <bool T_FlipRows, bool T_FlipCols>
+    void transposeImage(const Image& src, Image& dest)
+    {
+        dest = Image(src.dataFormat(), src.dataType());
+        if (src.data<void>() == nullptr)
+            return;
+
+        dest.create(src.height(), src.width());
+
+        if (!dispatchPixelSize<TransposeDispatcher<T_FlipRows, T_FlipCols>::template Type>(pixelSize(src),
+            static_cast<const uint8_t*>(src.data<void>()), src.width(), src.height(),
+            static_cast<uint8_t*>(dest.data<void>())))
+            fprintf(stderr, "ERROR: Unable to transform image: invalid data type\n"); // TODO logging
+    }
+
+} // namespace
+
+
+void gut::flipVertical(Image& image)
+{
+    auto* data = static_cast<uint8_t*>(image.data<void>());
+    if (data == nullptr)
+        return;
+
+    int64_t rowSize = (int64_t)image.width()*pixelSize(image);
+    int h = image.height();
+    parallelFor(0, h/2, [&](int64_t yBegin, int64_t yEnd, int) {
+        for (int64_t y=yBegin; y<yEnd; ++y) {
+            uint8_t* row1 = data + y*rowSize;
+            uint8_t* row2 = data + (h-1-y)*rowSize;
+            std::swap_ranges(row1, row1+rowSize, row2);
+        }
+    }, 64);
+}
+
+void gut::flipHorizontal(Image& image)
+{
+    auto* data = static_cast<uint8_t*>(image.data<void>());
+    if (data == nullptr)
+        return;
+
+    if (!dispatchPixelSize<FlipHorizontalDispatcher>(pixelSize(image), data, image.width(), image.height()))
+        fprintf(stderr, "ERROR: Unable to flip image: invalid data type\n"); // TODO logging
+}
+
+void gut::rotate180(Image& image)
+{
+    auto* data = static_cast<uint8_t*>(image.data<void>());
+    if (data == nullptr)
+        return;
+
+    if (!dispatchPixelSize<Rotate180Dispatcher>(pixelSize(image), data, image.width(), image.height()))
+        fprintf(stderr, "ERROR: Unable to rotate image: invalid data type\n"); // TODO logging
+}
+
+void gut::transpose(const Image& src, Image& dest)
+{
+    transposeImage<false, false>(src, dest);
+}
+
+void gut::rotate90(const Image& src, Image& dest)
+{
+    // Source pixel (x, y) maps to destination pixel (h-1-y, x)
+    transposeImage<false, true>(src, dest);
+}
+
+void gut::rotate270(const Image& src, Image& dest)
+{
+    // Source pixel (x, y) maps to destination pixel (y, w-1-x)
+    transposeImage<true, false>(src, dest);
+}
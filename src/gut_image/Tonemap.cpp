@@ -0,0 +1,282 @@
+//
+// Project: GraphicsUtils
+// File: Tonemap.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "Tonemap.hpp"
+#include "Image.hpp"
+
+#include <gut_utils/ParallelFor.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_TONEMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#ifdef __GNUG__
+#define INLINE inline __attribute__((always_inline))
+#else
+#define INLINE inline
+#endif
+
+
+using namespace gut;
+
+
+namespace {
+
+    // 8x8 Bayer matrix for ordered dithering
+    constexpr int bayerMatrix[64] = {
+         0, 32,  8, 40,  2, 34, 10, 42,
+        48, 16, 56, 24, 50, 18, 58, 26,
+        12, 44,  4, 36, 14, 46,  6, 38,
+        60, 28, 52, 20, 62, 30, 54, 22,
+         3, 35, 11, 43,  1, 33,  9, 41,
+        51, 19, 59, 27, 49, 17, 57, 25,
+        15, 47,  7, 39, 13, 45,  5, 37,
+        63, 31, 55, 23, 61, 29, 53, 21
+    };
+
+    // Uncharted 2 curve constants
+    constexpr float hableA = 0.15f;
+    constexpr float hableB = 0.50f;
+    constexpr float hableC = 0.10f;
+    constexpr float hableD = 0.20f;
+    constexpr float hableE = 0.02f;
+    constexpr float hableF = 0.30f;
+
+    // ACES fitted curve constants
+    constexpr float acesA = 2.51f;
+    constexpr float acesB = 0.03f;
+    constexpr float acesC = 2.43f;
+    constexpr float acesD = 0.59f;
+    constexpr float acesE = 0.14f;
+
+    // Below this the sRGB transfer function is linear
+    constexpr float srgbLinearThreshold = 0.0031308f;
+
+    // Curve input limit, keeps the squares in the rational curves finite (+inf maps to white)
+    constexpr float curveInputMax = 1.0e15f;
+
+    struct TonemapParameters {
+        float   exposureScale;  // linear exposure multiplier
+        float   whiteScale;     // reciprocal of the curve value at the white point
+        bool    srgbEncode;
+    };
+
+    INLINE float hable(float x)
+    {
+        return (x*(hableA*x + hableC*hableB) + hableD*hableE) /
+            (x*(hableA*x + hableB) + hableD*hableF) - hableE/hableF;
+    }
+
+    template <TonemapCurve T_Curve>
+    INLINE float applyCurve(float x, const TonemapParameters& p)
+    {
+        // NaN and negative values map to 0 like in the SIMD path
+        x *= p.exposureScale;
+        x = x > 0.0f ? std::min(x, curveInputMax) : 0.0f;
+        if constexpr (T_Curve == TonemapCurve::REINHARD)
+            return x / (1.0f + x);
+        else if constexpr (T_Curve == TonemapCurve::ACES_FITTED)
+            return (x*(acesA*x + acesB)) / (x*(acesC*x + acesD) + acesE);
+        else if constexpr (T_Curve == TonemapCurve::HABLE)
+            return hable(x) * p.whiteScale;
+        else
+            return x;
+    }
+
+    // sRGB transfer function, the power segment is approximated with a combination of
+    // square roots (max error well below half of a 8-bit quantization step)
+    INLINE float linearToSRGB(float x)
+    {
+        x = std::clamp(x, 0.0f, 1.0f);
+        if (x <= srgbLinearThreshold)
+            return 12.92f*x;
+
+        float s1 = std::sqrt(x);
+        float s2 = std::sqrt(s1);
+        float s3 = std::sqrt(s2);
+        return 0.662002687f*s1 + 0.684122060f*s2 - 0.323583601f*s3 - 0.0225411470f*x;
+    }
+
+    // Tonemap a single component, ditherOffset in quantization steps, [0, 1)
+    template <TonemapCurve T_Curve>
+    INLINE uint8_t tonemapValue(float x, bool alpha, float ditherOffset, const TonemapParameters& p)
+    {
+        if (!alpha) {
+            x = applyCurve<T_Curve>(x, p);
+            if (p.srgbEncode)
+                x = linearToSRGB(x);
+        }
+        x = x > 0.0f ? std::min(x, 1.0f) : 0.0f; // NaN to 0
+        return (uint8_t)std::min(x*255.0f + ditherOffset, 255.0f);
+    }
+
+#ifdef GUT_TONEMAP_SSE2
+    INLINE __m128 hable(__m128 x)
+    {
+        __m128 n = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(hableA), x),
+            _mm_set1_ps(hableC*hableB))), _mm_set1_ps(hableD*hableE));
+        __m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(hableA), x),
+            _mm_set1_ps(hableB))), _mm_set1_ps(hableD*hableF));
+        return _mm_sub_ps(_mm_div_ps(n, d), _mm_set1_ps(hableE/hableF));
+    }
+
+    template <TonemapCurve T_Curve>
+    INLINE __m128 applyCurve(__m128 x, const TonemapParameters& p)
+    {
+        // _mm_max_ps returns the second operand for NaN
+        x = _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(p.exposureScale)), _mm_setzero_ps());
+        x = _mm_min_ps(x, _mm_set1_ps(curveInputMax));
+        if constexpr (T_Curve == TonemapCurve::REINHARD)
+            return _mm_div_ps(x, _mm_add_ps(x, _mm_set1_ps(1.0f)));
+        else if constexpr (T_Curve == TonemapCurve::ACES_FITTED) {
+            __m128 n = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(acesA), x), _mm_set1_ps(acesB)));
+            __m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(acesC), x),
+                _mm_set1_ps(acesD))), _mm_set1_ps(acesE));
+            return _mm_div_ps(n, d);
+        }
+        else if constexpr (T_Curve == TonemapCurve::HABLE)
+            return _mm_mul_ps(hable(x), _mm_set1_ps(p.whiteScale));
+        else
+            return x;
+    }
+
+    INLINE __m128 clamp01(__m128 x)
+    {
+        return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    }
+
+    INLINE __m128 linearToSRGB(__m128 x)
+    {
+        x = clamp01(x);
+        __m128 s1 = _mm_sqrt_ps(x);
+        __m128 s2 = _mm_sqrt_ps(s1);
+        __m128 s3 = _mm_sqrt_ps(s2);
+        __m128 power = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.662002687f), s1),
+            _mm_mul_ps(_mm_set1_ps(0.684122060f), s2));
+        power = _mm_sub_ps(power, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.323583601f), s3),
+            _mm_mul_ps(_mm_set1_ps(0.0225411470f), x)));
+        __m128 linear = _mm_mul_ps(_mm_set1_ps(12.92f), x);
+        __m128 isLinear = _mm_cmple_ps(x, _mm_set1_ps(srgbLinearThreshold));
+        return _mm_or_ps(_mm_and_ps(isLinear, linear), _mm_andnot_ps(isLinear, power));
+    }
+
+    // Tonemap 4 components, alphaMask has all bits set on lanes containing alpha
+    template <TonemapCurve T_Curve>
+    INLINE __m128i tonemapVector(__m128 x, __m128 alphaMask, __m128 ditherOffset, const TonemapParameters& p)
+    {
+        __m128 c = applyCurve<T_Curve>(x, p);
+        if (p.srgbEncode)
+            c = linearToSRGB(c);
+        c = _mm_or_ps(_mm_and_ps(alphaMask, x), _mm_andnot_ps(alphaMask, c));
+        c = _mm_add_ps(_mm_mul_ps(clamp01(c), _mm_set1_ps(255.0f)), ditherOffset);
+        return _mm_cvttps_epi32(_mm_min_ps(c, _mm_set1_ps(255.0f)));
+    }
+#endif
+
+    // Tonemap a row of n components. ditherOffsets contains the repeating per-component
+    // offsets for the row, padded with 16 values for unaligned SIMD access.
+    template <TonemapCurve T_Curve>
+    void tonemapRow(const float* src, uint8_t* dest, int64_t n, int nChannels,
+        const float* ditherOffsets, int ditherPeriod, const TonemapParameters& p)
+    {
+        int64_t i = 0;
+#ifdef GUT_TONEMAP_SSE2
+        // RGBA pixels are aligned to the 4-wide vectors, alpha is in the last lane
+        __m128 alphaMask = nChannels == 4 ?
+            _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)) : _mm_setzero_ps();
+
+        for (; i+16<=n; i+=16) {
+            const float* o = ditherOffsets + (i % ditherPeriod);
+            __m128i v0 = tonemapVector<T_Curve>(_mm_loadu_ps(src+i), alphaMask, _mm_loadu_ps(o), p);
+            __m128i v1 = tonemapVector<T_Curve>(_mm_loadu_ps(src+i+4), alphaMask, _mm_loadu_ps(o+4), p);
+            __m128i v2 = tonemapVector<T_Curve>(_mm_loadu_ps(src+i+8), alphaMask, _mm_loadu_ps(o+8), p);
+            __m128i v3 = tonemapVector<T_Curve>(_mm_loadu_ps(src+i+12), alphaMask, _mm_loadu_ps(o+12), p);
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest+i), packed);
+        }
+#endif
+        for (; i<n; ++i) {
+            bool alpha = nChannels == 4 && i % 4 == 3;
+            dest[i] = tonemapValue<T_Curve>(src[i], alpha, ditherOffsets[i % ditherPeriod], p);
+        }
+    }
+
+    template <TonemapCurve T_Curve>
+    void tonemapImage(const Image& src, Image& dest, const TonemapSettings& settings)
+    {
+        TonemapParameters p;
+        p.exposureScale = std::exp2(settings.exposure);
+        p.whiteScale = T_Curve == TonemapCurve::HABLE ? 1.0f / hable(settings.whitePoint) : 1.0f;
+        p.srgbEncode = settings.srgbEncode;
+
+        int w = src.width();
+        int h = src.height();
+        int nChannels = Image::nChannels(src.dataFormat());
+        int64_t rowSize = (int64_t)w*nChannels;
+        int ditherPeriod = 8*nChannels; // components in 8 pixels, multiple of 4
+
+        const float* srcData = src.data<float>();
+        uint8_t* destData = dest.data<uint8_t>();
+
+        parallelFor(0, h, [&](int64_t yBegin, int64_t yEnd, int) {
+            std::vector<float> ditherOffsets(ditherPeriod+16);
+
+            for (int64_t y=yBegin; y<yEnd; ++y) {
+                // Offset added before truncation: 0.5 for rounding, Bayer matrix threshold for dithering
+                for (int i=0; i<(int)ditherOffsets.size(); ++i) {
+                    int x = (i % ditherPeriod) / nChannels;
+                    ditherOffsets[i] = settings.dither ?
+                        ((float)bayerMatrix[(y%8)*8 + x%8] + 0.5f) / 64.0f : 0.5f;
+                }
+
+                tonemapRow<T_Curve>(srcData + y*rowSize, destData + y*rowSize, rowSize, nChannels,
+                    ditherOffsets.data(), ditherPeriod, p);
+            }
+        }, 16);
+    }
+
+} // namespace
+
+
+void gut::tonemap(const Image& src, Image& dest, const TonemapSettings& settings)
+{
+    if (src.dataType() != Image::DataType::F32) {
+        fprintf(stderr, "ERROR: Unable to tonemap image: source data type must be F32\n"); // TODO logging
+        return;
+    }
+
+    dest = Image(src.dataFormat(), Image::DataType::U8);
+    if (src.data<void>() == nullptr)
+        return;
+
+    dest.create(src.width(), src.height());
+
+    switch (settings.curve) {
+        case TonemapCurve::LINEAR:
+            tonemapImage<TonemapCurve::LINEAR>(src, dest, settings);
+            break;
+        case TonemapCurve::REINHARD:
+            tonemapImage<TonemapCurve::REINHARD>(src, dest, settings);
+            break;
+        case TonemapCurve::ACES_FITTED:
+            tonemapImage<TonemapCurve::ACES_FITTED>(src, dest, settings);
+            break;
+        case TonemapCurve::HABLE:
+            tonemapImage<TonemapCurve::HABLE>(src, dest, settings);
+            break;
+    }
+}
@@ -13,9 +13,13 @@
 #include "Mesh.hpp"
 
 #include <gut_utils/VertexData.hpp>
+#include <gut_utils/MeshBatching.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
+#include <numeric>
+#include <utility>
 #include <cstdio>
 #include <iostream> // TODO temp
 
@@ -25,6 +29,11 @@ using Json = nlohmann::json;
 using Path = std::filesystem::path;
 
 
+GLTFLoader::GLTFLoader(std::pmr::memory_resource* resource) :
+    _resource   (resource)
+{
+}
+
 void GLTFLoader::loadFromFile(const std::string& filename)
 {
     clear();
@@ -151,23 +160,79 @@ void GLTFLoader::loadFromFile(const std::string& filename)
     printf("---- PARSED %lu SCENES ----\n", _scenes.size()); // TODO remove debug print
 }
 
-void GLTFLoader::constructObjects(gut::Node& root, Vector<gut::Mesh>& meshes)
+void GLTFLoader::constructObjects(gut::Node& root, Vector<gut::Mesh>& meshes, bool batch)
 {
     _meshPrimitiveFlattenedIds.clear();
     _meshPrimitiveFlattenedIds.resize(_meshes.size());
+    _meshPrimitiveSubMeshIds.clear();
+    _meshPrimitiveSubMeshIds.resize(_meshes.size());
+
+    // Vertex data of the primitives to be batched and their (mesh, primitive) ids
+    Vector<VertexData> batchVertexData;
+    Vector<std::pair<size_t, size_t>> batchPrimitiveIds;
+
     for (size_t i=0; i<_meshes.size(); ++i) {
         auto& mesh = _meshes[i];
         printf("N. of primitives: %lu\n", mesh.primitives.size());
-        for (auto& primitive : mesh.primitives) {
+        _meshPrimitiveFlattenedIds[i].resize(mesh.primitives.size());
+        _meshPrimitiveSubMeshIds[i].resize(mesh.primitives.size(), -1);
+        for (size_t j=0; j<mesh.primitives.size(); ++j) {
+            VertexData vertexData;
+            createVertexDataFromMeshPrimitive(vertexData, mesh.primitives[j]);
+            if (batch && vertexData.isValid()) {
+                batchVertexData.emplace_back(std::move(vertexData));
+                batchPrimitiveIds.emplace_back(i, j);
+                continue;
+            }
+
             // save the new vector location as gltf mesh primitives are flattened into gut::Meshes
-            _meshPrimitiveFlattenedIds[i].emplace_back(meshes.size());
+            _meshPrimitiveFlattenedIds[i][j] = meshes.size();
             meshes.emplace_back();
-            VertexData vertexData;
-            createVertexDataFromMeshPrimitive(vertexData, primitive);
             meshes.back().loadFromVertexData(vertexData);
         }
     }
 
+    // Group the compatible primitives, one gut::Mesh per group
+    Vector<Vector<size_t>> groups;
+    for (size_t i=0; i<batchVertexData.size(); ++i) {
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const Vector<size_t>& g) {
+            return isBatchCompatible(batchVertexData[g[0]], batchVertexData[i]);
+        });
+        if (group == groups.end())
+            groups.emplace_back(1, i);
+        else
+            group->emplace_back(i);
+    }
+
+    for (auto& group : groups) {
+        Vector<const VertexData*> sources;
+        for (auto& i : group)
+            sources.emplace_back(&batchVertexData[i]);
+
+        // Indices local to the primitives keep the index type narrow
+        VertexData merged;
+        Vector<SubMesh> subMeshes;
+        if (!mergeVertexData(sources, merged, subMeshes, false)) {
+            // Fall back to a gut::Mesh per primitive
+            for (auto& i : group) {
+                auto [meshId, primitiveId] = batchPrimitiveIds[i];
+                _meshPrimitiveFlattenedIds[meshId][primitiveId] = meshes.size();
+                meshes.emplace_back();
+                meshes.back().loadFromVertexData(batchVertexData[i]);
+            }
+            continue;
+        }
+
+        for (size_t k=0; k<group.size(); ++k) {
+            auto [meshId, primitiveId] = batchPrimitiveIds[group[k]];
+            _meshPrimitiveFlattenedIds[meshId][primitiveId] = meshes.size();
+            _meshPrimitiveSubMeshIds[meshId][primitiveId] = k;
+        }
+        meshes.emplace_back();
+        meshes.back().loadFromVertexData(merged);
+        meshes.back().setSubMeshes(subMeshes);
+    }
+
     for (auto& scene : _scenes) { // TODO maybe implement Scene class? (scene switching etc.)
         // Flatten all scenes directly to root node for now
         createNodeChildren(root, scene.nodes);
@@ -183,6 +248,7 @@ void GLTFLoader::clear()
     _meshes.clear();
     _scenes.clear();
     _meshPrimitiveFlattenedIds.clear();
+    _meshPrimitiveSubMeshIds.clear();
 }
 
 void GLTFLoader::createNodeChildren(gut::Node& parent, const Vector<size_t>& children) const
@@ -191,8 +257,10 @@ void GLTFLoader::createNodeChildren(gut::Node& parent, const Vector<size_t>& chi
         // construct each child node
         auto& child = _nodes[childId];
         parent._children.emplace_back(createNodeTransfomation(child));
-        if (child.mesh >= 0)
+        if (child.mesh >= 0) {
             parent._children.back()._meshIds = _meshPrimitiveFlattenedIds[child.mesh];
+            parent._children.back()._subMeshIds = _meshPrimitiveSubMeshIds[child.mesh];
+        }
 
         // recurse to grandchildren
         createNodeChildren(parent._children.back(), child.children);
@@ -218,18 +286,26 @@ void GLTFLoader::createVertexDataFromMeshPrimitive(
         //5123 UNSIGNED_SHORT
         //5125 UNSIGNED_INT
         //5126 FLOAT
-        assert(accessor.componentType == 5123); // TODO support other data types
-
-        // raw unsigned short pointer to the buffer, according to bufferView
-        auto* indicesBufferView = reinterpret_cast<const uint16_t*>(
-            _buffers.at(bufferView.buffer).data() + bufferView.byteOffset);
-        size_t accessorOffset = accessor.byteOffset / sizeof(uint16_t); // offset in elements
-        Vector<unsigned> indices;
-        indices.reserve(accessor.count);
-        for (size_t i=0; i<accessor.count; ++i) {
-            indices.emplace_back(indicesBufferView[accessorOffset+i]);
+        // raw pointer to the buffer, according to bufferView and accessor
+        const char* indicesData = _buffers.at(bufferView.buffer).data() +
+            bufferView.byteOffset + accessor.byteOffset;
+        Vector<unsigned> indices(accessor.count);
+        auto readIndices = [&](auto* p) {
+            using T_Index = std::remove_pointer_t<decltype(p)>;
+            auto* indicesBufferView = reinterpret_cast<const T_Index*>(indicesData);
+            for (size_t i=0; i<accessor.count; ++i)
+                indices[i] = indicesBufferView[i];
+        };
+        switch (accessor.componentType) {
+            case 5121: readIndices(static_cast<uint8_t*>(nullptr)); break;
+            case 5123: readIndices(static_cast<uint16_t*>(nullptr)); break;
+            case 5125: readIndices(static_cast<uint32_t*>(nullptr)); break;
+            default:
+                fprintf(stderr, "ERROR: Invalid index component type %d\n",
+                    accessor.componentType); // TODO logging
+                return;
         }
-        vertexData.setIndices(indices);
+        vertexData.setIndices(std::move(indices));
     }
 
     assert(primitive.mode == 4); // TODO support other modes than triangles
@@ -245,23 +321,30 @@ void GLTFLoader::createVertexDataFromMeshPrimitive(
                 accessor.bufferView, accessor.byteOffset, accessor.componentType, accessor.count, accessor.type.c_str());
 
             assert(accessor.type == "VEC3");
-            vertexData.addDataVector<Vec3f>("position");
 
             // raw Vec3f pointer to the buffer, according to bufferView
             auto* dataBufferView = reinterpret_cast<const Vec3f*>(
                 _buffers.at(bufferView.buffer).data() + bufferView.byteOffset);
             size_t accessorOffset = accessor.byteOffset / sizeof(Vec3f); // offset in elements
-            Vector<Vec3f> data;
-            data.reserve(accessor.count);
-            for (size_t i=0; i<accessor.count; ++i) {
-                data.emplace_back(dataBufferView[accessorOffset+i]);
-            }
 
-            vertexData.addData<Vec3f>("position", data);
+            // copied directly to the container, no intermediate vector
+            Vec3f* positions = vertexData.allocateData<Vec3f>("position", accessor.count, _resource);
+            if (positions == nullptr)
+                return;
+            std::copy(dataBufferView+accessorOffset, dataBufferView+accessorOffset+accessor.count, positions);
             printf("      type: %s\n", accessor.type.c_str());
 
         }
     }
 
-    assert(vertexData.validate());
+    // Non-indexed primitive, one index per vertex
+    const auto* positions = std::as_const(vertexData).accessData("position");
+    if (primitive.indices < 0 && positions != nullptr) {
+        Vector<unsigned> indices(positions->size());
+        std::iota(indices.begin(), indices.end(), 0u);
+        vertexData.setIndices(std::move(indices));
+    }
+
+    if (!vertexData.validate())
+        fprintf(stderr, "ERROR: VertexData validation failed\n"); // TODO logging
 }
@@ -12,7 +12,9 @@
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "gut_utils/VertexData.hpp"
+#include "gut_utils/VertexPacking.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <array>
 #include <map>
@@ -20,22 +22,123 @@
 #include <cstdio>
 #include <cstring>
 #include <cctype>
+#include <cmath>
 
 
 using namespace gut;
 
 
+namespace {
+
+    struct AttributeFormat {
+        GLint       nComponents;
+        GLenum      type;
+        GLboolean   normalized;
+    };
+
+    // Vertex attribute format for a data type, nComponents is 0 for unsupported types
+    AttributeFormat attributeFormat(MathTypeEnum type)
+    {
+        switch (type) {
+            case MathTypeEnum::FLOAT:   return { 1, GL_FLOAT, GL_FALSE };
+            case MathTypeEnum::VEC2F:   return { 2, GL_FLOAT, GL_FALSE };
+            case MathTypeEnum::VEC3F:   return { 3, GL_FLOAT, GL_FALSE };
+            case MathTypeEnum::VEC4F:   return { 4, GL_FLOAT, GL_FALSE };
+            case MathTypeEnum::VEC2I:   return { 2, GL_INT, GL_FALSE };
+            case MathTypeEnum::VEC3I:   return { 3, GL_INT, GL_FALSE };
+            case MathTypeEnum::VEC4I:   return { 4, GL_INT, GL_FALSE };
+            case MathTypeEnum::VEC2B:   return { 2, GL_BYTE, GL_TRUE };
+            case MathTypeEnum::VEC2S:   return { 2, GL_SHORT, GL_TRUE };
+            case MathTypeEnum::VEC4US:  return { 3, GL_UNSIGNED_SHORT, GL_TRUE }; // 4th component is padding
+            case MathTypeEnum::VEC2H:   return { 2, GL_HALF_FLOAT, GL_FALSE };
+            default:                    return { 0, GL_FLOAT, GL_FALSE };
+        }
+    }
+
+    // Vertex attributes bound by Mesh and the data types accepted for them
+    struct MeshAttribute {
+        const char*     name;
+        const char*     description;
+        GLuint          location;
+        MathTypeEnum    types[3];
+        int             nTypes;
+
+        bool accepts(MathTypeEnum type) const
+        {
+            return std::find(types, types+nTypes, type) != types+nTypes;
+        }
+    };
+
+    const MeshAttribute meshAttributes[] = {
+        { "position", "position", 0, { MathTypeEnum::VEC3F, MathTypeEnum::VEC4US }, 2 },
+        { "normal", "normal", 1, { MathTypeEnum::VEC3F, MathTypeEnum::VEC2B, MathTypeEnum::VEC2S }, 3 },
+        { "texCoord", "texture coordinate", 2, { MathTypeEnum::VEC2F, MathTypeEnum::VEC2H }, 2 },
+        { "color", "color", 3, { MathTypeEnum::VEC3F }, 1 }
+    };
+    constexpr int nMeshAttributes = sizeof(meshAttributes) / sizeof(MeshAttribute);
+
+    inline bool isOctahedral(MathTypeEnum type)
+    {
+        return type == MathTypeEnum::VEC2B || type == MathTypeEnum::VEC2S;
+    }
+
+    void setAttributePointer(GLuint location, MathTypeEnum type, GLsizei stride, uintptr_t offset)
+    {
+        auto format = attributeFormat(type);
+        glEnableVertexAttribArray(location);
+        if (format.type == GL_INT)
+            glVertexAttribIPointer(location, format.nComponents, format.type, stride, (GLvoid*)offset);
+        else
+            glVertexAttribPointer(location, format.nComponents, format.type, format.normalized, stride,
+                (GLvoid*)offset);
+    }
+
+    // Upload indices to the bound element buffer in the narrowest type, returns the GL index type
+    GLenum uploadIndices(const Vector<unsigned>& indices, VertexData::IndexType indexType)
+    {
+        size_t size = indices.size() * VertexData::indexTypeSize(indexType);
+        if (indexType == VertexData::IndexType::U32) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices.data(), GL_STATIC_DRAW);
+            return GL_UNSIGNED_INT;
+        }
+
+        Vector<uint8_t> packed(size);
+        VertexData::packIndices(indices, indexType, packed.data());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, packed.data(), GL_STATIC_DRAW);
+        return indexType == VertexData::IndexType::U8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+    }
+
+    // Object space bounds of the mesh, quantized positions fill the unit cube
+    Bounds objectBounds(MathTypeEnum positionType, const Bounds& positionBounds, const Mat4f& positionTransform)
+    {
+        if (positionType == MathTypeEnum::VEC3F)
+            return transformBounds(positionBounds, positionTransform);
+
+        Bounds unitCube;
+        unitCube.minimum = Vec3f::Zero();
+        unitCube.maximum = Vec3f::Ones();
+        unitCube.sphere = Vec4f(0.5f, 0.5f, 0.5f, 0.5f*std::sqrt(3.0f));
+        return transformBounds(unitCube, positionTransform);
+    }
+
+} // namespace
+
+
 Mesh::Mesh(void) :
     _vertexArrayObjectId    (0),
     _positionBufferId       (0),
     _normalBufferId         (0),
     _texCoordBufferId       (0),
     _colorBufferId          (0),
+    _vertexBufferId         (0),
     _elementBufferId        (0),
     _nIndices               (0),
+    _indexType              (GL_UNSIGNED_INT),
     _usingNormals           (false),
     _usingTexCoords         (false),
-    _usingColors            (false)
+    _usingColors            (false),
+    _octahedralNormals      (false),
+    _positionTransform      (Mat4f::Identity())
 {}
 
 Mesh::Mesh(Mesh&& other) noexcept :
@@ -44,47 +147,80 @@ Mesh::Mesh(Mesh&& other) noexcept :
     _normalBufferId         (other._normalBufferId),
     _texCoordBufferId       (other._texCoordBufferId),
     _colorBufferId          (other._colorBufferId),
+    _vertexBufferId         (other._vertexBufferId),
     _elementBufferId        (other._elementBufferId),
     _nIndices               (other._nIndices),
+    _indexType              (other._indexType),
     _usingNormals           (other._usingNormals),
     _usingTexCoords         (other._usingTexCoords),
-    _usingColors            (other._usingColors)
+    _usingColors            (other._usingColors),
+    _octahedralNormals      (other._octahedralNormals),
+    _positionTransform      (other._positionTransform),
+    _bounds                 (other._bounds),
+    _subMeshes              (std::move(other._subMeshes)),
+    _uniformLocations       (other._uniformLocations)
 {
     other._vertexArrayObjectId = 0;
     other._positionBufferId = 0;
     other._normalBufferId = 0;
     other._texCoordBufferId = 0;
     other._colorBufferId = 0;
+    other._vertexBufferId = 0;
     other._elementBufferId = 0;
     other._nIndices = 0;
+    other._indexType = GL_UNSIGNED_INT;
     other._usingNormals = false;
     other._usingTexCoords = false;
     other._usingColors = false;
+    other._octahedralNormals = false;
+    other._positionTransform = Mat4f::Identity();
+    other._bounds = Bounds();
+    other._subMeshes.clear();
+    other._uniformLocations = UniformLocations();
 }
 
 Mesh& Mesh::operator=(Mesh&& other) noexcept
 {
+    if (this == &other)
+        return *this;
+
+    reset();
+
     _vertexArrayObjectId    = other._vertexArrayObjectId;
     _positionBufferId       = other._positionBufferId;
     _normalBufferId         = other._normalBufferId;
     _texCoordBufferId       = other._texCoordBufferId;
     _colorBufferId          = other._colorBufferId;
+    _vertexBufferId         = other._vertexBufferId;
     _elementBufferId        = other._elementBufferId;
     _nIndices               = other._nIndices;
+    _indexType              = other._indexType;
     _usingNormals           = other._usingNormals;
     _usingTexCoords         = other._usingTexCoords;
     _usingColors            = other._usingColors;
+    _octahedralNormals      = other._octahedralNormals;
+    _positionTransform      = other._positionTransform;
+    _bounds                 = other._bounds;
+    _subMeshes              = std::move(other._subMeshes);
+    _uniformLocations       = other._uniformLocations;
 
     other._vertexArrayObjectId = 0;
     other._positionBufferId = 0;
     other._normalBufferId = 0;
     other._texCoordBufferId = 0;
     other._colorBufferId = 0;
+    other._vertexBufferId = 0;
     other._elementBufferId = 0;
     other._nIndices = 0;
+    other._indexType = GL_UNSIGNED_INT;
     other._usingNormals = false;
     other._usingTexCoords = false;
     other._usingColors = false;
+    other._octahedralNormals = false;
+    other._positionTransform = Mat4f::Identity();
+    other._bounds = Bounds();
+    other._subMeshes.clear();
+    other._uniformLocations = UniformLocations();
 
     return *this;
 }
@@ -93,132 +229,222 @@ Mesh::~Mesh(void) {
     reset();
 }
 
-void Mesh::loadFromVertexData(const VertexData& vertexData)
+void Mesh::loadFromVertexData(const VertexData& vertexData, bool interleaved,
+                              const Mat4f& positionTransform)
 {
     if (!vertexData.isValid()) {
         fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
         return;
     }
 
-    auto* positionContainer = vertexData.accessData("position");
-    if (positionContainer == nullptr) {
+    if (vertexData.accessData("position") == nullptr) {
         fprintf(stderr, "ERROR: No position data in VertexData\n"); // TODO logging
         return;
     }
-    // Check position data type
-    if (positionContainer->type != MathTypeEnum::VEC3F) {
-        fprintf(stderr, "ERROR: Invalid data type for position data\n"); // TODO logging
-        return;
-    }
 
-    auto* normalContainer = vertexData.accessData("normal");
-    bool usingNormals = false;
-    if (normalContainer != nullptr) {
-        if (normalContainer->type != MathTypeEnum::VEC3F) {
-            fprintf(stderr, "ERROR: Invalid data type for normal data\n"); // TODO logging
+    // Check the data types
+    const VertexData::Container* containers[nMeshAttributes];
+    for (int i=0; i<nMeshAttributes; ++i) {
+        containers[i] = vertexData.accessData(meshAttributes[i].name);
+        if (containers[i] != nullptr && !meshAttributes[i].accepts(containers[i]->type)) {
+            fprintf(stderr, "ERROR: Invalid data type for %s data\n", meshAttributes[i].description); // TODO logging
             return;
         }
-        usingNormals = true;
     }
 
-    auto* texCoordContainer = vertexData.accessData("texCoord");
-    bool usingTexCoords = false;
-    if (texCoordContainer != nullptr) {
-        if (texCoordContainer->type != MathTypeEnum::VEC2F) {
-            fprintf(stderr, "ERROR: Invalid data type for texture coordinate data\n"); // TODO logging
-            return;
-        }
-        usingTexCoords = true;
-    }
+    if (interleaved) {
+        Vector<std::string> attributes;
+        for (int i=0; i<nMeshAttributes; ++i)
+            if (containers[i] != nullptr)
+                attributes.emplace_back(meshAttributes[i].name);
 
-    auto* colorContainer = vertexData.accessData("color");
-    bool usingColors = false;
-    if (colorContainer != nullptr) {
-        if (colorContainer->type != MathTypeEnum::VEC3F) {
-            fprintf(stderr, "ERROR: Invalid data type for color data\n"); // TODO logging
+        PackedVertexBuffer layout;
+        if (!layoutVertexData(vertexData, layout, VertexPackingSettings(attributes)))
             return;
-        }
-        usingColors = true;
+
+        // Index type and bounds are known from the validation, the vertices are packed
+        // straight into the vertex buffer
+        AttributeBinding bindings[nMeshAttributes];
+        int nBindings = packedBindings(layout, bindings);
+        loadInterleaved(nullptr, layout.nVertices, layout.stride, bindings, nBindings,
+            vertexData.getIndices(), vertexData.getIndexType(), vertexData.getBounds(), positionTransform,
+            [&](void* dest) {
+                packVertexData(vertexData, layout, dest);
+            });
+        return;
     }
 
+    // Raw data access works for both owned and external (memory-mapped) containers,
+    // external data is uploaded directly from the mapping
     auto& indices = vertexData.getIndices();
-    auto& positions = *static_cast<Vector<Vec3f>*>(positionContainer->v);
-    Vector<Vec3f>* normals = nullptr;
-    if (usingNormals)
-        normals = static_cast<Vector<Vec3f>*>(normalContainer->v);
-    Vector<Vec2f>* texCoords = nullptr;
-    if (usingTexCoords)
-        texCoords = static_cast<Vector<Vec2f>*>(texCoordContainer->v);
-    Vector<Vec3f>* colors = nullptr;
-    if (usingColors)
-        colors = static_cast<Vector<Vec3f>*>(colorContainer->v);
 
     // release the used resources
     reset();
 
     _nIndices = indices.size();
-    _usingNormals = usingNormals;
-    _usingTexCoords = usingTexCoords;
-    _usingColors = usingColors;
+    _usingNormals = containers[1] != nullptr;
+    _usingTexCoords = containers[2] != nullptr;
+    _usingColors = containers[3] != nullptr;
+    _octahedralNormals = _usingNormals && isOctahedral(containers[1]->type);
+    _positionTransform = positionTransform;
+    _bounds = objectBounds(containers[0]->type, vertexData.getBounds(), positionTransform);
 
     //  create and bind the VAO
     glGenVertexArrays(1, &_vertexArrayObjectId);
     glBindVertexArray(_vertexArrayObjectId);
 
     //  upload the vertex data to GPU and set up the vertex attribute arrays
-    glGenBuffers(1, &_positionBufferId);
-    glBindBuffer(GL_ARRAY_BUFFER, _positionBufferId);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(Vec3f), positions.data(), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
-
-    if (_usingNormals) {
-        glGenBuffers(1, &_normalBufferId);
-        glBindBuffer(GL_ARRAY_BUFFER, _normalBufferId);
-        glBufferData(GL_ARRAY_BUFFER, normals->size() * sizeof(Vec3f), normals->data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+    GLuint* bufferIds[nMeshAttributes] = { &_positionBufferId, &_normalBufferId, &_texCoordBufferId, &_colorBufferId };
+    for (int i=0; i<nMeshAttributes; ++i) {
+        auto* container = containers[i];
+        if (container == nullptr)
+            continue;
+
+        glGenBuffers(1, bufferIds[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, *bufferIds[i]);
+        glBufferData(GL_ARRAY_BUFFER, container->size() * container->elementSize(), container->data(), GL_STATIC_DRAW);
+        setAttributePointer(meshAttributes[i].location, container->type, 0, 0);
     }
 
-    if (_usingTexCoords) {
-        glGenBuffers(1, &_texCoordBufferId);
-        glBindBuffer(GL_ARRAY_BUFFER, _texCoordBufferId);
-        glBufferData(GL_ARRAY_BUFFER, texCoords->size() * sizeof(Vec2f), texCoords->data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+    glGenBuffers(1, &_elementBufferId);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferId);
+    _indexType = uploadIndices(indices, vertexData.getIndexType());
+
+    //  unbind the VAO so it won't be changed outside this function
+    glBindVertexArray(0);
+}
+
+void Mesh::loadFromPackedVertexBuffer(const PackedVertexBuffer& vertexBuffer,
+                                      const Vector<unsigned>& indices,
+                                      const Mat4f& positionTransform)
+{
+    if (vertexBuffer.findAttribute("position") == nullptr) {
+        fprintf(stderr, "ERROR: No position data in vertex buffer\n"); // TODO logging
+        return;
+    }
+
+    AttributeBinding bindings[nMeshAttributes];
+    int nBindings = packedBindings(vertexBuffer, bindings);
+    loadInterleaved(vertexBuffer.data.data(), vertexBuffer.nVertices, vertexBuffer.stride, bindings, nBindings,
+        indices, positionTransform);
+}
+
+void Mesh::loadInterleaved(const uint8_t* data, int64_t nVertices, uint32_t stride,
+                           const AttributeBinding* bindings, int nBindings,
+                           const Vector<unsigned>& indices, const Mat4f& positionTransform)
+{
+    // Raw data has not been validated, scan the indices and positions
+    unsigned maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+
+    Bounds positionBounds;
+    for (int i=0; i<nBindings; ++i) {
+        if (bindings[i].location == 0 && bindings[i].type == MathTypeEnum::VEC3F) {
+            positionBounds = computeBounds(reinterpret_cast<const Vec3f*>(data + bindings[i].offset),
+                nVertices, stride);
+        }
+    }
+
+    loadInterleaved(data, nVertices, stride, bindings, nBindings, indices,
+        VertexData::indexTypeFor(maxIndex), positionBounds, positionTransform);
+}
+
+void Mesh::loadInterleaved(const uint8_t* data, int64_t nVertices, uint32_t stride,
+                           const AttributeBinding* bindings, int nBindings,
+                           const Vector<unsigned>& indices, VertexData::IndexType indexType,
+                           const Bounds& positionBounds, const Mat4f& positionTransform,
+                           const std::function<void(void*)>& writeVertices)
+{
+    // Check the data types
+    const AttributeBinding* attributes[nMeshAttributes] = {};
+    for (int i=0; i<nBindings; ++i) {
+        int location = bindings[i].location;
+        if (location < 0)
+            continue;
+        if (!meshAttributes[location].accepts(bindings[i].type)) {
+            fprintf(stderr, "ERROR: Invalid data type for %s data\n", meshAttributes[location].description); // TODO logging
+            return;
+        }
+        attributes[location] = &bindings[i];
+    }
+
+    if (attributes[0] == nullptr) {
+        fprintf(stderr, "ERROR: No position data in vertex buffer\n"); // TODO logging
+        return;
+    }
+
+    // release the used resources
+    reset();
+
+    _nIndices = indices.size();
+    _usingNormals = attributes[1] != nullptr;
+    _usingTexCoords = attributes[2] != nullptr;
+    _usingColors = attributes[3] != nullptr;
+    _octahedralNormals = _usingNormals && isOctahedral(attributes[1]->type);
+    _positionTransform = positionTransform;
+    _bounds = objectBounds(attributes[0]->type, positionBounds, positionTransform);
+
+    //  create and bind the VAO
+    glGenVertexArrays(1, &_vertexArrayObjectId);
+    glBindVertexArray(_vertexArrayObjectId);
+
+    //  upload the interleaved vertex data to GPU, attributes are read from their offsets
+    glGenBuffers(1, &_vertexBufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferId);
+    glBufferData(GL_ARRAY_BUFFER, nVertices*stride, data, GL_STATIC_DRAW);
+    if (data == nullptr && nVertices > 0) {
+        void* dest = glMapBufferRange(GL_ARRAY_BUFFER, 0, nVertices*stride,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dest != nullptr)
+            writeVertices(dest);
+        if (dest == nullptr || glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
+            fprintf(stderr, "ERROR: Writing the vertex buffer failed\n"); // TODO logging
     }
 
-    if (_usingColors) {
-        glGenBuffers(1, &_colorBufferId);
-        glBindBuffer(GL_ARRAY_BUFFER, _colorBufferId);
-        glBufferData(GL_ARRAY_BUFFER, colors->size() * sizeof(Vec3f), colors->data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+    for (int i=0; i<nMeshAttributes; ++i) {
+        if (attributes[i] != nullptr)
+            setAttributePointer(meshAttributes[i].location, attributes[i]->type, stride, attributes[i]->offset);
     }
 
     glGenBuffers(1, &_elementBufferId);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferId);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _nIndices * sizeof(unsigned), indices.data(), GL_STATIC_DRAW);
+    _indexType = uploadIndices(indices, indexType);
 
     //  unbind the VAO so it won't be changed outside this function
     glBindVertexArray(0);
 }
 
+int Mesh::packedBindings(const PackedVertexBuffer& vertexBuffer, AttributeBinding* bindings)
+{
+    int nBindings = 0;
+    for (int i=0; i<nMeshAttributes; ++i) {
+        auto* attribute = vertexBuffer.findAttribute(meshAttributes[i].name);
+        if (attribute != nullptr)
+            bindings[nBindings++] = { (int)meshAttributes[i].location, attribute->type, attribute->offset };
+    }
+    return nBindings;
+}
+
+const Bounds& Mesh::getBounds() const noexcept
+{
+    return _bounds;
+}
+
+const Mat4f& Mesh::getPositionTransform() const noexcept
+{
+    return _positionTransform;
+}
+
 void Mesh::render(
     Shader& shader,
     const Camera& camera,
     const Mat4f& orientation,
     GLenum mode) const
 {
-    shader.use();
-    shader.setUniform("objectToWorld", orientation);
-    if (_usingNormals)
-        shader.setUniform("normalToWorld", Mat3f(Mat4f(orientation.inverse().transpose()).block<3,3>(0,0)));
-    shader.setUniform("worldToClip", camera.worldToClip());
+    setUniforms(shader, camera, orientation);
 
     glBindVertexArray(_vertexArrayObjectId);
 
-    glDrawElements(mode, _nIndices, GL_UNSIGNED_INT, (GLvoid*)0);
+    glDrawElements(mode, _nIndices, _indexType, (GLvoid*)0);
 
     glBindVertexArray(0);
 }
@@ -227,11 +453,86 @@ void Mesh::render(Shader& shader, GLenum mode) const
 {
     shader.use();
 
+    const auto& locations = uniformLocations(shader);
+    if (locations.octahedralNormals >= 0)
+        shader.setUniform(locations.octahedralNormals, _octahedralNormals);
+
     glBindVertexArray(_vertexArrayObjectId);
-    glDrawElements(mode, _nIndices, GL_UNSIGNED_INT, (GLvoid*)0);
+    glDrawElements(mode, _nIndices, _indexType, (GLvoid*)0);
     glBindVertexArray(0);
 }
 
+void Mesh::setSubMeshes(const Vector<SubMesh>& subMeshes)
+{
+    _subMeshes = subMeshes;
+}
+
+const Vector<SubMesh>& Mesh::getSubMeshes() const noexcept
+{
+    return _subMeshes;
+}
+
+void Mesh::renderSubMesh(
+    size_t subMeshId,
+    Shader& shader,
+    const Camera& camera,
+    const Mat4f& orientation,
+    GLenum mode) const
+{
+    setUniforms(shader, camera, orientation);
+
+    glBindVertexArray(_vertexArrayObjectId);
+    drawSubMesh(_subMeshes.at(subMeshId), mode);
+    glBindVertexArray(0);
+}
+
+void Mesh::renderSubMeshes(
+    const Vector<std::pair<size_t, Mat4f>>& instances,
+    Shader& shader,
+    const Camera& camera,
+    GLenum mode) const
+{
+    glBindVertexArray(_vertexArrayObjectId);
+    for (auto& [subMeshId, orientation] : instances) {
+        setUniforms(shader, camera, orientation);
+        drawSubMesh(_subMeshes.at(subMeshId), mode);
+    }
+    glBindVertexArray(0);
+}
+
+void Mesh::setUniforms(Shader& shader, const Camera& camera, const Mat4f& orientation) const
+{
+    shader.use();
+    shader.setUniform("objectToWorld", Mat4f(orientation * _positionTransform));
+    if (_usingNormals)
+        shader.setUniform("normalToWorld", Mat3f(Mat4f(orientation.inverse().transpose()).block<3,3>(0,0)));
+    shader.setUniform("worldToClip", camera.worldToClip());
+
+    // Shaders without octahedral normal support do not have the uniform
+    const auto& locations = uniformLocations(shader);
+    if (locations.octahedralNormals >= 0)
+        shader.setUniform(locations.octahedralNormals, _octahedralNormals);
+}
+
+const Mesh::UniformLocations& Mesh::uniformLocations(const Shader& shader) const
+{
+    if (_uniformLocations.programId != shader.id()) {
+        _uniformLocations.programId = shader.id();
+        _uniformLocations.octahedralNormals = shader.getUniformLocation("octahedralNormals");
+    }
+    return _uniformLocations;
+}
+
+void Mesh::drawSubMesh(const SubMesh& subMesh, GLenum mode) const
+{
+    size_t indexSize = _indexType == GL_UNSIGNED_BYTE ? 1 : _indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    auto* offset = (GLvoid*)(uintptr_t)(subMesh.firstIndex*indexSize);
+    if (subMesh.baseVertex != 0)
+        glDrawElementsBaseVertex(mode, subMesh.indexCount, _indexType, offset, (GLint)subMesh.baseVertex);
+    else
+        glDrawElements(mode, subMesh.indexCount, _indexType, offset);
+}
+
 void Mesh::reset()
 {
     if (_vertexArrayObjectId != 0)
@@ -242,6 +543,10 @@ void Mesh::reset()
         glDeleteBuffers(1, &_normalBufferId);
     if (_texCoordBufferId != 0)
         glDeleteBuffers(1, &_texCoordBufferId);
+    if (_colorBufferId != 0)
+        glDeleteBuffers(1, &_colorBufferId);
+    if (_vertexBufferId != 0)
+        glDeleteBuffers(1, &_vertexBufferId);
     if (_elementBufferId != 0)
         glDeleteBuffers(1, &_elementBufferId);
 
@@ -249,8 +554,17 @@ void Mesh::reset()
     _positionBufferId = 0;
     _normalBufferId = 0;
     _texCoordBufferId = 0;
+    _colorBufferId = 0;
+    _vertexBufferId = 0;
     _elementBufferId = 0;
     _nIndices = 0;
+    _indexType = GL_UNSIGNED_INT;
     _usingNormals = false;
     _usingTexCoords = false;
+    _usingColors = false;
+    _octahedralNormals = false;
+    _positionTransform = Mat4f::Identity();
+    _bounds = Bounds();
+    _subMeshes.clear();
+    _uniformLocations = UniformLocations();
 }
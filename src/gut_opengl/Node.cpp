@@ -26,9 +26,28 @@ void Node::render(const Mat4f& tParent, const Vector<Mesh>& meshes, Shader& shad
 {
     Mat4f t = tParent * _t;
 
-    for (auto& meshId : _meshIds)
-        meshes.at(meshId).render(shader, camera, t, GL_TRIANGLES); // TODO mode from mesh primitive
+    for (size_t i=0; i<_meshIds.size(); ++i) {
+        auto& mesh = meshes.at(_meshIds[i]);
+        if (_subMeshIds[i] >= 0)
+            mesh.renderSubMesh(_subMeshIds[i], shader, camera, t, GL_TRIANGLES); // TODO mode from mesh primitive
+        else
+            mesh.render(shader, camera, t, GL_TRIANGLES);
+    }
 
     for (auto& child : _children)
         child.render(t, meshes, shader, camera);
 }
+
+void Node::collectMeshInstances(const Mat4f& tParent, Vector<std::pair<size_t, Mat4f>>& instances,
+    Vector<int64_t>* subMeshIds) const
+{
+    Mat4f t = tParent * _t;
+
+    for (auto& meshId : _meshIds)
+        instances.emplace_back(meshId, t);
+    if (subMeshIds != nullptr)
+        subMeshIds->insert(subMeshIds->end(), _subMeshIds.begin(), _subMeshIds.end());
+
+    for (auto& child : _children)
+        child.collectMeshInstances(t, instances, subMeshIds);
+}
@@ -194,6 +194,11 @@ void Shader::use() const
     glUseProgram(_programId);
 }
 
+GLuint Shader::id() const noexcept
+{
+    return _programId;
+}
+
 GLint Shader::getUniformLocation(const std::string& name) const
 {
     if (_uniforms.find(name) == _uniforms.end())
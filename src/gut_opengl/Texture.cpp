@@ -10,6 +10,7 @@
 
 #include "Texture.hpp"
 #include <gut_image/Image.hpp>
+#include <gut_image/ImageTransform.hpp>
 #include <gut_opengl/GLTypeUtils.hpp>
 #include <stdexcept>
 
@@ -400,7 +401,7 @@ void Texture::updateFromImage(const Image& image)
     glBindTexture(_target, 0);
 }
 
-void Texture::copyToImage(Image& image, GLint level) const
+void Texture::copyToImage(Image& image, GLint level, bool flipVertically) const
 {
     glBindTexture(_target, _textureIds[_activeId]);
 
@@ -415,6 +416,9 @@ void Texture::copyToImage(Image& image, GLint level) const
         imageDataTypeToGLEnum(image.dataType()),
         wCopy*hCopy*Image::nChannels(image.dataFormat())*Image::dataTypeSize(image.dataType()),
         image.data<void>());
+
+    if (flipVertically)
+        flipVertical(image);
 }
 
 void Texture::initiateMapping()
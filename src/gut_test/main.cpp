@@ -17,6 +17,7 @@ using namespace gut;
 int main(int argv, char** args)
 {
     testImage();
+    testUtils();
     testOpenGL();
 
     return 0;
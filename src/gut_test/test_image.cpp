@@ -10,8 +10,17 @@
 
 #include "tests.hpp"
 #include <gut_image/Image.hpp>
+#include <gut_image/ImageTransform.hpp>
+#include <gut_image/DistanceField.hpp>
+#include <gut_image/Tonemap.hpp>
+#include <gut_image/ImageHash.hpp>
+#include <gut_image/ImageExpression.hpp>
 #include <gut_utils/Stopwatch.hpp>
 
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
 
 using namespace gut;
 
@@ -107,5 +116,378 @@ int gut::testImage()
         img.writeToFile("output/testImage_setPixel.png");
     }
 
+    // Test geometric transforms
+    {
+        Image img;
+        img.loadFromFile(std::string(RES_PATH)+"images/lenna.png");
+
+        Image imgFlipped;
+        imgFlipped.loadFromFile(std::string(RES_PATH)+"images/lenna.png", true);
+        flipVertical(imgFlipped);
+        if (memcmp(img.data<void>(), imgFlipped.data<void>(),
+            img.width()*img.height()*Image::nChannels(img.dataFormat())) != 0) {
+            fprintf(stderr, "ERROR: Flip on load does not match flipVertical()\n");
+            return 1;
+        }
+
+        Image imgTransposed, imgRotated90, imgRotated270;
+        Stopwatch sw;
+        sw.start();
+        transpose(img, imgTransposed);
+        uint64_t t = sw.stop();
+        printf("Transpose:          %llu\n", t);
+
+        rotate90(img, imgRotated90);
+        rotate270(img, imgRotated270);
+        for (int y=0; y<img.height(); ++y) {
+            for (int x=0; x<img.width(); ++x) {
+                Image::Pixel<uint8_t> p = img(x, y);
+                Image::Pixel<uint8_t> pt = imgTransposed(y, x);
+                Image::Pixel<uint8_t> p90 = imgRotated90(img.height()-1-y, x);
+                Image::Pixel<uint8_t> p270 = imgRotated270(y, img.width()-1-x);
+                if (p.r != pt.r || p.g != pt.g || p.b != pt.b ||
+                    p.r != p90.r || p.g != p90.g || p.b != p90.b ||
+                    p.r != p270.r || p.g != p270.g || p.b != p270.b) {
+                    fprintf(stderr, "ERROR: Transform mismatch at (%d, %d)\n", x, y);
+                    return 1;
+                }
+            }
+        }
+
+        Image imgRotated180(img);
+        rotate180(imgRotated180);
+        Image imgFlippedHorizontal(img);
+        flipHorizontal(imgFlippedHorizontal);
+        for (int y=0; y<img.height(); ++y) {
+            for (int x=0; x<img.width(); ++x) {
+                Image::Pixel<uint8_t> p = img(x, y);
+                Image::Pixel<uint8_t> p180 = imgRotated180(img.width()-1-x, img.height()-1-y);
+                Image::Pixel<uint8_t> ph = imgFlippedHorizontal(img.width()-1-x, y);
+                if (p.r != p180.r || p.g != p180.g || p.b != p180.b ||
+                    p.r != ph.r || p.g != ph.g || p.b != ph.b) {
+                    fprintf(stderr, "ERROR: Rotate180 / flipHorizontal mismatch at (%d, %d)\n", x, y);
+                    return 1;
+                }
+            }
+        }
+
+        imgTransposed.writeToFile("output/testImage_transpose.png");
+        imgRotated90.writeToFile("output/testImage_rotate90.png");
+        imgRotated180.writeToFile("output/testImage_rotate180.png");
+        imgRotated270.writeToFile("output/testImage_rotate270.png");
+        imgFlippedHorizontal.writeToFile("output/testImage_flipHorizontal.png");
+    }
+
+    // Test geometric transforms of all pixel sizes against a per-pixel reference, image size
+    // not a multiple of the tile size
+    {
+        const Image::DataFormat formats[] = { Image::DataFormat::GRAY, Image::DataFormat::RGB, Image::DataFormat::RGBA };
+        const Image::DataType types[] = { Image::DataType::U8, Image::DataType::U16, Image::DataType::F32 };
+        for (auto format : formats) {
+            for (auto type : types) {
+                int w = 203;
+                int h = 131;
+                int pixelSize = Image::nChannels(format)*(int)Image::dataTypeSize(type);
+                Image img(format, type);
+                img.create(w, h);
+                auto* src = static_cast<const uint8_t*>(img.data<void>());
+                auto* bytes = static_cast<uint8_t*>(img.data<void>());
+                for (int64_t i=0; i<(int64_t)w*h*pixelSize; ++i)
+                    bytes[i] = (uint8_t)((i*2654435761u) >> 24);
+
+                Image imgTransposed, imgRotated90, imgRotated270;
+                transpose(img, imgTransposed);
+                rotate90(img, imgRotated90);
+                rotate270(img, imgRotated270);
+                Image imgRotated180(img);
+                rotate180(imgRotated180);
+                Image imgFlippedHorizontal(img);
+                flipHorizontal(imgFlippedHorizontal);
+
+                // Destination pixel (x, y) of each transform for source pixel (sx, sy)
+                struct Transformed {
+                    const char*     name;
+                    const Image*    image;
+                    int             destWidth;
+                    int             (*x)(int sx, int sy, int w, int h);
+                    int             (*y)(int sx, int sy, int w, int h);
+                };
+                const Transformed transformed[] = {
+                    { "transpose", &imgTransposed, h,
+                        [](int, int sy, int, int) { return sy; }, [](int sx, int, int, int) { return sx; } },
+                    { "rotate90", &imgRotated90, h,
+                        [](int, int sy, int, int h) { return h-1-sy; }, [](int sx, int, int, int) { return sx; } },
+                    { "rotate270", &imgRotated270, h,
+                        [](int, int sy, int, int) { return sy; }, [](int sx, int, int w, int) { return w-1-sx; } },
+                    { "rotate180", &imgRotated180, w,
+                        [](int sx, int, int w, int) { return w-1-sx; }, [](int, int sy, int, int h) { return h-1-sy; } },
+                    { "flipHorizontal", &imgFlippedHorizontal, w,
+                        [](int sx, int, int w, int) { return w-1-sx; }, [](int, int sy, int, int) { return sy; } }
+                };
+                for (auto& t : transformed) {
+                    auto* dest = static_cast<const uint8_t*>(t.image->data<void>());
+                    for (int sy=0; sy<h; ++sy) {
+                        for (int sx=0; sx<w; ++sx) {
+                            int64_t d = (int64_t)t.y(sx, sy, w, h)*t.destWidth + t.x(sx, sy, w, h);
+                            if (memcmp(dest + d*pixelSize, src + ((int64_t)sy*w + sx)*pixelSize, pixelSize) != 0) {
+                                fprintf(stderr, "ERROR: %s mismatch with %d-byte pixels at (%d, %d)\n",
+                                    t.name, pixelSize, sx, sy);
+                                return 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Test signed distance field generation
+    {
+        Image mask(Image::DataFormat::GRAY, Image::DataType::U8);
+        mask.create(4096, 4096);
+
+        // Disc of radius 1024 pixels
+        auto* p = mask.data<uint8_t>();
+        for (int y=0; y<4096; ++y) {
+            for (int x=0; x<4096; ++x)
+                p[y*4096 + x] = (x-2048)*(x-2048) + (y-2048)*(y-2048) < 1024*1024 ? 255 : 0;
+        }
+
+        Image sdf;
+        Stopwatch sw;
+        sw.start();
+        generateSignedDistanceField(mask, sdf, 64.0f, Image::DataType::F32);
+        uint64_t t = sw.stop();
+        printf("Distance field:     %llu\n", t);
+
+        // Compare to analytic distance to the circle
+        for (int y=0; y<4096; y+=17) {
+            for (int x=0; x<4096; x+=13) {
+                float r = std::sqrt((float)((x-2048)*(x-2048) + (y-2048)*(y-2048)));
+                float d = std::clamp(1024.0f-r, -64.0f, 64.0f);
+                if (std::abs(sdf.data<float>()[y*4096 + x] - d) > 1.0f) {
+                    fprintf(stderr, "ERROR: Distance field mismatch at (%d, %d)\n", x, y);
+                    return 1;
+                }
+            }
+        }
+
+        generateSignedDistanceField(mask, sdf, 64.0f);
+        sdf.writeToFile("output/testImage_distanceField.png");
+    }
+
+    // Test HDR tonemapping
+    {
+        Image img(Image::DataFormat::RGB, Image::DataType::F32);
+        img.create(4096, 4096);
+
+        // Horizontal exposure ramp from 2^-8 to 2^8
+        auto* p = img.data<float>();
+        for (int y=0; y<4096; ++y) {
+            for (int x=0; x<4096; ++x) {
+                float v = std::exp2(((float)x/4096.0f)*16.0f - 8.0f);
+                p[(y*4096 + x)*3] = v;
+                p[(y*4096 + x)*3 + 1] = v*((float)y/4096.0f);
+                p[(y*4096 + x)*3 + 2] = v*0.25f;
+            }
+        }
+        img.writeToFile("output/testImage_hdr.hdr");
+
+        Image imgTonemapped;
+        Stopwatch sw;
+        sw.start();
+        tonemap(img, imgTonemapped);
+        uint64_t t = sw.stop();
+        printf("Tonemap:            %llu\n", t);
+        imgTonemapped.writeToFile("output/testImage_tonemapAces.png");
+
+        tonemap(img, imgTonemapped, TonemapSettings(0.0f, TonemapCurve::REINHARD));
+        imgTonemapped.writeToFile("output/testImage_tonemapReinhard.png");
+        tonemap(img, imgTonemapped, TonemapSettings(1.0f, TonemapCurve::HABLE));
+        imgTonemapped.writeToFile("output/testImage_tonemapHable.png");
+
+        img.convertDataType(Image::DataType::U8);
+        img.writeToFile("output/testImage_hdrClamped.png");
+
+        const TonemapCurve curves[] = { TonemapCurve::LINEAR, TonemapCurve::REINHARD,
+            TonemapCurve::ACES_FITTED, TonemapCurve::HABLE };
+        const Image::DataFormat formats[] = { Image::DataFormat::GRAY, Image::DataFormat::RGB, Image::DataFormat::RGBA };
+        const float values[] = { 0.0f, -1.0f, NAN, INFINITY, -INFINITY, 1.0e4f, 1.0e30f, 0.001f, 0.01f,
+            0.18f, 0.5f, 1.0f, 2.0f, 11.2f, 100.0f };
+        constexpr int nValues = sizeof(values) / sizeof(values[0]);
+
+        // SIMD path (first 16 components of the rows) matches the scalar path: the first 3
+        // columns of a 37 pixel wide image against a 3 pixel wide image, dither offsets
+        // depend on the pixel position only
+        for (auto format : formats) {
+            int nChannels = Image::nChannels(format);
+            Image wide(format, Image::DataType::F32);
+            wide.create(37, 64);
+            Image narrow(format, Image::DataType::F32);
+            narrow.create(3, 64);
+            for (int y=0; y<64; ++y) {
+                for (int x=0; x<37*nChannels; ++x) {
+                    float v = values[(y*37*nChannels + x*7) % nValues];
+                    wide.data<float>()[y*37*nChannels + x] = v;
+                    if (x < 3*nChannels)
+                        narrow.data<float>()[y*3*nChannels + x] = v;
+                }
+            }
+
+            for (auto curve : curves) {
+                for (int i=0; i<4; ++i) {
+                    TonemapSettings settings(0.5f, curve, 11.2f, i & 1, i & 2);
+                    Image wideTonemapped, narrowTonemapped;
+                    tonemap(wide, wideTonemapped, settings);
+                    tonemap(narrow, narrowTonemapped, settings);
+                    for (int y=0; y<64; ++y) {
+                        if (memcmp(wideTonemapped.data<uint8_t>() + y*37*nChannels,
+                            narrowTonemapped.data<uint8_t>() + y*3*nChannels, 3*nChannels) != 0) {
+                            fprintf(stderr, "ERROR: Tonemap SIMD and scalar paths differ (curve %d, %d channels, row %d)\n",
+                                (int)curve, nChannels, y);
+                            return 1;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Known values without dithering, RGBA so that the alpha channel is covered
+        struct KnownValue {
+            float   input;
+            uint8_t output;
+        };
+        const KnownValue knownValues[] = { { 0.0f, 0 }, { -1.0f, 0 }, { NAN, 0 }, { -INFINITY, 0 },
+            { 1.0e4f, 255 }, { 1.0e30f, 255 }, { INFINITY, 255 } };
+        for (auto curve : curves) {
+            for (bool srgbEncode : { false, true }) {
+                for (int width : { 1, 5 }) { // scalar and SIMD paths
+                    Image known(Image::DataFormat::RGBA, Image::DataType::F32);
+                    known.create(width, 7);
+                    for (int i=0; i<7; ++i) {
+                        for (int64_t x=0; x<width; ++x) {
+                            float* p = known.data<float>() + (i*width + x)*4;
+                            p[0] = p[1] = p[2] = knownValues[i].input;
+                            p[3] = knownValues[i].input;
+                        }
+                    }
+
+                    Image knownTonemapped;
+                    tonemap(known, knownTonemapped, TonemapSettings(0.0f, curve, 11.2f, srgbEncode, false));
+                    for (int64_t i=0; i<7*width*4; ++i) {
+                        if (knownTonemapped.data<uint8_t>()[i] != knownValues[i/(width*4)].output) {
+                            fprintf(stderr, "ERROR: Tonemapped %g is %d (curve %d)\n", knownValues[i/(width*4)].input,
+                                (int)knownTonemapped.data<uint8_t>()[i], (int)curve);
+                            return 1;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Mid-range values without sRGB encoding: 0.5 by the linear curve, 1 by Reinhard (0.5),
+        // 0.5 alpha regardless of the curve
+        {
+            Image mid(Image::DataFormat::RGBA, Image::DataType::F32);
+            mid.create(1, 1);
+            float* p = mid.data<float>();
+            p[0] = 0.5f; p[1] = 1.0f; p[2] = 0.25f; p[3] = 0.5f;
+            Image linear, reinhard;
+            tonemap(mid, linear, TonemapSettings(0.0f, TonemapCurve::LINEAR, 11.2f, false, false));
+            tonemap(mid, reinhard, TonemapSettings(0.0f, TonemapCurve::REINHARD, 11.2f, false, false));
+            auto* l = linear.data<uint8_t>();
+            auto* r = reinhard.data<uint8_t>();
+            if (l[0] != 128 || l[1] != 255 || l[2] != 64 || l[3] != 128 ||
+                r[0] != 85 || r[1] != 128 || r[2] != 51 || r[3] != 128) {
+                fprintf(stderr, "ERROR: Tonemapped mid-range values do not match\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test image content hashing
+    {
+        Image img(Image::DataFormat::RGBA, Image::DataType::U8);
+        img.create(4096, 4096);
+        auto* p = img.data<uint8_t>();
+        for (int i=0; i<4096*4096*4; ++i)
+            p[i] = (i*2654435761u) >> 24;
+
+        Stopwatch sw;
+        sw.start();
+        Hash128 h = hashImage128(img);
+        uint64_t t = sw.stop();
+        printf("Image hash:         %llu\n", t);
+
+        // Hash of horizontal strips must equal hash of the whole image
+        ImageHasher hasher(img.dataFormat(), img.dataType(), img.width(), img.height());
+        for (int y=0; y<4096; y+=512)
+            hasher.update(p + y*4096*4, 512*4096*4);
+        if (hasher.digest128() != h) {
+            fprintf(stderr, "ERROR: Streamed image hash does not match\n");
+            return 1;
+        }
+
+        // Copies hash equal, content and dimension changes do not
+        Image img2(img);
+        if (hashImage64(img2) != hashImage64(img)) {
+            fprintf(stderr, "ERROR: Image copy hash does not match\n");
+            return 1;
+        }
+        img2.data<uint8_t>()[12345] ^= 1;
+        Image img3(Image::DataFormat::RGBA, Image::DataType::U8);
+        img3.create(2048, 8192);
+        memcpy(img3.data<uint8_t>(), p, 4096*4096*4);
+        if (hashImage64(img2) == hashImage64(img) || hashImage64(img3) == hashImage64(img)) {
+            fprintf(stderr, "ERROR: Image hash collision\n");
+            return 1;
+        }
+    }
+
+    // Test image expressions
+    {
+        Image img1(Image::DataFormat::RGB, Image::DataType::U8);
+        Image img2(Image::DataFormat::RGB, Image::DataType::F32);
+        img1.create(4096, 4096);
+        img2.create(4096, 4096);
+        auto* p1 = img1.data<uint8_t>();
+        auto* p2 = img2.data<float>();
+        for (int i=0; i<4096*4096*3; ++i) {
+            p1[i] = (i*2654435761u) >> 24;
+            p2[i] = (float)(i % 1000) * 0.001f;
+        }
+
+        Image result(Image::DataFormat::GRAY, Image::DataType::U16);
+        Stopwatch sw;
+        sw.start();
+        result = (img1*0.5f + img2*0.5f).multiplyChannels(1.0f, 0.5f, 2.0f).clamp(0.0f, 1.0f);
+        uint64_t t = sw.stop();
+        printf("Image expression:   %llu\n", t);
+
+        if (result.dataFormat() != Image::DataFormat::RGB || result.width() != 4096 ||
+            result.dataType() != Image::DataType::U16) {
+            fprintf(stderr, "ERROR: Image expression result has invalid shape\n");
+            return 1;
+        }
+
+        const float channelFactors[3] = { 1.0f, 0.5f, 2.0f };
+        auto* r = result.data<uint16_t>();
+        for (int i=0; i<4096*4096*3; ++i) {
+            float v = ((float)p1[i]*0.0039215686f*0.5f + p2[i]*0.5f)*channelFactors[i % 3];
+            auto expected = (uint16_t)(std::clamp(v, 0.0f, 1.0f)*65535.0f + 0.5f);
+            if (std::abs((int)r[i] - (int)expected) > 1) {
+                fprintf(stderr, "ERROR: Invalid image expression result at component %d\n", i);
+                return 1;
+            }
+        }
+
+        // In-place evaluation
+        img2 = -expr(img2).sqrt() + 1.0f;
+        if (std::abs(img2.data<float>()[4567] - (1.0f - std::sqrt((float)(4567 % 1000) * 0.001f))) > 1.0e-6f) {
+            fprintf(stderr, "ERROR: Invalid in-place image expression result\n");
+            return 1;
+        }
+    }
+
     return 0;
 }
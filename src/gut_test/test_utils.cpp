@@ -0,0 +1,1780 @@
+//
+// Project: GraphicsUtils
+// File: test_utils.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "tests.hpp"
+#include <gut_utils/VertexData.hpp>
+#include <gut_utils/LoadMesh.hpp>
+#include <gut_utils/WeldVertices.hpp>
+#include <gut_utils/MeshCache.hpp>
+#include <gut_utils/VertexPacking.hpp>
+#include <gut_utils/MeshOptimization.hpp>
+#include <gut_utils/SimplifyMesh.hpp>
+#include <gut_utils/Meshlets.hpp>
+#include <gut_utils/QuantizeVertexData.hpp>
+#include <gut_utils/TangentSpace.hpp>
+#include <gut_utils/Bounds.hpp>
+#include <gut_utils/Bvh.hpp>
+#include <gut_utils/RayQuery.hpp>
+#include <gut_utils/VertexLayout.hpp>
+#include <gut_utils/MemoryResource.hpp>
+#include <gut_utils/MeshBatching.hpp>
+#include <gut_utils/HalfEdgeMesh.hpp>
+#include <gut_utils/ParallelFor.hpp>
+#include <gut_utils/Stopwatch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+
+using namespace gut;
+
+
+int gut::testUtils()
+{
+    // Test outputs are written to output/ in the working directory
+    std::error_code ec;
+    std::filesystem::create_directories("output", ec);
+
+    // Test OBJ loading
+    {
+        const char* models[] = { "models/bunny.obj", "models/teapot.obj" };
+        for (auto& model : models) {
+            VertexData vertexData;
+            Stopwatch sw;
+            sw.start();
+            loadMeshFromOBJ(std::string(RES_PATH) + model, vertexData);
+            uint64_t t = sw.stop();
+            printf("Load %-20s%llu\n", model, (unsigned long long)t);
+
+            if (!vertexData.isValid() || vertexData.getIndices().size() % 3 != 0) {
+                fprintf(stderr, "ERROR: Invalid vertex data loaded from %s\n", model);
+                return 1;
+            }
+        }
+
+        // Polygons and relative indices
+        FILE* f = fopen("output/testUtils_quad.obj", "wb");
+        if (f == nullptr) {
+            fprintf(stderr, "ERROR: Could not open output/testUtils_quad.obj for writing\n");
+            return 1;
+        }
+        fprintf(f, "# quad\nv 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+            "f -4/-4 -3/-3 -2/-2 -1/-1\n");
+        fclose(f);
+
+        VertexData vertexData;
+        loadMeshFromOBJ("output/testUtils_quad.obj", vertexData);
+        const Vector<unsigned> expectedIndices = { 0, 1, 2, 0, 2, 3 };
+        if (vertexData.getIndices() != expectedIndices || vertexData.accessData("texCoord") == nullptr) {
+            fprintf(stderr, "ERROR: Invalid vertex data loaded from a quad\n");
+            return 1;
+        }
+    }
+
+    // Test vertex welding
+    {
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", vertexData);
+        const Vec3f* positions = vertexData.accessData("position")->data<Vec3f>();
+        Vector<Vec3f> triangles;
+        for (auto& i : vertexData.getIndices())
+            triangles.push_back(positions[i]);
+
+        // Teapot has duplicate positions at the seams, welding must not change the triangles
+        int64_t nVertices = vertexData.accessData("position")->size();
+        Stopwatch sw;
+        sw.start();
+        int64_t nWelded = weldVertices(vertexData);
+        uint64_t t = sw.stop();
+        printf("Weld vertices:      %llu\n", (unsigned long long)t);
+
+        const auto* weldedContainer = vertexData.accessData("position");
+        const Vec3f* weldedPositions = weldedContainer->data<Vec3f>();
+        const auto& indices = vertexData.getIndices();
+        if (nWelded >= nVertices || weldedContainer->size() != nWelded || !vertexData.isValid()) {
+            fprintf(stderr, "ERROR: Vertex welding failed\n");
+            return 1;
+        }
+        for (size_t i=0; i<indices.size(); ++i) {
+            if (weldedPositions[indices[i]] != triangles[i]) {
+                fprintf(stderr, "ERROR: Vertex welding changed the triangles\n");
+                return 1;
+            }
+        }
+
+        if (weldVertices(vertexData, 1.0e-4f) > nWelded) {
+            fprintf(stderr, "ERROR: Vertex welding with epsilon failed\n");
+            return 1;
+        }
+
+        // Non-finite positions stay unwelded, distant near-equal ones are still welded
+        VertexData outliers;
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const float inf = std::numeric_limits<float>::infinity();
+        outliers.addDataVector<Vec3f>("position", Vector<Vec3f>{ Vec3f(nan, 0.0f, 0.0f),
+            Vec3f(nan, 0.0f, 0.0f), Vec3f(inf, 0.0f, 0.0f), Vec3f(1.0e30f, -1.0e30f, 0.0f),
+            Vec3f(1.0e30f, -1.0e30f, 0.0f), Vec3f(0.0f, 0.0f, 0.0f) });
+        outliers.setIndices({ 0, 1, 2, 3, 4, 5 });
+        if (weldVertices(outliers, 1.0e-6f) != 5) {
+            fprintf(stderr, "ERROR: Vertex welding of non-finite or distant positions failed\n");
+            return 1;
+        }
+    }
+
+    // Test binary mesh cache
+    {
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData);
+        writeMeshCache("output/testUtils_bunny.gutmesh", vertexData);
+
+        VertexData cached;
+        Stopwatch sw;
+        sw.start();
+        loadMeshFromCache("output/testUtils_bunny.gutmesh", cached);
+        uint64_t t = sw.stop();
+        printf("Load bunny.gutmesh  %llu\n", (unsigned long long)t);
+
+        if (!cached.isValid() || cached.getDataNames() != vertexData.getDataNames() ||
+            cached.getIndices() != vertexData.getIndices()) {
+            fprintf(stderr, "ERROR: Invalid vertex data loaded from mesh cache\n");
+            return 1;
+        }
+        auto cacheMatches = [&]() {
+            for (auto& name : vertexData.getDataNames()) {
+                const auto* c1 = static_cast<const VertexData&>(vertexData).accessData(name);
+                const auto* c2 = static_cast<const VertexData&>(cached).accessData(name);
+                if (!c2->isExternal() || c1->type != c2->type || c1->size() != c2->size() ||
+                    memcmp(c1->data(), c2->data(), c1->size()*c1->elementSize()) != 0) {
+                    fprintf(stderr, "ERROR: Mesh cache container %s does not match\n", name.c_str());
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (!cacheMatches())
+            return 1;
+
+        // Rewriting the cache file must not change the data mapped from the previous one
+        VertexData teapot;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", teapot);
+        writeMeshCache("output/testUtils_bunny.gutmesh", teapot);
+        if (!cacheMatches())
+            return 1;
+    }
+
+    // Test interleaved vertex packing
+    {
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData);
+
+        PackedVertexBuffer vertexBuffer;
+        Stopwatch sw;
+        sw.start();
+        bool packed = packVertexData(vertexData, vertexBuffer,
+            VertexPackingSettings({ "normal", "position" }, 16));
+        uint64_t t = sw.stop();
+        printf("Pack bunny  %llu\n", (unsigned long long)t);
+
+        auto* position = vertexBuffer.findAttribute("position");
+        auto* normal = vertexBuffer.findAttribute("normal");
+        if (!packed || vertexBuffer.stride != 32 || vertexBuffer.attributes.size() != 2 ||
+            normal == nullptr || normal->offset != 0 ||
+            position == nullptr || position->offset != 16) {
+            fprintf(stderr, "ERROR: Invalid interleaved vertex layout\n");
+            return 1;
+        }
+
+        const auto* positions = static_cast<const VertexData&>(vertexData).accessData("position");
+        const auto* normals = static_cast<const VertexData&>(vertexData).accessData("normal");
+        const uint8_t zeros[4] = {};
+        for (int64_t i=0; i<vertexBuffer.nVertices; ++i) {
+            const uint8_t* v = vertexBuffer.data.data() + i*vertexBuffer.stride;
+            if (memcmp(v, static_cast<const Vec3f*>(normals->data()) + i, sizeof(Vec3f)) != 0 ||
+                memcmp(v+12, zeros, 4) != 0 || memcmp(v+28, zeros, 4) != 0 ||
+                memcmp(v+16, static_cast<const Vec3f*>(positions->data()) + i, sizeof(Vec3f)) != 0) {
+                fprintf(stderr, "ERROR: Interleaved vertex %lld does not match\n", (long long)i);
+                return 1;
+            }
+        }
+
+        // Packing to memory laid out separately (e.g. a mapped vertex buffer)
+        PackedVertexBuffer layout;
+        bool laidOut = layoutVertexData(vertexData, layout, VertexPackingSettings({ "normal", "position" }, 16));
+        Vector<uint8_t> mapped(layout.nVertices*layout.stride, 0xFF);
+        packVertexData(vertexData, layout, mapped.data());
+        if (!laidOut || !layout.data.empty() || layout.stride != vertexBuffer.stride || mapped != vertexBuffer.data) {
+            fprintf(stderr, "ERROR: Vertex packing to external memory failed\n");
+            return 1;
+        }
+
+        if (packVertexData(vertexData, vertexBuffer, VertexPackingSettings({ "position" }, 4, 8))) {
+            fprintf(stderr, "ERROR: Vertex packing accepted a too small stride\n");
+            return 1;
+        }
+    }
+
+    // Test mesh optimization
+    {
+        // Triangles as position triplets, rotated to a canonical first vertex and sorted
+        auto triangles = [](const VertexData& vertexData) {
+            auto* positions = static_cast<const Vec3f*>(vertexData.accessData("position")->data());
+            auto& indices = vertexData.getIndices();
+            Vector<std::array<float, 9>> triangles(indices.size()/3);
+            for (size_t t=0; t<triangles.size(); ++t) {
+                int first = 0;
+                for (int j=1; j<3; ++j) {
+                    if (std::lexicographical_compare(positions[indices[t*3+j]].data(),
+                        positions[indices[t*3+j]].data()+3, positions[indices[t*3+first]].data(),
+                        positions[indices[t*3+first]].data()+3))
+                        first = j;
+                }
+                for (int j=0; j<3; ++j)
+                    memcpy(&triangles[t][j*3], positions[indices[t*3+(first+j)%3]].data(), sizeof(Vec3f));
+            }
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        };
+
+        const char* models[] = { "models/bunny.obj", "models/teapot.obj" };
+        for (auto& model : models) {
+            VertexData vertexData;
+            {
+                // Flat-shaded models share no vertices, optimize the welded positions only
+                VertexData loaded;
+                loadMeshFromOBJ(std::string(RES_PATH) + model, loaded);
+                auto* positions = static_cast<const Vec3f*>(
+                    static_cast<const VertexData&>(loaded).accessData("position")->data());
+                vertexData.addDataVector<Vec3f>("position", Vector<Vec3f>(positions,
+                    positions + loaded.accessData("position")->size()));
+                vertexData.setIndices(loaded.getIndices());
+                vertexData.validate();
+                weldVertices(vertexData);
+            }
+            int64_t nVertices = vertexData.accessData("position")->size();
+            auto before = analyzeVertexCache(vertexData.getIndices(), nVertices);
+            auto trianglesBefore = triangles(vertexData);
+
+            Stopwatch sw;
+            sw.start();
+            bool optimized = optimizeMesh(vertexData);
+            uint64_t t = sw.stop();
+
+            auto after = analyzeVertexCache(vertexData.getIndices(), nVertices);
+            printf("Optimize %-18s %llu  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", model, (unsigned long long)t,
+                before.acmr, after.acmr, before.atvr, after.atvr);
+
+            if (!optimized || !vertexData.isValid() || after.acmr >= before.acmr ||
+                triangles(vertexData) != trianglesBefore) {
+                fprintf(stderr, "ERROR: Mesh optimization of %s failed\n", model);
+                return 1;
+            }
+
+            // Vertices are in order of first use after the fetch optimization
+            unsigned next = 0;
+            for (auto i : vertexData.getIndices()) {
+                if (i > next) {
+                    fprintf(stderr, "ERROR: Vertices of %s are not in fetch order\n", model);
+                    return 1;
+                }
+                next = std::max(next, i+1);
+            }
+        }
+    }
+
+    // Test mesh simplification
+    {
+        VertexData vertexData;
+        {
+            VertexData loaded;
+            loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", loaded);
+            auto* positions = static_cast<const Vec3f*>(
+                static_cast<const VertexData&>(loaded).accessData("position")->data());
+            vertexData.addDataVector<Vec3f>("position", Vector<Vec3f>(positions,
+                positions + loaded.accessData("position")->size()));
+            vertexData.setIndices(loaded.getIndices());
+            vertexData.validate();
+            weldVertices(vertexData);
+        }
+
+        Vector<unsigned> indices = vertexData.getIndices();
+        Stopwatch sw;
+        sw.start();
+        float error = simplifyMesh(vertexData, indices, SimplificationSettings(1000));
+        uint64_t t = sw.stop();
+        printf("Simplify bunny %llu  %lu -> %lu triangles, error %.5f\n", (unsigned long long)t,
+            vertexData.getIndices().size()/3, indices.size()/3, error);
+        if (error < 0.0f || indices.size()/3 > 1000 || indices.size()/3 < 900 || error > 0.05f) {
+            fprintf(stderr, "ERROR: Simplification to target triangle count failed\n");
+            return 1;
+        }
+
+        indices = vertexData.getIndices();
+        error = simplifyMesh(vertexData, indices, SimplificationSettings(0, 0.001f));
+        if (error < 0.0f || error > 0.001f || indices.size() >= vertexData.getIndices().size()) {
+            fprintf(stderr, "ERROR: Simplification to target error failed\n");
+            return 1;
+        }
+
+        auto lods = generateLODs(vertexData, 6);
+        for (size_t i=0; i<lods.size(); ++i)
+            printf("LOD %lu: %lu triangles, error %.5f\n", i, lods[i].indices.size()/3, lods[i].error);
+        if (lods.size() != 6) {
+            fprintf(stderr, "ERROR: Invalid number of LOD levels\n");
+            return 1;
+        }
+        for (size_t i=1; i<lods.size(); ++i) {
+            if (lods[i].indices.size() >= lods[i-1].indices.size() || lods[i].error < lods[i-1].error) {
+                fprintf(stderr, "ERROR: Invalid LOD level %lu\n", i);
+                return 1;
+            }
+        }
+    }
+
+    // Test simplification constraints on a grid with a texture coordinate seam in the middle
+    {
+        constexpr int n = 9; // vertices per side, seam at column n/2
+        Vector<Vec3f> positions;
+        Vector<Vec2f> texCoords;
+        auto addVertex = [&](int x, int y, float u) {
+            positions.emplace_back((float)x, (float)y, 0.0f);
+            texCoords.emplace_back(u, (float)y);
+            return (unsigned)(positions.size()-1);
+        };
+        Vector<unsigned> left(n*n), right(n*n); // vertices used by the left and right halves
+        for (int y=0; y<n; ++y) {
+            for (int x=0; x<n; ++x) {
+                left[y*n+x] = right[y*n+x] = addVertex(x, y, (float)x);
+                if (x == n/2)
+                    right[y*n+x] = addVertex(x, y, (float)x + 100.0f);
+            }
+        }
+        Vector<unsigned> gridIndices;
+        for (int y=0; y+1<n; ++y) {
+            for (int x=0; x+1<n; ++x) {
+                auto& v = x < n/2 ? left : right;
+                unsigned i00 = v[y*n+x], i10 = v[y*n+x+1], i01 = v[(y+1)*n+x], i11 = v[(y+1)*n+x+1];
+                gridIndices.insert(gridIndices.end(), { i00, i10, i11, i00, i11, i01 });
+            }
+        }
+
+        VertexData grid;
+        grid.addDataVector<Vec3f>("position", std::move(positions));
+        grid.addDataVector<Vec2f>("texCoord", std::move(texCoords));
+        grid.setIndices(gridIndices);
+        grid.validate();
+        auto* gridPositions = static_cast<const Vec3f*>(
+            static_cast<const VertexData&>(grid).accessData("position")->data());
+        auto* gridTexCoords = static_cast<const Vec2f*>(
+            static_cast<const VertexData&>(grid).accessData("texCoord")->data());
+
+        Vector<unsigned> indices = gridIndices;
+        simplifyMesh(grid, indices, SimplificationSettings(0, 0.001f, true));
+
+        // Border vertices are kept, no triangle crosses the seam
+        for (int i=0; i<n; ++i) {
+            for (auto b : { left[i], left[(n-1)*n+i], left[i*n], right[i*n+n-1] }) {
+                if (std::find(indices.begin(), indices.end(), b) == indices.end()) {
+                    fprintf(stderr, "ERROR: Locked border vertex %u was removed\n", b);
+                    return 1;
+                }
+            }
+        }
+        for (size_t t=0; t<indices.size()/3; ++t) {
+            float side = 0.0f;
+            for (int j=0; j<3; ++j) {
+                auto& p = gridPositions[indices[t*3+j]];
+                if (p(0) != (float)(n/2)) // vertices off the seam tell the side
+                    side = p(0) < (float)(n/2) ? -1.0f : 1.0f;
+            }
+            for (int j=0; j<3; ++j) {
+                auto& p = gridPositions[indices[t*3+j]];
+                auto& uv = gridTexCoords[indices[t*3+j]];
+                if (p(0) == (float)(n/2) && (uv(0) >= 100.0f) != (side > 0.0f)) {
+                    fprintf(stderr, "ERROR: Triangle crosses the texture coordinate seam\n");
+                    return 1;
+                }
+            }
+        }
+        printf("Simplify grid %lu -> %lu triangles\n", gridIndices.size()/3, indices.size()/3);
+        if (indices.size() >= gridIndices.size()) {
+            fprintf(stderr, "ERROR: Grid was not simplified\n");
+            return 1;
+        }
+    }
+
+    // Test meshlet building
+    {
+        VertexData bunny, teapot;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", bunny);
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", teapot);
+        optimizeMesh(teapot);
+
+        Vector<MeshletData> meshletData;
+        Stopwatch sw;
+        sw.start();
+        bool built = buildMeshlets({ &bunny, &teapot }, meshletData);
+        uint64_t t = sw.stop();
+        printf("Build meshlets %llu\n", (unsigned long long)t);
+        if (!built || meshletData.size() != 2) {
+            fprintf(stderr, "ERROR: Meshlet building failed\n");
+            return 1;
+        }
+
+        const VertexData* meshes[] = { &bunny, &teapot };
+        for (int i=0; i<2; ++i) {
+            auto& mesh = *meshes[i];
+            auto& data = meshletData[i];
+            auto* positions = static_cast<const Vec3f*>(mesh.accessData("position")->data());
+            auto* spheres = static_cast<const Vec4f*>(data.bounds.accessData("boundingSphere")->data());
+            auto* apexes = static_cast<const Vec3f*>(data.bounds.accessData("coneApex")->data());
+            auto* axes = static_cast<const Vec4f*>(data.bounds.accessData("coneAxis")->data());
+
+            // Bounds are valid per-meshlet data and survive the mesh cache
+            if (!data.bounds.isValid() || data.bounds.getIndices().size() != data.meshlets.size()) {
+                fprintf(stderr, "ERROR: Invalid meshlet bounds\n");
+                return 1;
+            }
+            writeMeshCache("output/testUtils_meshletBounds.gutmesh", data.bounds);
+            VertexData cachedBounds;
+            loadMeshFromCache("output/testUtils_meshletBounds.gutmesh", cachedBounds);
+            auto* cachedSpheres = std::as_const(cachedBounds).accessData("boundingSphere");
+            if (!cachedBounds.isValid() || cachedSpheres == nullptr ||
+                cachedSpheres->size() != (int64_t)data.meshlets.size() ||
+                memcmp(cachedSpheres->data(), spheres, data.meshlets.size()*sizeof(Vec4f)) != 0) {
+                fprintf(stderr, "ERROR: Meshlet bounds mesh cache mismatch\n");
+                return 1;
+            }
+
+            MeshletData single;
+            buildMeshlets(mesh, single);
+            if (single.vertices != data.vertices || single.triangles != data.triangles) {
+                fprintf(stderr, "ERROR: Meshlet building is not deterministic\n");
+                return 1;
+            }
+
+            // Meshlet triangles reproduce the mesh triangles
+            Vector<std::array<unsigned, 3>> meshTriangles, meshletTriangles;
+            auto& indices = mesh.getIndices();
+            for (size_t t=0; t<indices.size(); t+=3)
+                meshTriangles.push_back({ indices[t], indices[t+1], indices[t+2] });
+
+            int64_t nCulled = 0;
+            for (size_t m=0; m<data.meshlets.size(); ++m) {
+                auto& meshlet = data.meshlets[m];
+                if (meshlet.nVertices > 64 || meshlet.nTriangles > 124 || meshlet.nTriangles == 0) {
+                    fprintf(stderr, "ERROR: Meshlet exceeds the limits\n");
+                    return 1;
+                }
+
+                Vec3f center = spheres[m].block<3,1>(0,0);
+                Vec3f axis = axes[m].block<3,1>(0,0);
+                for (uint32_t v=0; v<meshlet.nVertices; ++v) {
+                    if ((positions[data.vertices[meshlet.vertexOffset+v]]-center).norm() > spheres[m](3)*1.0001f) {
+                        fprintf(stderr, "ERROR: Meshlet vertex outside the bounding sphere\n");
+                        return 1;
+                    }
+                }
+                for (uint32_t t=0; t<meshlet.nTriangles; ++t) {
+                    std::array<unsigned, 3> triangle;
+                    for (int j=0; j<3; ++j) {
+                        uint8_t local = data.triangles[meshlet.triangleOffset+t*3+j];
+                        if (local >= meshlet.nVertices) {
+                            fprintf(stderr, "ERROR: Meshlet-local index out of bounds\n");
+                            return 1;
+                        }
+                        triangle[j] = data.vertices[meshlet.vertexOffset+local];
+                    }
+                    meshletTriangles.push_back(triangle);
+
+                    // Triangles face away from cameras in the backfacing region of the cone
+                    Vec3f p0 = positions[triangle[0]];
+                    Vec3f n = (positions[triangle[1]]-p0).cross(positions[triangle[2]]-p0);
+                    if (axes[m](3) < 1.0f && n.norm() > 0.0f &&
+                        (n.normalized().dot(axis) < std::sqrt(1.0f-axes[m](3)*axes[m](3))-1.0e-4f ||
+                        (apexes[m]-p0).dot(n.normalized()) > 1.0e-4f*spheres[m](3))) {
+                        fprintf(stderr, "ERROR: Invalid meshlet normal cone\n");
+                        return 1;
+                    }
+                }
+                nCulled += axes[m](3) < 1.0f;
+            }
+            printf("%lu meshlets, %lld with normal cones\n", data.meshlets.size(), (long long)nCulled);
+
+            std::sort(meshTriangles.begin(), meshTriangles.end());
+            std::sort(meshletTriangles.begin(), meshletTriangles.end());
+            if (meshTriangles != meshletTriangles) {
+                fprintf(stderr, "ERROR: Meshlet triangles do not match the mesh\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test vertex attribute quantization
+    {
+        VertexData original;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", original);
+        auto vertexBytes = [](const VertexData& vertexData) {
+            int64_t bytes = 0;
+            for (auto& name : vertexData.getDataNames()) {
+                auto* c = vertexData.accessData(name);
+                bytes += c->size() * c->elementSize();
+            }
+            return bytes;
+        };
+
+        auto* positions = static_cast<const Vec3f*>(original.accessData("position")->data());
+        auto* normals = static_cast<const Vec3f*>(original.accessData("normal")->data());
+        int64_t n = original.accessData("position")->size();
+
+        for (int bits : { 8, 16 }) {
+            VertexData vertexData = original;
+            Mat4f dequantization;
+            if (!quantizePositions(vertexData, dequantization) || !quantizeNormals(vertexData, bits) ||
+                !vertexData.isValid()) {
+                fprintf(stderr, "ERROR: Vertex data quantization failed\n");
+                return 1;
+            }
+
+            auto* qPositions = static_cast<const Vec4us*>(vertexData.accessData("position")->data());
+            float maxPositionError = 0.0f;
+            float maxNormalError = 0.0f;
+            for (int64_t i=0; i<n; ++i) {
+                Vec4f p = dequantization * Vec4f(qPositions[i](0)/65535.0f, qPositions[i](1)/65535.0f,
+                    qPositions[i](2)/65535.0f, 1.0f);
+                maxPositionError = std::max(maxPositionError, (p.head<3>()-positions[i]).norm());
+
+                Vec2f e;
+                if (bits == 8) {
+                    auto& q = static_cast<const Vec2b*>(vertexData.accessData("normal")->data())[i];
+                    e = Vec2f(q(0)/127.0f, q(1)/127.0f);
+                }
+                else {
+                    auto& q = static_cast<const Vec2s*>(vertexData.accessData("normal")->data())[i];
+                    e = Vec2f(q(0)/32767.0f, q(1)/32767.0f);
+                }
+                Vec3f decoded = octahedralDecode(e);
+                Vec3f normal = normals[i].normalized();
+                maxNormalError = std::max(maxNormalError, std::atan2(decoded.cross(normal).norm(), decoded.dot(normal)));
+            }
+
+            float extent = dequantization.diagonal().head<3>().maxCoeff();
+            printf("Quantized bunny (%d-bit normals): %lld -> %lld bytes, position error %g, normal error %g deg\n",
+                bits, (long long)vertexBytes(original), (long long)vertexBytes(vertexData),
+                maxPositionError/extent, maxNormalError*180.0f/M_PI);
+            if (vertexBytes(vertexData)*2 > vertexBytes(original) || maxPositionError > extent/65535.0f ||
+                maxNormalError*180.0f/M_PI > (bits == 8 ? 1.5f : 0.01f)) {
+                fprintf(stderr, "ERROR: Invalid vertex data quantization\n");
+                return 1;
+            }
+
+            // Quantized types survive the mesh cache
+            writeMeshCache("output/testUtils_quantized.gutmesh", vertexData);
+            VertexData cached;
+            loadMeshFromCache("output/testUtils_quantized.gutmesh", cached);
+            auto* c = cached.accessData("normal");
+            if (!cached.isValid() || c == nullptr || c->type != vertexData.accessData("normal")->type ||
+                memcmp(c->data(), static_cast<const VertexData&>(vertexData).accessData("normal")->data(),
+                c->size()*c->elementSize()) != 0) {
+                fprintf(stderr, "ERROR: Quantized vertex data mesh cache mismatch\n");
+                return 1;
+            }
+        }
+
+        VertexData vertexData;
+        vertexData.addDataVector<Vec2f>("texCoord", { Vec2f(0.0f, 1.0f), Vec2f(0.25f, 0.3333f), Vec2f(0.9999f, 0.5f) });
+        vertexData.setIndices({ 0, 1, 2 });
+        vertexData.validate();
+        const auto* texCoordContainer = vertexData.accessData("texCoord");
+        Vector<Vec2f> texCoords(texCoordContainer->data<Vec2f>(), texCoordContainer->data<Vec2f>() + texCoordContainer->size());
+        if (!quantizeTexCoords(vertexData) || !vertexData.isValid()) {
+            fprintf(stderr, "ERROR: Texture coordinate quantization failed\n");
+            return 1;
+        }
+        auto* halfTexCoords = static_cast<const Vec2h*>(vertexData.accessData("texCoord")->data());
+        for (size_t i=0; i<texCoords.size(); ++i) {
+            if ((halfTexCoords[i].cast<float>()-texCoords[i]).norm() > 1.0e-3f) {
+                fprintf(stderr, "ERROR: Invalid half-precision texture coordinate\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test adaptive index width
+    {
+        const std::pair<unsigned, VertexData::IndexType> cases[] = {
+            { 0xFFu, VertexData::IndexType::U8 },
+            { 0x100u, VertexData::IndexType::U16 },
+            { 0xFFFFu, VertexData::IndexType::U16 },
+            { 0x10000u, VertexData::IndexType::U32 }
+        };
+        for (auto& [maxIndex, expectedType] : cases) {
+            VertexData vertexData;
+            vertexData.addDataVector<float>("value", Vector<float>(maxIndex+1, 0.0f));
+            Vector<unsigned> indices;
+            for (unsigned i=0; i<=maxIndex; i+=97)
+                indices.push_back(i);
+            indices.push_back(maxIndex);
+            const unsigned* indicesData = indices.data();
+            vertexData.setIndices(std::move(indices));
+            if (vertexData.getIndices().data() != indicesData ||
+                vertexData.getIndexType() != VertexData::IndexType::U32 || !vertexData.validate() ||
+                vertexData.getIndexType() != expectedType) {
+                fprintf(stderr, "ERROR: Invalid index type for maximum index %u\n", maxIndex);
+                return 1;
+            }
+
+            const auto& validIndices = vertexData.getIndices();
+            size_t indexSize = VertexData::indexTypeSize(expectedType);
+            Vector<uint8_t> packed(validIndices.size()*indexSize);
+            vertexData.packIndices(packed.data());
+            for (size_t i=0; i<validIndices.size(); ++i) {
+                uint32_t index = 0;
+                memcpy(&index, packed.data() + i*indexSize, indexSize); // little-endian
+                if (index != validIndices[i]) {
+                    fprintf(stderr, "ERROR: Index packing mismatch\n");
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // Test validation
+    {
+        VertexData vertexData;
+        vertexData.addDataVector<float>("value", Vector<float>(4, 0.0f));
+        vertexData.setIndices(Vector<unsigned>{ 0, 1, 4 });
+        bool outOfRange = vertexData.validate();
+        vertexData.setIndices(Vector<unsigned>());
+        bool empty = vertexData.validate();
+        vertexData.setIndices(Vector<unsigned>{ 0, 1, 3 });
+        if (outOfRange || empty || !vertexData.validate()) {
+            fprintf(stderr, "ERROR: Index range validation failed\n");
+            return 1;
+        }
+
+        // Large random mesh against a serial reference
+        const int64_t nIndices = 30000001;
+        const unsigned nVertices = 5000000;
+        Vector<unsigned> indices(nIndices);
+        uint32_t state = 12345;
+        for (auto& i : indices) {
+            state = state*1664525u + 1013904223u;
+            i = (state >> 8) % (nVertices / 64); // frequent degenerates
+        }
+        indices[nIndices/2] = nVertices-1;
+        unsigned referenceMax = *std::max_element(indices.begin(), indices.end());
+        int64_t referenceDegenerate = 0;
+        for (int64_t t=0; t<nIndices/3; ++t) {
+            const unsigned* p = indices.data() + t*3;
+            referenceDegenerate += p[0] == p[1] || p[1] == p[2] || p[2] == p[0];
+        }
+
+        vertexData.addDataVector<Vec3f>("position", Vector<Vec3f>(nVertices, Vec3f::Zero()));
+        vertexData.removeData("value");
+        vertexData.setIndices(std::move(indices));
+        int64_t nDegenerate = -1;
+        Stopwatch sw;
+        sw.start();
+        bool valid = vertexData.validate(&nDegenerate);
+        uint64_t t = sw.stop();
+        printf("Validate %lld indices %llu\n", (long long)nIndices, (unsigned long long)t);
+        if (!valid || nDegenerate != referenceDegenerate || nDegenerate == 0 ||
+            vertexData.getIndexType() != VertexData::indexTypeFor(referenceMax)) {
+            fprintf(stderr, "ERROR: Validation of a large mesh failed\n");
+            return 1;
+        }
+        vertexData.removeData("position");
+        vertexData.addDataVector<Vec3f>("position", Vector<Vec3f>(referenceMax, Vec3f::Zero()));
+        if (vertexData.validate()) {
+            fprintf(stderr, "ERROR: Validation of a large mesh accepted an out-of-range index\n");
+            return 1;
+        }
+    }
+
+    // Test normal and tangent generation
+    {
+        // UV sphere with duplicated seam vertices
+        const int nLongitude = 1024;
+        const int nLatitude = 512;
+        Vector<Vec3f> positions;
+        Vector<Vec2f> texCoords;
+        for (int j=0; j<=nLatitude; ++j) {
+            for (int i=0; i<=nLongitude; ++i) {
+                float theta = M_PI*j/nLatitude;
+                float phi = 2.0*M_PI*i/nLongitude;
+                float sinTheta = j == 0 || j == nLatitude ? 0.0f : std::sin(theta); // exact poles
+                positions.emplace_back(sinTheta*std::cos(phi), sinTheta*std::sin(phi), std::cos(theta));
+                texCoords.emplace_back((float)i/nLongitude, (float)j/nLatitude);
+            }
+        }
+        Vector<unsigned> indices;
+        for (int j=0; j<nLatitude; ++j) {
+            for (int i=0; i<nLongitude; ++i) {
+                unsigned a = j*(nLongitude+1)+i;
+                unsigned c = a+nLongitude+1;
+                indices.insert(indices.end(), { a, c, a+1, a+1, c, c+1 });
+            }
+        }
+
+        VertexData vertexData;
+        vertexData.addDataVector<Vec3f>("position", Vector<Vec3f>(positions));
+        vertexData.addDataVector<Vec2f>("texCoord", Vector<Vec2f>(texCoords));
+        vertexData.setIndices(std::move(indices));
+        vertexData.validate();
+
+        for (auto weighting : { NormalWeighting::AREA, NormalWeighting::ANGLE, NormalWeighting::AREA_ANGLE }) {
+            Stopwatch sw;
+            sw.start();
+            bool normalsGenerated = generateNormals(vertexData, weighting);
+            uint64_t tNormals = sw.stop();
+            sw.start();
+            bool tangentsGenerated = normalsGenerated && generateTangents(vertexData);
+            uint64_t tTangents = sw.stop();
+            printf("Tangent space for %lu triangles: normals %llu, tangents %llu\n",
+                vertexData.getIndices().size()/3, (unsigned long long)tNormals, (unsigned long long)tTangents);
+            if (!tangentsGenerated || !vertexData.isValid()) {
+                fprintf(stderr, "ERROR: Tangent space generation failed\n");
+                return 1;
+            }
+
+            auto* normals = static_cast<const Vec3f*>(vertexData.accessData("normal")->data());
+            auto* tangents = static_cast<const Vec4f*>(vertexData.accessData("tangent")->data());
+            float maxNormalError = 0.0f;
+            float maxTangentError = 0.0f;
+            for (int j=0; j<=nLatitude; ++j) {
+                for (int i=0; i<=nLongitude; ++i) {
+                    int64_t v = j*(nLongitude+1)+i;
+                    maxNormalError = std::max(maxNormalError, (normals[v]-positions[v]).norm());
+                    if (j == 0 || j == nLatitude)
+                        continue;
+
+                    // Tangent points to increasing u (longitude), bitangent to increasing v
+                    float phi = 2.0*M_PI*i/nLongitude;
+                    Vec3f tangent = tangents[v].head<3>();
+                    Vec3f bitangent = tangents[v](3)*normals[v].cross(tangent);
+                    maxTangentError = std::max(maxTangentError,
+                        (tangent-Vec3f(-std::sin(phi), std::cos(phi), 0.0f)).norm());
+                    if (bitangent(2) >= 0.0f) {
+                        fprintf(stderr, "ERROR: Invalid tangent handedness\n");
+                        return 1;
+                    }
+                }
+            }
+            // Error of the order of the segment angle: seam vertices only have triangles on one
+            // side and area weighting favours the wider triangles near the poles
+            if (maxNormalError > 1.0e-2f || maxTangentError > 1.0e-2f) {
+                fprintf(stderr, "ERROR: Inaccurate tangent space (normal error %g, tangent error %g)\n",
+                    maxNormalError, maxTangentError);
+                return 1;
+            }
+        }
+
+        // Normals of an indexed mesh without them
+        VertexData teapot;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", teapot);
+        if (!generateNormals(teapot) || teapot.accessData("normal") == nullptr) {
+            fprintf(stderr, "ERROR: Normal generation failed\n");
+            return 1;
+        }
+        auto* normals = static_cast<const Vec3f*>(teapot.accessData("normal")->data());
+        for (int64_t i=0; i<teapot.accessData("normal")->size(); ++i) {
+            if (std::abs(normals[i].norm()-1.0f) > 1.0e-5f) {
+                fprintf(stderr, "ERROR: Generated normal is not unit length\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test bounds computation
+    {
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData);
+        const Bounds& bounds = vertexData.getBounds();
+        auto* positionContainer = vertexData.accessData("position");
+        auto* positions = static_cast<const Vec3f*>(positionContainer->data());
+        int64_t n = positionContainer->size();
+
+        Vec3f minimum = positions[0];
+        Vec3f maximum = positions[0];
+        float maxDistance = 0.0f;
+        for (int64_t i=0; i<n; ++i) {
+            minimum = minimum.cwiseMin(positions[i]);
+            maximum = maximum.cwiseMax(positions[i]);
+            maxDistance = std::max(maxDistance, (positions[i]-bounds.sphere.head<3>()).norm());
+        }
+        printf("Bunny bounds: sphere radius %g, box half-diagonal %g\n",
+            bounds.sphere(3), 0.5f*(maximum-minimum).norm());
+        if (bounds.empty() || bounds.minimum != minimum || bounds.maximum != maximum ||
+            maxDistance > bounds.sphere(3)*(1.0f+1.0e-6f) || bounds.sphere(3) > 0.5f*(maximum-minimum).norm()) {
+            fprintf(stderr, "ERROR: Invalid VertexData bounds\n");
+            return 1;
+        }
+
+        // Strided and short inputs
+        Vector<Vec4f> strided(n);
+        for (int64_t i=0; i<n; ++i)
+            strided[i] = Vec4f(positions[i](0), positions[i](1), positions[i](2), 0.0f);
+        Bounds stridedBounds = computeBounds(reinterpret_cast<const Vec3f*>(strided.data()), n, sizeof(Vec4f));
+        if (stridedBounds.minimum != bounds.minimum || stridedBounds.maximum != bounds.maximum ||
+            stridedBounds.sphere != bounds.sphere) {
+            fprintf(stderr, "ERROR: Strided bounds mismatch\n");
+            return 1;
+        }
+        for (int64_t m=0; m<8; ++m) {
+            Bounds b = computeBounds(positions+5, m);
+            for (int64_t i=5; i<5+m; ++i) {
+                if ((positions[i].array() < b.minimum.array()).any() || (positions[i].array() > b.maximum.array()).any() ||
+                    (positions[i]-b.sphere.head<3>()).norm() > b.sphere(3)*(1.0f+1.0e-6f)) {
+                    fprintf(stderr, "ERROR: Invalid bounds for %lld positions\n", (long long)m);
+                    return 1;
+                }
+            }
+            if (b.empty() != (m == 0)) {
+                fprintf(stderr, "ERROR: Invalid bounds for %lld positions\n", (long long)m);
+                return 1;
+            }
+        }
+
+        Mat4f transform = Mat4f::Identity();
+        transform.block<3,3>(0,0) = 2.0f*Eigen::AngleAxisf(0.5f, Vec3f(0.0f, 0.0f, 1.0f)).toRotationMatrix();
+        transform.block<3,1>(0,3) = Vec3f(1.0f, 2.0f, 3.0f);
+        Bounds transformed = transformBounds(bounds, transform);
+        for (int64_t i=0; i<n; ++i) {
+            Vec3f p = (transform*Vec4f(positions[i](0), positions[i](1), positions[i](2), 1.0f)).head<3>();
+            if ((p.array() < transformed.minimum.array()-1.0e-5f).any() ||
+                (p.array() > transformed.maximum.array()+1.0e-5f).any() ||
+                (p-transformed.sphere.head<3>()).norm() > transformed.sphere(3)*(1.0f+1.0e-5f)) {
+                fprintf(stderr, "ERROR: Invalid transformed bounds\n");
+                return 1;
+            }
+        }
+
+        // Adding data invalidates the bounds
+        vertexData.addData<Vec3f>("position", { Vec3f(10.0f, 10.0f, 10.0f) });
+        if (!vertexData.getBounds().empty() || !vertexData.validate() ||
+            vertexData.getBounds().maximum != Vec3f(10.0f, 10.0f, 10.0f)) {
+            fprintf(stderr, "ERROR: VertexData bounds not updated\n");
+            return 1;
+        }
+    }
+
+    // Test BVH building
+    {
+        // Checks the node layout and that the node bounds contain their triangles
+        auto validBvh = [](const VertexData& vertexData, const Bvh& bvh) {
+            const auto& indices = vertexData.getIndices();
+            auto* positions = static_cast<const Vec3f*>(vertexData.accessData("position")->data());
+            int64_t nNodes = bvh.nodes.size();
+
+            Vector<unsigned> sortedTriangles = bvh.triangles;
+            std::sort(sortedTriangles.begin(), sortedTriangles.end());
+            for (size_t i=0; i<sortedTriangles.size(); ++i)
+                if (sortedTriangles[i] != i)
+                    return false;
+
+            auto contains = [](const BvhNode& node, const Vec3f& minimum, const Vec3f& maximum) {
+                return (minimum.array() >= node.minimum.array()).all() && (maximum.array() <= node.maximum.array()).all();
+            };
+            auto subtreeEnd = [&](int64_t i) {
+                return bvh.nodes[i].isLeaf() ? i+1 : (int64_t)bvh.nodes[i].offset;
+            };
+
+            int64_t nLeafTriangles = 0;
+            for (int64_t i=0; i<nNodes; ++i) {
+                const auto& node = bvh.nodes[i];
+                if (node.isLeaf()) {
+                    for (uint32_t j=node.offset; j<node.offset+node.count; ++j) {
+                        const unsigned* triangle = &indices[bvh.triangles[j]*3];
+                        for (int k=0; k<3; ++k)
+                            if (!contains(node, positions[triangle[k]], positions[triangle[k]]))
+                                return false;
+                    }
+                    nLeafTriangles += node.count;
+                    continue;
+                }
+
+                int64_t left = i+1;
+                int64_t right = subtreeEnd(left);
+                if (right >= nNodes || subtreeEnd(right) != node.offset ||
+                    !contains(node, bvh.nodes[left].minimum, bvh.nodes[left].maximum) ||
+                    !contains(node, bvh.nodes[right].minimum, bvh.nodes[right].maximum))
+                    return false;
+            }
+
+            return nLeafTriangles == (int64_t)bvh.triangles.size() && (nNodes == 0 || subtreeEnd(0) == nNodes);
+        };
+
+        const char* models[] = { "models/bunny.obj", "models/teapot.obj" };
+        for (auto& model : models) {
+            VertexData vertexData;
+            loadMeshFromOBJ(std::string(RES_PATH) + model, vertexData);
+
+            Bvh bvh;
+            BvhStatistics statistics;
+            if (!buildBvh(vertexData, bvh, BvhSettings(), &statistics) || !validBvh(vertexData, bvh)) {
+                fprintf(stderr, "ERROR: Invalid BVH built for %s\n", model);
+                return 1;
+            }
+            printf("BVH %-20s%lld nodes, %lld leaves, depth %d, leaf size avg %.2f max %d, SAH cost %.2f, %.2f ms\n",
+                model, (long long)statistics.nNodes, (long long)statistics.nLeaves, statistics.maxDepth,
+                statistics.averageLeafSize, statistics.maxLeafSize, statistics.sahCost, statistics.buildTime*1000.0);
+
+            // Refitting with unchanged positions reproduces the bounds
+            Bvh refitted = bvh;
+            for (auto& node : refitted.nodes)
+                node.minimum = node.maximum = Vec3f::Zero();
+            bool refitMatches = refitBvh(vertexData, refitted);
+            for (size_t i=0; i<bvh.nodes.size() && refitMatches; ++i) {
+                refitMatches = refitted.nodes[i].minimum == bvh.nodes[i].minimum &&
+                    refitted.nodes[i].maximum == bvh.nodes[i].maximum; // -0 and 0 may differ in bits
+            }
+            if (!refitMatches) {
+                fprintf(stderr, "ERROR: BVH refit mismatch\n");
+                return 1;
+            }
+
+            // Deformed mesh
+            auto* positions = static_cast<Vec3f*>(vertexData.accessData("position")->data());
+            for (int64_t i=0; i<vertexData.accessData("position")->size(); ++i)
+                positions[i] = Vec3f(positions[i](0)*2.0f, positions[i](1) + std::sin(positions[i](0)*10.0f), positions[i](2));
+            if (!refitBvh(vertexData, refitted) || !validBvh(vertexData, refitted)) {
+                fprintf(stderr, "ERROR: Invalid refitted BVH\n");
+                return 1;
+            }
+        }
+
+        // Mesh large enough for the parallel top of the tree
+        {
+            const int gridSize = 300;
+            Vector<Vec3f> positions;
+            Vector<unsigned> indices;
+            for (int y=0; y<=gridSize; ++y)
+                for (int x=0; x<=gridSize; ++x)
+                    positions.emplace_back((float)x, (float)y, std::sin(x*0.1f)*std::cos(y*0.1f)*10.0f);
+            for (int y=0; y<gridSize; ++y) {
+                for (int x=0; x<gridSize; ++x) {
+                    unsigned i = y*(gridSize+1)+x;
+                    indices.insert(indices.end(), { i, i+1, i+gridSize+1, i+1, i+gridSize+2, i+gridSize+1 });
+                }
+            }
+            VertexData vertexData;
+            vertexData.addDataVector<Vec3f>("position", std::move(positions));
+            vertexData.setIndices(std::move(indices));
+            vertexData.validate();
+
+            Bvh bvh;
+            BvhStatistics statistics;
+            if (!buildBvh(vertexData, bvh, BvhSettings(), &statistics) || !validBvh(vertexData, bvh)) {
+                fprintf(stderr, "ERROR: Invalid BVH built for grid\n");
+                return 1;
+            }
+            printf("BVH grid %lld triangles: %lld nodes, depth %d, SAH cost %.2f, %.2f ms\n",
+                (long long)bvh.triangles.size(), (long long)statistics.nNodes, statistics.maxDepth,
+                statistics.sahCost, statistics.buildTime*1000.0);
+        }
+
+        // Degenerate input: coincident triangles
+        VertexData vertexData;
+        vertexData.addDataVector<Vec3f>("position", { Vec3f(0.0f, 0.0f, 0.0f), Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f) });
+        Vector<unsigned> indices;
+        for (int i=0; i<100; ++i)
+            indices.insert(indices.end(), { 0, 1, 2 });
+        vertexData.setIndices(std::move(indices));
+        vertexData.validate();
+        Bvh bvh;
+        BvhStatistics statistics;
+        if (!buildBvh(vertexData, bvh, BvhSettings(), &statistics) || !validBvh(vertexData, bvh) ||
+            statistics.maxLeafSize > BvhSettings().maxLeafSize) {
+            fprintf(stderr, "ERROR: Invalid BVH for coincident triangles\n");
+            return 1;
+        }
+    }
+
+    // Test ray queries
+    {
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData);
+        RayQueryMesh mesh;
+        if (!buildRayQueryMesh(vertexData, mesh)) {
+            fprintf(stderr, "ERROR: Failed to build ray query mesh\n");
+            return 1;
+        }
+
+        // Orthographic grid of rays towards the bunny along -z
+        const int gridSize = 512;
+        Bounds bounds = vertexData.getBounds();
+        Vec3f extent = (bounds.maximum - bounds.minimum)*1.2f;
+        Vec3f corner = (bounds.maximum + bounds.minimum)*0.5f - extent*0.5f;
+        Vector<Ray> rays;
+        rays.reserve(gridSize*gridSize);
+        for (int y=0; y<gridSize; ++y) {
+            for (int x=0; x<gridSize; ++x) {
+                rays.emplace_back(Vec3f(corner(0) + extent(0)*(x+0.5f)/gridSize,
+                    corner(1) + extent(1)*(y+0.5f)/gridSize, bounds.maximum(2) + 1.0f), Vec3f(0.0f, 0.0f, -1.0f));
+            }
+        }
+        int64_t nRays = rays.size();
+
+        Vector<RayHit> hits(nRays);
+        std::unique_ptr<bool[]> occluded(new bool[nRays]);
+
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(0, nRays, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                hits[i] = intersectClosest(mesh, rays[i]);
+        }, 64);
+        double singleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Vector<RayHit> packetHits(nRays);
+        start = std::chrono::steady_clock::now();
+        intersectClosest(mesh, rays.data(), packetHits.data(), nRays);
+        double packetTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        intersectAny(mesh, rays.data(), occluded.get(), nRays);
+        double anyTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto mraysPerThread = [&](double time) { return nRays / time / nWorkerThreads() * 1.0e-6; };
+        printf("Ray queries bunny %lld rays: closest %.2f, packets %.2f, any-hit %.2f Mrays/s per thread\n",
+            (long long)nRays, mraysPerThread(singleTime), mraysPerThread(packetTime), mraysPerThread(anyTime));
+
+        // Packets and occlusion queries agree with the single ray queries
+        int64_t nHits = 0;
+        for (int64_t i=0; i<nRays; ++i) {
+            nHits += hits[i].hit();
+            if (packetHits[i].hit() != hits[i].hit() || occluded[i] != hits[i].hit() ||
+                std::abs(packetHits[i].t - hits[i].t) > 1.0e-5f*std::abs(hits[i].t)) {
+                fprintf(stderr, "ERROR: Ray query mismatch between single rays and packets for ray %lld\n", (long long)i);
+                return 1;
+            }
+        }
+        if (nHits < nRays/4 || nHits == nRays) {
+            fprintf(stderr, "ERROR: Unexpected number of ray hits: %lld / %lld\n", (long long)nHits, (long long)nRays);
+            return 1;
+        }
+
+        // Brute force reference for a subset of the rays
+        const auto& indices = vertexData.getIndices();
+        auto* positions = static_cast<const Vec3f*>(vertexData.accessData("position")->data());
+        int64_t nMismatches = 0, nTested = 0;
+        for (int64_t i=0; i<nRays; i+=97, ++nTested) {
+            const Ray& ray = rays[i];
+            float tBest = FLT_MAX;
+            for (size_t j=0; j<indices.size(); j+=3) {
+                Vec3f v0 = positions[indices[j]];
+                Vec3f e1 = positions[indices[j+1]] - v0;
+                Vec3f e2 = positions[indices[j+2]] - v0;
+                Vec3f p = ray.direction.cross(e2);
+                float det = e1.dot(p);
+                if (det == 0.0f)
+                    continue;
+                Vec3f s = ray.origin - v0;
+                float u = s.dot(p) / det;
+                Vec3f q = s.cross(e1);
+                float v = ray.direction.dot(q) / det;
+                float t = e2.dot(q) / det;
+                if (u >= 0.0f && v >= 0.0f && u+v <= 1.0f && t > ray.tMin && t < tBest)
+                    tBest = t;
+            }
+            bool hit = tBest < FLT_MAX;
+            if (hit != hits[i].hit() || (hit && std::abs(tBest - hits[i].t) > 1.0e-4f*std::abs(tBest)))
+                ++nMismatches;
+            if (hits[i].hit()) { // reported hit is on the reported triangle
+                const unsigned* triangle = &indices[hits[i].triangle*3];
+                Vec3f point = positions[triangle[0]]*(1.0f - hits[i].u - hits[i].v) +
+                    positions[triangle[1]]*hits[i].u + positions[triangle[2]]*hits[i].v;
+                if ((point - (ray.origin + ray.direction*hits[i].t)).norm() > 1.0e-4f)
+                    ++nMismatches;
+            }
+        }
+        if (nMismatches*1000 > nTested) { // grazing hits on shared edges may differ
+            fprintf(stderr, "ERROR: Ray query differs from brute force for %lld / %lld rays\n",
+                (long long)nMismatches, (long long)nTested);
+            return 1;
+        }
+
+        // Instances: translated and scaled copy, object space t equals world space t
+        Vector<RayQueryInstance> instances;
+        Mat4f objectToWorld;
+        objectToWorld <<
+            2.0f,   0.0f,   0.0f,   10.0f,
+            0.0f,   2.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   2.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   1.0f;
+        instances.emplace_back(&mesh);
+        instances.emplace_back(&mesh, objectToWorld);
+        for (int64_t i=0; i<nRays; i+=101) {
+            Ray worldRay(rays[i].origin*2.0f + Vec3f(10.0f, 0.0f, 0.0f), rays[i].direction*2.0f);
+            RayHit instanceHit = intersectClosest(instances, worldRay);
+            if (instanceHit.hit() != hits[i].hit() || intersectAny(instances, worldRay) != hits[i].hit() ||
+                (hits[i].hit() && (instanceHit.instance != 1 || instanceHit.triangle != hits[i].triangle ||
+                std::abs(instanceHit.t - hits[i].t) > 1.0e-4f*std::abs(hits[i].t)))) {
+                fprintf(stderr, "ERROR: Instance ray query mismatch for ray %lld\n", (long long)i);
+                return 1;
+            }
+        }
+
+        // Refitting follows the deformed positions
+        auto* mutablePositions = static_cast<Vec3f*>(vertexData.accessData("position")->data());
+        for (int64_t i=0; i<vertexData.accessData("position")->size(); ++i)
+            mutablePositions[i](0) += 100.0f;
+        if (!refitRayQueryMesh(vertexData, mesh)) {
+            fprintf(stderr, "ERROR: Failed to refit ray query mesh\n");
+            return 1;
+        }
+        for (int64_t i=0; i<nRays; i+=101) {
+            Ray shifted(rays[i].origin + Vec3f(100.0f, 0.0f, 0.0f), rays[i].direction);
+            if (intersectClosest(mesh, shifted).hit() != hits[i].hit()) {
+                fprintf(stderr, "ERROR: Ray query mismatch after refit for ray %lld\n", (long long)i);
+                return 1;
+            }
+        }
+
+        // Axis-parallel rays starting on a face of the bounds hit the edge of the quad
+        VertexData quad;
+        quad.addDataVector<Vec3f>("position", { Vec3f(0.0f, 0.0f, 1.0f), Vec3f(2.0f, 0.0f, 1.0f),
+            Vec3f(2.0f, 2.0f, 1.0f), Vec3f(0.0f, 2.0f, 1.0f) });
+        quad.setIndices({ 0, 1, 2, 0, 2, 3 });
+        quad.validate();
+        RayQueryMesh quadMesh;
+        Ray faceRays[rayPacketSize] = { Ray(Vec3f(0.0f, 1.0f, 0.0f)), Ray(Vec3f(1.0f, 0.0f, 0.0f)),
+            Ray(Vec3f(2.0f, 1.0f, 0.0f)), Ray(Vec3f(1.0f, 2.0f, 0.0f)) };
+        RayHit faceHits[rayPacketSize];
+        if (!buildRayQueryMesh(quad, quadMesh)) {
+            fprintf(stderr, "ERROR: Failed to build quad ray query mesh\n");
+            return 1;
+        }
+        intersectClosest(quadMesh, faceRays, faceHits);
+        for (int i=0; i<rayPacketSize; ++i) {
+            if (!intersectClosest(quadMesh, faceRays[i]).hit() || !faceHits[i].hit()) {
+                fprintf(stderr, "ERROR: Ray starting on a bounds face missed\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test compile-time vertex layouts
+    {
+        using Layout = VertexLayout<PositionAttribute, VertexAttribute<"tangent", Vec4f>, TexCoordAttribute>;
+        static_assert(Layout::offsets[0] == 0 && Layout::offsets[1] == 16 && Layout::offsets[2] == 32);
+        static_assert(Layout::stride == 48 && Layout::hasAttribute<"tangent">() && !Layout::hasAttribute<"normal">());
+        static_assert(StandardVertexLayout::stride == 44 && StandardVertexLayout::offsets[3] == 32);
+        static_assert(std::is_same_v<Layout::AttributeType<"tangent">, Vec4f>);
+        using PackedLayout = VertexLayout<VertexAttribute<"position", Vec4us>, VertexAttribute<"normal", Vec2s>,
+            VertexAttribute<"texCoord", Vec2h>, VertexAttribute<"color", Vec2b>>;
+        static_assert(PackedLayout::stride == 18 && PackedLayout::offsets[3] == 16);
+        static_assert(VertexData::isValidDataType<Vec2h>() && !VertexData::isValidDataType<std::string>());
+
+        VertexData vertexData;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData);
+
+        // Missing attribute fails the conversion
+        Layout tangentLayout;
+        if (tangentLayout.fromVertexData(vertexData)) {
+            fprintf(stderr, "ERROR: VertexLayout conversion should fail without tangent data\n");
+            return 1;
+        }
+
+        using BunnyLayout = VertexLayout<PositionAttribute, NormalAttribute>;
+        BunnyLayout layout;
+        Stopwatch sw;
+        sw.start();
+        bool converted = layout.fromVertexData(vertexData);
+        auto t = sw.stop();
+        if (!converted) {
+            fprintf(stderr, "ERROR: VertexLayout conversion failed\n");
+            return 1;
+        }
+        printf("VertexLayout from bunny %llu\n", (unsigned long long)t);
+
+        auto* positions = static_cast<const Vec3f*>(vertexData.accessData("position")->data());
+        auto* normals = static_cast<const Vec3f*>(vertexData.accessData("normal")->data());
+        for (int64_t i=0; i<layout.size(); ++i) {
+            if (layout.get<"position">(i) != positions[i] || layout.get<"normal">(i) != normals[i] ||
+                memcmp(layout.data() + i*BunnyLayout::stride + BunnyLayout::offsets[1], &normals[i], sizeof(Vec3f)) != 0) {
+                fprintf(stderr, "ERROR: VertexLayout data mismatch at vertex %lld\n", (long long)i);
+                return 1;
+            }
+        }
+
+        // Round trip through VertexData
+        layout.get<"position">(0) = Vec3f(1.0f, 2.0f, 3.0f);
+        VertexData roundTrip;
+        if (!layout.toVertexData(roundTrip) || roundTrip.getIndices() != vertexData.getIndices() ||
+            static_cast<const Vec3f*>(roundTrip.accessData("position")->data())[0] != Vec3f(1.0f, 2.0f, 3.0f) ||
+            memcmp(roundTrip.accessData("normal")->data(), normals, layout.size()*sizeof(Vec3f)) != 0) {
+            fprintf(stderr, "ERROR: VertexLayout round trip failed\n");
+            return 1;
+        }
+    }
+
+    // Test mesh merging
+    {
+        VertexData bunny, teapot;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", bunny);
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", teapot);
+        if (!isBatchCompatible(bunny, bunny)) {
+            fprintf(stderr, "ERROR: VertexData not batch compatible with itself\n");
+            return 1;
+        }
+
+        // Copies share the data, merging many of them exercises the parallel copy
+        Vector<VertexData> meshes(32, bunny);
+        if (isBatchCompatible(bunny, teapot))
+            meshes.emplace_back(teapot);
+        Vector<const VertexData*> sources;
+        for (auto& mesh : meshes)
+            sources.emplace_back(&mesh);
+
+        for (bool rebaseIndices : { true, false }) {
+            VertexData merged;
+            Vector<SubMesh> subMeshes;
+            Stopwatch sw;
+            sw.start();
+            bool success = mergeVertexData(sources, merged, subMeshes, rebaseIndices);
+            uint64_t t = sw.stop();
+            printf("Merge %lu meshes (rebased indices %d) %llu\n", sources.size(), (int)rebaseIndices, (unsigned long long)t);
+            if (!success || subMeshes.size() != sources.size() || !merged.isValid()) {
+                fprintf(stderr, "ERROR: Mesh merging failed\n");
+                return 1;
+            }
+
+            const auto* mergedPositions = static_cast<const Vec3f*>(merged.accessData("position")->data());
+            const auto& mergedIndices = merged.getIndices();
+            for (size_t i=0; i<sources.size(); ++i) {
+                auto& subMesh = subMeshes[i];
+                const auto* positions = static_cast<const Vec3f*>(sources[i]->accessData("position")->data());
+                const auto& indices = sources[i]->getIndices();
+                bool equal = subMesh.indexCount == indices.size() &&
+                    subMesh.baseVertex == (rebaseIndices ? 0 : subMesh.firstVertex) &&
+                    subMesh.bounds.minimum == sources[i]->getBounds().minimum;
+                for (size_t j=0; j<indices.size() && equal; ++j) {
+                    int64_t index = mergedIndices[subMesh.firstIndex+j] + subMesh.baseVertex;
+                    equal = index-subMesh.firstVertex == indices[j] && mergedPositions[index] == positions[indices[j]];
+                }
+                if (!equal) {
+                    fprintf(stderr, "ERROR: Merged sub-mesh %lu does not match its source\n", i);
+                    return 1;
+                }
+            }
+
+            // Local indices keep the index type of the largest mesh
+            auto expectedType = rebaseIndices ? VertexData::IndexType::U32 : bunny.getIndexType();
+            if (!rebaseIndices && teapot.getIndexType() > expectedType && isBatchCompatible(bunny, teapot))
+                expectedType = teapot.getIndexType();
+            if (merged.getIndexType() != expectedType) {
+                fprintf(stderr, "ERROR: Invalid index type of merged meshes\n");
+                return 1;
+            }
+        }
+
+        Vector<const VertexData*> incompatible = { &bunny, &bunny };
+        VertexData noNormals = bunny;
+        noNormals.removeData("normal");
+        noNormals.validate();
+        incompatible.emplace_back(&noNormals);
+        VertexData merged;
+        Vector<SubMesh> subMeshes;
+        if (mergeVertexData(incompatible, merged, subMeshes)) {
+            fprintf(stderr, "ERROR: Incompatible meshes merged\n");
+            return 1;
+        }
+    }
+
+    // Test half-edge mesh
+    {
+        // Closed cube, all edges manifold
+        VertexData cube;
+        Vector<Vec3f> cubePositions;
+        for (int i=0; i<8; ++i)
+            cubePositions.emplace_back(i&1, (i>>1)&1, (i>>2)&1);
+        cube.addDataVector<Vec3f>("position", std::move(cubePositions));
+        cube.setIndices(Vector<unsigned>{
+            0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7,   0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5 });
+        cube.validate();
+
+        HalfEdgeMesh halfEdgeMesh;
+        if (!buildHalfEdgeMesh(cube, halfEdgeMesh) || halfEdgeMesh.nBorderEdges != 0 ||
+            !halfEdgeMesh.nonManifoldEdges.empty()) {
+            fprintf(stderr, "ERROR: Half-edge mesh of a cube failed\n");
+            return 1;
+        }
+        for (unsigned v=0; v<8; ++v) {
+            // Fan of a closed manifold vertex returns to the first half-edge
+            unsigned first = halfEdgeMesh.vertexHalfEdges[v];
+            unsigned h = first;
+            int nOutgoing = 0;
+            do {
+                if (h == HalfEdgeMesh::none || halfEdgeMesh.from(h) != v || ++nOutgoing > 6)
+                    break;
+                h = halfEdgeMesh.nextOutgoing(h);
+            } while (h != first);
+            if (h != first || nOutgoing < 3) {
+                fprintf(stderr, "ERROR: Invalid fan around cube vertex %u\n", v);
+                return 1;
+            }
+        }
+
+        // Three triangles sharing an edge and a degenerate triangle
+        VertexData fin;
+        fin.addDataVector<Vec3f>("position", Vector<Vec3f>(6, Vec3f::Zero()));
+        fin.setIndices(Vector<unsigned>{ 0, 1, 2, 1, 0, 3, 0, 1, 4, 4, 4, 5 });
+        fin.validate();
+        if (!buildHalfEdgeMesh(fin, halfEdgeMesh) ||
+            halfEdgeMesh.nonManifoldEdges != Vector<unsigned>{ 0, 9 } || halfEdgeMesh.nBorderEdges != 6) {
+            fprintf(stderr, "ERROR: Non-manifold edges not reported\n");
+            return 1;
+        }
+
+        // Grid against a brute force reference of the twins
+        const int gridSize = 1000;
+        VertexData grid;
+        grid.addDataVector<Vec3f>("position", Vector<Vec3f>((gridSize+1)*(gridSize+1), Vec3f::Zero()));
+        Vector<unsigned> indices;
+        indices.reserve(gridSize*gridSize*6);
+        for (int j=0; j<gridSize; ++j) {
+            for (int i=0; i<gridSize; ++i) {
+                unsigned a = j*(gridSize+1)+i;
+                unsigned c = a+gridSize+1;
+                indices.insert(indices.end(), { a, a+1, c, a+1, c+1, c });
+            }
+        }
+        grid.setIndices(std::move(indices));
+        grid.validate();
+
+        Stopwatch sw;
+        sw.start();
+        bool built = buildHalfEdgeMesh(grid, halfEdgeMesh);
+        uint64_t t = sw.stop();
+        printf("Half-edge mesh for %lld triangles %llu\n", (long long)halfEdgeMesh.nTriangles(), (unsigned long long)t);
+        if (!built || halfEdgeMesh.nBorderEdges != gridSize*4 || !halfEdgeMesh.nonManifoldEdges.empty()) {
+            fprintf(stderr, "ERROR: Half-edge mesh of a grid failed\n");
+            return 1;
+        }
+        for (int64_t h=0; h<halfEdgeMesh.nHalfEdges(); ++h) {
+            // Diagonal, horizontal and vertical half-edges of the quads
+            unsigned from = halfEdgeMesh.from(h), to = halfEdgeMesh.to(h);
+            unsigned twin = halfEdgeMesh.twin(h);
+            int64_t dx = (int64_t)(to%(gridSize+1)) - (from%(gridSize+1));
+            int64_t dy = (int64_t)(to/(gridSize+1)) - (from/(gridSize+1));
+            int64_t x = std::min(from%(gridSize+1), to%(gridSize+1));
+            int64_t y = std::min(from/(gridSize+1), to/(gridSize+1));
+            bool border = (dy == 0 && (y == 0 || y == gridSize)) || (dx == 0 && (x == 0 || x == gridSize));
+            if (border != (twin == HalfEdgeMesh::none) || (!border && (halfEdgeMesh.twin(twin) != h ||
+                halfEdgeMesh.from(twin) != to || halfEdgeMesh.to(twin) != from))) {
+                fprintf(stderr, "ERROR: Invalid twin of half-edge %lld\n", (long long)h);
+                return 1;
+            }
+            unsigned fanStart = halfEdgeMesh.vertexHalfEdges[from];
+            if (halfEdgeMesh.from(fanStart) != from || (border && halfEdgeMesh.twin(fanStart) != HalfEdgeMesh::none &&
+                halfEdgeMesh.from(h) == from && twin == HalfEdgeMesh::none)) {
+                fprintf(stderr, "ERROR: Invalid outgoing half-edge of vertex %u\n", from);
+                return 1;
+            }
+        }
+    }
+
+    // Test half-edge mesh of a high-valence vertex: open fan around vertex 0 with descending
+    // spokes, the whole mesh falls in the bucket of vertex 0 in reverse order
+    {
+        constexpr unsigned nFanTriangles = 100000;
+        VertexData fan;
+        Vector<Vec3f> positions(nFanTriangles+2);
+        positions[0] = Vec3f(0.0f, 0.0f, 0.0f);
+        for (unsigned s=1; s<=nFanTriangles+1; ++s) {
+            float angle = 3.0f*(float)(s-1)/nFanTriangles;
+            positions[s] = Vec3f(std::cos(angle), std::sin(angle), 0.0f);
+        }
+        fan.addDataVector<Vec3f>("position", std::move(positions));
+        Vector<unsigned> indices;
+        for (unsigned s=nFanTriangles; s>=1; --s)
+            indices.insert(indices.end(), { 0u, s, s+1 });
+        fan.setIndices(std::move(indices));
+        fan.validate();
+
+        HalfEdgeMesh halfEdgeMesh;
+        Stopwatch sw;
+        sw.start();
+        bool built = buildHalfEdgeMesh(fan, halfEdgeMesh);
+        uint64_t t = sw.stop();
+        printf("Half-edge mesh for a fan of %lld triangles %llu\n", (long long)halfEdgeMesh.nTriangles(), (unsigned long long)t);
+        if (!built || halfEdgeMesh.nBorderEdges != nFanTriangles+2 || !halfEdgeMesh.nonManifoldEdges.empty()) {
+            fprintf(stderr, "ERROR: Half-edge mesh of a fan failed\n");
+            return 1;
+        }
+        for (int64_t h=0; h<halfEdgeMesh.nHalfEdges(); ++h) {
+            // Spokes other than the first and the last are shared by two triangles
+            unsigned from = halfEdgeMesh.from(h), to = halfEdgeMesh.to(h);
+            unsigned twin = halfEdgeMesh.twin(h);
+            unsigned spoke = std::max(from, to);
+            bool border = std::min(from, to) != 0 || spoke == 1 || spoke == nFanTriangles+1;
+            if (border != (twin == HalfEdgeMesh::none) || (!border && (halfEdgeMesh.twin(twin) != h ||
+                halfEdgeMesh.from(twin) != to || halfEdgeMesh.to(twin) != from))) {
+                fprintf(stderr, "ERROR: Invalid twin of fan half-edge %lld\n", (long long)h);
+                return 1;
+            }
+        }
+        unsigned fanStart = halfEdgeMesh.vertexHalfEdges[0];
+        if (halfEdgeMesh.from(fanStart) != 0 || halfEdgeMesh.to(fanStart) != 1) {
+            fprintf(stderr, "ERROR: Invalid outgoing half-edge of the fan center\n");
+            return 1;
+        }
+    }
+
+    // Test PLY and STL loading
+    {
+        VertexData reference;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", reference);
+        const auto* referencePosition = std::as_const(reference).accessData("position");
+        const auto* referenceNormal = std::as_const(reference).accessData("normal");
+        auto* positions = static_cast<const Vec3f*>(referencePosition->data());
+        auto* normals = static_cast<const Vec3f*>(referenceNormal->data());
+        int64_t nVertices = referencePosition->size();
+        const auto& indices = reference.getIndices();
+        int64_t nTriangles = indices.size() / 3;
+
+        // Binary writer in the given byte order, faces stored as uchar count + int indices
+        // Returns flag indicating whether the file was written
+        auto writeBinaryPLY = [&](const std::string& fileName, bool bigEndian, bool withNormals,
+            bool withColors, bool withFaces) {
+            std::string header = std::string("ply\nformat ") +
+                (bigEndian ? "binary_big_endian" : "binary_little_endian") + " 1.0\n" +
+                "element vertex " + std::to_string(nVertices) + "\n" +
+                "property float x\nproperty float y\nproperty float z\n";
+            if (withNormals)
+                header += "property float nx\nproperty float ny\nproperty float nz\n";
+            if (withColors)
+                header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+            if (withFaces)
+                header += "element face " + std::to_string(nTriangles) + "\nproperty list uchar int vertex_indices\n";
+            header += "end_header\n";
+
+            // Comment padding the data to a 4-byte boundary for aliasing
+            std::string comment = "comment GraphicsUtils test";
+            comment.append((4 - (header.size()+comment.size()+1)%4)%4, ' ');
+            header.insert(header.find("element"), comment + "\n");
+
+            FILE* f = fopen(fileName.c_str(), "wb");
+            if (f == nullptr) {
+                fprintf(stderr, "ERROR: Could not open %s for writing\n", fileName.c_str());
+                return false;
+            }
+            fwrite(header.data(), 1, header.size(), f);
+
+            bool swap = bigEndian != (std::endian::native == std::endian::big);
+            auto put = [&](auto v) {
+                char bytes[sizeof(v)];
+                memcpy(bytes, &v, sizeof(v));
+                if (swap)
+                    std::reverse(bytes, bytes+sizeof(v));
+                fwrite(bytes, 1, sizeof(v), f);
+            };
+            for (int64_t i=0; i<nVertices; ++i) {
+                put(positions[i](0)); put(positions[i](1)); put(positions[i](2));
+                if (withNormals) {
+                    put(normals[i](0)); put(normals[i](1)); put(normals[i](2));
+                }
+                if (withColors) {
+                    put((uint8_t)(i%256)); put((uint8_t)(i*7%256)); put((uint8_t)255);
+                }
+            }
+            for (int64_t t=0; withFaces && t<nTriangles; ++t) {
+                put((uint8_t)3);
+                for (int j=0; j<3; ++j)
+                    put((int32_t)indices[t*3+j]);
+            }
+            fclose(f);
+            return true;
+        };
+
+        auto matchesReference = [&](const VertexData& vertexData, bool external) {
+            const auto* position = vertexData.accessData("position");
+            const auto* normal = vertexData.accessData("normal");
+            return vertexData.isValid() && position != nullptr && normal != nullptr &&
+                position->isExternal() == external && position->size() == nVertices && normal->size() == nVertices &&
+                vertexData.getIndices() == indices &&
+                memcmp(position->data(), positions, nVertices*sizeof(Vec3f)) == 0 &&
+                memcmp(normal->data(), normals, nVertices*sizeof(Vec3f)) == 0;
+        };
+
+        for (bool bigEndian : { false, true }) {
+            std::string fileName = bigEndian ? "output/testUtils_bunny_be.ply" : "output/testUtils_bunny_le.ply";
+            if (!writeBinaryPLY(fileName, bigEndian, true, false, true))
+                return 1;
+
+            VertexData vertexData;
+            Stopwatch sw;
+            sw.start();
+            loadMeshFromPLY(fileName, vertexData);
+            uint64_t t = sw.stop();
+            printf("Load bunny.ply (binary %s endian) %llu\n", bigEndian ? "big" : "little", (unsigned long long)t);
+
+            if (!matchesReference(vertexData, false)) {
+                fprintf(stderr, "ERROR: Binary PLY (%s endian) loading failed\n", bigEndian ? "big" : "little");
+                return 1;
+            }
+        }
+
+        {
+            FILE* f = fopen("output/testUtils_bunny_ascii.ply", "wb");
+            if (f == nullptr) {
+                fprintf(stderr, "ERROR: Could not open output/testUtils_bunny_ascii.ply for writing\n");
+                return 1;
+            }
+            fprintf(f, "ply\nformat ascii 1.0\nelement vertex %lld\nproperty float x\nproperty float y\n"
+                "property float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+                "element face %lld\nproperty list uchar uint vertex_indices\nend_header\n",
+                (long long)nVertices, (long long)nTriangles);
+            for (int64_t i=0; i<nVertices; ++i) {
+                fprintf(f, "%.9g %.9g %.9g %.9g %.9g %.9g\n", positions[i](0), positions[i](1), positions[i](2),
+                    normals[i](0), normals[i](1), normals[i](2));
+            }
+            for (int64_t t=0; t<nTriangles; ++t)
+                fprintf(f, "3 %u %u %u\n", indices[t*3], indices[t*3+1], indices[t*3+2]);
+            fclose(f);
+
+            VertexData vertexData;
+            loadMeshFromPLY("output/testUtils_bunny_ascii.ply", vertexData);
+            if (!matchesReference(vertexData, false)) {
+                fprintf(stderr, "ERROR: ASCII PLY loading failed\n");
+                return 1;
+            }
+        }
+
+        // Point clouds, xyz-only records in the native byte order alias the mapped file and in
+        // the foreign byte order are swapped directly to the container
+        for (int cloud=0; cloud<4; ++cloud) {
+            bool bigEndian = cloud & 1, withColors = cloud & 2;
+            bool foreign = bigEndian != (std::endian::native == std::endian::big);
+            std::string fileName = std::string("output/testUtils_cloud") + (withColors ? "_color" : "") +
+                (bigEndian ? "_be.ply" : "_le.ply");
+            if (!writeBinaryPLY(fileName, bigEndian, false, withColors, false))
+                return 1;
+
+            VertexData vertexData;
+            loadMeshFromPLY(fileName, vertexData);
+            const auto* position = std::as_const(vertexData).accessData("position");
+            const auto* color = std::as_const(vertexData).accessData("color");
+            bool success = vertexData.isValid() && position != nullptr && position->size() == nVertices &&
+                position->isExternal() == (!foreign && !withColors) && (color != nullptr) == withColors &&
+                (int64_t)vertexData.getIndices().size() == nVertices &&
+                memcmp(position->data(), positions, nVertices*sizeof(Vec3f)) == 0;
+            for (int64_t i=0; success && i<nVertices; ++i) {
+                success = vertexData.getIndices()[i] == (unsigned)i;
+                if (color != nullptr) {
+                    auto& c = static_cast<const Vec3f*>(color->data())[i];
+                    success = success && std::abs(c(0) - (float)(i%256)/255.0f) < 1.0e-6f &&
+                        std::abs(c(1) - (float)(i*7%256)/255.0f) < 1.0e-6f && c(2) == 1.0f;
+                }
+            }
+            if (!success) {
+                fprintf(stderr, "ERROR: PLY point cloud (%s endian%s) loading failed\n", bigEndian ? "big" : "little",
+                    withColors ? ", colors" : "");
+                return 1;
+            }
+        }
+
+        // Polygons are triangulated as fans
+        {
+            FILE* f = fopen("output/testUtils_quad.ply", "wb");
+            if (f == nullptr) {
+                fprintf(stderr, "ERROR: Could not open output/testUtils_quad.ply for writing\n");
+                return 1;
+            }
+            fprintf(f, "ply\r\nformat ascii 1.0\r\nelement vertex 4\r\nproperty float x\r\nproperty float y\r\n"
+                "property float z\r\nelement face 1\r\nproperty list uchar int vertex_index\r\nend_header\r\n"
+                "0 0 0\r\n1 0 0\r\n1 1 0\r\n0 1 0\r\n4 0 1 2 3\r\n");
+            fclose(f);
+
+            VertexData vertexData;
+            loadMeshFromPLY("output/testUtils_quad.ply", vertexData);
+            if (!vertexData.isValid() || vertexData.getIndices() != Vector<unsigned>{ 0, 1, 2, 0, 2, 3 }) {
+                fprintf(stderr, "ERROR: PLY polygon triangulation failed\n");
+                return 1;
+            }
+        }
+
+        // Binary STL, odd triangles without facet normals
+        {
+            FILE* f = fopen("output/testUtils_bunny.stl", "wb");
+            if (f == nullptr) {
+                fprintf(stderr, "ERROR: Could not open output/testUtils_bunny.stl for writing\n");
+                return 1;
+            }
+            char header[80] = "GraphicsUtils test";
+            uint32_t n = (uint32_t)nTriangles;
+            fwrite(header, 1, sizeof(header), f);
+            fwrite(&n, sizeof(n), 1, f);
+            for (int64_t t=0; t<nTriangles; ++t) {
+                const Vec3f* p[3] = { &positions[indices[t*3]], &positions[indices[t*3+1]], &positions[indices[t*3+2]] };
+                Vec3f normal = t%2 == 0 ? Vec3f((*p[1]-*p[0]).cross(*p[2]-*p[0]).normalized()) : Vec3f::Zero();
+                uint16_t attribute = 0;
+                fwrite(normal.data(), sizeof(float), 3, f);
+                for (int j=0; j<3; ++j)
+                    fwrite(p[j]->data(), sizeof(float), 3, f);
+                fwrite(&attribute, sizeof(attribute), 1, f);
+            }
+            fclose(f);
+
+            VertexData vertexData;
+            loadMeshFromSTL("output/testUtils_bunny.stl", vertexData);
+            const auto* position = std::as_const(vertexData).accessData("position");
+            const auto* normal = std::as_const(vertexData).accessData("normal");
+            bool success = vertexData.isValid() && position != nullptr && normal != nullptr &&
+                position->size() == nTriangles*3 && (int64_t)vertexData.getIndices().size() == nTriangles*3;
+            for (int64_t i=0; success && i<nTriangles*3; ++i) {
+                const Vec3f* p = static_cast<const Vec3f*>(position->data()) + i/3*3;
+                Vec3f expected = (p[1]-p[0]).cross(p[2]-p[0]).normalized();
+                success = p[i%3] == positions[indices[i]] &&
+                    (static_cast<const Vec3f*>(normal->data())[i] - expected).norm() < 1.0e-5f;
+            }
+            if (!success) {
+                fprintf(stderr, "ERROR: Binary STL loading failed\n");
+                return 1;
+            }
+        }
+    }
+
+    // Test loading with memory resources
+    {
+        VertexData reference;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", reference);
+
+        CountingMemoryResource counter;
+        {
+            VertexData vertexData;
+            loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", vertexData, &counter);
+            printf("Load bunny with resource: %lld allocations, peak %lld bytes, %lld bytes retained\n",
+                (long long)counter.nAllocations(), (long long)counter.peakBytes(), (long long)counter.allocatedBytes());
+
+            auto* position = vertexData.accessData("position");
+            auto* normal = vertexData.accessData("normal");
+            if (!vertexData.isValid() || position == nullptr || normal == nullptr ||
+                vertexData.getIndices() != reference.getIndices() ||
+                memcmp(position->data(), reference.accessData("position")->data(), position->size()*sizeof(Vec3f)) != 0 ||
+                memcmp(normal->data(), reference.accessData("normal")->data(), normal->size()*sizeof(Vec3f)) != 0 ||
+                counter.allocatedBytes() < (position->size() + normal->size())*(int64_t)sizeof(Vec3f) ||
+                counter.allocatedBytes() > (position->size() + normal->size())*(int64_t)sizeof(Vec3f) + 1024) { // + control blocks
+                fprintf(stderr, "ERROR: Loading with memory resource failed\n");
+                return 1;
+            }
+
+            // Copies share the resource-allocated data, modifications detach it to a new
+            // allocation from the resource
+            int64_t nPositions = position->size();
+            int64_t allocatedBytes = counter.allocatedBytes();
+            const Vec3f* sharedPositions = position->data<Vec3f>();
+            VertexData copy = vertexData;
+            auto* copyPosition = copy.accessData("position");
+            if (copyPosition->data<Vec3f>() == sharedPositions || !copyPosition->isExternal() ||
+                counter.allocatedBytes() <= allocatedBytes || position->data<Vec3f>() != sharedPositions) {
+                fprintf(stderr, "ERROR: Modifying resource-allocated vertex data failed\n");
+                return 1;
+            }
+            vertexData = VertexData();
+            if (copy.accessData("position")->size() != nPositions || counter.nDeallocations() > counter.nAllocations() ||
+                counter.allocatedBytes() > allocatedBytes) {
+                fprintf(stderr, "ERROR: Copying resource-allocated vertex data failed\n");
+                return 1;
+            }
+        }
+        if (counter.allocatedBytes() != 0) {
+            fprintf(stderr, "ERROR: Resource-allocated vertex data not released: %lld bytes\n",
+                (long long)counter.allocatedBytes());
+            return 1;
+        }
+
+        // Batch of meshes from a shared pool released in one shot
+        counter.resetCounters();
+        {
+            std::pmr::synchronized_pool_resource pool(&counter);
+            Vector<VertexData> batch(16);
+            for (auto& vertexData : batch)
+                loadMeshFromOBJ(std::string(RES_PATH) + "models/teapot.obj", vertexData, &pool);
+            printf("Load 16 teapots with a pool: %lld upstream allocations, peak %lld bytes\n",
+                (long long)counter.nAllocations(), (long long)counter.peakBytes());
+        }
+        if (counter.allocatedBytes() != 0) {
+            fprintf(stderr, "ERROR: Pool memory not released\n");
+            return 1;
+        }
+    }
+
+    // Test copy-on-write vertex data
+    {
+        VertexData original;
+        loadMeshFromOBJ(std::string(RES_PATH) + "models/bunny.obj", original);
+        const auto& originalIndices = original.getIndices();
+        const auto* originalPositions = std::as_const(original).accessData("position");
+        Vector<Vec3f> positions(static_cast<const Vec3f*>(originalPositions->data()),
+            static_cast<const Vec3f*>(originalPositions->data()) + originalPositions->size());
+
+        Stopwatch sw;
+        sw.start();
+        VertexData copy = original;
+        uint64_t t = sw.stop();
+        printf("Copy bunny VertexData %llu\n", (unsigned long long)t);
+
+        // Copies share the data until modified
+        if (!originalPositions->isShared() || &copy.getIndices() != &originalIndices ||
+            std::as_const(copy).accessData("position")->data() != originalPositions->data()) {
+            fprintf(stderr, "ERROR: VertexData copy does not share the data\n");
+            return 1;
+        }
+
+        copy.addData<Vec3f>("position", { Vec3f(1.0f, 2.0f, 3.0f) });
+        copy.setIndices(Vector<unsigned>{ 0, 1, (unsigned)positions.size()-1 });
+        if (originalPositions->isShared() || originalPositions->size() != (int64_t)positions.size() ||
+            memcmp(originalPositions->data(), positions.data(), positions.size()*sizeof(Vec3f)) != 0 ||
+            &original.getIndices() != &originalIndices || !copy.validate() ||
+            copy.accessData("position")->size() != (int64_t)positions.size()+1) {
+            fprintf(stderr, "ERROR: Modifying VertexData copy changed the original\n");
+            return 1;
+        }
+
+        // Readers of shared copies while new versions are produced and released
+        std::atomic<int> nErrors(0);
+        parallelFor(0, 64, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                VertexData version = original;
+                if (i % 2 == 0) {
+                    version.accessData("position")->gather(version.getIndices().data(), 3);
+                    version.setIndices(Vector<unsigned>{ 0, 1, 2 });
+                }
+                else {
+                    const auto* c = std::as_const(version).accessData("position");
+                    if (memcmp(c->data(), positions.data(), positions.size()*sizeof(Vec3f)) != 0)
+                        ++nErrors;
+                }
+            }
+        }, 1);
+        if (nErrors > 0 || originalPositions->isShared() ||
+            memcmp(originalPositions->data(), positions.data(), positions.size()*sizeof(Vec3f)) != 0) {
+            fprintf(stderr, "ERROR: Concurrent VertexData versions failed\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
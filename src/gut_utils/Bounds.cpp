@@ -0,0 +1,244 @@
+//
+// Project: GraphicsUtils
+// File: Bounds.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "Bounds.hpp"
+#include "ParallelFor.hpp"
+#include "TypeUtils.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_BOUNDS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+using namespace gut;
+
+
+namespace {
+
+    constexpr int64_t boundsBlockSize = 65536;
+
+    inline const Vec3f& position(const uint8_t* data, size_t stride, int64_t i)
+    {
+        return *reinterpret_cast<const Vec3f*>(data + i*stride);
+    }
+
+#ifdef GUT_BOUNDS_SSE2
+    // Load four positions transposed to SoA registers
+    inline void load4(const uint8_t* data, size_t stride, int64_t i, __m128& x, __m128& y, __m128& z)
+    {
+        if (stride == sizeof(Vec3f)) {
+            // a = (x0 y0 z0 x1), b = (y1 z1 x2 y2), c = (z2 x3 y3 z3)
+            const float* f = reinterpret_cast<const float*>(data + i*stride);
+            __m128 a = _mm_loadu_ps(f);
+            __m128 b = _mm_loadu_ps(f+4);
+            __m128 c = _mm_loadu_ps(f+8);
+            __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); // b2 b3 c1 c2
+            __m128 ab1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)); // a1 a1 b0 b0
+            __m128 ab2 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)); // a2 a2 b1 b1
+            x = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));
+            y = _mm_shuffle_ps(ab1, bc, _MM_SHUFFLE(3, 1, 2, 0));
+            z = _mm_shuffle_ps(ab2, c, _MM_SHUFFLE(3, 0, 2, 0));
+        }
+        else {
+            const Vec3f& p0 = position(data, stride, i);
+            const Vec3f& p1 = position(data, stride, i+1);
+            const Vec3f& p2 = position(data, stride, i+2);
+            const Vec3f& p3 = position(data, stride, i+3);
+            x = _mm_setr_ps(p0(0), p1(0), p2(0), p3(0));
+            y = _mm_setr_ps(p0(1), p1(1), p2(1), p3(1));
+            z = _mm_setr_ps(p0(2), p1(2), p2(2), p3(2));
+        }
+    }
+
+    inline float horizontalMin(__m128 v)
+    {
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float horizontalMax(__m128 v)
+    {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    // Squared distances of four positions to center
+    inline __m128 squaredDistance4(const uint8_t* data, size_t stride, int64_t i, const Vec3f& center)
+    {
+        __m128 x, y, z;
+        load4(data, stride, i, x, y, z);
+        x = _mm_sub_ps(x, _mm_set1_ps(center(0)));
+        y = _mm_sub_ps(y, _mm_set1_ps(center(1)));
+        z = _mm_sub_ps(z, _mm_set1_ps(center(2)));
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    }
+#endif
+
+    void minMax(const uint8_t* data, size_t stride, int64_t begin, int64_t end, Vec3f& minimum, Vec3f& maximum)
+    {
+        minimum = Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+        maximum = Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        int64_t i = begin;
+#ifdef GUT_BOUNDS_SSE2
+        if (end-begin >= 4) {
+            __m128 minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+            __m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+            for (; i+4<=end; i+=4) {
+                __m128 x, y, z;
+                load4(data, stride, i, x, y, z);
+                minX = _mm_min_ps(minX, x); maxX = _mm_max_ps(maxX, x);
+                minY = _mm_min_ps(minY, y); maxY = _mm_max_ps(maxY, y);
+                minZ = _mm_min_ps(minZ, z); maxZ = _mm_max_ps(maxZ, z);
+            }
+            minimum = Vec3f(horizontalMin(minX), horizontalMin(minY), horizontalMin(minZ));
+            maximum = Vec3f(horizontalMax(maxX), horizontalMax(maxY), horizontalMax(maxZ));
+        }
+#endif
+        for (; i<end; ++i) {
+            minimum = minimum.cwiseMin(position(data, stride, i));
+            maximum = maximum.cwiseMax(position(data, stride, i));
+        }
+    }
+
+    float maxSquaredDistance(const uint8_t* data, size_t stride, int64_t begin, int64_t end, const Vec3f& center)
+    {
+        float d2 = 0.0f;
+        int64_t i = begin;
+#ifdef GUT_BOUNDS_SSE2
+        if (end-begin >= 4) {
+            __m128 maxD2 = _mm_setzero_ps();
+            for (; i+4<=end; i+=4)
+                maxD2 = _mm_max_ps(maxD2, squaredDistance4(data, stride, i, center));
+            d2 = horizontalMax(maxD2);
+        }
+#endif
+        for (; i<end; ++i)
+            d2 = std::max(d2, (position(data, stride, i)-center).squaredNorm());
+        return d2;
+    }
+
+    // Ritter's bounding sphere seeded with the extreme points along the widest axis
+    Vec4f ritterSphere(const uint8_t* data, size_t stride, int64_t n, const Vec3f& minimum, const Vec3f& maximum)
+    {
+        int axis;
+        (maximum-minimum).maxCoeff(&axis);
+        int64_t iMin = 0, iMax = 0;
+        for (int64_t i=0; i<n; ++i) {
+            float v = position(data, stride, i)(axis);
+            if (v == minimum(axis)) iMin = i;
+            if (v == maximum(axis)) iMax = i;
+        }
+
+        Vec3f center = 0.5f*(position(data, stride, iMin) + position(data, stride, iMax));
+        float radius = 0.5f*(position(data, stride, iMax) - position(data, stride, iMin)).norm();
+
+        auto grow = [&](const Vec3f& p) {
+            float d = (p-center).norm();
+            if (d > radius) {
+                float newRadius = 0.5f*(radius+d);
+                center += (p-center)*((newRadius-radius)/d);
+                radius = newRadius;
+            }
+        };
+
+        int64_t i = 0;
+#ifdef GUT_BOUNDS_SSE2
+        // Most points are inside, test four at a time and grow sequentially on misses
+        for (; i+4<=n; i+=4) {
+            __m128 d2 = squaredDistance4(data, stride, i, center);
+            if (_mm_movemask_ps(_mm_cmpgt_ps(d2, _mm_set1_ps(radius*radius))) != 0) {
+                for (int j=0; j<4; ++j)
+                    grow(position(data, stride, i+j));
+            }
+        }
+#endif
+        for (; i<n; ++i)
+            grow(position(data, stride, i));
+
+        return Vec4f(center(0), center(1), center(2), radius);
+    }
+
+} // namespace
+
+
+Bounds::Bounds() :
+    minimum (FLT_MAX, FLT_MAX, FLT_MAX),
+    maximum (-FLT_MAX, -FLT_MAX, -FLT_MAX),
+    sphere  (0.0f, 0.0f, 0.0f, -1.0f)
+{
+}
+
+bool Bounds::empty() const noexcept
+{
+    return (minimum.array() > maximum.array()).any();
+}
+
+Bounds gut::computeBounds(const Vec3f* positions, int64_t n, size_t stride)
+{
+    Bounds bounds;
+    if (n <= 0)
+        return bounds;
+
+    const auto* data = reinterpret_cast<const uint8_t*>(positions);
+
+    int nBlocks = parallelForBlocks(n, boundsBlockSize);
+    Vector<Vec3f> blockMinimums(nBlocks);
+    Vector<Vec3f> blockMaximums(nBlocks);
+    parallelFor(0, n, [&](int64_t begin, int64_t end, int blockId) {
+        minMax(data, stride, begin, end, blockMinimums[blockId], blockMaximums[blockId]);
+    }, boundsBlockSize);
+    for (int i=0; i<nBlocks; ++i) {
+        bounds.minimum = bounds.minimum.cwiseMin(blockMinimums[i]);
+        bounds.maximum = bounds.maximum.cwiseMax(blockMaximums[i]);
+    }
+
+    Vec3f boxCenter = 0.5f*(bounds.minimum + bounds.maximum);
+    Vector<float> blockDistances(nBlocks);
+    parallelFor(0, n, [&](int64_t begin, int64_t end, int blockId) {
+        blockDistances[blockId] = maxSquaredDistance(data, stride, begin, end, boxCenter);
+    }, boundsBlockSize);
+    float boxRadius = std::sqrt(*std::max_element(blockDistances.begin(), blockDistances.end()));
+
+    bounds.sphere = ritterSphere(data, stride, n, bounds.minimum, bounds.maximum);
+    if (boxRadius <= bounds.sphere(3))
+        bounds.sphere = Vec4f(boxCenter(0), boxCenter(1), boxCenter(2), boxRadius);
+
+    return bounds;
+}
+
+Bounds gut::transformBounds(const Bounds& bounds, const Mat4f& transform)
+{
+    if (bounds.empty())
+        return bounds;
+
+    Bounds transformed;
+    for (int i=0; i<8; ++i) {
+        Vec4f corner((i & 1) ? bounds.maximum(0) : bounds.minimum(0),
+                     (i & 2) ? bounds.maximum(1) : bounds.minimum(1),
+                     (i & 4) ? bounds.maximum(2) : bounds.minimum(2), 1.0f);
+        Vec3f p = (transform*corner).head<3>();
+        transformed.minimum = transformed.minimum.cwiseMin(p);
+        transformed.maximum = transformed.maximum.cwiseMax(p);
+    }
+
+    Vec4f center = transform*Vec4f(bounds.sphere(0), bounds.sphere(1), bounds.sphere(2), 1.0f);
+    float scale = transform.block<3,3>(0,0).colwise().norm().maxCoeff();
+    transformed.sphere = Vec4f(center(0), center(1), center(2), bounds.sphere(3)*scale);
+
+    return transformed;
+}
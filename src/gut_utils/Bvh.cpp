@@ -0,0 +1,453 @@
+//
+// Project: GraphicsUtils
+// File: Bvh.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "Bvh.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+
+
+using namespace gut;
+
+
+namespace {
+
+    constexpr int64_t triangleBlockSize = 16384;
+    constexpr int64_t parallelBinningSize = 65536;
+    constexpr int64_t minTaskSize = 4096;
+
+    inline float halfArea(const Vec3f& minimum, const Vec3f& maximum)
+    {
+        Vec3f e = (maximum-minimum).cwiseMax(0.0f);
+        return e(0)*e(1) + e(1)*e(2) + e(2)*e(0);
+    }
+
+    // Triangle and centroid bounds of a set of triangles (a SAH bin or a triangle range)
+    struct Bin {
+        Vec3f   minimum;
+        Vec3f   maximum;
+        Vec3f   centroidMinimum;
+        Vec3f   centroidMaximum;
+        int64_t count;
+
+        Bin() :
+            minimum         (FLT_MAX, FLT_MAX, FLT_MAX),
+            maximum         (-FLT_MAX, -FLT_MAX, -FLT_MAX),
+            centroidMinimum (FLT_MAX, FLT_MAX, FLT_MAX),
+            centroidMaximum (-FLT_MAX, -FLT_MAX, -FLT_MAX),
+            count           (0)
+        {}
+
+        void add(const Vec3f& triangleMinimum, const Vec3f& triangleMaximum, const Vec3f& centroid)
+        {
+            minimum = minimum.cwiseMin(triangleMinimum);
+            maximum = maximum.cwiseMax(triangleMaximum);
+            centroidMinimum = centroidMinimum.cwiseMin(centroid);
+            centroidMaximum = centroidMaximum.cwiseMax(centroid);
+            ++count;
+        }
+
+        void merge(const Bin& other)
+        {
+            minimum = minimum.cwiseMin(other.minimum);
+            maximum = maximum.cwiseMax(other.maximum);
+            centroidMinimum = centroidMinimum.cwiseMin(other.centroidMinimum);
+            centroidMaximum = centroidMaximum.cwiseMax(other.centroidMaximum);
+            count += other.count;
+        }
+    };
+
+    // Node of the intermediate tree, children index the same node vector
+    struct BuildNode {
+        Vec3f   minimum;
+        Vec3f   maximum;
+        int64_t begin;
+        int64_t count;  // > 0 for leaves
+        int64_t left;
+        int64_t right;
+        int64_t task;   // >= 0 for subtrees built as separate tasks
+    };
+
+    struct WorkItem {
+        int64_t node;
+        int64_t begin;
+        Bin     range;
+    };
+
+    class BvhBuilder {
+    public:
+        BvhBuilder(const BvhSettings& settings, const Vector<Vec3f>& minimums, const Vector<Vec3f>& maximums,
+            const Vector<Vec3f>& centroids, Vector<unsigned>& triangles) :
+            _settings   (settings),
+            _minimums   (minimums),
+            _maximums   (maximums),
+            _centroids  (centroids),
+            _triangles  (triangles)
+        {}
+
+        // Build a subtree to nodes, its root is the first added node. With tasks, ranges of
+        // at most taskSize triangles are deferred to tasks instead of being built.
+        void build(Vector<BuildNode>& nodes, int64_t begin, const Bin& range,
+            int64_t taskSize = 0, Vector<WorkItem>* tasks = nullptr)
+        {
+            Vector<WorkItem> stack;
+            stack.push_back({ addNode(nodes, begin, range), begin, range });
+            while (!stack.empty()) {
+                WorkItem item = stack.back();
+                stack.pop_back();
+
+                if (tasks != nullptr && item.range.count <= taskSize) {
+                    nodes[item.node].task = (int64_t)tasks->size();
+                    tasks->push_back(item);
+                    continue;
+                }
+
+                Bin left, right;
+                int64_t middle = split(item.begin, item.range, left, right, tasks != nullptr);
+                if (middle < 0) {
+                    nodes[item.node].count = item.range.count;
+                    continue;
+                }
+
+                int64_t leftNode = addNode(nodes, item.begin, left);
+                int64_t rightNode = addNode(nodes, middle, right);
+                nodes[item.node].left = leftNode;
+                nodes[item.node].right = rightNode;
+                stack.push_back({ rightNode, middle, right });
+                stack.push_back({ leftNode, item.begin, left });
+            }
+        }
+
+    private:
+        const BvhSettings&      _settings;
+        const Vector<Vec3f>&    _minimums;
+        const Vector<Vec3f>&    _maximums;
+        const Vector<Vec3f>&    _centroids;
+        Vector<unsigned>&       _triangles;
+
+        static int64_t addNode(Vector<BuildNode>& nodes, int64_t begin, const Bin& range)
+        {
+            nodes.push_back({ range.minimum, range.maximum, begin, 0, -1, -1, -1 });
+            return (int64_t)nodes.size()-1;
+        }
+
+        inline int binIndex(float centroid, float minimum, float scale) const
+        {
+            return std::clamp((int)((centroid-minimum)*scale), 0, _settings.nBins-1);
+        }
+
+        // Split a range, returns the first triangle of the right side or -1 for a leaf
+        int64_t split(int64_t begin, const Bin& range, Bin& left, Bin& right, bool parallel)
+        {
+            const int nBins = _settings.nBins;
+            int64_t count = range.count;
+            int64_t end = begin + count;
+            if (count <= 1)
+                return -1;
+
+            Vec3f extent = range.centroidMaximum - range.centroidMinimum;
+            if (extent.maxCoeff() <= 0.0f) {
+                // Coincident centroids, split in the middle unless a leaf is allowed
+                if (count <= _settings.maxLeafSize)
+                    return -1;
+                int64_t middle = begin + count/2;
+                for (int64_t i=begin; i<end; ++i) {
+                    unsigned t = _triangles[i];
+                    (i < middle ? left : right).add(_minimums[t], _maximums[t], _centroids[t]);
+                }
+                return middle;
+            }
+
+            Vec3f scale;
+            for (int a=0; a<3; ++a)
+                scale(a) = extent(a) > 0.0f ? (float)nBins*(1.0f-1.0e-6f) / extent(a) : 0.0f;
+
+            // Bins of all axes, parallel binning accumulates per-block bins merged in order
+            auto binRange = [&](int64_t b, int64_t e, Bin* bins) {
+                for (int64_t i=b; i<e; ++i) {
+                    unsigned t = _triangles[i];
+                    const Vec3f& c = _centroids[t];
+                    for (int a=0; a<3; ++a)
+                        bins[a*nBins + binIndex(c(a), range.centroidMinimum(a), scale(a))]
+                            .add(_minimums[t], _maximums[t], c);
+                }
+            };
+            Vector<Bin> bins(3*nBins);
+            if (parallel && count > parallelBinningSize) {
+                int nBlocks = parallelForBlocks(count, parallelBinningSize);
+                Vector<Vector<Bin>> blockBins(nBlocks, Vector<Bin>(3*nBins));
+                parallelFor(begin, end, [&](int64_t b, int64_t e, int blockId) {
+                    binRange(b, e, blockBins[blockId].data());
+                }, parallelBinningSize);
+                for (auto& blockBin : blockBins)
+                    for (int i=0; i<3*nBins; ++i)
+                        bins[i].merge(blockBin[i]);
+            }
+            else
+                binRange(begin, end, bins.data());
+
+            // Sweep the split planes, costs relative to the range area
+            float rangeArea = halfArea(range.minimum, range.maximum);
+            float areaScale = rangeArea > 0.0f ? 1.0f/rangeArea : 0.0f;
+            float bestCost = FLT_MAX;
+            int bestAxis = -1;
+            int bestSplit = -1;
+            Vector<float> rightCosts(nBins);
+            for (int a=0; a<3; ++a) {
+                if (extent(a) <= 0.0f)
+                    continue;
+
+                Bin* axisBins = &bins[a*nBins];
+                Bin accumulated;
+                for (int i=nBins-1; i>0; --i) {
+                    accumulated.merge(axisBins[i]);
+                    rightCosts[i] = halfArea(accumulated.minimum, accumulated.maximum)*accumulated.count;
+                }
+                accumulated = Bin();
+                for (int i=1; i<nBins; ++i) {
+                    accumulated.merge(axisBins[i-1]);
+                    if (accumulated.count == 0 || accumulated.count == count)
+                        continue;
+                    float cost = _settings.traversalCost + _settings.intersectionCost*areaScale*
+                        (halfArea(accumulated.minimum, accumulated.maximum)*accumulated.count + rightCosts[i]);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = a;
+                        bestSplit = i;
+                    }
+                }
+            }
+
+            if (bestAxis < 0 || (bestCost >= _settings.intersectionCost*count && count <= _settings.maxLeafSize))
+                return -1;
+
+            for (int i=0; i<nBins; ++i)
+                (i < bestSplit ? left : right).merge(bins[bestAxis*nBins + i]);
+
+            auto* middle = std::partition(_triangles.data()+begin, _triangles.data()+end, [&](unsigned t) {
+                return binIndex(_centroids[t](bestAxis), range.centroidMinimum(bestAxis), scale(bestAxis)) < bestSplit;
+            });
+            return middle - _triangles.data();
+        }
+    };
+
+    // Write the subtree depth-first, subtrees built by tasks are followed to their own node vectors
+    void flatten(const Vector<BuildNode>& nodes, const Vector<Vector<BuildNode>>& taskNodes, Vector<BvhNode>& output)
+    {
+        struct Entry {
+            const Vector<BuildNode>*    nodes;
+            int64_t                     node;
+            int64_t                     outputNode; // >= 0 for closing the subtree of an output node
+        };
+
+        Vector<Entry> stack;
+        stack.push_back({ &nodes, 0, -1 });
+        while (!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+
+            if (entry.outputNode >= 0) {
+                output[entry.outputNode].offset = (uint32_t)output.size();
+                continue;
+            }
+
+            const BuildNode* node = &(*entry.nodes)[entry.node];
+            if (node->task >= 0) {
+                entry.nodes = &taskNodes[node->task];
+                node = &entry.nodes->front();
+            }
+
+            output.push_back({ node->minimum, (uint32_t)node->begin, node->maximum, (uint32_t)node->count });
+            if (node->count == 0) {
+                stack.push_back({ nullptr, 0, (int64_t)output.size()-1 });
+                stack.push_back({ entry.nodes, node->right, -1 });
+                stack.push_back({ entry.nodes, node->left, -1 });
+            }
+        }
+    }
+
+    // Triangle bounds, false if positions are not available
+    bool triangleBounds(const VertexData& vertexData, const unsigned* triangles, int64_t nTriangles,
+        const Vector<unsigned>& indices, Vector<Vec3f>& minimums, Vector<Vec3f>& maximums)
+    {
+        const auto* positionContainer = vertexData.accessData("position");
+        if (positionContainer == nullptr || positionContainer->type != MathTypeEnum::VEC3F) {
+            fprintf(stderr, "ERROR: BVH requires Vec3f position data\n"); // TODO logging
+            return false;
+        }
+        const auto* positions = static_cast<const Vec3f*>(positionContainer->data());
+
+        minimums.resize(nTriangles);
+        maximums.resize(nTriangles);
+        parallelFor(0, nTriangles, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                const unsigned* triangle = &indices[(triangles != nullptr ? triangles[i] : i)*3];
+                const Vec3f& p0 = positions[triangle[0]];
+                const Vec3f& p1 = positions[triangle[1]];
+                const Vec3f& p2 = positions[triangle[2]];
+                minimums[i] = p0.cwiseMin(p1).cwiseMin(p2);
+                maximums[i] = p0.cwiseMax(p1).cwiseMax(p2);
+            }
+        }, triangleBlockSize);
+
+        return true;
+    }
+
+} // namespace
+
+
+bool gut::buildBvh(const VertexData& vertexData, Bvh& bvh, const BvhSettings& settings,
+    BvhStatistics* statistics)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    bvh = Bvh();
+
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+    if (settings.nBins < 2 || settings.maxLeafSize < 1) {
+        fprintf(stderr, "ERROR: Invalid BVH settings\n"); // TODO logging
+        return false;
+    }
+
+    const auto& indices = vertexData.getIndices();
+    int64_t nTriangles = indices.size()/3;
+
+    Vector<Vec3f> minimums, maximums;
+    if (!triangleBounds(vertexData, nullptr, nTriangles, indices, minimums, maximums))
+        return false;
+
+    if (nTriangles > 0) {
+        Vector<Vec3f> centroids(nTriangles);
+        bvh.triangles.resize(nTriangles);
+        int nBlocks = parallelForBlocks(nTriangles, triangleBlockSize);
+        Vector<Bin> blockRanges(nBlocks);
+        parallelFor(0, nTriangles, [&](int64_t begin, int64_t end, int blockId) {
+            for (int64_t i=begin; i<end; ++i) {
+                centroids[i] = 0.5f*(minimums[i] + maximums[i]);
+                bvh.triangles[i] = (unsigned)i;
+                blockRanges[blockId].add(minimums[i], maximums[i], centroids[i]);
+            }
+        }, triangleBlockSize);
+        Bin range;
+        for (auto& blockRange : blockRanges)
+            range.merge(blockRange);
+
+        // Top of the tree with parallel binning, the remaining subtrees as parallel tasks
+        BvhBuilder builder(settings, minimums, maximums, centroids, bvh.triangles);
+        Vector<BuildNode> nodes;
+        Vector<WorkItem> tasks;
+        int64_t taskSize = std::max(nTriangles / (4*nWorkerThreads()), minTaskSize);
+        builder.build(nodes, 0, range, taskSize, &tasks);
+
+        Vector<Vector<BuildNode>> taskNodes(tasks.size());
+        parallelFor(0, tasks.size(), [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                builder.build(taskNodes[i], tasks[i].begin, tasks[i].range);
+        }, 1);
+
+        flatten(nodes, taskNodes, bvh.nodes);
+    }
+
+    if (statistics != nullptr) {
+        *statistics = computeBvhStatistics(bvh, settings);
+        statistics->buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    return true;
+}
+
+bool gut::refitBvh(const VertexData& vertexData, Bvh& bvh)
+{
+    const auto& indices = vertexData.getIndices();
+    if (!vertexData.isValid() || indices.size()/3 != bvh.triangles.size()) {
+        fprintf(stderr, "ERROR: VertexData does not match the BVH\n"); // TODO logging
+        return false;
+    }
+
+    // Triangle bounds in leaf order
+    int64_t nTriangles = bvh.triangles.size();
+    Vector<Vec3f> minimums, maximums;
+    if (!triangleBounds(vertexData, bvh.triangles.data(), nTriangles, indices, minimums, maximums))
+        return false;
+
+    int64_t nNodes = bvh.nodes.size();
+    parallelFor(0, nNodes, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            auto& node = bvh.nodes[i];
+            if (!node.isLeaf())
+                continue;
+            node.minimum = minimums[node.offset];
+            node.maximum = maximums[node.offset];
+            for (uint32_t j=1; j<node.count; ++j) {
+                node.minimum = node.minimum.cwiseMin(minimums[node.offset+j]);
+                node.maximum = node.maximum.cwiseMax(maximums[node.offset+j]);
+            }
+        }
+    }, triangleBlockSize);
+
+    // Children follow their parents, refit interior nodes in reverse order
+    for (int64_t i=nNodes-1; i>=0; --i) {
+        auto& node = bvh.nodes[i];
+        if (node.isLeaf())
+            continue;
+        const auto& left = bvh.nodes[i+1];
+        const auto& right = bvh.nodes[left.isLeaf() ? i+2 : left.offset];
+        node.minimum = left.minimum.cwiseMin(right.minimum);
+        node.maximum = left.maximum.cwiseMax(right.maximum);
+    }
+
+    return true;
+}
+
+BvhStatistics gut::computeBvhStatistics(const Bvh& bvh, const BvhSettings& settings)
+{
+    BvhStatistics statistics;
+    statistics.nNodes = bvh.nodes.size();
+    if (bvh.nodes.empty())
+        return statistics;
+
+    float rootArea = halfArea(bvh.nodes[0].minimum, bvh.nodes[0].maximum);
+    float areaScale = rootArea > 0.0f ? 1.0f/rootArea : 0.0f;
+    double cost = 0.0;
+    int64_t nLeafTriangles = 0;
+
+    // Ends of the subtrees enclosing the current node
+    Vector<uint32_t> subtreeEnds;
+    for (int64_t i=0; i<statistics.nNodes; ++i) {
+        while (!subtreeEnds.empty() && subtreeEnds.back() <= i)
+            subtreeEnds.pop_back();
+
+        const auto& node = bvh.nodes[i];
+        double area = halfArea(node.minimum, node.maximum)*areaScale;
+        if (node.isLeaf()) {
+            ++statistics.nLeaves;
+            nLeafTriangles += node.count;
+            statistics.maxDepth = std::max(statistics.maxDepth, (int)subtreeEnds.size());
+            statistics.maxLeafSize = std::max(statistics.maxLeafSize, (int)node.count);
+            cost += settings.intersectionCost*node.count*area;
+        }
+        else {
+            subtreeEnds.push_back(node.offset);
+            cost += settings.traversalCost*area;
+        }
+    }
+
+    statistics.averageLeafSize = (float)nLeafTriangles / statistics.nLeaves;
+    statistics.sahCost = (float)cost;
+
+    return statistics;
+}
@@ -0,0 +1,167 @@
+//
+// Project: GraphicsUtils
+// File: HalfEdgeMesh.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "HalfEdgeMesh.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+
+using namespace gut;
+
+
+namespace {
+
+    constexpr int64_t halfEdgeBlockSize = 65536;
+
+    // Buckets larger than this (high-valence vertices) are sorted with std::sort
+    constexpr int64_t insertionSortMaxKeys = 32;
+
+    // Sort a bucket of (higher vertex, half-edge) keys, buckets hold a few keys on average
+    inline void sortBucket(uint64_t* keys, int64_t n)
+    {
+        if (n > insertionSortMaxKeys) {
+            std::sort(keys, keys+n);
+            return;
+        }
+        for (int64_t i=1; i<n; ++i) {
+            uint64_t key = keys[i];
+            int64_t j = i;
+            for (; j>0 && keys[j-1] > key; --j)
+                keys[j] = keys[j-1];
+            keys[j] = key;
+        }
+    }
+
+} // namespace
+
+
+bool gut::buildHalfEdgeMesh(const VertexData& vertexData, HalfEdgeMesh& halfEdgeMesh)
+{
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+
+    const auto& indices = vertexData.getIndices();
+    if (indices.size() % 3 != 0 || indices.size() >= HalfEdgeMesh::none) {
+        fprintf(stderr, "ERROR: Indices are not a triangle list of at most 2^32-1 half-edges\n"); // TODO logging
+        return false;
+    }
+
+    // Containers are longer than the maximum index, unreferenced vertices are included
+    int64_t nHalfEdges = indices.size();
+    auto names = vertexData.getDataNames();
+    int64_t nVertices = names.empty() ? (int64_t)*std::max_element(indices.begin(), indices.end())+1 : INT64_MAX;
+    for (auto& name : names)
+        nVertices = std::min(nVertices, vertexData.accessData(name)->size());
+
+    auto& mesh = halfEdgeMesh;
+    mesh.vertices = indices;
+    mesh.twins.resize(nHalfEdges);
+    mesh.nonManifoldEdges.clear();
+    mesh.nBorderEdges = 0;
+
+    // Radix sort of the undirected edges with the lower vertex as the digit: one counting pass
+    // to size the buckets and one to scatter (higher vertex, half-edge) keys to them
+    Vector<unsigned> bucketBegins(nVertices+1, 0);
+    parallelFor(0, nHalfEdges, [&](int64_t begin, int64_t end, int) {
+        for (int64_t h=begin; h<end; ++h) {
+            unsigned lower = std::min(indices[h], indices[HalfEdgeMesh::next(h)]);
+            std::atomic_ref<unsigned>(bucketBegins[lower+1]).fetch_add(1, std::memory_order_relaxed);
+        }
+    }, halfEdgeBlockSize);
+    for (int64_t v=0; v<nVertices; ++v)
+        bucketBegins[v+1] += bucketBegins[v];
+
+    Vector<uint64_t> keys(nHalfEdges);
+    {
+        Vector<unsigned> fill(bucketBegins.begin(), bucketBegins.end()-1);
+        parallelFor(0, nHalfEdges, [&](int64_t begin, int64_t end, int) {
+            for (int64_t h=begin; h<end; ++h) {
+                unsigned a = indices[h];
+                unsigned b = indices[HalfEdgeMesh::next(h)];
+                unsigned i = std::atomic_ref<unsigned>(fill[std::min(a, b)]).fetch_add(1, std::memory_order_relaxed);
+                keys[i] = ((uint64_t)std::max(a, b) << 32) | (uint64_t)h;
+            }
+        }, halfEdgeBlockSize);
+    }
+
+    // Sort the buckets (making the result independent of the scatter order) and match the
+    // half-edges of each edge
+    int nBlocks = parallelForBlocks(nVertices, 16384);
+    Vector<Vector<unsigned>> blockNonManifoldEdges(nBlocks);
+    Vector<int64_t> blockBorderEdges(nBlocks, 0);
+    parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int blockId) {
+        for (int64_t v=begin; v<end; ++v) {
+            uint64_t* bucket = keys.data() + bucketBegins[v];
+            int64_t bucketSize = bucketBegins[v+1] - bucketBegins[v];
+            sortBucket(bucket, bucketSize);
+
+            for (int64_t i=0; i<bucketSize;) {
+                int64_t edgeEnd = i+1;
+                while (edgeEnd < bucketSize && (bucket[edgeEnd] >> 32) == (bucket[i] >> 32))
+                    ++edgeEnd;
+
+                // Half-edges of an edge are in ascending order
+                unsigned h0 = (unsigned)bucket[i];
+                unsigned h1 = edgeEnd-i > 1 ? (unsigned)bucket[i+1] : HalfEdgeMesh::none;
+                bool degenerate = mesh.from(h0) == mesh.to(h0);
+                if (edgeEnd-i == 1 && !degenerate) {
+                    mesh.twins[h0] = HalfEdgeMesh::none;
+                    ++blockBorderEdges[blockId];
+                }
+                else if (edgeEnd-i == 2 && !degenerate && mesh.from(h0) == mesh.to(h1)) {
+                    mesh.twins[h0] = h1;
+                    mesh.twins[h1] = h0;
+                }
+                else {
+                    for (int64_t j=i; j<edgeEnd; ++j)
+                        mesh.twins[(unsigned)bucket[j]] = HalfEdgeMesh::none;
+                    blockNonManifoldEdges[blockId].push_back(h0);
+                }
+
+                i = edgeEnd;
+            }
+        }
+    }, 16384);
+
+    for (int b=0; b<nBlocks; ++b) {
+        mesh.nonManifoldEdges.insert(mesh.nonManifoldEdges.end(),
+            blockNonManifoldEdges[b].begin(), blockNonManifoldEdges[b].end());
+        mesh.nBorderEdges += blockBorderEdges[b];
+    }
+    std::sort(mesh.nonManifoldEdges.begin(), mesh.nonManifoldEdges.end());
+
+    // Lowest outgoing half-edge of each vertex, ones without a twin first
+    Vector<uint64_t> vertexHalfEdges(nVertices, UINT64_MAX);
+    parallelFor(0, nHalfEdges, [&](int64_t begin, int64_t end, int) {
+        for (int64_t h=begin; h<end; ++h) {
+            uint64_t candidate = ((uint64_t)(mesh.twins[h] != HalfEdgeMesh::none) << 32) | (uint64_t)h;
+            std::atomic_ref<uint64_t> best(vertexHalfEdges[indices[h]]);
+            uint64_t current = best.load(std::memory_order_relaxed);
+            while (candidate < current && !best.compare_exchange_weak(current, candidate, std::memory_order_relaxed));
+        }
+    }, halfEdgeBlockSize);
+
+    mesh.vertexHalfEdges.resize(nVertices);
+    parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+        for (int64_t v=begin; v<end; ++v) {
+            mesh.vertexHalfEdges[v] = vertexHalfEdges[v] == UINT64_MAX ?
+                HalfEdgeMesh::none : (unsigned)vertexHalfEdges[v];
+        }
+    }, halfEdgeBlockSize);
+
+    return true;
+}
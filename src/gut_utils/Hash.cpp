@@ -0,0 +1,266 @@
+//
+// Project: GraphicsUtils
+// File: Hash.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "Hash.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define GUT_HASH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define GUT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+
+#ifdef __GNUG__
+#define INLINE inline __attribute__((always_inline))
+#else
+#define INLINE inline
+#endif
+
+
+using namespace gut;
+
+
+namespace {
+
+    constexpr uint64_t prime32_1 = 0x9E3779B1ull;
+    constexpr uint64_t prime32_2 = 0x85EBCA77ull;
+    constexpr uint64_t prime32_3 = 0xC2B2AE3Dull;
+    constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t prime64_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ull;
+
+    // Key material: 8 words for stripe accumulation, 8 for scrambling and 16 for merging,
+    // generated with splitmix64
+    struct HashKey {
+        uint64_t    v[32];
+
+        constexpr HashKey() : v()
+        {
+            uint64_t s = prime64_5;
+            for (auto& k : v) {
+                s += 0x9E3779B97F4A7C15ull;
+                uint64_t z = s;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                k = z ^ (z >> 31);
+            }
+        }
+    };
+
+    constexpr HashKey hashKey;
+    constexpr int stripeKeyOffset = 0;
+    constexpr int scrambleKeyOffset = 8;
+    constexpr int mergeKeyOffsetLow = 16;
+    constexpr int mergeKeyOffsetHigh = 24;
+
+    INLINE uint64_t load64(const uint8_t* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(uint64_t));
+        return v;
+    }
+
+    // Fold 128-bit product of two 64-bit values to 64 bits
+    INLINE uint64_t mulFold64(uint64_t a, uint64_t b)
+    {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t p = (__uint128_t)a * b;
+        return (uint64_t)p ^ (uint64_t)(p >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        uint64_t high;
+        uint64_t low = _umul128(a, b, &high);
+        return low ^ high;
+#else
+        uint64_t aLo = a & 0xFFFFFFFFull, aHi = a >> 32;
+        uint64_t bLo = b & 0xFFFFFFFFull, bHi = b >> 32;
+        uint64_t ll = aLo*bLo, lh = aLo*bHi, hl = aHi*bLo, hh = aHi*bHi;
+        uint64_t cross = (ll >> 32) + (lh & 0xFFFFFFFFull) + hl;
+        uint64_t high = hh + (lh >> 32) + (cross >> 32);
+        uint64_t low = (cross << 32) | (ll & 0xFFFFFFFFull);
+        return low ^ high;
+#endif
+    }
+
+    INLINE uint64_t avalanche(uint64_t h)
+    {
+        h ^= h >> 37;
+        h *= 0x165667919E3779F9ull;
+        h ^= h >> 32;
+        return h;
+    }
+
+    // Accumulate one 64-byte stripe
+    INLINE void accumulateStripe(uint64_t (&acc)[8], const uint8_t* p)
+    {
+#if defined(GUT_HASH_AVX2)
+        for (int i=0; i<8; i+=4) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc+i));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+i*8));
+            __m256i k = _mm256_xor_si256(d, _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(hashKey.v+stripeKeyOffset+i)));
+            a = _mm256_add_epi64(a, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+            a = _mm256_add_epi64(a, _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc+i), a);
+        }
+#elif defined(GUT_HASH_SSE2)
+        for (int i=0; i<8; i+=2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc+i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i*8));
+            __m128i k = _mm_xor_si128(d, _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(hashKey.v+stripeKeyOffset+i)));
+            a = _mm_add_epi64(a, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+            a = _mm_add_epi64(a, _mm_mul_epu32(k, _mm_srli_epi64(k, 32)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc+i), a);
+        }
+#else
+        for (int i=0; i<8; ++i) {
+            uint64_t d = load64(p+i*8);
+            uint64_t k = d ^ hashKey.v[stripeKeyOffset+i];
+            acc[i^1] += d;
+            acc[i] += (k & 0xFFFFFFFFull) * (k >> 32);
+        }
+#endif
+    }
+
+    // Scramble accumulators at the end of each block
+    INLINE void scramble(uint64_t (&acc)[8])
+    {
+        for (int i=0; i<8; ++i) {
+            uint64_t a = acc[i];
+            a ^= a >> 47;
+            a ^= hashKey.v[scrambleKeyOffset+i];
+            acc[i] = a * prime32_1;
+        }
+    }
+
+    // Accumulate n stripes, scrambling when a block is full
+    void accumulate(uint64_t (&acc)[8], size_t& nStripes, const uint8_t* p, size_t n)
+    {
+        for (size_t i=0; i<n; ++i) {
+            accumulateStripe(acc, p + i*Hasher::stripeSize);
+            if (++nStripes == Hasher::blockSize) {
+                scramble(acc);
+                nStripes = 0;
+            }
+        }
+    }
+
+} // namespace
+
+
+Hasher::Hasher(uint64_t seed)
+{
+    reset(seed);
+}
+
+void Hasher::reset(uint64_t seed)
+{
+    const uint64_t init[8] = {
+        prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1 };
+    for (int i=0; i<8; ++i)
+        _acc[i] = i % 2 == 0 ? init[i] + seed : init[i] - seed;
+
+    _bufferSize = 0;
+    _nStripes = 0;
+    _totalSize = 0;
+    _seed = seed;
+}
+
+void Hasher::update(const void* data, size_t size)
+{
+    auto* p = static_cast<const uint8_t*>(data);
+    _totalSize += size;
+
+    // Fill the partial stripe first
+    if (_bufferSize > 0) {
+        size_t n = stripeSize-_bufferSize < size ? stripeSize-_bufferSize : size;
+        memcpy(_buffer+_bufferSize, p, n);
+        _bufferSize += n;
+        p += n;
+        size -= n;
+
+        if (_bufferSize < stripeSize)
+            return;
+
+        accumulate(_acc, _nStripes, _buffer, 1);
+        _bufferSize = 0;
+    }
+
+    // Consume full stripes directly from the input
+    size_t nFull = size / stripeSize;
+    accumulate(_acc, _nStripes, p, nFull);
+    p += nFull*stripeSize;
+    size -= nFull*stripeSize;
+
+    memcpy(_buffer, p, size);
+    _bufferSize = size;
+}
+
+uint64_t Hasher::digest64() const
+{
+    uint64_t acc[8];
+    finalAccumulators(acc);
+    return merge(acc, _totalSize*prime64_1, _seed, mergeKeyOffsetLow);
+}
+
+Hash128 Hasher::digest128() const
+{
+    uint64_t acc[8];
+    finalAccumulators(acc);
+    return {
+        merge(acc, _totalSize*prime64_1, _seed, mergeKeyOffsetLow),
+        merge(acc, ~_totalSize*prime64_2, _seed, mergeKeyOffsetHigh)
+    };
+}
+
+uint64_t Hasher::merge(const uint64_t (&acc)[8], uint64_t sizeTerm, uint64_t seed, int keyOffset)
+{
+    uint64_t h = sizeTerm ^ seed;
+    for (int i=0; i<8; i+=2)
+        h += mulFold64(acc[i] ^ hashKey.v[keyOffset+i], acc[i+1] ^ hashKey.v[keyOffset+i+1]);
+    return avalanche(h);
+}
+
+void Hasher::finalAccumulators(uint64_t (&acc)[8]) const
+{
+    memcpy(acc, _acc, sizeof(acc));
+    if (_bufferSize == 0)
+        return;
+
+    // Zero-padded last stripe, total size in the merge disambiguates the padding
+    uint8_t stripe[stripeSize] = {};
+    memcpy(stripe, _buffer, _bufferSize);
+    size_t nStripes = _nStripes;
+    accumulate(acc, nStripes, stripe, 1);
+}
+
+uint64_t gut::hash64(const void* data, size_t size, uint64_t seed)
+{
+    Hasher hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest64();
+}
+
+Hash128 gut::hash128(const void* data, size_t size, uint64_t seed)
+{
+    Hasher hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest128();
+}
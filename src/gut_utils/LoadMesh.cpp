@@ -10,189 +10,1197 @@
 
 #include "LoadMesh.hpp"
 #include "VertexData.hpp"
+#include "MappedFile.hpp"
+#include "ParallelFor.hpp"
+#include "Deduplicate.hpp"
+
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_LOADMESH_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#ifdef __GNUG__
+#define INLINE inline __attribute__((always_inline))
+#else
+#define INLINE inline
+#endif
 
 
 using namespace gut;
 
 
-// Adapted from https://github.com/Anttifer/impromptu/blob/master/src/Mesh.cpp
-void gut::loadMeshFromOBJ(const std::string& fileName, VertexData& vertexData)
-{
-    FILE* f = fopen(fileName.c_str(), "rb");
-    if (f == NULL) {
-        fprintf(stderr, "ERROR: Cannot open file %s\n", fileName.c_str()); // TODO logging
-        return;
+namespace {
+
+    constexpr int64_t objMinChunkSize = 1 << 20; // bytes parsed by one thread at minimum
+    constexpr int32_t objNoIndex = -1;
+
+    // Face corner, 0-based indices to the OBJ attribute arrays
+    struct ObjCorner {
+        int32_t p;
+        int32_t t;
+        int32_t n;
+    };
+
+    // Data parsed from a newline-aligned chunk of the file
+    struct ObjChunk {
+        std::pmr::monotonic_buffer_resource arena; // chunk-local scratch, chunks are parsed in parallel
+        std::pmr::vector<Vec3f>             positions;
+        std::pmr::vector<Vec2f>             texCoords;
+        std::pmr::vector<Vec3f>             normals;
+        std::pmr::vector<ObjCorner>         corners; // triangulated
+        std::pmr::vector<int64_t>           relativeRefs; // corner*3 + attribute id of relative (negative) indices
+        int64_t                             nLines;
+        int64_t                             errorLine; // chunk-local line number of the first error
+
+        explicit ObjChunk(std::pmr::memory_resource* upstream) :
+            arena           (upstream),
+            positions       (&arena),
+            texCoords       (&arena),
+            normals         (&arena),
+            corners         (&arena),
+            relativeRefs    (&arena),
+            nLines          (0),
+            errorLine       (-1)
+        {}
+    };
+
+    INLINE uint64_t hashCorner(const ObjCorner& c)
+    {
+        uint64_t h = (uint32_t)c.p*0x9E3779B97F4A7C15ull;
+        h ^= (uint32_t)c.t*0xC2B2AE3D27D4EB4Full;
+        h ^= (uint32_t)c.n*0x165667B19E3779F9ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return h ^ (h >> 32);
     }
 
-    // Vectors to be stored into the VertexData object
-    Vector<Vec3f> positions;
-    Vector<Vec3f> normals;
-    Vector<Vec2f> texCoords;
-    Vector<unsigned> indices;
+    INLINE bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
 
-    // Temporary objects for reading
-    char lineHeader[32];
-    lineHeader[31] = '\0';
-    bool readSuccessful = true;
-    unsigned currentLine = 0;
+    INLINE bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
 
-    float data[3];
-    unsigned pIndices[3];
-    unsigned tIndices[3];
-    unsigned nIndices[3];
+    INLINE void skipBlanks(const char*& p, const char* end)
+    {
+        while (p < end && isBlank(*p))
+            ++p;
+    }
 
-    Vector<Vec3f> objPositions;
-    Vector<Vec3f> objNormals;
-    Vector<Vec2f> objTexCoords;
+    INLINE void skipLine(const char*& p, const char* end)
+    {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end-p));
+        p = nl == nullptr ? end : nl;
+    }
 
-    Vector<int> positionIndices;
-    Vector<int> normalIndices;
-    Vector<int> texCoordIndices;
+    // Slow path for floats outside the exact fast path, nan, inf etc.
+    bool parseFloatFallback(const char*& p, const char* end, float& v)
+    {
+        char buffer[64];
+        int n = 0;
+        while (p+n < end && n < 63 && !isBlank(p[n]) && p[n] != '\n')
+            buffer[n] = p[n], ++n;
+        buffer[n] = '\0';
 
-    while (fscanf(f, "%31s", lineHeader) != EOF) {
-        ++currentLine;
-        readSuccessful = true;
+        char* bufferEnd;
+        v = strtof(buffer, &bufferEnd);
+        if (bufferEnd == buffer)
+            return false;
 
-        if (!strcmp(lineHeader, "v")) {
-            memset(data, 0, sizeof(data));
+        p += bufferEnd-buffer;
+        return true;
+    }
 
-            if (3 == fscanf(f, "%f %f %f", &data[0], &data[1], &data[2])) {
-                objPositions.emplace_back(data[0], data[1], data[2]);
-                positionIndices.push_back(-1);
-            }
+    // Parse a decimal float, result is identical to strtof
+    INLINE bool parseFloat(const char*& p, const char* end, float& v)
+    {
+        static constexpr double powers[23] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+            negative = *s++ == '-';
+
+        uint64_t mantissa = 0;
+        int nDigits = 0; // significant digits accumulated to mantissa
+        int exponent = 0;
+        bool anyDigits = false;
+
+        for (; s < end && isDigit(*s); ++s) {
+            anyDigits = true;
+            if (mantissa == 0 && *s == '0')
+                continue;
+            if (nDigits++ < 19)
+                mantissa = mantissa*10 + (*s-'0');
             else
-                readSuccessful = false;
+                ++exponent;
+        }
+        if (s < end && *s == '.') {
+            for (++s; s < end && isDigit(*s); ++s) {
+                anyDigits = true;
+                if (mantissa == 0 && *s == '0') {
+                    --exponent;
+                    continue;
+                }
+                if (nDigits++ < 19) {
+                    mantissa = mantissa*10 + (*s-'0');
+                    --exponent;
+                }
+            }
         }
-        else if (!strcmp(lineHeader, "vt")) {
-            memset(data, 0, sizeof(data));
+        if (!anyDigits)
+            return parseFloatFallback(p, end, v);
 
-            if (2 == fscanf(f, "%f %f", &data[0], &data[1])) {
-                objTexCoords.emplace_back(data[0], data[1]);
-                texCoordIndices.push_back(-1);
+        if (s < end && (*s == 'e' || *s == 'E')) {
+            const char* e = s+1;
+            bool expNegative = false;
+            if (e < end && (*e == '-' || *e == '+'))
+                expNegative = *e++ == '-';
+            if (e < end && isDigit(*e)) {
+                int exp = 0;
+                for (; e < end && isDigit(*e); ++e)
+                    exp = exp < 10000 ? exp*10 + (*e-'0') : exp;
+                exponent += expNegative ? -exp : exp;
+                s = e;
             }
-            else
-                readSuccessful = false;
         }
-        else if (!strcmp(lineHeader, "vn")) {
-            memset(data, 0, sizeof(data));
 
-            if (3 == fscanf(f, "%f %f %f", &data[0], &data[1], &data[2])) {
-                objNormals.emplace_back(data[0], data[1], data[2]);
-                normalIndices.push_back(-1);
+        // Exact fast path: mantissa and power of ten both exact in double, one rounding
+        if (nDigits > 19 || mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+            return parseFloatFallback(p, end, v);
+
+        double d = (double)mantissa;
+        d = exponent < 0 ? d / powers[-exponent] : d * powers[exponent];
+
+        // Rounding to float is ambiguous only when d lies exactly halfway between two floats
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(double));
+        if ((bits & 0x1FFFFFFFull) == 0x10000000ull)
+            return parseFloatFallback(p, end, v);
+
+        v = negative ? -(float)d : (float)d;
+        p = s;
+        return true;
+    }
+
+    INLINE bool parseInt(const char*& p, const char* end, int64_t& v)
+    {
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+            negative = *s++ == '-';
+        if (s >= end || !isDigit(*s))
+            return false;
+
+        int64_t r = 0;
+        for (; s < end && isDigit(*s); ++s) {
+            r = r*10 + (*s-'0');
+            if (r > INT32_MAX)
+                return false;
+        }
+
+        v = negative ? -r : r;
+        p = s;
+        return true;
+    }
+
+    // Parse n floats separated by blanks, extra values on the line are ignored
+    template <int T_N>
+    INLINE bool parseFloats(const char*& p, const char* end, float (&v)[T_N])
+    {
+        for (int i=0; i<T_N; ++i) {
+            skipBlanks(p, end);
+            if (!parseFloat(p, end, v[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Convert OBJ index to 0-based one, relative indices are converted to chunk-local ones
+    INLINE bool resolveIndex(int64_t index, int64_t nLocal, int32_t& resolved, bool& relative)
+    {
+        if (index > 0) {
+            resolved = (int32_t)(index-1);
+            relative = false;
+            return true;
+        }
+        if (index < 0) {
+            resolved = (int32_t)(nLocal+index); // may be negative, points to a previous chunk
+            relative = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Parse a face corner of form p, p/t, p/t/n or p//n
+    INLINE bool parseCorner(const char*& p, const char* end, const ObjChunk& chunk,
+        ObjCorner& corner, bool (&relative)[3])
+    {
+        int64_t index;
+        if (!parseInt(p, end, index) ||
+            !resolveIndex(index, chunk.positions.size(), corner.p, relative[0]))
+            return false;
+
+        corner.t = objNoIndex;
+        corner.n = objNoIndex;
+        relative[1] = relative[2] = false;
+        if (p >= end || *p != '/')
+            return true;
+
+        ++p;
+        if (p < end && *p != '/') {
+            if (!parseInt(p, end, index) ||
+                !resolveIndex(index, chunk.texCoords.size(), corner.t, relative[1]))
+                return false;
+        }
+
+        if (p >= end || *p != '/')
+            return true;
+
+        ++p;
+        return parseInt(p, end, index) &&
+            resolveIndex(index, chunk.normals.size(), corner.n, relative[2]);
+    }
+
+    INLINE void addCorner(ObjChunk& chunk, const ObjCorner& corner, const bool (&relative)[3])
+    {
+        int64_t id = chunk.corners.size()*3;
+        for (int i=0; i<3; ++i)
+            if (relative[i])
+                chunk.relativeRefs.push_back(id+i);
+        chunk.corners.push_back(corner);
+    }
+
+    // Parse face line (after "f"), polygons are triangulated as fans
+    bool parseFace(const char*& p, const char* end, ObjChunk& chunk)
+    {
+        ObjCorner first, previous, corner;
+        bool firstRelative[3], previousRelative[3], relative[3];
+        int nCorners = 0;
+
+        for (;;) {
+            skipBlanks(p, end);
+            if (p >= end || *p == '\n' || *p == '#')
+                break;
+
+            if (!parseCorner(p, end, chunk, corner, relative))
+                return false;
+
+            if (nCorners == 0) {
+                first = corner;
+                memcpy(firstRelative, relative, sizeof(relative));
             }
-            else
-                readSuccessful = false;
+            else if (nCorners >= 2) {
+                addCorner(chunk, first, firstRelative);
+                addCorner(chunk, previous, previousRelative);
+                addCorner(chunk, corner, relative);
+            }
+
+            previous = corner;
+            memcpy(previousRelative, relative, sizeof(relative));
+            ++nCorners;
         }
-        else if (!strcmp(lineHeader, "f")) {
-            memset(pIndices, 0, sizeof(pIndices));
-            memset(tIndices, 0, sizeof(tIndices));
-            memset(nIndices, 0, sizeof(nIndices));
 
-            if (3 == fscanf(f, "%u %u %u", &pIndices[0], &pIndices[1], &pIndices[2]))
-            {
-                for (int i=0; i<3; ++i) {
-                    int pi = pIndices[i]-1;
+        return nCorners >= 3;
+    }
+
+    void parseChunk(const char* p, const char* end, ObjChunk& chunk)
+    {
+        // Rough reservation, typical OBJ lines are 20-40 bytes
+        chunk.positions.reserve((end-p) / 64);
+        chunk.corners.reserve((end-p) / 32);
 
-                    if (positionIndices[pi] < 0) { // value of this index is yet to be used
-                        positions.emplace_back(objPositions[pi]);
-                        positionIndices[pi] = positions.size()-1;
-                    }
+        float data[3];
+        while (p < end) {
+            ++chunk.nLines;
+            skipBlanks(p, end);
 
-                    indices.push_back((unsigned)positionIndices[pi]);
+            bool success = true;
+            if (p+1 < end && p[0] == 'v' && isBlank(p[1])) {
+                p += 2;
+                if ((success = parseFloats(p, end, data)))
+                    chunk.positions.emplace_back(data[0], data[1], data[2]);
+            }
+            else if (p+2 < end && p[0] == 'v' && p[1] == 't' && isBlank(p[2])) {
+                p += 3;
+                float texCoord[2];
+                if ((success = parseFloats(p, end, texCoord)))
+                    chunk.texCoords.emplace_back(texCoord[0], texCoord[1]);
+            }
+            else if (p+2 < end && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+                p += 3;
+                if ((success = parseFloats(p, end, data)))
+                    chunk.normals.emplace_back(data[0], data[1], data[2]);
+            }
+            else if (p+1 < end && p[0] == 'f' && isBlank(p[1])) {
+                p += 2;
+                success = parseFace(p, end, chunk);
+            }
+            // Comments, groups, materials etc. are skipped
+
+            if (!success) {
+                chunk.errorLine = chunk.nLines;
+                return;
+            }
+
+            skipLine(p, end);
+            if (p < end)
+                ++p; // newline
+        }
+    }
+
+
+    constexpr int64_t plyMinBlockSize = 16384; // records converted by one thread at minimum
+    constexpr int64_t plyChunkLines = 16384; // lines of an ASCII element parsed by one task
+
+    enum class PlyFormat {
+        ASCII,
+        BINARY_LITTLE_ENDIAN,
+        BINARY_BIG_ENDIAN
+    };
+
+    enum class PlyType {
+        INT8,
+        UINT8,
+        INT16,
+        UINT16,
+        INT32,
+        UINT32,
+        FLOAT32,
+        FLOAT64,
+        NONE
+    };
+
+    struct PlyProperty {
+        std::string name;
+        PlyType     type; // item type of list properties
+        PlyType     countType; // NONE for scalar properties
+        int64_t     offset; // byte offset in a binary record, -1 after a list property
+    };
+
+    struct PlyElement {
+        std::string         name;
+        int64_t             count;
+        Vector<PlyProperty> properties;
+        int64_t             stride; // binary record size, -1 for records with list properties
+    };
+
+    // Vertex attribute read from PLY vertex properties
+    struct PlyAttribute {
+        const char*     name;
+        MathTypeEnum    type;
+        int             nComponents;
+        bool            normalized; // integer values are mapped to [0, 1]
+        const char*     properties[3][3]; // alternative property names of each component
+    };
+
+    constexpr PlyAttribute plyAttributes[] = {
+        { "position", MathTypeEnum::VEC3F, 3, false, { { "x" }, { "y" }, { "z" } } },
+        { "normal", MathTypeEnum::VEC3F, 3, false, { { "nx" }, { "ny" }, { "nz" } } },
+        { "texCoord", MathTypeEnum::VEC2F, 2, false, { { "u", "s", "texture_u" }, { "v", "t", "texture_v" } } },
+        { "color", MathTypeEnum::VEC3F, 3, true, { { "red", "diffuse_red" }, { "green", "diffuse_green" },
+            { "blue", "diffuse_blue" } } }
+    };
+
+    // Destination of a vertex property value, a component of a float vector container
+    struct PlyTarget {
+        float*  data; // nullptr for properties not stored
+        int     nComponents;
+        int     component;
+        float   scale; // integer colors are normalized to [0, 1]
+    };
+
+    INLINE int plyTypeSize(PlyType type)
+    {
+        constexpr int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+        return sizes[(int)type];
+    }
+
+    // Scale mapping the maximum value of an integer type to 1
+    INLINE float plyNormalizationScale(PlyType type)
+    {
+        constexpr double maxValues[] = { 127.0, 255.0, 32767.0, 65535.0, 2147483647.0, 4294967295.0, 1.0, 1.0, 1.0 };
+        return (float)(1.0 / maxValues[(int)type]);
+    }
+
+    PlyType parsePlyType(std::string_view name)
+    {
+        if (name == "char" || name == "int8") return PlyType::INT8;
+        if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+        if (name == "short" || name == "int16") return PlyType::INT16;
+        if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+        if (name == "int" || name == "int32") return PlyType::INT32;
+        if (name == "uint" || name == "uint32") return PlyType::UINT32;
+        if (name == "float" || name == "float32") return PlyType::FLOAT32;
+        if (name == "double" || name == "float64") return PlyType::FLOAT64;
+        return PlyType::NONE;
+    }
+
+    // Next blank-separated token on a line
+    std::string_view nextToken(const char*& p, const char* end)
+    {
+        skipBlanks(p, end);
+        const char* begin = p;
+        while (p < end && !isBlank(*p) && *p != '\n')
+            ++p;
+        return std::string_view(begin, p-begin);
+    }
+
+    // Parse the header, p is moved to the first byte of the data
+    bool parsePlyHeader(const char*& p, const char* end, PlyFormat& format, Vector<PlyElement>& elements)
+    {
+        bool hasFormat = false;
+        bool hasEnd = false;
+        for (int64_t line=0; p < end && !hasEnd; ++line) {
+            const char* lineEnd = p;
+            skipLine(lineEnd, end);
+            auto keyword = nextToken(p, lineEnd);
+
+            if (line == 0) {
+                if (keyword != "ply")
+                    return false;
+            }
+            else if (keyword == "format") {
+                auto name = nextToken(p, lineEnd);
+                if (name == "ascii")
+                    format = PlyFormat::ASCII;
+                else if (name == "binary_little_endian")
+                    format = PlyFormat::BINARY_LITTLE_ENDIAN;
+                else if (name == "binary_big_endian")
+                    format = PlyFormat::BINARY_BIG_ENDIAN;
+                else
+                    return false;
+                hasFormat = true;
+            }
+            else if (keyword == "element") {
+                auto name = nextToken(p, lineEnd);
+                int64_t count;
+                skipBlanks(p, lineEnd);
+                if (name.empty() || !parseInt(p, lineEnd, count) || count < 0)
+                    return false;
+                elements.push_back({ std::string(name), count, {}, 0 });
+            }
+            else if (keyword == "property") {
+                if (elements.empty())
+                    return false;
+
+                PlyProperty property;
+                property.countType = PlyType::NONE;
+                auto typeName = nextToken(p, lineEnd);
+                if (typeName == "list") {
+                    property.countType = parsePlyType(nextToken(p, lineEnd));
+                    if (property.countType == PlyType::NONE || property.countType >= PlyType::FLOAT32)
+                        return false;
+                    typeName = nextToken(p, lineEnd);
                 }
+                property.type = parsePlyType(typeName);
+                property.name = nextToken(p, lineEnd);
+                if (property.type == PlyType::NONE || property.name.empty())
+                    return false;
+                elements.back().properties.push_back(std::move(property));
             }
-            else if (5 == fscanf(f, "/%u %u/%u %u/%u", &tIndices[0],
-                &pIndices[1], &tIndices[1],
-                &pIndices[2], &tIndices[2]))
-            {
-                for (int i=0; i<3; ++i) {
-                    int pi = pIndices[i]-1;
-                    int ti = tIndices[i]-1;
-
-                    if (positionIndices[pi] < 0 ||
-                        texCoordIndices[ti] < 0 ||
-                        positionIndices[pi] != texCoordIndices[pi])
-                    {
-                        positions.emplace_back(objPositions[pi]);
-                        positionIndices[pi] = positions.size()-1;
-                        texCoords.emplace_back(objTexCoords[ti]);
-                        texCoordIndices[ti] = texCoords.size()-1;
-                    }
+            else if (keyword == "end_header")
+                hasEnd = true;
+            // Comments, obj_info etc. are skipped
+
+            p = lineEnd < end ? lineEnd+1 : end;
+        }
+
+        // Binary records have a fixed layout up to the first list property
+        for (auto& element : elements) {
+            int64_t offset = 0;
+            for (auto& property : element.properties) {
+                property.offset = offset;
+                if (offset >= 0)
+                    offset = property.countType == PlyType::NONE ? offset + plyTypeSize(property.type) : -1;
+            }
+            element.stride = offset;
+        }
+
+        return hasFormat && hasEnd;
+    }
+
+    // Reverse the bytes of each valueSize-byte value in nBytes bytes from src to dest
+    // (src and dest may be the same)
+    void byteSwap(const char* src, char* dest, int64_t nBytes, int valueSize)
+    {
+        int64_t i = 0;
+#ifdef GUT_LOADMESH_SSE2
+        // Reverse the 16-bit words of each value, then the bytes of each word
+        if (valueSize == 2 || valueSize == 4 || valueSize == 8) {
+            for (; i+16 <= nBytes; i+=16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i));
+                if (valueSize == 4) {
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                }
+                else if (valueSize == 8) {
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                }
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest+i), v);
+            }
+        }
+#endif
+        for (; i+valueSize <= nBytes; i+=valueSize) {
+            char value[8];
+            memcpy(value, src+i, valueSize);
+            for (int j=0; j<valueSize; ++j)
+                dest[i+j] = value[valueSize-1-j];
+        }
+    }
+
+    template <typename T>
+    INLINE T loadValue(const char* p, bool swap)
+    {
+        char bytes[sizeof(T)];
+        for (size_t i=0; i<sizeof(T); ++i)
+            bytes[i] = p[swap ? sizeof(T)-1-i : i];
+
+        T v;
+        memcpy(&v, bytes, sizeof(T));
+        return v;
+    }
+
+    INLINE double readPlyValue(const char* p, PlyType type, bool swap)
+    {
+        switch (type) {
+            case PlyType::INT8:     return (double)loadValue<int8_t>(p, false);
+            case PlyType::UINT8:    return (double)loadValue<uint8_t>(p, false);
+            case PlyType::INT16:    return (double)loadValue<int16_t>(p, swap);
+            case PlyType::UINT16:   return (double)loadValue<uint16_t>(p, swap);
+            case PlyType::INT32:    return (double)loadValue<int32_t>(p, swap);
+            case PlyType::UINT32:   return (double)loadValue<uint32_t>(p, swap);
+            case PlyType::FLOAT32:  return (double)loadValue<float>(p, swap);
+            case PlyType::FLOAT64:  return loadValue<double>(p, swap);
+            default:                return 0.0;
+        }
+    }
+
+    // Triangulate a polygon of n vertex indices (fan), indices of invalid type are rejected
+    // by the validation as they end up out of range
+    INLINE void addPlyPolygon(const char* p, int64_t n, PlyType type, bool swap, Vector<unsigned>& indices)
+    {
+        int size = plyTypeSize(type);
+        auto index = [&](int64_t i) { return (unsigned)(int64_t)readPlyValue(p + i*size, type, swap); };
+        for (int64_t i=2; i<n; ++i) {
+            indices.push_back(index(0));
+            indices.push_back(index(i-1));
+            indices.push_back(index(i));
+        }
+    }
+
+    // Parse binary records of an element with list properties, polygons of list property
+    // indexList are triangulated to indices (-1 to skip the records)
+    bool parsePlyBinaryRecords(const char*& p, const char* end, const PlyElement& element,
+        int indexList, bool swap, Vector<unsigned>& indices)
+    {
+        for (int64_t i=0; i<element.count; ++i) {
+            for (int k=0; k<(int)element.properties.size(); ++k) {
+                auto& property = element.properties[k];
+                int itemSize = plyTypeSize(property.type);
+                if (property.countType == PlyType::NONE) {
+                    if (end-p < itemSize)
+                        return false;
+                    p += itemSize;
+                    continue;
+                }
+
+                int countSize = plyTypeSize(property.countType);
+                if (end-p < countSize)
+                    return false;
+                int64_t n = (int64_t)readPlyValue(p, property.countType, swap);
+                p += countSize;
+                if (n < 0 || n > (end-p)/itemSize)
+                    return false;
+
+                if (k == indexList)
+                    addPlyPolygon(p, n, property.type, swap, indices);
+                p += n*itemSize;
+            }
+        }
+        return true;
+    }
+
+    // Parse an ASCII record line. Values of properties with a target are stored for record i,
+    // polygons of list property indexList are triangulated to indices (-1 for none).
+    bool parsePlyAsciiRecord(const char*& p, const char* end, const PlyElement& element,
+        const PlyTarget* targets, int64_t i, int indexList, Vector<unsigned>& indices)
+    {
+        for (int k=0; k<(int)element.properties.size(); ++k) {
+            auto& property = element.properties[k];
+            float value;
+            skipBlanks(p, end);
+            if (property.countType == PlyType::NONE) {
+                if (!parseFloat(p, end, value))
+                    return false;
+                if (targets != nullptr && targets[k].data != nullptr) {
+                    auto& t = targets[k];
+                    t.data[i*t.nComponents + t.component] = value*t.scale;
+                }
+                continue;
+            }
+
+            int64_t n;
+            if (!parseInt(p, end, n) || n < 0)
+                return false;
+            unsigned firstIndex = 0;
+            unsigned previousIndex = 0;
+            for (int64_t j=0; j<n; ++j) {
+                skipBlanks(p, end);
+                if (k != indexList) {
+                    if (!parseFloat(p, end, value))
+                        return false;
+                    continue;
+                }
 
-                    indices.push_back((unsigned)positionIndices[pi]);
+                int64_t index;
+                if (!parseInt(p, end, index))
+                    return false;
+                if (j >= 2) {
+                    indices.push_back(firstIndex);
+                    indices.push_back(previousIndex);
+                    indices.push_back((unsigned)index);
                 }
+                firstIndex = j == 0 ? (unsigned)index : firstIndex;
+                previousIndex = (unsigned)index;
             }
-            else if (7 == fscanf(f, "/%u %u/%u/%u %u/%u/%u", &nIndices[0],
-                &pIndices[1], &tIndices[1], &nIndices[1],
-                &pIndices[2], &tIndices[2], &nIndices[2]))
-            {
-                for (int i=0; i<3; ++i) {
-                    int pi = pIndices[i]-1;
-                    int ti = tIndices[i]-1;
-                    int ni = nIndices[i]-1;
-
-                    if (positionIndices[pi] < 0 ||
-                        texCoordIndices[ti] < 0 ||
-                        normalIndices[ni] < 0 ||
-                        positionIndices[pi] != texCoordIndices[ti] ||
-                        positionIndices[pi] != normalIndices[ni])
-                    {
-                        positions.emplace_back(objPositions[pi]);
-                        positionIndices[pi] = positions.size()-1;
-                        texCoords.emplace_back(objTexCoords[ti]);
-                        texCoordIndices[ti] = texCoords.size()-1;
-                        normals.emplace_back(objNormals[ni]);
-                        normalIndices[ni] = normals.size()-1;
+        }
+
+        skipLine(p, end);
+        if (p < end)
+            ++p; // newline
+        return true;
+    }
+
+    // Split count lines starting from p to chunks of plyChunkLines lines, p is moved past them
+    bool splitPlyLines(const char*& p, const char* end, int64_t count, Vector<const char*>& chunkBegins)
+    {
+        chunkBegins.clear();
+        for (int64_t i=0; i<count; ++i) {
+            if (p >= end)
+                return false;
+            if (i % plyChunkLines == 0)
+                chunkBegins.push_back(p);
+            skipLine(p, end);
+            if (p < end)
+                ++p;
+        }
+        chunkBegins.push_back(p);
+        return true;
+    }
+
+    // Indices 0, 1, ..., n-1 for meshes without shared vertices (point clouds, STL triangles)
+    void identityIndices(Vector<unsigned>& indices, int64_t n)
+    {
+        indices.resize(n);
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                indices[i] = (unsigned)i;
+        }, 65536);
+    }
+
+
+    // Read the vertex element to vertexData. Binary records consisting only of the float
+    // components of one attribute in the native byte order match the container layout and
+    // are aliased, file keeps the mapping alive.
+    bool readPlyVertices(const char*& p, const char* end, const PlyElement& element, PlyFormat format,
+        const std::shared_ptr<const MappedFile>& file, VertexData& vertexData,
+        std::pmr::memory_resource* resource)
+    {
+        int64_t count = element.count;
+        bool binary = format != PlyFormat::ASCII;
+        bool swap = binary &&
+            (format == PlyFormat::BINARY_LITTLE_ENDIAN) != (std::endian::native == std::endian::little);
+
+        const char* records = p;
+        Vector<const char*> chunkBegins;
+        if (binary) {
+            if (element.stride <= 0 || count > (end-p)/element.stride)
+                return false;
+            p += count*element.stride;
+        }
+        else if (!splitPlyLines(p, end, count, chunkBegins))
+            return false;
+
+        // Properties of the attributes found
+        Vector<PlyTarget> targets(element.properties.size(), PlyTarget{ nullptr, 0, 0, 1.0f });
+        bool converted = false;
+        for (auto& attribute : plyAttributes) {
+            int propertyIds[3];
+            bool found = true;
+            for (int c=0; c<attribute.nComponents; ++c) {
+                propertyIds[c] = -1;
+                for (int k=(int)element.properties.size()-1; k>=0; --k) {
+                    auto& property = element.properties[k];
+                    for (const char* name : attribute.properties[c]) {
+                        if (name != nullptr && property.countType == PlyType::NONE && property.name == name)
+                            propertyIds[c] = k;
                     }
+                }
+                found = found && propertyIds[c] >= 0;
+            }
+            if (!found)
+                continue;
+
+            bool matching = binary && element.stride == attribute.nComponents*(int64_t)sizeof(float);
+            for (int c=0; c<attribute.nComponents; ++c) {
+                auto& property = element.properties[propertyIds[c]];
+                matching = matching && property.type == PlyType::FLOAT32 &&
+                    property.offset == c*(int64_t)sizeof(float);
+            }
+            if (matching && !swap && (uintptr_t)records % alignof(float) == 0) {
+                if (!vertexData.addExternalData(attribute.name, attribute.type, records, count, file))
+                    return false;
+                continue;
+            }
+
+            float* data = attribute.nComponents == 3 ?
+                reinterpret_cast<float*>(vertexData.allocateData<Vec3f>(attribute.name, count, resource)) :
+                reinterpret_cast<float*>(vertexData.allocateData<Vec2f>(attribute.name, count, resource));
+            if (data == nullptr)
+                return false;
+
+            // Foreign byte order swapped straight to the container
+            if (matching) {
+                parallelFor(0, count, [&](int64_t recordBegin, int64_t recordEnd, int) {
+                    byteSwap(records + recordBegin*element.stride,
+                        reinterpret_cast<char*>(data + recordBegin*attribute.nComponents),
+                        (recordEnd-recordBegin)*element.stride, sizeof(float));
+                }, plyMinBlockSize);
+                continue;
+            }
+
+            for (int c=0; c<attribute.nComponents; ++c) {
+                auto type = element.properties[propertyIds[c]].type;
+                targets[propertyIds[c]] = PlyTarget{ data, attribute.nComponents, c,
+                    attribute.normalized ? plyNormalizationScale(type) : 1.0f };
+            }
+            converted = true;
+        }
+
+        if (!converted)
+            return true;
+
+        if (!binary) {
+            int64_t nChunks = chunkBegins.size()-1;
+            Vector<char> chunkSuccess(nChunks, 0);
+            parallelFor(0, nChunks, [&](int64_t chunkBegin, int64_t chunkEnd, int) {
+                Vector<unsigned> noIndices;
+                for (int64_t c=chunkBegin; c<chunkEnd; ++c) {
+                    const char* r = chunkBegins[c];
+                    bool success = true;
+                    for (int64_t i=c*plyChunkLines; i<std::min(count, (c+1)*plyChunkLines) && success; ++i)
+                        success = parsePlyAsciiRecord(r, end, element, targets.data(), i, -1, noIndices);
+                    chunkSuccess[c] = success;
+                }
+            });
+            return std::all_of(chunkSuccess.begin(), chunkSuccess.end(), [](char s) { return s != 0; });
+        }
+
+        // Foreign byte order of records of equally sized values is swapped with SIMD first
+        bool uniform = true;
+        for (auto& property : element.properties)
+            uniform = uniform && plyTypeSize(property.type) == plyTypeSize(element.properties[0].type);
+
+        std::pmr::vector<char> swapped(resource != nullptr ? resource : std::pmr::get_default_resource());
+        if (swap && uniform) {
+            swapped.resize(count*element.stride);
+            parallelFor(0, count, [&](int64_t recordBegin, int64_t recordEnd, int) {
+                byteSwap(records + recordBegin*element.stride, swapped.data() + recordBegin*element.stride,
+                    (recordEnd-recordBegin)*element.stride, plyTypeSize(element.properties[0].type));
+            }, plyMinBlockSize);
+            records = swapped.data();
+            swap = false;
+        }
+
+        parallelFor(0, count, [&](int64_t recordBegin, int64_t recordEnd, int) {
+            for (int64_t i=recordBegin; i<recordEnd; ++i) {
+                const char* record = records + i*element.stride;
+                for (size_t k=0; k<targets.size(); ++k) {
+                    auto& t = targets[k];
+                    if (t.data == nullptr)
+                        continue;
+                    auto& property = element.properties[k];
+                    t.data[i*t.nComponents + t.component] =
+                        (float)readPlyValue(record + property.offset, property.type, swap)*t.scale;
+                }
+            }
+        }, plyMinBlockSize);
+
+        return true;
+    }
 
-                    indices.push_back((unsigned)positionIndices[pi]);
+    // Read the face element, polygons of the vertex index list are triangulated to indices
+    bool readPlyFaces(const char*& p, const char* end, const PlyElement& element, PlyFormat format,
+        Vector<unsigned>& indices)
+    {
+        int64_t count = element.count;
+        int indexList = -1;
+        for (int k=(int)element.properties.size()-1; k>=0; --k) {
+            auto& property = element.properties[k];
+            if (property.countType != PlyType::NONE &&
+                (property.name == "vertex_indices" || property.name == "vertex_index"))
+                indexList = k;
+        }
+
+        if (format == PlyFormat::ASCII) {
+            Vector<const char*> chunkBegins;
+            if (!splitPlyLines(p, end, count, chunkBegins))
+                return false;
+
+            int64_t nChunks = chunkBegins.size()-1;
+            Vector<Vector<unsigned>> chunkIndices(nChunks);
+            Vector<char> chunkSuccess(nChunks, 0);
+            parallelFor(0, nChunks, [&](int64_t chunkBegin, int64_t chunkEnd, int) {
+                for (int64_t c=chunkBegin; c<chunkEnd; ++c) {
+                    const char* r = chunkBegins[c];
+                    bool success = true;
+                    chunkIndices[c].reserve(plyChunkLines*3);
+                    for (int64_t i=c*plyChunkLines; i<std::min(count, (c+1)*plyChunkLines) && success; ++i)
+                        success = parsePlyAsciiRecord(r, end, element, nullptr, i, indexList, chunkIndices[c]);
+                    chunkSuccess[c] = success;
                 }
+            });
+
+            for (int64_t c=0; c<nChunks; ++c) {
+                if (!chunkSuccess[c])
+                    return false;
+                indices.insert(indices.end(), chunkIndices[c].begin(), chunkIndices[c].end());
             }
-            else if (3 == fscanf(f, "/%u %u//%u", &nIndices[1],
-                &pIndices[2], &nIndices[2]))
-            {
-                for (int i=0; i<3; ++i) {
-                    int pi = pIndices[i]-1;
-                    int ni = nIndices[i]-1;
-
-                    if (positionIndices[pi] < 0 ||
-                        normalIndices[ni] < 0 ||
-                        positionIndices[pi] != normalIndices[ni])
-                    {
-                        positions.emplace_back(objPositions[pi]);
-                        positionIndices[pi] = positions.size()-1;
-                        normals.emplace_back(objNormals[ni]);
-                        normalIndices[ni] = normals.size()-1;
+            return true;
+        }
+
+        bool swap = (format == PlyFormat::BINARY_LITTLE_ENDIAN) != (std::endian::native == std::endian::little);
+
+        // Records of triangles only (the common case) have a fixed size and are converted in parallel
+        if (indexList == 0 && element.properties.size() == 1) {
+            auto& property = element.properties[0];
+            int countSize = plyTypeSize(property.countType);
+            int itemSize = plyTypeSize(property.type);
+            int64_t stride = countSize + 3*itemSize;
+
+            bool triangles = count <= (end-p)/stride;
+            if (triangles) {
+                int nBlocks = parallelForBlocks(count, plyMinBlockSize);
+                Vector<char> blockTriangles(nBlocks, 1);
+                parallelFor(0, count, [&](int64_t recordBegin, int64_t recordEnd, int blockId) {
+                    bool t = true;
+                    for (int64_t i=recordBegin; i<recordEnd; ++i)
+                        t = t && readPlyValue(p + i*stride, property.countType, swap) == 3.0;
+                    blockTriangles[blockId] = t;
+                }, plyMinBlockSize);
+                triangles = std::all_of(blockTriangles.begin(), blockTriangles.end(), [](char t) { return t != 0; });
+            }
+
+            if (triangles) {
+                size_t first = indices.size();
+                indices.resize(first + count*3);
+                parallelFor(0, count, [&](int64_t recordBegin, int64_t recordEnd, int) {
+                    for (int64_t i=recordBegin; i<recordEnd; ++i) {
+                        const char* record = p + i*stride + countSize;
+                        for (int j=0; j<3; ++j)
+                            indices[first + i*3 + j] = (unsigned)(int64_t)readPlyValue(record + j*itemSize, property.type, swap);
                     }
+                }, plyMinBlockSize);
+                p += count*stride;
+                return true;
+            }
+        }
+
+        return parsePlyBinaryRecords(p, end, element, indexList, swap, indices);
+    }
+
+    bool skipPlyElement(const char*& p, const char* end, const PlyElement& element, PlyFormat format)
+    {
+        if (format == PlyFormat::ASCII) {
+            for (int64_t i=0; i<element.count; ++i) {
+                if (p >= end)
+                    return false;
+                skipLine(p, end);
+                if (p < end)
+                    ++p;
+            }
+            return true;
+        }
+
+        if (element.stride >= 0) {
+            if (element.stride > 0 && element.count > (end-p)/element.stride)
+                return false;
+            p += element.count*element.stride;
+            return true;
+        }
+
+        bool swap = (format == PlyFormat::BINARY_LITTLE_ENDIAN) != (std::endian::native == std::endian::little);
+        Vector<unsigned> noIndices;
+        return parsePlyBinaryRecords(p, end, element, -1, swap, noIndices);
+    }
+
+} // namespace
+
+
+void gut::loadMeshFromOBJ(const std::string& fileName, VertexData& vertexData,
+    std::pmr::memory_resource* resource)
+{
+    MappedFile file(fileName);
+    if (!file.isOpen())
+        return;
+
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    // Split the file into newline-aligned chunks, one per thread
+    int nChunks = std::max(parallelForBlocks((int64_t)file.size(), objMinChunkSize), 1);
+    Vector<const char*> chunkBegins(nChunks+1);
+    chunkBegins[0] = begin;
+    chunkBegins[nChunks] = end;
+    for (int i=1; i<nChunks; ++i) {
+        const char* p = std::max(begin + (int64_t)file.size()*i/nChunks, chunkBegins[i-1]);
+        skipLine(p, end);
+        chunkBegins[i] = p < end ? p+1 : end;
+    }
+
+    std::pmr::memory_resource* upstream = resource != nullptr ? resource : std::pmr::get_default_resource();
+    std::pmr::monotonic_buffer_resource arena(upstream);
+
+    std::deque<ObjChunk> chunks;
+    for (int i=0; i<nChunks; ++i)
+        chunks.emplace_back(upstream);
+    parallelFor(0, nChunks, [&](int64_t chunkBegin, int64_t chunkEnd, int) {
+        for (int64_t i=chunkBegin; i<chunkEnd; ++i)
+            parseChunk(chunkBegins[i], chunkBegins[i+1], chunks[i]);
+    });
+
+    // Attribute offsets of the chunks, report the first error
+    Vector<int64_t> positionOffsets(nChunks+1, 0);
+    Vector<int64_t> texCoordOffsets(nChunks+1, 0);
+    Vector<int64_t> normalOffsets(nChunks+1, 0);
+    Vector<int64_t> cornerOffsets(nChunks+1, 0);
+    int64_t lineOffset = 0;
+    for (int i=0; i<nChunks; ++i) {
+        if (chunks[i].errorLine >= 0) {
+            fprintf(stderr, "ERROR: %s failed at line %lld\n",
+                fileName.c_str(), (long long)(lineOffset+chunks[i].errorLine)); // TODO logging
+            return;
+        }
+        lineOffset += chunks[i].nLines;
+        positionOffsets[i+1] = positionOffsets[i] + chunks[i].positions.size();
+        texCoordOffsets[i+1] = texCoordOffsets[i] + chunks[i].texCoords.size();
+        normalOffsets[i+1] = normalOffsets[i] + chunks[i].normals.size();
+        cornerOffsets[i+1] = cornerOffsets[i] + chunks[i].corners.size();
+    }
+
+    if (!vertexData.getDataNames().empty()){
+        fprintf(stderr, "ERROR: vertexData is required to be empty\n"); // TODO logging
+        return;
+    }
+
+    // Merge the chunks, relative indices are remapped to global ones
+    std::pmr::vector<Vec3f> objPositions(positionOffsets[nChunks], &arena);
+    std::pmr::vector<Vec2f> objTexCoords(texCoordOffsets[nChunks], &arena);
+    std::pmr::vector<Vec3f> objNormals(normalOffsets[nChunks], &arena);
+    std::pmr::vector<ObjCorner> corners(cornerOffsets[nChunks], &arena);
+    parallelFor(0, nChunks, [&](int64_t chunkBegin, int64_t chunkEnd, int) {
+        for (int64_t i=chunkBegin; i<chunkEnd; ++i) {
+            auto& c = chunks[i];
+            std::copy(c.positions.begin(), c.positions.end(), objPositions.begin()+positionOffsets[i]);
+            std::copy(c.texCoords.begin(), c.texCoords.end(), objTexCoords.begin()+texCoordOffsets[i]);
+            std::copy(c.normals.begin(), c.normals.end(), objNormals.begin()+normalOffsets[i]);
 
-                    indices.push_back((unsigned)positionIndices[pi]);
+            for (auto& r : c.relativeRefs) {
+                auto& corner = c.corners[r/3];
+                switch (r%3) {
+                    case 0: corner.p += (int32_t)positionOffsets[i]; break;
+                    case 1: corner.t += (int32_t)texCoordOffsets[i]; break;
+                    case 2: corner.n += (int32_t)normalOffsets[i]; break;
                 }
             }
-            else
-                readSuccessful = false;
+            std::copy(c.corners.begin(), c.corners.end(), corners.begin()+cornerOffsets[i]);
+        }
+    });
+    chunks.clear(); // releases the chunk arenas
+
+    int64_t nObjPositions = objPositions.size();
+    int64_t nObjTexCoords = objTexCoords.size();
+    int64_t nObjNormals = objNormals.size();
+    for (auto& c : corners) {
+        if (c.p < 0 || c.p >= nObjPositions ||
+            c.t < objNoIndex || c.t >= nObjTexCoords ||
+            c.n < objNoIndex || c.n >= nObjNormals) {
+            fprintf(stderr, "ERROR: %s contains face index out of range\n", fileName.c_str()); // TODO logging
+            return;
+        }
+    }
+
+    // Weld corners with equal (position, texCoord, normal) index triples to vertices
+    Vector<unsigned> indices;
+    Vector<unsigned> uniqueCorners;
+    int64_t nVertices = deduplicate(corners.size(),
+        [&](int64_t i) { return hashCorner(corners[i]); },
+        [&](int64_t i, int64_t j) {
+            return corners[i].p == corners[j].p && corners[i].t == corners[j].t && corners[i].n == corners[j].n;
+        },
+        indices, uniqueCorners);
+
+    // Attributes missing from some of the corners are zero-filled
+    bool hasTexCoords = false;
+    bool hasNormals = false;
+    for (auto& c : corners) {
+        hasTexCoords |= c.t != objNoIndex;
+        hasNormals |= c.n != objNoIndex;
+    }
+
+    // Data stored into the VertexData object
+    Vec3f* positions = vertexData.allocateData<Vec3f>("position", nVertices, resource);
+    Vec3f* normals = hasNormals ? vertexData.allocateData<Vec3f>("normal", nVertices, resource) : nullptr;
+    Vec2f* texCoords = hasTexCoords ? vertexData.allocateData<Vec2f>("texCoord", nVertices, resource) : nullptr;
+    parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            auto& c = corners[uniqueCorners[i]];
+            positions[i] = objPositions[c.p];
+            if (hasTexCoords)
+                texCoords[i] = c.t != objNoIndex ? objTexCoords[c.t] : Vec2f(0.0f, 0.0f);
+            if (hasNormals)
+                normals[i] = c.n != objNoIndex ? objNormals[c.n] : Vec3f(0.0f, 0.0f, 0.0f);
+        }
+    }, 16384);
+
+    vertexData.setIndices(std::move(indices));
+
+    if (!vertexData.validate())
+        fprintf(stderr, "ERROR: VertexData validation failed\n"); // TODO logging
+}
+
+void gut::loadMeshFromPLY(const std::string& fileName, VertexData& vertexData,
+    std::pmr::memory_resource* resource)
+{
+    if (!vertexData.getDataNames().empty()){
+        fprintf(stderr, "ERROR: vertexData is required to be empty\n"); // TODO logging
+        return;
+    }
+
+    // Containers aliasing the file reference the mapping, the last one alive releases it
+    auto file = std::make_shared<MappedFile>(fileName);
+    if (!file->isOpen())
+        return;
+
+    const char* p = file->data();
+    const char* end = p + file->size();
+
+    PlyFormat format;
+    Vector<PlyElement> elements;
+    if (p == nullptr || !parsePlyHeader(p, end, format, elements)) {
+        fprintf(stderr, "ERROR: %s is not a PLY file\n", fileName.c_str()); // TODO logging
+        return;
+    }
+
+    Vector<unsigned> indices;
+    bool hasVertices = false;
+    for (auto& element : elements) {
+        bool success;
+        if (element.name == "vertex" && !hasVertices) {
+            success = readPlyVertices(p, end, element, format, file, vertexData, resource);
+            hasVertices = true;
         }
+        else if (element.name == "face")
+            success = readPlyFaces(p, end, element, format, indices);
+        else
+            success = skipPlyElement(p, end, element, format);
 
-        if (!readSuccessful)
-            break;
+        if (!success) {
+            fprintf(stderr, "ERROR: %s has invalid or truncated element %s\n",
+                fileName.c_str(), element.name.c_str()); // TODO logging
+            vertexData = VertexData();
+            return;
+        }
     }
 
-    if (!readSuccessful) {
-        fprintf(stderr, "ERROR: %s failed at line %d\n",
-            fileName.c_str(), currentLine); // TODO logging
+    const auto* positions = std::as_const(vertexData).accessData("position");
+    if (positions == nullptr) {
+        fprintf(stderr, "ERROR: %s contains no vertex positions\n", fileName.c_str()); // TODO logging
+        vertexData = VertexData();
         return;
     }
 
+    // Point clouds without faces are drawn as points, one index per vertex
+    if (indices.empty())
+        identityIndices(indices, positions->size());
+    vertexData.setIndices(std::move(indices));
+
+    if (!vertexData.validate())
+        fprintf(stderr, "ERROR: VertexData validation failed\n"); // TODO logging
+}
+
+void gut::loadMeshFromSTL(const std::string& fileName, VertexData& vertexData,
+    std::pmr::memory_resource* resource)
+{
     if (!vertexData.getDataNames().empty()){
         fprintf(stderr, "ERROR: vertexData is required to be empty\n"); // TODO logging
         return;
     }
 
-    // Move the data vectors to the VertexData container
-    vertexData.addDataVector<Vec3f>("position", std::move(positions));
-    if (!normals.empty())
-        vertexData.addDataVector<Vec3f>("normal", std::move(normals));
-    if (!texCoords.empty())
-        vertexData.addDataVector<Vec2f>("texCoord", std::move(texCoords));
+    MappedFile file(fileName);
+    if (!file.isOpen())
+        return;
+
+    // 80-byte header, triangle count and 50-byte triangle records (facet normal, three
+    // vertices and attribute byte count), all little endian
+    constexpr int64_t stlHeaderSize = 84;
+    constexpr int64_t stlTriangleSize = 50;
+    bool swap = std::endian::native != std::endian::little;
+
+    int64_t nTriangles = file.size() >= stlHeaderSize ? loadValue<uint32_t>(file.data() + 80, swap) : -1;
+    if (nTriangles < 0 || (int64_t)file.size() != stlHeaderSize + nTriangles*stlTriangleSize) {
+        fprintf(stderr, "ERROR: %s is not a binary STL file\n", fileName.c_str()); // TODO logging
+        return;
+    }
+
+    const char* triangles = file.data() + stlHeaderSize;
+    Vec3f* positions = vertexData.allocateData<Vec3f>("position", nTriangles*3, resource);
+    Vec3f* normals = vertexData.allocateData<Vec3f>("normal", nTriangles*3, resource);
+    parallelFor(0, nTriangles, [&](int64_t begin, int64_t end, int) {
+        for (int64_t t=begin; t<end; ++t) {
+            float v[12];
+            if (swap)
+                byteSwap(triangles + t*stlTriangleSize, reinterpret_cast<char*>(v), sizeof(v), sizeof(float));
+            else
+                memcpy(v, triangles + t*stlTriangleSize, sizeof(v));
+
+            for (int i=0; i<3; ++i)
+                positions[t*3+i] = Vec3f(v[3+i*3], v[4+i*3], v[5+i*3]);
+
+            // Exporters may leave the facet normal zero
+            Vec3f normal(v[0], v[1], v[2]);
+            if (normal == Vec3f::Zero()) {
+                normal = (positions[t*3+1]-positions[t*3]).cross(positions[t*3+2]-positions[t*3]);
+                normal = normal == Vec3f::Zero() ? normal : normal.normalized();
+            }
+            for (int i=0; i<3; ++i)
+                normals[t*3+i] = normal;
+        }
+    }, plyMinBlockSize);
+
+    Vector<unsigned> indices;
+    identityIndices(indices, nTriangles*3);
     vertexData.setIndices(std::move(indices));
 
     if (!vertexData.validate())
@@ -0,0 +1,207 @@
+//
+// Project: GraphicsUtils
+// File: MappedFile.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "MappedFile.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+using namespace gut;
+
+
+MappedFile::MappedFile() :
+    _data           (nullptr),
+    _size           (0),
+    _open           (false)
+#ifdef _WIN32
+    ,
+    _fileHandle     (nullptr),
+    _mappingHandle  (nullptr)
+#endif
+{
+}
+
+MappedFile::MappedFile(const std::string& fileName) :
+    MappedFile()
+{
+    open(fileName);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    _data           (other._data),
+    _size           (other._size),
+    _open           (other._open)
+#ifdef _WIN32
+    ,
+    _fileHandle     (other._fileHandle),
+    _mappingHandle  (other._mappingHandle)
+#endif
+{
+    other._data = nullptr;
+    other._size = 0;
+    other._open = false;
+#ifdef _WIN32
+    other._fileHandle = nullptr;
+    other._mappingHandle = nullptr;
+#endif
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    close();
+
+    _data = other._data;
+    _size = other._size;
+    _open = other._open;
+#ifdef _WIN32
+    _fileHandle = other._fileHandle;
+    _mappingHandle = other._mappingHandle;
+    other._fileHandle = nullptr;
+    other._mappingHandle = nullptr;
+#endif
+    other._data = nullptr;
+    other._size = 0;
+    other._open = false;
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "ERROR: Cannot open file %s\n", fileName.c_str()); // TODO logging
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        fprintf(stderr, "ERROR: Cannot get size of file %s\n", fileName.c_str()); // TODO logging
+        CloseHandle(file);
+        return false;
+    }
+
+    _fileHandle = file;
+    _size = (size_t)fileSize.QuadPart;
+    _open = true;
+    if (_size == 0) // empty files cannot be mapped
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        fprintf(stderr, "ERROR: Cannot map file %s\n", fileName.c_str()); // TODO logging
+        close();
+        return false;
+    }
+    _mappingHandle = mapping;
+
+    _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr) {
+        fprintf(stderr, "ERROR: Cannot map file %s\n", fileName.c_str()); // TODO logging
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Cannot open file %s\n", fileName.c_str()); // TODO logging
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "ERROR: Cannot get size of file %s\n", fileName.c_str()); // TODO logging
+        ::close(fd);
+        return false;
+    }
+
+    _size = (size_t)st.st_size;
+    _open = true;
+    if (_size == 0) { // empty files cannot be mapped
+        ::close(fd);
+        return true;
+    }
+
+    void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // mapping keeps the file referenced
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Cannot map file %s\n", fileName.c_str()); // TODO logging
+        _size = 0;
+        _open = false;
+        return false;
+    }
+
+    // Files are mostly read front to back
+    madvise(p, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(p);
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mappingHandle != nullptr)
+        CloseHandle(_mappingHandle);
+    if (_fileHandle != nullptr)
+        CloseHandle(_fileHandle);
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+#else
+    if (_data != nullptr)
+        munmap(const_cast<char*>(_data), _size);
+#endif
+
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
+bool MappedFile::isOpen() const noexcept
+{
+    return _open;
+}
+
+const char* MappedFile::data() const noexcept
+{
+    return _data;
+}
+
+size_t MappedFile::size() const noexcept
+{
+    return _size;
+}
@@ -0,0 +1,76 @@
+//
+// Project: GraphicsUtils
+// File: MemoryResource.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "MemoryResource.hpp"
+
+
+using namespace gut;
+
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource* upstream) :
+    _upstream       (upstream),
+    _nAllocations   (0),
+    _nDeallocations (0),
+    _allocatedBytes (0),
+    _peakBytes      (0)
+{
+}
+
+int64_t CountingMemoryResource::nAllocations() const noexcept
+{
+    return _nAllocations.load(std::memory_order_relaxed);
+}
+
+int64_t CountingMemoryResource::nDeallocations() const noexcept
+{
+    return _nDeallocations.load(std::memory_order_relaxed);
+}
+
+int64_t CountingMemoryResource::allocatedBytes() const noexcept
+{
+    return _allocatedBytes.load(std::memory_order_relaxed);
+}
+
+int64_t CountingMemoryResource::peakBytes() const noexcept
+{
+    return _peakBytes.load(std::memory_order_relaxed);
+}
+
+void CountingMemoryResource::resetCounters() noexcept
+{
+    _nAllocations.store(0, std::memory_order_relaxed);
+    _nDeallocations.store(0, std::memory_order_relaxed);
+    _peakBytes.store(_allocatedBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* CountingMemoryResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void* p = _upstream->allocate(bytes, alignment);
+
+    _nAllocations.fetch_add(1, std::memory_order_relaxed);
+    int64_t allocated = _allocatedBytes.fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+    int64_t peak = _peakBytes.load(std::memory_order_relaxed);
+    while (allocated > peak && !_peakBytes.compare_exchange_weak(peak, allocated, std::memory_order_relaxed));
+
+    return p;
+}
+
+void CountingMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    _upstream->deallocate(p, bytes, alignment);
+
+    _nDeallocations.fetch_add(1, std::memory_order_relaxed);
+    _allocatedBytes.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
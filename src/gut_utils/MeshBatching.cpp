@@ -0,0 +1,122 @@
+//
+// Project: GraphicsUtils
+// File: MeshBatching.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "MeshBatching.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace gut;
+
+
+bool gut::isBatchCompatible(const VertexData& a, const VertexData& b)
+{
+    auto names = a.getDataNames();
+    if (names.size() != b.getDataNames().size())
+        return false;
+
+    for (auto& name : names) {
+        const auto* c = b.accessData(name);
+        if (c == nullptr || c->type != a.accessData(name)->type)
+            return false;
+    }
+
+    return true;
+}
+
+bool gut::mergeVertexData(const Vector<const VertexData*>& sources, VertexData& merged,
+    Vector<SubMesh>& subMeshes, bool rebaseIndices)
+{
+    if (sources.empty()) {
+        fprintf(stderr, "ERROR: No meshes to merge\n"); // TODO logging
+        return false;
+    }
+
+    for (auto* source : sources) {
+        if (!source->isValid()) {
+            fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+            return false;
+        }
+        if (!isBatchCompatible(*sources[0], *source)) {
+            fprintf(stderr, "ERROR: Incompatible VertexData containers\n"); // TODO logging
+            return false;
+        }
+    }
+
+    auto names = sources[0]->getDataNames();
+    if (names.empty()) {
+        fprintf(stderr, "ERROR: No containers in VertexData\n"); // TODO logging
+        return false;
+    }
+
+    // Ranges of the sources, the vertex count is the common container size
+    int64_t nSources = sources.size();
+    subMeshes.resize(nSources);
+    uint64_t nIndices = 0;
+    int64_t nVertices = 0;
+    for (int64_t i=0; i<nSources; ++i) {
+        int64_t vertexCount = INT64_MAX;
+        for (auto& name : names)
+            vertexCount = std::min(vertexCount, sources[i]->accessData(name)->size());
+
+        auto& subMesh = subMeshes[i];
+        subMesh.firstIndex = nIndices;
+        subMesh.indexCount = sources[i]->getIndices().size();
+        subMesh.firstVertex = nVertices;
+        subMesh.vertexCount = vertexCount;
+        subMesh.baseVertex = rebaseIndices ? 0 : nVertices;
+        subMesh.bounds = sources[i]->getBounds();
+        nIndices += subMesh.indexCount;
+        nVertices += vertexCount;
+    }
+
+    if (!rebaseIndices && nVertices > (int64_t)UINT32_MAX+1) {
+        fprintf(stderr, "ERROR: Too many vertices for 32-bit indices\n"); // TODO logging
+        return false;
+    }
+
+    merged = VertexData();
+    for (auto& name : names) {
+        auto type = sources[0]->accessData(name)->type;
+        uint8_t* dest = dispatchMathType(type, [&](auto* p) {
+            using T_Data = std::remove_pointer_t<decltype(p)>;
+            return reinterpret_cast<uint8_t*>(merged.allocateData<T_Data>(name, nVertices));
+        });
+        if (dest == nullptr)
+            return false;
+
+        size_t elementSize = merged.accessData(name)->elementSize();
+        parallelFor(0, nSources, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                memcpy(dest + subMeshes[i].firstVertex*elementSize, sources[i]->accessData(name)->data(),
+                    subMeshes[i].vertexCount*elementSize);
+            }
+        }, 16);
+    }
+
+    Vector<unsigned> indices(nIndices);
+    parallelFor(0, nSources, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            auto& sourceIndices = sources[i]->getIndices();
+            unsigned* dest = indices.data() + subMeshes[i].firstIndex;
+            unsigned offset = rebaseIndices ? (unsigned)subMeshes[i].firstVertex : 0u;
+            for (size_t j=0; j<sourceIndices.size(); ++j)
+                dest[j] = sourceIndices[j] + offset;
+        }
+    }, 16);
+    merged.setIndices(std::move(indices));
+
+    return merged.validate();
+}
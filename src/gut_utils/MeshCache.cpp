@@ -0,0 +1,225 @@
+//
+// Project: GraphicsUtils
+// File: MeshCache.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "MeshCache.hpp"
+#include "VertexData.hpp"
+#include "LoadMesh.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+
+using namespace gut;
+
+
+namespace {
+
+    constexpr char gutMeshMagic[8] = { 'G', 'U', 'T', 'M', 'E', 'S', 'H', '\0' };
+    constexpr uint32_t gutMeshVersion = 1;
+    constexpr uint64_t gutMeshAlignment = 64;
+    constexpr uint32_t nMathTypes = (uint32_t)MathTypeEnum::VEC2H + 1;
+
+    static_assert(sizeof(unsigned) == sizeof(uint32_t), "Indices are stored as 32-bit integers");
+
+    // File layout: header, container entries, names, container payloads, indices.
+    // Payloads and indices start at multiples of gutMeshAlignment.
+    struct GutMeshHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    nContainers;
+        uint64_t    nIndices;
+        uint64_t    indexOffset;
+        uint64_t    fileSize;
+    };
+
+    struct GutMeshContainerEntry {
+        uint64_t    nameOffset;
+        uint32_t    nameLength;
+        uint32_t    type; // MathTypeEnum
+        uint64_t    elementSize;
+        uint64_t    size;
+        uint64_t    dataOffset;
+    };
+
+    inline uint64_t align(uint64_t offset)
+    {
+        return (offset + gutMeshAlignment-1) & ~(gutMeshAlignment-1);
+    }
+
+} // namespace
+
+
+void gut::writeMeshCache(const std::string& fileName, const VertexData& vertexData)
+{
+    Vector<std::string> names = vertexData.getDataNames();
+    const auto& indices = vertexData.getIndices();
+
+    GutMeshHeader header;
+    memcpy(header.magic, gutMeshMagic, sizeof(gutMeshMagic));
+    header.version = gutMeshVersion;
+    header.nContainers = names.size();
+    header.nIndices = indices.size();
+
+    // Lay out the file
+    Vector<GutMeshContainerEntry> entries(names.size());
+    uint64_t offset = sizeof(GutMeshHeader) + names.size()*sizeof(GutMeshContainerEntry);
+    for (size_t i=0; i<names.size(); ++i) {
+        entries[i].nameOffset = offset;
+        entries[i].nameLength = names[i].size();
+        offset += names[i].size();
+    }
+    for (size_t i=0; i<names.size(); ++i) {
+        auto* c = vertexData.accessData(names[i]);
+        offset = align(offset);
+        entries[i].type = (uint32_t)c->type;
+        entries[i].elementSize = c->elementSize();
+        entries[i].size = c->size();
+        entries[i].dataOffset = offset;
+        offset += c->size()*c->elementSize();
+    }
+    offset = align(offset);
+    header.indexOffset = offset;
+    header.fileSize = offset + indices.size()*sizeof(uint32_t);
+
+    // Write to a temporary file in the same directory and rename it over the cache file
+    // afterwards, truncating the file in place would break VertexData still mapping it
+    std::string tmpFileName = fileName + ".tmp" + std::to_string(std::random_device()());
+    FILE* f = fopen(tmpFileName.c_str(), "wb");
+    if (f == NULL) {
+        fprintf(stderr, "ERROR: Cannot open file %s for writing\n", tmpFileName.c_str()); // TODO logging
+        return;
+    }
+
+    const char padding[gutMeshAlignment] = {};
+    uint64_t written = 0;
+    auto write = [&](const void* data, uint64_t size) {
+        if (size > 0 && fwrite(data, 1, size, f) != size)
+            return false;
+        written += size;
+        return true;
+    };
+    auto pad = [&](uint64_t targetOffset) {
+        return write(padding, targetOffset-written);
+    };
+
+    bool success = write(&header, sizeof(header)) &&
+        write(entries.data(), entries.size()*sizeof(GutMeshContainerEntry));
+    for (size_t i=0; i<names.size() && success; ++i)
+        success = write(names[i].data(), names[i].size());
+    for (size_t i=0; i<names.size() && success; ++i) {
+        auto* c = vertexData.accessData(names[i]);
+        success = pad(entries[i].dataOffset) && write(c->data(), c->size()*c->elementSize());
+    }
+    success = success && pad(header.indexOffset) &&
+        write(indices.data(), indices.size()*sizeof(uint32_t));
+
+    std::error_code error;
+    if (fclose(f) != 0 || !success) {
+        fprintf(stderr, "ERROR: Writing file %s failed\n", fileName.c_str()); // TODO logging
+        std::filesystem::remove(tmpFileName, error);
+        return;
+    }
+
+    std::filesystem::rename(tmpFileName, fileName, error);
+    if (error) {
+        fprintf(stderr, "ERROR: Replacing file %s failed: %s\n", fileName.c_str(),
+            error.message().c_str()); // TODO logging
+        std::filesystem::remove(tmpFileName, error);
+    }
+}
+
+void gut::loadMeshFromCache(const std::string& fileName, VertexData& vertexData)
+{
+    if (!vertexData.getDataNames().empty()){
+        fprintf(stderr, "ERROR: vertexData is required to be empty\n"); // TODO logging
+        return;
+    }
+
+    auto file = std::make_shared<MappedFile>(fileName);
+    if (!file->isOpen())
+        return;
+
+    const char* data = file->data();
+    uint64_t fileSize = file->size();
+
+    GutMeshHeader header;
+    if (fileSize >= sizeof(GutMeshHeader))
+        memcpy(&header, data, sizeof(GutMeshHeader));
+    if (fileSize < sizeof(GutMeshHeader) || memcmp(header.magic, gutMeshMagic, sizeof(gutMeshMagic)) != 0) {
+        fprintf(stderr, "ERROR: %s is not a gutmesh file\n", fileName.c_str()); // TODO logging
+        return;
+    }
+    if (header.version != gutMeshVersion) {
+        fprintf(stderr, "ERROR: Unsupported gutmesh version %u in %s\n",
+            header.version, fileName.c_str()); // TODO logging
+        return;
+    }
+
+    uint64_t entriesEnd = sizeof(GutMeshHeader) + (uint64_t)header.nContainers*sizeof(GutMeshContainerEntry);
+    if (header.fileSize != fileSize || entriesEnd > fileSize ||
+        header.indexOffset % gutMeshAlignment != 0 ||
+        header.nIndices > (fileSize - std::min(header.indexOffset, fileSize)) / sizeof(uint32_t)) {
+        fprintf(stderr, "ERROR: Corrupted gutmesh file %s\n", fileName.c_str()); // TODO logging
+        return;
+    }
+
+    // Containers reference the mapping, the last one alive releases it
+    std::shared_ptr<const void> owner = file;
+    for (uint32_t i=0; i<header.nContainers; ++i) {
+        GutMeshContainerEntry entry;
+        memcpy(&entry, data + sizeof(GutMeshHeader) + i*sizeof(GutMeshContainerEntry), sizeof(entry));
+
+        bool valid = entry.type < nMathTypes &&
+            entry.nameOffset <= fileSize && entry.nameLength <= fileSize - entry.nameOffset &&
+            entry.dataOffset % gutMeshAlignment == 0 && entry.dataOffset <= fileSize &&
+            entry.elementSize == dispatchMathType((MathTypeEnum)entry.type, [](auto* p) { return sizeof(*p); }) &&
+            entry.size <= (fileSize - entry.dataOffset) / entry.elementSize;
+        if (!valid) {
+            fprintf(stderr, "ERROR: Corrupted gutmesh file %s\n", fileName.c_str()); // TODO logging
+            vertexData = VertexData();
+            return;
+        }
+
+        vertexData.addExternalData(std::string(data + entry.nameOffset, entry.nameLength),
+            (MathTypeEnum)entry.type, data + entry.dataOffset, entry.size, owner);
+    }
+
+    auto* indices = reinterpret_cast<const unsigned*>(data + header.indexOffset);
+    vertexData.setIndices(Vector<unsigned>(indices, indices + header.nIndices));
+
+    if (!vertexData.validate())
+        fprintf(stderr, "ERROR: VertexData validation failed\n"); // TODO logging
+}
+
+void gut::loadMeshFromOBJCached(const std::string& fileName, VertexData& vertexData)
+{
+    std::string cacheFileName = fileName + ".gutmesh";
+
+    std::error_code error;
+    auto objTime = std::filesystem::last_write_time(fileName, error);
+    if (!error) {
+        auto cacheTime = std::filesystem::last_write_time(cacheFileName, error);
+        if (!error && cacheTime >= objTime) {
+            loadMeshFromCache(cacheFileName, vertexData);
+            if (vertexData.isValid())
+                return;
+
+            vertexData = VertexData();
+        }
+    }
+
+    loadMeshFromOBJ(fileName, vertexData);
+    if (vertexData.isValid())
+        writeMeshCache(cacheFileName, vertexData);
+}
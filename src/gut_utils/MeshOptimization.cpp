@@ -0,0 +1,420 @@
+//
+// Project: GraphicsUtils
+// File: MeshOptimization.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "MeshOptimization.hpp"
+#include "VertexData.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Forsyth's vertex cache model
+    constexpr int forsythCacheSize = 32;
+    constexpr int forsythMaxValence = 32;
+
+    struct ForsythScores {
+        float   cache[forsythCacheSize];
+        float   valence[forsythMaxValence+1];
+
+        ForsythScores()
+        {
+            for (int i=0; i<forsythCacheSize; ++i) {
+                // Vertices of the last triangle get a fixed score so that the next triangle
+                // does not simply reuse the same edge
+                cache[i] = i < 3 ? 0.75f :
+                    std::pow(1.0f - (float)(i-3)/(float)(forsythCacheSize-3), 1.5f);
+            }
+            valence[0] = 0.0f;
+            for (int i=1; i<=forsythMaxValence; ++i)
+                valence[i] = 2.0f / std::sqrt((float)i);
+        }
+
+        float operator()(int cachePosition, unsigned remainingValence) const
+        {
+            if (remainingValence == 0)
+                return -1.0f;
+
+            float score = remainingValence <= (unsigned)forsythMaxValence ?
+                valence[remainingValence] : 2.0f / std::sqrt((float)remainingValence);
+            if (cachePosition >= 0)
+                score += cache[cachePosition];
+            return score;
+        }
+    };
+
+    // FIFO cache simulation with timestamps, a vertex is cached if it was
+    // transformed less than cacheSize misses ago
+    class FifoCache {
+    public:
+        FifoCache(int64_t nVertices, int cacheSize) :
+            _timestamps (nVertices, 0),
+            _time       (cacheSize+1),
+            _cacheSize  (cacheSize)
+        {}
+
+        // Returns flag indicating whether the vertex missed the cache
+        bool access(unsigned v)
+        {
+            if (_time - _timestamps[v] > (uint64_t)_cacheSize) {
+                _timestamps[v] = _time++;
+                return true;
+            }
+            return false;
+        }
+
+        void flush()
+        {
+            _time += _cacheSize+1;
+        }
+
+    private:
+        Vector<uint64_t>    _timestamps;
+        uint64_t            _time;
+        int                 _cacheSize;
+    };
+
+    // Transformed vertices of triangles [begin, end) starting from an empty cache
+    int64_t countMisses(const unsigned* indices, int64_t begin, int64_t end, FifoCache& cache)
+    {
+        int64_t misses = 0;
+        cache.flush();
+        for (int64_t t=begin; t<end; ++t)
+            for (int j=0; j<3; ++j)
+                misses += cache.access(indices[t*3+j]);
+        return misses;
+    }
+
+} // namespace
+
+
+VertexCacheStatistics gut::analyzeVertexCache(const Vector<unsigned>& indices, int64_t nVertices,
+    int cacheSize)
+{
+    VertexCacheStatistics statistics { 0, 0.0, 0.0 };
+    if (indices.empty() || nVertices <= 0)
+        return statistics;
+
+    FifoCache cache(nVertices, cacheSize);
+    Vector<uint8_t> referenced(nVertices, 0);
+    int64_t nReferenced = 0;
+    for (auto i : indices) {
+        statistics.nTransformed += cache.access(i);
+        nReferenced += referenced[i] == 0;
+        referenced[i] = 1;
+    }
+
+    statistics.acmr = (double)statistics.nTransformed / (double)(indices.size()/3);
+    statistics.atvr = (double)statistics.nTransformed / (double)nReferenced;
+    return statistics;
+}
+
+void gut::optimizeVertexCache(Vector<unsigned>& indices, int64_t nVertices)
+{
+    static const ForsythScores score;
+
+    int64_t nTriangles = indices.size() / 3;
+    if (nTriangles == 0 || nVertices <= 0)
+        return;
+
+    // Triangles adjacent to each vertex, emitted triangles are removed from the lists
+    Vector<unsigned> valence(nVertices, 0);
+    for (int64_t i=0; i<nTriangles*3; ++i)
+        ++valence[indices[i]];
+
+    Vector<unsigned> adjacencyOffsets(nVertices+1, 0);
+    for (int64_t v=0; v<nVertices; ++v)
+        adjacencyOffsets[v+1] = adjacencyOffsets[v] + valence[v];
+
+    Vector<unsigned> adjacency(nTriangles*3);
+    {
+        Vector<unsigned> fill(adjacencyOffsets.begin(), adjacencyOffsets.end()-1);
+        for (int64_t i=0; i<nTriangles*3; ++i)
+            adjacency[fill[indices[i]]++] = (unsigned)(i/3);
+    }
+
+    Vector<int> cachePositions(nVertices, -1);
+    Vector<float> vertexScores(nVertices);
+    for (int64_t v=0; v<nVertices; ++v)
+        vertexScores[v] = score(-1, valence[v]);
+
+    Vector<float> triangleScores(nTriangles);
+    Vector<uint8_t> emitted(nTriangles, 0);
+    int64_t bestTriangle = 0;
+    for (int64_t t=0; t<nTriangles; ++t) {
+        triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3+1]] +
+            vertexScores[indices[t*3+2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+
+    unsigned cache[forsythCacheSize+3];
+    unsigned newCache[forsythCacheSize+3];
+    int cacheSize = 0;
+
+    Vector<unsigned> output(nTriangles*3);
+    int64_t cursor = 0; // triangles before the cursor have been emitted
+    for (int64_t o=0; o<nTriangles; ++o) {
+        if (bestTriangle < 0) {
+            // Dead end: continue from the next triangle in input order
+            while (emitted[cursor])
+                ++cursor;
+            bestTriangle = cursor;
+        }
+
+        const unsigned* tri = &indices[bestTriangle*3];
+        output[o*3] = tri[0];
+        output[o*3+1] = tri[1];
+        output[o*3+2] = tri[2];
+        emitted[bestTriangle] = 1;
+
+        // Remove the triangle from the adjacency lists of its vertices
+        int newCacheSize = 0;
+        for (int j=0; j<3; ++j) {
+            unsigned v = tri[j];
+            unsigned* begin = &adjacency[adjacencyOffsets[v]];
+            unsigned* end = begin + valence[v];
+            *std::find(begin, end, (unsigned)bestTriangle) = *(end-1);
+            --valence[v];
+
+            if (std::find(newCache, newCache+newCacheSize, v) == newCache+newCacheSize)
+                newCache[newCacheSize++] = v;
+        }
+
+        // Triangle vertices to the front of the LRU cache
+        int nTriangleVertices = newCacheSize;
+        for (int i=0; i<cacheSize; ++i) {
+            if (std::find(newCache, newCache+nTriangleVertices, cache[i]) == newCache+nTriangleVertices)
+                newCache[newCacheSize++] = cache[i];
+        }
+
+        // Update scores of the vertices in the cache and those just pushed out of it
+        for (int i=0; i<newCacheSize; ++i) {
+            unsigned v = newCache[i];
+            cachePositions[v] = i < forsythCacheSize ? i : -1;
+
+            float newScore = score(cachePositions[v], valence[v]);
+            float delta = newScore - vertexScores[v];
+            vertexScores[v] = newScore;
+
+            const unsigned* begin = &adjacency[adjacencyOffsets[v]];
+            for (const unsigned* t=begin; t<begin+valence[v]; ++t)
+                triangleScores[*t] += delta;
+        }
+
+        cacheSize = std::min(newCacheSize, forsythCacheSize);
+        for (int i=0; i<cacheSize; ++i)
+            cache[i] = newCache[i];
+
+        // Next triangle is the best one adjacent to the cached vertices
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (int i=0; i<cacheSize; ++i) {
+            unsigned v = cache[i];
+            const unsigned* begin = &adjacency[adjacencyOffsets[v]];
+            for (const unsigned* t=begin; t<begin+valence[v]; ++t) {
+                if (triangleScores[*t] > bestScore) {
+                    bestScore = triangleScores[*t];
+                    bestTriangle = *t;
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void gut::optimizeOverdraw(Vector<unsigned>& indices, const Vec3f* positions, int64_t nVertices,
+    float threshold)
+{
+    constexpr int cacheSize = 16;
+
+    int64_t nTriangles = indices.size() / 3;
+    if (nTriangles == 0 || nVertices <= 0)
+        return;
+
+    // Hard cluster boundaries where all vertices of a triangle miss the cache
+    Vector<int64_t> hardBoundaries;
+    FifoCache cache(nVertices, cacheSize);
+    for (int64_t t=0; t<nTriangles; ++t) {
+        int misses = 0;
+        for (int j=0; j<3; ++j)
+            misses += cache.access(indices[t*3+j]);
+        if (misses == 3 || t == 0)
+            hardBoundaries.push_back(t);
+    }
+    hardBoundaries.push_back(nTriangles);
+
+    // Split the hard clusters further where the ACMR allows it
+    Vector<int64_t> clusters;
+    for (size_t c=0; c+1<hardBoundaries.size(); ++c) {
+        int64_t begin = hardBoundaries[c];
+        int64_t end = hardBoundaries[c+1];
+        double clusterAcmr = (double)countMisses(indices.data(), begin, end, cache) / (double)(end-begin);
+
+        clusters.push_back(begin);
+        int64_t misses = 0;
+        int64_t subBegin = begin;
+        cache.flush();
+        for (int64_t t=begin; t<end; ++t) {
+            for (int j=0; j<3; ++j)
+                misses += cache.access(indices[t*3+j]);
+
+            if (t+1 < end && (double)misses <= threshold*clusterAcmr*(double)(t+1-subBegin)) {
+                clusters.push_back(t+1);
+                subBegin = t+1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(nTriangles);
+    int64_t nClusters = clusters.size()-1;
+
+    // Area-weighted centroids and normals
+    auto triangleCentroidAndNormal = [&](int64_t t, Vec3f& centroid, Vec3f& normal) {
+        const Vec3f& p0 = positions[indices[t*3]];
+        const Vec3f& p1 = positions[indices[t*3+1]];
+        const Vec3f& p2 = positions[indices[t*3+2]];
+        normal = (p1-p0).cross(p2-p0); // length is twice the area
+        centroid = (p0+p1+p2) / 3.0f;
+    };
+
+    Vec3f meshCentroid = Vec3f::Zero();
+    float meshArea = 0.0f;
+    Vector<Vec3f> clusterCentroids(nClusters);
+    Vector<Vec3f> clusterNormals(nClusters);
+    for (int64_t c=0; c<nClusters; ++c) {
+        Vec3f centroid = Vec3f::Zero();
+        Vec3f normal = Vec3f::Zero();
+        float area = 0.0f;
+        for (int64_t t=clusters[c]; t<clusters[c+1]; ++t) {
+            Vec3f tc, tn;
+            triangleCentroidAndNormal(t, tc, tn);
+            float a = tn.norm();
+            centroid += tc*a;
+            normal += tn;
+            area += a;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0f ? Vec3f(centroid / area) : centroid;
+        clusterNormals[c] = normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the mesh centroid are likely to occlude others
+    Vector<float> sortKeys(nClusters);
+    Vector<int64_t> order(nClusters);
+    for (int64_t c=0; c<nClusters; ++c) {
+        float normalLength = clusterNormals[c].norm();
+        sortKeys[c] = normalLength > 0.0f ?
+            (clusterCentroids[c]-meshCentroid).dot(clusterNormals[c]) / normalLength : 0.0f;
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    Vector<unsigned> output;
+    output.reserve(nTriangles*3);
+    for (auto c : order)
+        output.insert(output.end(), indices.begin()+clusters[c]*3, indices.begin()+clusters[c+1]*3);
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+int64_t gut::optimizeVertexFetch(VertexData& vertexData)
+{
+    Vector<std::string> names = vertexData.getDataNames();
+    if (names.empty())
+        return 0;
+
+    int64_t nVertices = -1;
+    for (auto& name : names) {
+        const auto* c = static_cast<const VertexData&>(vertexData).accessData(name);
+        if (nVertices >= 0 && c->size() != nVertices) {
+            fprintf(stderr, "ERROR: Vertex data containers are of different sizes\n"); // TODO logging
+            return -1;
+        }
+        nVertices = c->size();
+    }
+
+    constexpr unsigned unassigned = 0xFFFFFFFFu;
+    Vector<unsigned> indices = vertexData.getIndices();
+    Vector<unsigned> remap(nVertices, unassigned); // old vertex index to new one
+    Vector<unsigned> order; // new vertex index to old one
+    order.reserve(nVertices);
+    for (auto& i : indices) {
+        if (i >= nVertices) {
+            fprintf(stderr, "ERROR: Vertex index %u out of bounds\n", i); // TODO logging
+            return -1;
+        }
+        if (remap[i] == unassigned) {
+            remap[i] = (unsigned)order.size();
+            order.push_back(i);
+        }
+        i = remap[i];
+    }
+
+    int64_t nReferenced = order.size();
+    for (int64_t v=0; v<nVertices; ++v) {
+        if (remap[v] == unassigned)
+            order.push_back((unsigned)v);
+    }
+
+    bool wasValid = vertexData.isValid();
+
+    for (auto& name : names)
+        vertexData.accessData(name)->gather(order.data(), order.size());
+    vertexData.setIndices(std::move(indices));
+    if (wasValid)
+        vertexData.validate();
+
+    return nReferenced;
+}
+
+bool gut::optimizeMesh(VertexData& vertexData, const MeshOptimizationSettings& settings)
+{
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+
+    const auto* positions = static_cast<const VertexData&>(vertexData).accessData("position");
+    if (positions == nullptr) {
+        fprintf(stderr, "ERROR: No position data in VertexData\n"); // TODO logging
+        return false;
+    }
+    if (settings.optimizeOverdraw && positions->type != MathTypeEnum::VEC3F) {
+        fprintf(stderr, "ERROR: Overdraw optimization requires Vec3f position data\n"); // TODO logging
+        return false;
+    }
+
+    Vector<unsigned> indices = vertexData.getIndices();
+    optimizeVertexCache(indices, positions->size());
+    if (settings.optimizeOverdraw) {
+        optimizeOverdraw(indices, static_cast<const Vec3f*>(positions->data()), positions->size(),
+            settings.overdrawThreshold);
+    }
+    vertexData.setIndices(std::move(indices));
+    vertexData.validate();
+
+    if (settings.optimizeVertexFetch)
+        return optimizeVertexFetch(vertexData) >= 0;
+
+    return true;
+}
@@ -0,0 +1,287 @@
+//
+// Project: GraphicsUtils
+// File: Meshlets.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "Meshlets.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Ritter's bounding sphere
+    Vec4f boundingSphere(const Vec3f* positions, const unsigned* vertices, uint32_t nVertices)
+    {
+        // Most distant pair of the axis-extreme points as the initial sphere
+        const Vec3f* extremes[6];
+        for (int a=0; a<3; ++a) {
+            extremes[a*2] = extremes[a*2+1] = &positions[vertices[0]];
+            for (uint32_t i=1; i<nVertices; ++i) {
+                const Vec3f& p = positions[vertices[i]];
+                if (p(a) < (*extremes[a*2])(a)) extremes[a*2] = &p;
+                if (p(a) > (*extremes[a*2+1])(a)) extremes[a*2+1] = &p;
+            }
+        }
+        int axis = 0;
+        for (int a=1; a<3; ++a) {
+            if ((*extremes[a*2+1]-*extremes[a*2]).squaredNorm() >
+                (*extremes[axis*2+1]-*extremes[axis*2]).squaredNorm())
+                axis = a;
+        }
+
+        Vec3f center = 0.5f*(*extremes[axis*2] + *extremes[axis*2+1]);
+        float radius = 0.5f*(*extremes[axis*2+1]-*extremes[axis*2]).norm();
+
+        // Grow to include the points outside
+        for (uint32_t i=0; i<nVertices; ++i) {
+            const Vec3f& p = positions[vertices[i]];
+            float d = (p-center).norm();
+            if (d > radius) {
+                float newRadius = 0.5f*(radius+d);
+                center += (p-center)*((newRadius-radius)/d);
+                radius = newRadius;
+            }
+        }
+
+        return Vec4f(center(0), center(1), center(2), radius);
+    }
+
+    // Normal cone of the meshlet triangles, apex behind all triangle planes
+    void normalCone(const Vec3f* positions, const MeshletData& meshletData, const Meshlet& meshlet,
+        const Vec3f& center, Vec3f& apex, Vec4f& axisCutoff)
+    {
+        const unsigned* vertices = &meshletData.vertices[meshlet.vertexOffset];
+        const uint8_t* triangles = &meshletData.triangles[meshlet.triangleOffset];
+
+        auto triangle = [&](uint32_t t, Vec3f& p0, Vec3f& n) {
+            p0 = positions[vertices[triangles[t*3]]];
+            n = (positions[vertices[triangles[t*3+1]]]-p0).cross(positions[vertices[triangles[t*3+2]]]-p0);
+            float length = n.norm();
+            if (length <= 0.0f)
+                return false;
+            n /= length;
+            return true;
+        };
+
+        apex = center;
+        axisCutoff = Vec4f(0.0f, 0.0f, 1.0f, 1.0f); // never rejected
+
+        Vec3f axis = Vec3f::Zero();
+        Vec3f p0, n;
+        for (uint32_t t=0; t<meshlet.nTriangles; ++t)
+            if (triangle(t, p0, n))
+                axis += n;
+        if (axis.norm() <= 0.0f)
+            return;
+        axis.normalize();
+
+        float minDot = 1.0f;
+        for (uint32_t t=0; t<meshlet.nTriangles; ++t)
+            if (triangle(t, p0, n))
+                minDot = std::min(minDot, axis.dot(n));
+
+        // Cones wider than ~85 degrees are not worth testing
+        if (minDot <= 0.1f)
+            return;
+
+        float maxT = 0.0f;
+        for (uint32_t t=0; t<meshlet.nTriangles; ++t)
+            if (triangle(t, p0, n))
+                maxT = std::max(maxT, (center-p0).dot(n) / axis.dot(n));
+
+        apex = center - axis*maxT;
+        axisCutoff = Vec4f(axis(0), axis(1), axis(2), std::sqrt(1.0f - minDot*minDot));
+    }
+
+} // namespace
+
+
+bool gut::buildMeshlets(const VertexData& vertexData, MeshletData& meshletData,
+    const MeshletSettings& settings)
+{
+    meshletData = MeshletData();
+
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+    const auto* positionContainer = vertexData.accessData("position");
+    if (positionContainer == nullptr || positionContainer->type != MathTypeEnum::VEC3F) {
+        fprintf(stderr, "ERROR: Meshlet building requires Vec3f position data\n"); // TODO logging
+        return false;
+    }
+    if (settings.maxVertices < 3 || settings.maxVertices > 256 || settings.maxTriangles < 1) {
+        fprintf(stderr, "ERROR: Invalid meshlet limits\n"); // TODO logging
+        return false;
+    }
+
+    const auto* positions = static_cast<const Vec3f*>(positionContainer->data());
+    const auto& indices = vertexData.getIndices();
+    int64_t nVertices = positionContainer->size();
+    int64_t nTriangles = indices.size()/3;
+
+    // Triangles adjacent to each vertex
+    Vector<unsigned> adjacencyOffsets(nVertices+1, 0);
+    for (int64_t i=0; i<nTriangles*3; ++i)
+        ++adjacencyOffsets[indices[i]+1];
+    for (int64_t v=0; v<nVertices; ++v)
+        adjacencyOffsets[v+1] += adjacencyOffsets[v];
+    Vector<unsigned> adjacency(nTriangles*3);
+    {
+        Vector<unsigned> fill(adjacencyOffsets.begin(), adjacencyOffsets.end()-1);
+        for (int64_t i=0; i<nTriangles*3; ++i)
+            adjacency[fill[indices[i]]++] = (unsigned)(i/3);
+    }
+
+    Vector<int> localIndices(nVertices, -1);
+    Vector<uint8_t> emitted(nTriangles, 0);
+    Vector<unsigned> meshletVertices;
+    Vector<uint8_t> meshletTriangles;
+    Vector<unsigned> previousVertices;
+    Vec3f centerSum = Vec3f::Zero();
+
+    auto nNewVertices = [&](int64_t t) {
+        unsigned i0 = indices[t*3], i1 = indices[t*3+1], i2 = indices[t*3+2];
+        return (localIndices[i0] < 0) + (localIndices[i1] < 0 && i1 != i0) +
+            (localIndices[i2] < 0 && i2 != i0 && i2 != i1);
+    };
+
+    auto finishMeshlet = [&]() {
+        meshletData.meshlets.push_back({ (uint32_t)meshletData.vertices.size(),
+            (uint32_t)meshletData.triangles.size(), (uint32_t)meshletVertices.size(),
+            (uint32_t)meshletTriangles.size()/3 });
+        meshletData.vertices.insert(meshletData.vertices.end(), meshletVertices.begin(), meshletVertices.end());
+        meshletData.triangles.insert(meshletData.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+
+        for (auto v : meshletVertices)
+            localIndices[v] = -1;
+        previousVertices.swap(meshletVertices);
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        centerSum = Vec3f::Zero();
+    };
+
+    int64_t cursor = 0; // triangles before the cursor have been emitted
+    for (int64_t nEmitted=0; nEmitted<nTriangles; ++nEmitted) {
+        int64_t best = -1;
+        if (!meshletVertices.empty()) {
+            // Adjacent triangle adding the fewest vertices, closest to the meshlet center
+            Vec3f center = centerSum / (float)meshletVertices.size();
+            int bestNew = 4;
+            float bestDistance = 0.0f;
+            for (auto v : meshletVertices) {
+                for (unsigned a=adjacencyOffsets[v]; a<adjacencyOffsets[v+1]; ++a) {
+                    unsigned t = adjacency[a];
+                    if (emitted[t])
+                        continue;
+                    int nNew = nNewVertices(t);
+                    if ((int)meshletVertices.size()+nNew > settings.maxVertices || nNew > bestNew)
+                        continue;
+                    float distance = ((positions[indices[t*3]] + positions[indices[t*3+1]] +
+                        positions[indices[t*3+2]])/3.0f - center).squaredNorm();
+                    if (nNew < bestNew || distance < bestDistance ||
+                        (distance == bestDistance && t < best)) {
+                        best = t;
+                        bestNew = nNew;
+                        bestDistance = distance;
+                    }
+                }
+            }
+
+            // Without adjacent triangles continue with a disconnected one if it fits
+            if (best < 0 && (int)meshletVertices.size()+3 > settings.maxVertices)
+                finishMeshlet();
+        }
+
+        if (best < 0 && meshletVertices.empty()) {
+            // Seed next to the previous meshlet if possible
+            for (auto v : previousVertices) {
+                for (unsigned a=adjacencyOffsets[v]; a<adjacencyOffsets[v+1]; ++a) {
+                    unsigned t = adjacency[a];
+                    if (!emitted[t] && (best < 0 || t < best))
+                        best = t;
+                }
+            }
+        }
+        if (best < 0) {
+            while (emitted[cursor])
+                ++cursor;
+            best = cursor;
+        }
+
+        emitted[best] = 1;
+        for (int j=0; j<3; ++j) {
+            unsigned v = indices[best*3+j];
+            if (localIndices[v] < 0) {
+                localIndices[v] = (int)meshletVertices.size();
+                meshletVertices.push_back(v);
+                centerSum += positions[v];
+            }
+            meshletTriangles.push_back((uint8_t)localIndices[v]);
+        }
+
+        if ((int)meshletTriangles.size()/3 >= settings.maxTriangles)
+            finishMeshlet();
+    }
+    if (!meshletTriangles.empty())
+        finishMeshlet();
+
+    // Culling data
+    int64_t nMeshlets = meshletData.meshlets.size();
+    Vector<Vec4f> spheres(nMeshlets);
+    Vector<Vec3f> apexes(nMeshlets);
+    Vector<Vec4f> axes(nMeshlets);
+    parallelFor(0, nMeshlets, [&](int64_t begin, int64_t end, int) {
+        for (int64_t m=begin; m<end; ++m) {
+            const Meshlet& meshlet = meshletData.meshlets[m];
+            spheres[m] = boundingSphere(positions, &meshletData.vertices[meshlet.vertexOffset],
+                meshlet.nVertices);
+            normalCone(positions, meshletData, meshlet, spheres[m].block<3,1>(0,0), apexes[m], axes[m]);
+        }
+    }, 256);
+
+    meshletData.bounds.addDataVector<Vec4f>("boundingSphere", std::move(spheres));
+    meshletData.bounds.addDataVector<Vec3f>("coneApex", std::move(apexes));
+    meshletData.bounds.addDataVector<Vec4f>("coneAxis", std::move(axes));
+
+    // One index per meshlet, validation requires indices
+    Vector<unsigned> boundsIndices(nMeshlets);
+    std::iota(boundsIndices.begin(), boundsIndices.end(), 0u);
+    meshletData.bounds.setIndices(std::move(boundsIndices));
+    if (!meshletData.bounds.validate()) {
+        fprintf(stderr, "ERROR: Meshlet bounds validation failed\n"); // TODO logging
+        return false;
+    }
+
+    return true;
+}
+
+bool gut::buildMeshlets(const Vector<const VertexData*>& meshes, Vector<MeshletData>& meshletData,
+    const MeshletSettings& settings)
+{
+    meshletData.clear();
+    meshletData.resize(meshes.size());
+
+    std::atomic<bool> success = true;
+    parallelFor(0, meshes.size(), [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i)
+            if (!buildMeshlets(*meshes[i], meshletData[i], settings))
+                success = false;
+    }, 1);
+
+    return success;
+}
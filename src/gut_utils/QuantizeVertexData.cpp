@@ -0,0 +1,157 @@
+//
+// Project: GraphicsUtils
+// File: QuantizeVertexData.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "QuantizeVertexData.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Vec3f container or nullptr with an error message
+    const Vec3f* accessVec3f(const VertexData& vertexData, const std::string& name, int64_t& size)
+    {
+        const auto* c = vertexData.accessData(name);
+        if (c == nullptr || c->type != MathTypeEnum::VEC3F) {
+            fprintf(stderr, "ERROR: No Vec3f data container %s in VertexData\n", name.c_str()); // TODO logging
+            return nullptr;
+        }
+        size = c->size();
+        return static_cast<const Vec3f*>(c->data());
+    }
+
+} // namespace
+
+
+bool gut::quantizePositions(VertexData& vertexData, Mat4f& dequantization, const std::string& name)
+{
+    int64_t n;
+    const Vec3f* positions = accessVec3f(vertexData, name, n);
+    if (positions == nullptr)
+        return false;
+
+    Vec3f minimum = Vec3f::Zero();
+    Vec3f maximum = Vec3f::Zero();
+    if (n > 0) {
+        minimum = maximum = positions[0];
+        for (int64_t i=1; i<n; ++i) {
+            minimum = minimum.cwiseMin(positions[i]);
+            maximum = maximum.cwiseMax(positions[i]);
+        }
+    }
+
+    Vec3f extent = maximum-minimum;
+    Vec3f scale;
+    for (int j=0; j<3; ++j)
+        scale(j) = extent(j) > 0.0f ? 65535.0f / extent(j) : 0.0f;
+
+    Vector<Vec4us> quantized(n);
+    parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            Vec3f q = ((positions[i]-minimum).cwiseProduct(scale)).array().round().min(65535.0f).max(0.0f);
+            quantized[i] = Vec4us((uint16_t)q(0), (uint16_t)q(1), (uint16_t)q(2), 0);
+        }
+    }, 16384);
+
+    dequantization = Mat4f::Identity();
+    dequantization.diagonal().head<3>() = extent;
+    dequantization.block<3,1>(0,3) = minimum;
+
+    return vertexData.replaceDataVector<Vec4us>(name, std::move(quantized));
+}
+
+bool gut::quantizeNormals(VertexData& vertexData, int bits, const std::string& name)
+{
+    if (bits != 8 && bits != 16) {
+        fprintf(stderr, "ERROR: Normals can be quantized to 8 or 16 bits\n"); // TODO logging
+        return false;
+    }
+
+    int64_t n;
+    const Vec3f* normals = accessVec3f(vertexData, name, n);
+    if (normals == nullptr)
+        return false;
+
+    auto quantize = [&](auto* p) {
+        using T_Quantized = std::remove_pointer_t<decltype(p)>;
+        using T_Scalar = typename T_Quantized::Scalar;
+        const float maxValue = (float)std::numeric_limits<T_Scalar>::max();
+
+        Vector<T_Quantized> quantized(n);
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                Vec2f e = (octahedralEncode(normals[i])*maxValue).array().round();
+                quantized[i] = T_Quantized((T_Scalar)e(0), (T_Scalar)e(1));
+            }
+        }, 16384);
+
+        vertexData.replaceDataVector<T_Quantized>(name, std::move(quantized));
+    };
+
+    if (bits == 8)
+        quantize(static_cast<Vec2b*>(nullptr));
+    else
+        quantize(static_cast<Vec2s*>(nullptr));
+
+    return true;
+}
+
+bool gut::quantizeTexCoords(VertexData& vertexData, const std::string& name)
+{
+    const auto* c = vertexData.accessData(name);
+    if (c == nullptr || c->type != MathTypeEnum::VEC2F) {
+        fprintf(stderr, "ERROR: No Vec2f data container %s in VertexData\n", name.c_str()); // TODO logging
+        return false;
+    }
+
+    const auto* texCoords = static_cast<const Vec2f*>(c->data());
+    int64_t n = c->size();
+
+    Vector<Vec2h> converted(n);
+    parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i)
+            converted[i] = texCoords[i].cast<Eigen::half>();
+    }, 16384);
+
+    return vertexData.replaceDataVector<Vec2h>(name, std::move(converted));
+}
+
+Vec2f gut::octahedralEncode(const Vec3f& n)
+{
+    float l1 = std::abs(n(0)) + std::abs(n(1)) + std::abs(n(2));
+    if (l1 <= 0.0f)
+        return Vec2f(0.0f, 0.0f);
+
+    Vec2f e(n(0)/l1, n(1)/l1);
+    if (n(2) < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        e = Vec2f((1.0f - std::abs(e(1))) * (e(0) >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(e(0))) * (e(1) >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+Vec3f gut::octahedralDecode(const Vec2f& e)
+{
+    Vec3f n(e(0), e(1), 1.0f - std::abs(e(0)) - std::abs(e(1)));
+    if (n(2) < 0.0f) {
+        n(0) = (1.0f - std::abs(e(1))) * (e(0) >= 0.0f ? 1.0f : -1.0f);
+        n(1) = (1.0f - std::abs(e(0))) * (e(1) >= 0.0f ? 1.0f : -1.0f);
+    }
+    return n.normalized();
+}
@@ -0,0 +1,497 @@
+//
+// Project: GraphicsUtils
+// File: RayQuery.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "RayQuery.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_RAYQUERY_SSE2
+#include <emmintrin.h>
+#endif
+
+
+using namespace gut;
+
+
+namespace {
+
+#ifdef GUT_RAYQUERY_SSE2
+    // 4-wide float vector, comparisons return lane masks
+    struct Float4 {
+        __m128  v;
+
+        Float4() = default;
+        Float4(__m128 v) : v(v) {}
+
+        static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+        static Float4 broadcast(float f) { return _mm_set1_ps(f); }
+        static Float4 set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+    };
+
+    inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+    inline Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+    inline Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+    inline Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+    // Lanes where either operand is NaN
+    inline Float4 unordered(Float4 a, Float4 b) { return _mm_cmpunord_ps(a.v, b.v); }
+    inline Float4 vmin(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+    inline Float4 vmax(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+    inline int laneMask(Float4 m) { return _mm_movemask_ps(m.v); }
+    // Lanes of a where the mask m is not set
+    inline Float4 andNot(Float4 m, Float4 a) { return _mm_andnot_ps(m.v, a.v); }
+    // Lanes of a where the mask m is set, b elsewhere
+    inline Float4 select(Float4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+    inline Float4 maskFromBits(int bits)
+    {
+        return _mm_castsi128_ps(_mm_setr_epi32(-(bits & 1), -((bits >> 1) & 1), -((bits >> 2) & 1), -((bits >> 3) & 1)));
+    }
+#else
+    // 4-wide float vector, comparisons return lane masks (all bits set for true)
+    struct Float4 {
+        float   v[4];
+
+        static Float4 load(const float* p) { Float4 r; memcpy(r.v, p, sizeof(r.v)); return r; }
+        static Float4 broadcast(float f) { return {{ f, f, f, f }}; }
+        static Float4 set(float a, float b, float c, float d) { return {{ a, b, c, d }}; }
+        void store(float* p) const { memcpy(p, v, sizeof(v)); }
+    };
+
+    inline uint32_t floatBits(float f) { uint32_t b; memcpy(&b, &f, sizeof(b)); return b; }
+    inline float bitsFloat(uint32_t b) { float f; memcpy(&f, &b, sizeof(f)); return f; }
+    inline float maskFloat(bool m) { return bitsFloat(m ? 0xFFFFFFFFu : 0u); }
+
+    template <typename T_Op>
+    inline Float4 apply(Float4 a, Float4 b, const T_Op& op)
+    {
+        Float4 r;
+        for (int i=0; i<4; ++i)
+            r.v[i] = op(a.v[i], b.v[i]);
+        return r;
+    }
+
+    inline Float4 operator+(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x+y; }); }
+    inline Float4 operator-(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x-y; }); }
+    inline Float4 operator*(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x*y; }); }
+    inline Float4 operator/(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x/y; }); }
+    inline Float4 operator<(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return maskFloat(x < y); }); }
+    inline Float4 operator<=(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return maskFloat(x <= y); }); }
+    inline Float4 operator>(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return maskFloat(x > y); }); }
+    inline Float4 operator>=(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return maskFloat(x >= y); }); }
+    inline Float4 operator&(Float4 a, Float4 b)
+    {
+        return apply(a, b, [](float x, float y) { return bitsFloat(floatBits(x) & floatBits(y)); });
+    }
+    // Lanes where either operand is NaN
+    inline Float4 unordered(Float4 a, Float4 b)
+    {
+        return apply(a, b, [](float x, float y) { return maskFloat(x != x || y != y); });
+    }
+    // Same semantics as SSE min/max: the second operand is returned for NaNs
+    inline Float4 vmin(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline Float4 vmax(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline int laneMask(Float4 m)
+    {
+        int bits = 0;
+        for (int i=0; i<4; ++i)
+            bits |= (int)(floatBits(m.v[i]) >> 31) << i;
+        return bits;
+    }
+    // Lanes of a where the mask m is not set
+    inline Float4 andNot(Float4 m, Float4 a)
+    {
+        return apply(m, a, [](float x, float y) { return bitsFloat(~floatBits(x) & floatBits(y)); });
+    }
+    // Lanes of a where the mask m is set, b elsewhere
+    inline Float4 select(Float4 m, Float4 a, Float4 b)
+    {
+        Float4 r;
+        for (int i=0; i<4; ++i)
+            r.v[i] = floatBits(m.v[i]) ? a.v[i] : b.v[i];
+        return r;
+    }
+    inline Float4 maskFromBits(int bits)
+    {
+        return Float4::set(maskFloat(bits & 1), maskFloat(bits & 2), maskFloat(bits & 4), maskFloat(bits & 8));
+    }
+#endif
+
+    // Möller-Trumbore, either the ray or the triangle components may be broadcast
+    // Returns the mask of intersections within (tMin, tMax)
+    inline Float4 mollerTrumbore(const Float4 (&o)[3], const Float4 (&d)[3],
+        const Float4 (&v0)[3], const Float4 (&e1)[3], const Float4 (&e2)[3],
+        const Float4& tMin, const Float4& tMax, Float4& t, Float4& u, Float4& v)
+    {
+        const Float4 zero = Float4::broadcast(0.0f);
+        const Float4 one = Float4::broadcast(1.0f);
+
+        Float4 p[3] = { d[1]*e2[2] - d[2]*e2[1], d[2]*e2[0] - d[0]*e2[2], d[0]*e2[1] - d[1]*e2[0] };
+        Float4 det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+        Float4 inverseDet = one / det; // parallel rays produce NaNs that fail the tests below
+
+        Float4 s[3] = { o[0]-v0[0], o[1]-v0[1], o[2]-v0[2] };
+        u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2])*inverseDet;
+        Float4 q[3] = { s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0] };
+        v = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2])*inverseDet;
+        t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2])*inverseDet;
+
+        return (u >= zero) & (v >= zero) & (u+v <= one) & (t > tMin) & (t < tMax);
+    }
+
+    // Entry and exit distances of slabs from the distances t1 and t2 to their planes. An
+    // axis-parallel ray (infinite inverse direction) with the origin on a plane gives
+    // 0*inf = NaN, the slab does not limit the ray then (the slabs are closed, the origin is
+    // inside). Only rays with axis-parallel directions check for the NaNs.
+    inline void slabInterval(const Float4& t1, const Float4& t2, bool axisParallel, Float4& entry, Float4& exit)
+    {
+        entry = vmin(t1, t2);
+        exit = vmax(t1, t2);
+        if (!axisParallel || laneMask(unordered(t1, t2)) == 0)
+            return;
+
+        const Float4 infinity = Float4::broadcast(std::numeric_limits<float>::infinity());
+        const Float4 negativeInfinity = Float4::broadcast(-std::numeric_limits<float>::infinity());
+        Float4 valid1 = t1 <= t1;
+        Float4 valid2 = t2 <= t2;
+        entry = vmin(select(valid1, t1, negativeInfinity), select(valid2, t2, negativeInfinity));
+        exit = vmax(select(valid1, t1, infinity), select(valid2, t2, infinity));
+    }
+
+    // Slab test of a single ray against a node, node bounds are loaded with their padding lanes
+    inline bool intersectNode(const BvhNode& node, const Float4& origin, const Float4& inverseDirection,
+        bool axisParallel, float tMin, float tMax)
+    {
+        Float4 t1 = (Float4::load(&node.minimum(0)) - origin)*inverseDirection;
+        Float4 t2 = (Float4::load(&node.maximum(0)) - origin)*inverseDirection;
+        Float4 slabEntry, slabExit;
+        slabInterval(t1, t2, axisParallel, slabEntry, slabExit);
+        float entries[4], exits[4];
+        slabEntry.store(entries);
+        slabExit.store(exits);
+        float entry = std::max(std::max(entries[0], entries[1]), std::max(entries[2], tMin));
+        float exit = std::min(std::min(exits[0], exits[1]), std::min(exits[2], tMax));
+        return entry <= exit;
+    }
+
+    inline int64_t nextNode(const BvhNode& node, int64_t i, bool hit)
+    {
+        return hit || node.isLeaf() ? i+1 : node.offset;
+    }
+
+    template <bool T_AnyHit>
+    bool traverse(const RayQueryMesh& mesh, const Ray& ray, RayHit& hit)
+    {
+        const auto& nodes = mesh.bvh.nodes;
+        const int64_t nNodes = nodes.size();
+        const float* data[9];
+        for (int k=0; k<9; ++k)
+            data[k] = mesh.triangleData.data() + k*mesh.triangleStride;
+
+        const Float4 origin = Float4::set(ray.origin(0), ray.origin(1), ray.origin(2), 0.0f);
+        const Float4 inverseDirection = Float4::set(1.0f/ray.direction(0), 1.0f/ray.direction(1),
+            1.0f/ray.direction(2), 0.0f);
+        const bool axisParallel = std::isinf(1.0f/ray.direction(0)) || std::isinf(1.0f/ray.direction(1)) ||
+            std::isinf(1.0f/ray.direction(2));
+        const Float4 o[3] = { Float4::broadcast(ray.origin(0)), Float4::broadcast(ray.origin(1)),
+            Float4::broadcast(ray.origin(2)) };
+        const Float4 d[3] = { Float4::broadcast(ray.direction(0)), Float4::broadcast(ray.direction(1)),
+            Float4::broadcast(ray.direction(2)) };
+        const Float4 tMin = Float4::broadcast(ray.tMin);
+
+        float tMax = ray.tMax;
+        bool found = false;
+        for (int64_t i=0; i<nNodes;) {
+            const BvhNode& node = nodes[i];
+            bool nodeHit = intersectNode(node, origin, inverseDirection, axisParallel, ray.tMin, tMax);
+            if (nodeHit && node.isLeaf()) {
+                int64_t end = (int64_t)node.offset + node.count;
+                for (int64_t j=node.offset; j<end; j+=4) {
+                    const Float4 v0[3] = { Float4::load(data[0]+j), Float4::load(data[1]+j), Float4::load(data[2]+j) };
+                    const Float4 e1[3] = { Float4::load(data[3]+j), Float4::load(data[4]+j), Float4::load(data[5]+j) };
+                    const Float4 e2[3] = { Float4::load(data[6]+j), Float4::load(data[7]+j), Float4::load(data[8]+j) };
+                    Float4 t, u, v;
+                    int hits = laneMask(mollerTrumbore(o, d, v0, e1, e2, tMin, Float4::broadcast(tMax), t, u, v));
+                    hits &= (1 << std::min(end-j, (int64_t)4)) - 1; // lanes of the leaf
+                    if (hits == 0)
+                        continue;
+                    if (T_AnyHit)
+                        return true;
+
+                    float ts[4], us[4], vs[4];
+                    t.store(ts);
+                    u.store(us);
+                    v.store(vs);
+                    for (int lane=0; lane<4; ++lane) {
+                        if ((hits & (1 << lane)) && ts[lane] < tMax) {
+                            tMax = ts[lane];
+                            hit.t = ts[lane];
+                            hit.u = us[lane];
+                            hit.v = vs[lane];
+                            hit.triangle = mesh.bvh.triangles[j+lane];
+                            found = true;
+                        }
+                    }
+                }
+            }
+            i = nextNode(node, i, nodeHit);
+        }
+
+        return found;
+    }
+
+    template <bool T_AnyHit>
+    void traversePacket(const RayQueryMesh& mesh, const Ray (&rays)[rayPacketSize],
+        RayHit (&hits)[rayPacketSize], bool (&occluded)[rayPacketSize])
+    {
+        const auto& nodes = mesh.bvh.nodes;
+        const int64_t nNodes = nodes.size();
+        const float* data[9];
+        for (int k=0; k<9; ++k)
+            data[k] = mesh.triangleData.data() + k*mesh.triangleStride;
+
+        // Rays in SoA layout
+        Float4 o[3], d[3], inverseDirection[3];
+        for (int k=0; k<3; ++k) {
+            o[k] = Float4::set(rays[0].origin(k), rays[1].origin(k), rays[2].origin(k), rays[3].origin(k));
+            d[k] = Float4::set(rays[0].direction(k), rays[1].direction(k), rays[2].direction(k), rays[3].direction(k));
+            inverseDirection[k] = Float4::broadcast(1.0f) / d[k];
+        }
+        bool axisParallel = false;
+        for (int lane=0; lane<rayPacketSize; ++lane)
+            for (int k=0; k<3; ++k)
+                axisParallel = axisParallel || std::isinf(1.0f/rays[lane].direction(k));
+        const Float4 tMin = Float4::set(rays[0].tMin, rays[1].tMin, rays[2].tMin, rays[3].tMin);
+        Float4 tMax = Float4::set(rays[0].tMax, rays[1].tMax, rays[2].tMax, rays[3].tMax);
+        Float4 hitU = Float4::broadcast(0.0f);
+        Float4 hitV = Float4::broadcast(0.0f);
+        uint32_t hitTriangles[rayPacketSize] = { rayNoHit, rayNoHit, rayNoHit, rayNoHit };
+        Float4 active = maskFromBits(0xF);
+
+        for (int64_t i=0; i<nNodes;) {
+            const BvhNode& node = nodes[i];
+            Float4 entry = tMin;
+            Float4 exit = tMax;
+            for (int k=0; k<3; ++k) {
+                Float4 t1 = (Float4::broadcast(node.minimum(k)) - o[k])*inverseDirection[k];
+                Float4 t2 = (Float4::broadcast(node.maximum(k)) - o[k])*inverseDirection[k];
+                Float4 slabEntry, slabExit;
+                slabInterval(t1, t2, axisParallel, slabEntry, slabExit);
+                entry = vmax(slabEntry, entry);
+                exit = vmin(slabExit, exit);
+            }
+            bool nodeHit = laneMask((entry <= exit) & active) != 0;
+
+            if (nodeHit && node.isLeaf()) {
+                for (uint32_t j=node.offset; j<node.offset+node.count; ++j) {
+                    Float4 triangle[9];
+                    for (int k=0; k<9; ++k)
+                        triangle[k] = Float4::broadcast(data[k][j]);
+                    const Float4 v0[3] = { triangle[0], triangle[1], triangle[2] };
+                    const Float4 e1[3] = { triangle[3], triangle[4], triangle[5] };
+                    const Float4 e2[3] = { triangle[6], triangle[7], triangle[8] };
+
+                    Float4 t, u, v;
+                    Float4 hit = mollerTrumbore(o, d, v0, e1, e2, tMin, tMax, t, u, v) & active;
+                    int hitBits = laneMask(hit);
+                    if (hitBits == 0)
+                        continue;
+
+                    if (T_AnyHit) {
+                        active = andNot(hit, active);
+                        if (laneMask(active) == 0)
+                            break;
+                        continue;
+                    }
+
+                    tMax = select(hit, t, tMax);
+                    hitU = select(hit, u, hitU);
+                    hitV = select(hit, v, hitV);
+                    for (int lane=0; lane<rayPacketSize; ++lane)
+                        if (hitBits & (1 << lane))
+                            hitTriangles[lane] = mesh.bvh.triangles[j];
+                }
+                if (T_AnyHit && laneMask(active) == 0)
+                    break;
+            }
+            i = nextNode(node, i, nodeHit);
+        }
+
+        if (T_AnyHit) {
+            int activeBits = laneMask(active);
+            for (int lane=0; lane<rayPacketSize; ++lane)
+                occluded[lane] = !(activeBits & (1 << lane));
+            return;
+        }
+
+        float ts[4], us[4], vs[4];
+        tMax.store(ts);
+        hitU.store(us);
+        hitV.store(vs);
+        for (int lane=0; lane<rayPacketSize; ++lane) {
+            hits[lane] = RayHit();
+            if (hitTriangles[lane] != rayNoHit) {
+                hits[lane].t = ts[lane];
+                hits[lane].u = us[lane];
+                hits[lane].v = vs[lane];
+                hits[lane].triangle = hitTriangles[lane];
+            }
+        }
+    }
+
+    // Triangle vertices and edges in leaf order, padded for 4-wide loads
+    bool fillTriangleData(const VertexData& vertexData, RayQueryMesh& mesh)
+    {
+        const auto* positionContainer = vertexData.accessData("position");
+        const auto* positions = static_cast<const Vec3f*>(positionContainer->data());
+        const auto& indices = vertexData.getIndices();
+        int64_t nTriangles = mesh.bvh.triangles.size();
+
+        mesh.triangleStride = nTriangles + 3;
+        mesh.triangleData.assign(9*mesh.triangleStride, 0.0f);
+        float* data = mesh.triangleData.data();
+        parallelFor(0, nTriangles, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                const unsigned* triangle = &indices[mesh.bvh.triangles[i]*3];
+                const Vec3f& v0 = positions[triangle[0]];
+                Vec3f e1 = positions[triangle[1]] - v0;
+                Vec3f e2 = positions[triangle[2]] - v0;
+                for (int k=0; k<3; ++k) {
+                    data[k*mesh.triangleStride + i] = v0(k);
+                    data[(3+k)*mesh.triangleStride + i] = e1(k);
+                    data[(6+k)*mesh.triangleStride + i] = e2(k);
+                }
+            }
+        }, 16384);
+
+        return true;
+    }
+
+    inline Ray objectSpaceRay(const RayQueryInstance& instance, const Ray& ray, float tMax)
+    {
+        Vec4f origin = instance.worldToObject*Vec4f(ray.origin(0), ray.origin(1), ray.origin(2), 1.0f);
+        Vec3f direction = instance.worldToObject.block<3,3>(0,0)*ray.direction;
+        return Ray(origin.head<3>(), direction, ray.tMin, tMax);
+    }
+
+} // namespace
+
+
+bool gut::buildRayQueryMesh(const VertexData& vertexData, RayQueryMesh& mesh, const BvhSettings& settings)
+{
+    mesh = RayQueryMesh();
+    if (!buildBvh(vertexData, mesh.bvh, settings))
+        return false;
+
+    return fillTriangleData(vertexData, mesh);
+}
+
+bool gut::refitRayQueryMesh(const VertexData& vertexData, RayQueryMesh& mesh)
+{
+    if (!refitBvh(vertexData, mesh.bvh))
+        return false;
+
+    return fillTriangleData(vertexData, mesh);
+}
+
+RayHit gut::intersectClosest(const RayQueryMesh& mesh, const Ray& ray)
+{
+    RayHit hit;
+    traverse<false>(mesh, ray, hit);
+    return hit;
+}
+
+bool gut::intersectAny(const RayQueryMesh& mesh, const Ray& ray)
+{
+    RayHit hit;
+    return traverse<true>(mesh, ray, hit);
+}
+
+void gut::intersectClosest(const RayQueryMesh& mesh, const Ray (&rays)[rayPacketSize],
+    RayHit (&hits)[rayPacketSize])
+{
+    bool occluded[rayPacketSize];
+    traversePacket<false>(mesh, rays, hits, occluded);
+}
+
+void gut::intersectAny(const RayQueryMesh& mesh, const Ray (&rays)[rayPacketSize],
+    bool (&occluded)[rayPacketSize])
+{
+    RayHit hits[rayPacketSize];
+    traversePacket<true>(mesh, rays, hits, occluded);
+}
+
+void gut::intersectClosest(const RayQueryMesh& mesh, const Ray* rays, RayHit* hits, int64_t n)
+{
+    parallelFor(0, (n+rayPacketSize-1)/rayPacketSize, [&](int64_t begin, int64_t end, int) {
+        for (int64_t p=begin; p<end; ++p) {
+            int64_t first = p*rayPacketSize;
+            if (first+rayPacketSize <= n) {
+                intersectClosest(mesh, *reinterpret_cast<const Ray(*)[rayPacketSize]>(rays+first),
+                    *reinterpret_cast<RayHit(*)[rayPacketSize]>(hits+first));
+            }
+            else {
+                for (int64_t i=first; i<n; ++i)
+                    hits[i] = intersectClosest(mesh, rays[i]);
+            }
+        }
+    }, 64);
+}
+
+void gut::intersectAny(const RayQueryMesh& mesh, const Ray* rays, bool* occluded, int64_t n)
+{
+    parallelFor(0, (n+rayPacketSize-1)/rayPacketSize, [&](int64_t begin, int64_t end, int) {
+        for (int64_t p=begin; p<end; ++p) {
+            int64_t first = p*rayPacketSize;
+            if (first+rayPacketSize <= n) {
+                intersectAny(mesh, *reinterpret_cast<const Ray(*)[rayPacketSize]>(rays+first),
+                    *reinterpret_cast<bool(*)[rayPacketSize]>(occluded+first));
+            }
+            else {
+                for (int64_t i=first; i<n; ++i)
+                    occluded[i] = intersectAny(mesh, rays[i]);
+            }
+        }
+    }, 64);
+}
+
+RayHit gut::intersectClosest(const Vector<RayQueryInstance>& instances, const Ray& ray)
+{
+    RayHit hit;
+    float tMax = ray.tMax;
+    for (size_t i=0; i<instances.size(); ++i) {
+        RayHit instanceHit = intersectClosest(*instances[i].mesh, objectSpaceRay(instances[i], ray, tMax));
+        if (instanceHit.hit()) {
+            hit = instanceHit;
+            hit.instance = (uint32_t)i;
+            tMax = hit.t;
+        }
+    }
+    return hit;
+}
+
+bool gut::intersectAny(const Vector<RayQueryInstance>& instances, const Ray& ray)
+{
+    for (auto& instance : instances)
+        if (intersectAny(*instance.mesh, objectSpaceRay(instance, ray, ray.tMax)))
+            return true;
+    return false;
+}
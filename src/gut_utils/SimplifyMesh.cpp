@@ -0,0 +1,634 @@
+//
+// Project: GraphicsUtils
+// File: SimplifyMesh.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "SimplifyMesh.hpp"
+#include "VertexData.hpp"
+#include "Deduplicate.hpp"
+#include "MathTypes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Weights of the constraint planes along open borders and attribute seams,
+    // relative to the surface planes
+    constexpr double borderWeight = 10.0;
+    constexpr double seamWeight = 1.0;
+
+    // Symmetric 4x4 quadric of area-weighted squared plane distances
+    struct Quadric {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double w; // sum of weights
+
+        Quadric() :
+            a00(0.0), a01(0.0), a02(0.0), a11(0.0), a12(0.0), a22(0.0),
+            b0(0.0), b1(0.0), b2(0.0), c(0.0), w(0.0)
+        {}
+
+        // Plane through point p with unit normal n
+        static Quadric plane(const Vec3d& n, const Vec3d& p, double weight)
+        {
+            double d = -n.dot(p);
+            Quadric q;
+            q.a00 = weight*n(0)*n(0); q.a01 = weight*n(0)*n(1); q.a02 = weight*n(0)*n(2);
+            q.a11 = weight*n(1)*n(1); q.a12 = weight*n(1)*n(2); q.a22 = weight*n(2)*n(2);
+            q.b0 = weight*d*n(0); q.b1 = weight*d*n(1); q.b2 = weight*d*n(2);
+            q.c = weight*d*d;
+            q.w = weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            w += other.w;
+            return *this;
+        }
+
+        // Weighted mean squared distance of p to the planes
+        double error(const Vec3d& p) const
+        {
+            double e =
+                a00*p(0)*p(0) + a11*p(1)*p(1) + a22*p(2)*p(2) +
+                2.0*(a01*p(0)*p(1) + a02*p(0)*p(2) + a12*p(1)*p(2)) +
+                2.0*(b0*p(0) + b1*p(1) + b2*p(2)) + c;
+            return w > 0.0 ? std::max(e, 0.0) / w : 0.0;
+        }
+    };
+
+    enum class EdgeKind : uint8_t {
+        MANIFOLD,
+        SEAM,       // manifold in positions, attributes differ on the two sides
+        BORDER,
+        COMPLEX     // shared by more than two triangles or inconsistently oriented
+    };
+
+    struct Candidate {
+        double      cost;
+        unsigned    from, to; // position ids
+
+        bool operator<(const Candidate& other) const
+        {
+            if (cost != other.cost) return cost < other.cost;
+            if (from != other.from) return from < other.from;
+            return to < other.to;
+        }
+    };
+
+    // Mesh state of the simplification
+    struct SimplificationMesh {
+        const Vec3f*        positions;
+        Vector<unsigned>    positionIds;    // vertex index to position id
+        Vector<unsigned>    uniquePositions;// position id to (first) vertex index
+        Vector<unsigned>    indices;
+
+        Vec3d position(unsigned positionId) const
+        {
+            return positions[uniquePositions[positionId]].cast<double>();
+        }
+
+        unsigned pid(unsigned vertex) const
+        {
+            return positionIds[vertex];
+        }
+
+        int64_t nTriangles() const
+        {
+            return indices.size()/3;
+        }
+
+        Vec3d normal(int64_t t) const // length is twice the area
+        {
+            Vec3d p0 = position(pid(indices[t*3]));
+            return (position(pid(indices[t*3+1]))-p0).cross(position(pid(indices[t*3+2]))-p0);
+        }
+    };
+
+    // Triangles around the positions, updated by the collapses
+    class CollapseMesh {
+    public:
+        CollapseMesh(SimplificationMesh& mesh, int64_t nPositions) :
+            _mesh           (mesh),
+            _triangles      (nPositions),
+            _removed        (mesh.nTriangles(), 0),
+            _nTriangles     (mesh.nTriangles()),
+            _corners        (mesh.indices.size())
+        {
+            for (size_t i=0; i<mesh.indices.size(); ++i) {
+                _corners[i] = mesh.pid(mesh.indices[i]);
+                _triangles[_corners[i]].push_back((unsigned)(i/3));
+            }
+        }
+
+        const Vector<unsigned>& triangles(unsigned p) const { return _triangles[p]; }
+        int64_t nTriangles() const { return _nTriangles; }
+
+        bool contains(unsigned t, unsigned p) const
+        {
+            return _corners[t*3] == p || _corners[t*3+1] == p ||
+                _corners[t*3+2] == p;
+        }
+
+        // Sorted neighbouring position ids
+        void neighbours(unsigned p, Vector<unsigned>& result) const
+        {
+            result.clear();
+            for (auto t : _triangles[p]) {
+                for (int j=0; j<3; ++j) {
+                    unsigned q = _corners[t*3+j];
+                    if (q != p)
+                        result.push_back(q);
+                }
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+        }
+
+        // Classify edge between positions a and b, triangle is set to one of the
+        // triangles containing the edge
+        EdgeKind classifyEdge(unsigned a, unsigned b, unsigned& triangle) const
+        {
+            int nForward = 0, nBackward = 0;
+            unsigned forward[2] = {}, backward[2] = {}; // vertex indices at a and b
+            for (auto t : _triangles[a]) {
+                const unsigned* tri = &_mesh.indices[t*3];
+                const unsigned* corners = &_corners[t*3];
+                for (int j=0; j<3; ++j) {
+                    if (corners[j] != a)
+                        continue;
+                    if (corners[(j+1)%3] == b) {
+                        forward[0] = tri[j]; forward[1] = tri[(j+1)%3];
+                        ++nForward;
+                        triangle = t;
+                    }
+                    else if (corners[(j+2)%3] == b) {
+                        backward[0] = tri[j]; backward[1] = tri[(j+2)%3];
+                        ++nBackward;
+                        triangle = t;
+                    }
+                }
+            }
+
+            if (nForward + nBackward == 1)
+                return EdgeKind::BORDER;
+            if (nForward == 1 && nBackward == 1) {
+                return (forward[0] == backward[0] && forward[1] == backward[1]) ?
+                    EdgeKind::MANIFOLD : EdgeKind::SEAM;
+            }
+            return EdgeKind::COMPLEX;
+        }
+
+        // Check whether u can be collapsed onto v, on success mapping contains the
+        // vertex (attribute variant) pairs to collapse
+        bool checkCollapse(unsigned u, unsigned v, Vector<std::pair<unsigned, unsigned>>& mapping)
+        {
+            // Link condition: common neighbours must be exactly the opposite vertices
+            // of the shared triangles, otherwise the collapse pinches the surface
+            int64_t nShared = 0;
+            for (auto t : _triangles[u])
+                nShared += contains(t, v);
+            neighbours(u, _neighboursU);
+            neighbours(v, _neighboursV);
+            int64_t nCommon = 0;
+            for (size_t i=0, j=0; i<_neighboursU.size() && j<_neighboursV.size();) {
+                if (_neighboursU[i] < _neighboursV[j]) ++i;
+                else if (_neighboursU[i] > _neighboursV[j]) ++j;
+                else { ++nCommon; ++i; ++j; }
+            }
+            if (nShared == 0 || nCommon != nShared)
+                return false;
+
+            // Every vertex at u needs a vertex at v sharing a triangle with it
+            mapping.clear();
+            for (auto t : _triangles[u]) {
+                for (int j=0; j<3; ++j) {
+                    unsigned w = _mesh.indices[t*3+j];
+                    if (_corners[t*3+j] != u)
+                        continue;
+                    if (std::find_if(mapping.begin(), mapping.end(),
+                        [&](const auto& m) { return m.first == w; }) != mapping.end())
+                        continue;
+
+                    unsigned partner = 0xFFFFFFFFu;
+                    for (auto t2 : _triangles[u]) {
+                        const unsigned* tri = &_mesh.indices[t2*3];
+                        const unsigned* corners = &_corners[t2*3];
+                        if (tri[0] != w && tri[1] != w && tri[2] != w)
+                            continue;
+                        for (int k=0; k<3; ++k)
+                            if (corners[k] == v)
+                                partner = tri[k];
+                        if (partner != 0xFFFFFFFFu)
+                            break;
+                    }
+                    if (partner == 0xFFFFFFFFu)
+                        return false;
+                    mapping.emplace_back(w, partner);
+                }
+            }
+
+            // Remaining triangles must not flip
+            Vec3d pv = _mesh.position(v);
+            for (auto t : _triangles[u]) {
+                if (contains(t, v))
+                    continue;
+
+                Vec3d p[3];
+                for (int j=0; j<3; ++j)
+                    p[j] = _mesh.position(_corners[t*3+j]);
+                Vec3d nOld = (p[1]-p[0]).cross(p[2]-p[0]);
+                for (int j=0; j<3; ++j)
+                    if (_corners[t*3+j] == u)
+                        p[j] = pv;
+                Vec3d nNew = (p[1]-p[0]).cross(p[2]-p[0]);
+                if (nNew.dot(nOld) <= 0.0)
+                    return false;
+            }
+
+            return true;
+        }
+
+        // Collapse u onto v with the vertex mapping from checkCollapse, the triangles
+        // containing both are removed
+        void collapse(unsigned u, unsigned v, const Vector<std::pair<unsigned, unsigned>>& mapping)
+        {
+            _compactList.clear();
+            for (auto t : _triangles[u]) {
+                if (contains(t, v)) {
+                    _removed[t] = 1;
+                    --_nTriangles;
+                    for (int j=0; j<3; ++j)
+                        _compactList.push_back(_corners[t*3+j]);
+                    continue;
+                }
+                for (int j=0; j<3; ++j) {
+                    unsigned& w = _mesh.indices[t*3+j];
+                    if (_corners[t*3+j] == u) {
+                        w = std::find_if(mapping.begin(), mapping.end(),
+                            [&](const auto& m) { return m.first == w; })->second;
+                        _corners[t*3+j] = v;
+                    }
+                }
+                _triangles[v].push_back(t);
+            }
+            _triangles[u].clear();
+            _triangles[u].shrink_to_fit();
+
+            // Remove the collapsed triangles from the triangle lists of their other positions
+            for (auto p : _compactList) {
+                auto& triangles = _triangles[p];
+                triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                    [&](unsigned t) { return _removed[t] != 0; }), triangles.end());
+            }
+        }
+
+        // Remaining triangles in their original order
+        void remainingIndices(Vector<unsigned>& indices) const
+        {
+            indices.clear();
+            for (int64_t t=0; t<(int64_t)_removed.size(); ++t)
+                if (!_removed[t])
+                    indices.insert(indices.end(), &_mesh.indices[t*3], &_mesh.indices[t*3]+3);
+        }
+
+    private:
+        SimplificationMesh&         _mesh;
+        Vector<Vector<unsigned>>    _triangles;
+        Vector<uint8_t>             _removed;
+        int64_t                     _nTriangles;
+        Vector<unsigned>            _corners;       // Position id of each index
+        Vector<unsigned>            _neighboursU;
+        Vector<unsigned>            _neighboursV;
+        Vector<unsigned>            _compactList;
+    };
+
+    // Min-heap order of the candidates
+    struct CandidateGreater {
+        bool operator()(const Candidate& c1, const Candidate& c2) const
+        {
+            return c2 < c1;
+        }
+    };
+
+} // namespace
+
+
+float gut::simplifyMesh(const VertexData& vertexData, Vector<unsigned>& indices,
+    const SimplificationSettings& settings)
+{
+    const auto* positionContainer = vertexData.accessData("position");
+    if (positionContainer == nullptr || positionContainer->type != MathTypeEnum::VEC3F) {
+        fprintf(stderr, "ERROR: Simplification requires Vec3f position data\n"); // TODO logging
+        return -1.0f;
+    }
+    int64_t nVertices = positionContainer->size();
+    if (indices.size() % 3 != 0) {
+        fprintf(stderr, "ERROR: Number of indices is not a multiple of 3\n"); // TODO logging
+        return -1.0f;
+    }
+    for (auto i : indices) {
+        if (i >= nVertices) {
+            fprintf(stderr, "ERROR: Vertex index %u out of bounds\n", i); // TODO logging
+            return -1.0f;
+        }
+    }
+
+    SimplificationMesh mesh;
+    mesh.positions = static_cast<const Vec3f*>(positionContainer->data());
+
+    // Vertices sharing a position are variants of the same vertex across attribute seams
+    int64_t nPositions = deduplicate(nVertices,
+        [&](int64_t i) {
+            uint64_t h[2] = {};
+            memcpy(h, mesh.positions[i].data(), sizeof(Vec3f));
+            return (h[0] ^ (h[1] * 0x9E3779B97F4A7C15ull)) * 0xC2B2AE3D27D4EB4Full;
+        },
+        [&](int64_t i, int64_t j) {
+            return memcmp(mesh.positions[i].data(), mesh.positions[j].data(), sizeof(Vec3f)) == 0;
+        },
+        mesh.positionIds, mesh.uniquePositions);
+
+    // Drop degenerate triangles
+    mesh.indices.reserve(indices.size());
+    for (size_t t=0; t<indices.size()/3; ++t) {
+        unsigned p0 = mesh.pid(indices[t*3]), p1 = mesh.pid(indices[t*3+1]), p2 = mesh.pid(indices[t*3+2]);
+        if (p0 != p1 && p1 != p2 && p2 != p0)
+            mesh.indices.insert(mesh.indices.end(), &indices[t*3], &indices[t*3]+3);
+    }
+    if (mesh.indices.empty()) {
+        indices.clear();
+        return 0.0f;
+    }
+
+    // Errors are relative to the extent of the mesh
+    Vec3d minimum = mesh.position(mesh.pid(mesh.indices[0]));
+    Vec3d maximum = minimum;
+    for (auto i : mesh.indices) {
+        minimum = minimum.cwiseMin(mesh.position(mesh.pid(i)));
+        maximum = maximum.cwiseMax(mesh.position(mesh.pid(i)));
+    }
+    double scale = (maximum-minimum).maxCoeff();
+    double maxCost = settings.targetError >= std::numeric_limits<float>::max() ?
+        std::numeric_limits<double>::infinity() : std::pow((double)settings.targetError*scale, 2.0);
+
+    CollapseMesh collapseMesh(mesh, nPositions);
+    Vector<unsigned> neighbours;
+
+    // Numbers of border and complex edges of the positions, updated by the collapses
+    Vector<int> nBorderEdges(nPositions, 0);
+    Vector<int> nComplexEdges(nPositions, 0);
+    auto countEdge = [&](unsigned a, unsigned b, EdgeKind kind, int count) {
+        if (kind == EdgeKind::BORDER) {
+            nBorderEdges[a] += count;
+            nBorderEdges[b] += count;
+        }
+        else if (kind == EdgeKind::COMPLEX) {
+            nComplexEdges[a] += count;
+            nComplexEdges[b] += count;
+        }
+    };
+    auto border = [&](unsigned p) {
+        return nBorderEdges[p] > 0;
+    };
+    auto locked = [&](unsigned p) {
+        return nComplexEdges[p] > 0 || (settings.lockBorders && nBorderEdges[p] > 0);
+    };
+
+    // Surface quadrics and constraint planes along borders and seams
+    Vector<Quadric> quadrics(nPositions);
+    for (int64_t t=0; t<mesh.nTriangles(); ++t) {
+        Vec3d n = mesh.normal(t);
+        double area = 0.5*n.norm();
+        if (area <= 0.0)
+            continue;
+        auto q = Quadric::plane(n.normalized(), mesh.position(mesh.pid(mesh.indices[t*3])), area);
+        for (int j=0; j<3; ++j)
+            quadrics[mesh.pid(mesh.indices[t*3+j])] += q;
+    }
+    for (unsigned a=0; a<(unsigned)nPositions; ++a) {
+        collapseMesh.neighbours(a, neighbours);
+        for (auto b : neighbours) {
+            if (b < a)
+                continue;
+            unsigned triangle = 0;
+            EdgeKind kind = collapseMesh.classifyEdge(a, b, triangle);
+            countEdge(a, b, kind, 1);
+            if (kind != EdgeKind::BORDER && kind != EdgeKind::SEAM)
+                continue;
+            Vec3d pa = mesh.position(a), pb = mesh.position(b);
+            Vec3d n = (pb-pa).cross(mesh.normal(triangle));
+            if (n.norm() <= 0.0)
+                continue;
+            double weight = (pb-pa).squaredNorm() * (kind == EdgeKind::BORDER ? borderWeight : seamWeight);
+            auto q = Quadric::plane(n.normalized(), pa, weight);
+            quadrics[a] += q;
+            quadrics[b] += q;
+        }
+    }
+
+    auto cost = [&](unsigned u, unsigned v) {
+        Quadric q = quadrics[u];
+        q += quadrics[v];
+        return q.error(mesh.position(v));
+    };
+
+    // Check whether u can be collapsed along an edge of given kind
+    auto allowed = [&](unsigned u, EdgeKind kind) {
+        return kind != EdgeKind::COMPLEX && !locked(u) && (!border(u) || kind == EdgeKind::BORDER);
+    };
+
+    // Cheaper allowed collapse direction of edge a-b, cost is negative if there is none
+    auto edgeCandidate = [&](unsigned a, unsigned b, EdgeKind kind) {
+        Candidate best = { -1.0, a, b };
+        for (auto [u, v] : { std::make_pair(a, b), std::make_pair(b, a) }) {
+            if (!allowed(u, kind))
+                continue;
+            Candidate c = { cost(u, v), u, v };
+            if (c.cost <= maxCost && (best.cost < 0.0 || c < best))
+                best = c;
+        }
+        return best;
+    };
+
+    // Edges are kept in a heap with the cost of their cheaper direction at the time of
+    // pushing. A collapse changes the costs of the edges at the target and the flags of
+    // the positions around it, only those edges are pushed again and the outdated
+    // entries are skipped when their cost no longer matches.
+    Vector<Candidate> heap;
+    auto push = [&](const Candidate& c) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), CandidateGreater());
+    };
+    auto pushEdge = [&](unsigned a, unsigned b) {
+        unsigned triangle = 0;
+        Candidate c = edgeCandidate(a, b, collapseMesh.classifyEdge(a, b, triangle));
+        if (c.cost >= 0.0)
+            push(c);
+    };
+    // Push the edges of the marked positions, edges between two of them once
+    Vector<uint8_t> marked(nPositions, 0);
+    auto pushMarkedEdges = [&](const Vector<unsigned>& positions) {
+        for (auto p : positions) {
+            collapseMesh.neighbours(p, neighbours);
+            for (auto q : neighbours)
+                if (!marked[q] || p < q)
+                    pushEdge(p, q);
+        }
+        for (auto p : positions)
+            marked[p] = 0;
+    };
+    for (unsigned a=0; a<(unsigned)nPositions; ++a) {
+        collapseMesh.neighbours(a, neighbours);
+        for (auto b : neighbours) {
+            if (a >= b)
+                continue;
+            unsigned triangle = 0;
+            Candidate c = edgeCandidate(a, b, collapseMesh.classifyEdge(a, b, triangle));
+            if (c.cost >= 0.0)
+                heap.push_back(c);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), CandidateGreater());
+
+    double error = 0.0;
+    Vector<std::pair<unsigned, unsigned>> mapping;
+    Vector<unsigned> ring; // positions around the collapse
+    Vector<uint8_t> flags; // border and locked flags of the ring before the collapse
+    Vector<unsigned> repush;
+    Vector<unsigned> oldNeighbours; // neighbours of the target before the collapse
+    Vector<uint8_t> retry(nPositions, 0); // candidates of the position failed the collapse check
+    while (!heap.empty() && collapseMesh.nTriangles() > settings.targetTriangles) {
+        std::pop_heap(heap.begin(), heap.end(), CandidateGreater());
+        Candidate c = heap.back();
+        heap.pop_back();
+
+        // Skip collapsed positions, entries of edges changed by the collapses are pushed
+        // again with the current cost
+        unsigned u = c.from, v = c.to;
+        if (collapseMesh.triangles(u).empty() || collapseMesh.triangles(v).empty())
+            continue;
+        unsigned triangle = 0;
+        EdgeKind kind = collapseMesh.classifyEdge(u, v, triangle);
+        if (cost(u, v) != c.cost) {
+            Candidate current = edgeCandidate(u, v, kind);
+            if (current.cost >= 0.0)
+                push(current);
+            continue;
+        }
+        if (!allowed(u, kind))
+            continue;
+
+        if (!collapseMesh.checkCollapse(u, v, mapping)) {
+            // Neighbourhood changes may make the collapse possible later, the other
+            // direction is tried right away (once, after the cheaper one failed)
+            retry[u] = retry[v] = 1;
+            Candidate preferred = edgeCandidate(u, v, kind);
+            if (preferred.from == u && allowed(v, kind)) {
+                Candidate reverse = { cost(v, u), v, u };
+                if (reverse.cost <= maxCost)
+                    push(reverse);
+            }
+            continue;
+        }
+
+        // Remove the edges at u and v from the counts, they are counted again after the collapse
+        ring.clear();
+        collapseMesh.neighbours(u, neighbours);
+        for (auto p : neighbours) {
+            countEdge(u, p, collapseMesh.classifyEdge(u, p, triangle), -1);
+            ring.push_back(p);
+        }
+        collapseMesh.neighbours(v, oldNeighbours);
+        for (auto p : oldNeighbours) {
+            if (p == u)
+                continue;
+            countEdge(v, p, collapseMesh.classifyEdge(v, p, triangle), -1);
+            ring.push_back(p);
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+        flags.resize(ring.size());
+        for (size_t i=0; i<ring.size(); ++i)
+            flags[i] = (uint8_t)(border(ring[i]) | locked(ring[i]) << 1);
+
+        collapseMesh.collapse(u, v, mapping);
+        quadrics[v] += quadrics[u];
+        error = std::max(error, c.cost);
+
+        collapseMesh.neighbours(v, neighbours);
+        for (auto p : neighbours)
+            countEdge(v, p, collapseMesh.classifyEdge(v, p, triangle), 1);
+        nBorderEdges[u] = nComplexEdges[u] = 0;
+
+        // Edges at v changed cost, their entries are updated lazily when popped. Edges
+        // v inherited from u and the edges of the ring positions with changed flags
+        // or failed candidates are pushed again.
+        repush.clear();
+        for (size_t i=0; i<ring.size(); ++i) {
+            unsigned p = ring[i];
+            if (p == u || p == v)
+                continue;
+            if (retry[p] || flags[i] != (uint8_t)(border(p) | locked(p) << 1)) {
+                retry[p] = 0;
+                repush.push_back(p);
+                marked[p] = 1;
+            }
+        }
+        pushMarkedEdges(repush);
+        for (auto p : neighbours)
+            if (!std::binary_search(oldNeighbours.begin(), oldNeighbours.end(), p))
+                pushEdge(v, p);
+    }
+
+    collapseMesh.remainingIndices(indices);
+    return scale > 0.0 ? (float)(std::sqrt(error) / scale) : 0.0f;
+}
+
+Vector<MeshLOD> gut::generateLODs(const VertexData& vertexData, int nLevels, float reductionFactor,
+    const SimplificationSettings& settings)
+{
+    Vector<MeshLOD> levels;
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return levels;
+    }
+
+    levels.push_back({ vertexData.getIndices(), 0.0f });
+    for (int l=1; l<nLevels; ++l) {
+        const MeshLOD& previous = levels.back();
+        int64_t nTriangles = previous.indices.size()/3;
+
+        SimplificationSettings levelSettings = settings;
+        levelSettings.targetTriangles = (int64_t)((double)nTriangles*reductionFactor);
+
+        Vector<unsigned> indices = previous.indices;
+        float error = simplifyMesh(vertexData, indices, levelSettings);
+        // Stop when the level could not be simplified meaningfully
+        if (error < 0.0f || indices.empty() ||
+            (int64_t)(indices.size()/3) > nTriangles - std::max(nTriangles/100, (int64_t)1))
+            break;
+
+        levels.push_back({ std::move(indices), previous.error + error });
+    }
+
+    return levels;
+}
@@ -0,0 +1,225 @@
+//
+// Project: GraphicsUtils
+// File: TangentSpace.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "TangentSpace.hpp"
+#include "VertexData.hpp"
+#include "Deduplicate.hpp"
+#include "ParallelFor.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace gut;
+
+
+namespace {
+
+    inline uint64_t mix64(uint64_t h)
+    {
+        h ^= h >> 31;
+        h *= 0x7FB5D329728EA185ull;
+        h ^= h >> 27;
+        h *= 0x81DADEF4BC2DD44Dull;
+        return h ^ (h >> 33);
+    }
+
+    // Sum per-corner values of the triangles to the vertices. Corners are grouped by vertex
+    // (counting sort) and each vertex sums its corners in triangle order, so vertex ranges are
+    // processed in parallel without per-thread accumulators and the result does not depend
+    // on the number of threads.
+    template <typename T_Value, typename T_Vertex, typename T_Corner>
+    void accumulateCorners(int64_t nTriangles, int64_t nVertices, Vector<T_Value>& result,
+        const T_Vertex& vertex, const T_Corner& corner)
+    {
+        int64_t nCorners = nTriangles*3;
+        Vector<int64_t> offsets(nVertices+1, 0);
+        for (int64_t c=0; c<nCorners; ++c)
+            ++offsets[vertex(c)+1];
+        for (int64_t i=0; i<nVertices; ++i)
+            offsets[i+1] += offsets[i];
+
+        // Offsets are advanced to the ends of the ranges while filling and shifted back after
+        Vector<unsigned> corners(nCorners);
+        for (int64_t c=0; c<nCorners; ++c)
+            corners[offsets[vertex(c)]++] = (unsigned)c;
+        for (int64_t i=nVertices; i>0; --i)
+            offsets[i] = offsets[i-1];
+        offsets[0] = 0;
+
+        result.resize(nVertices);
+        parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                T_Value sum = T_Value::Zero();
+                for (int64_t k=offsets[i]; k<offsets[i+1]; ++k)
+                    sum += corner(corners[k]/3, corners[k]%3);
+                result[i] = sum;
+            }
+        }, 16384);
+    }
+
+    // Container of the given type or nullptr with an error message
+    template <typename T_Data>
+    const T_Data* accessContainer(const VertexData& vertexData, const std::string& name,
+        MathTypeEnum type, const char* typeName)
+    {
+        const auto* c = vertexData.accessData(name);
+        if (c == nullptr || c->type != type) {
+            fprintf(stderr, "ERROR: No %s data container %s in VertexData\n", typeName, name.c_str()); // TODO logging
+            return nullptr;
+        }
+        return static_cast<const T_Data*>(c->data());
+    }
+
+    // Unit vector perpendicular to n
+    inline Vec3f perpendicular(const Vec3f& n)
+    {
+        Vec3f axis = std::abs(n(0)) < 0.9f ? Vec3f(1.0f, 0.0f, 0.0f) : Vec3f(0.0f, 1.0f, 0.0f);
+        return (axis - n*n.dot(axis)).normalized();
+    }
+
+} // namespace
+
+
+bool gut::generateNormals(VertexData& vertexData, NormalWeighting weighting)
+{
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+
+    const auto* positions = accessContainer<Vec3f>(vertexData, "position", MathTypeEnum::VEC3F, "Vec3f");
+    if (positions == nullptr)
+        return false;
+
+    const auto& indices = vertexData.getIndices();
+    int64_t nVertices = vertexData.accessData("position")->size();
+    int64_t nTriangles = indices.size()/3;
+
+    // Vertices with equal positions accumulate to the same normal
+    Vector<unsigned> remap;
+    Vector<unsigned> unique;
+    int64_t nUnique = deduplicate(nVertices,
+        [&](int64_t i) {
+            uint64_t h[2] = {};
+            memcpy(h, &positions[i], sizeof(Vec3f));
+            return mix64(h[0] ^ mix64(h[1]));
+        },
+        [&](int64_t i, int64_t j) {
+            return memcmp(&positions[i], &positions[j], sizeof(Vec3f)) == 0;
+        },
+        remap, unique);
+
+    Vector<Vec3f> accumulated;
+    accumulateCorners<Vec3f>(nTriangles, nUnique, accumulated,
+        [&](int64_t c) { return remap[indices[c]]; },
+        [&](int64_t t, int j) -> Vec3f {
+            const unsigned* triangle = &indices[t*3];
+            const Vec3f& p0 = positions[triangle[0]];
+            const Vec3f& p1 = positions[triangle[1]];
+            const Vec3f& p2 = positions[triangle[2]];
+
+            // Cross product length is twice the triangle area
+            Vec3f n = (p1-p0).cross(p2-p0);
+            float length = n.norm();
+            if (!(length > 0.0f))
+                return Vec3f::Zero();
+
+            if (weighting == NormalWeighting::AREA)
+                return n;
+
+            if (weighting == NormalWeighting::ANGLE)
+                n /= length;
+
+            const Vec3f* p[3] = { &p0, &p1, &p2 };
+            float angle = std::atan2(length, (*p[(j+1)%3]-*p[j]).dot(*p[(j+2)%3]-*p[j]));
+            return n*angle;
+        });
+
+    Vector<Vec3f> normals(nVertices);
+    parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            const Vec3f& n = accumulated[remap[i]];
+            float length = n.norm();
+            normals[i] = length > 0.0f ? Vec3f(n/length) : Vec3f(0.0f, 0.0f, 1.0f);
+        }
+    }, 16384);
+
+    return vertexData.replaceDataVector<Vec3f>("normal", std::move(normals));
+}
+
+bool gut::generateTangents(VertexData& vertexData)
+{
+    if (!vertexData.isValid()) {
+        fprintf(stderr, "ERROR: Invalid VertexData\n"); // TODO logging
+        return false;
+    }
+
+    const auto* positions = accessContainer<Vec3f>(vertexData, "position", MathTypeEnum::VEC3F, "Vec3f");
+    const auto* normals = accessContainer<Vec3f>(vertexData, "normal", MathTypeEnum::VEC3F, "Vec3f");
+    const auto* texCoords = accessContainer<Vec2f>(vertexData, "texCoord", MathTypeEnum::VEC2F, "Vec2f");
+    if (positions == nullptr || normals == nullptr || texCoords == nullptr)
+        return false;
+
+    const auto& indices = vertexData.getIndices();
+    int64_t nVertices = vertexData.accessData("position")->size();
+    int64_t nTriangles = indices.size()/3;
+
+    // xyz: angle-weighted tangent sum, w: angle-weighted texture space orientation
+    Vector<Vec4f> accumulated;
+    accumulateCorners<Vec4f>(nTriangles, nVertices, accumulated,
+        [&](int64_t c) { return indices[c]; },
+        [&](int64_t t, int j) -> Vec4f {
+            const unsigned* triangle = &indices[t*3];
+            Vec3f d1 = positions[triangle[1]] - positions[triangle[0]];
+            Vec3f d2 = positions[triangle[2]] - positions[triangle[0]];
+            Vec2f st1 = texCoords[triangle[1]] - texCoords[triangle[0]];
+            Vec2f st2 = texCoords[triangle[2]] - texCoords[triangle[0]];
+
+            // Triangles degenerate in texture space do not contribute
+            float signedArea = st1(0)*st2(1) - st1(1)*st2(0);
+            if (signedArea == 0.0f)
+                return Vec4f::Zero();
+            float orientation = signedArea > 0.0f ? 1.0f : -1.0f;
+            Vec3f tangent = (d1*st2(1) - d2*st1(1))*orientation;
+
+            const Vec3f& n = normals[triangle[j]];
+            auto project = [&](const Vec3f& v) { return Vec3f(v - n*n.dot(v)); };
+
+            Vec3f projected = project(tangent);
+            float length = projected.norm();
+            if (!(length > 0.0f))
+                return Vec4f::Zero();
+
+            // Corner angle between the edges projected to the normal plane
+            const Vec3f& p = positions[triangle[j]];
+            Vec3f e1 = project(positions[triangle[(j+1)%3]] - p);
+            Vec3f e2 = project(positions[triangle[(j+2)%3]] - p);
+            float angle = std::atan2(e1.cross(e2).norm(), e1.dot(e2));
+
+            projected *= angle/length;
+            return Vec4f(projected(0), projected(1), projected(2), angle*orientation);
+        });
+
+    Vector<Vec4f> tangents(nVertices);
+    parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i) {
+            const Vec3f& n = normals[i];
+            Vec3f tangent = accumulated[i].head<3>();
+            tangent -= n*n.dot(tangent);
+            float length = tangent.norm();
+            tangent = length > 0.0f ? Vec3f(tangent/length) : perpendicular(n);
+            tangents[i] = Vec4f(tangent(0), tangent(1), tangent(2), accumulated[i](3) < 0.0f ? -1.0f : 1.0f);
+        }
+    }, 16384);
+
+    return vertexData.replaceDataVector<Vec4f>("tangent", std::move(tangents));
+}
@@ -9,89 +9,251 @@
 //
 
 #include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUT_VERTEXDATA_SSE2
+#include <emmintrin.h>
+#endif
 
 
 using namespace gut;
 
 
-VertexData::Container::Container(const VertexData::Container& other) :
-    name    (other.name),
-    type    (other.type),
-    size    (other.size),
-    v       (nullptr),
-    deleter (other.deleter),
-    copier  (other.copier)
-{
-    // Check for corrupted object
-    if (deleter == nullptr || copier == nullptr) {
-        name = "";
-        type = MathTypeEnum::FLOAT;
-        size = 0;
-        deleter = nullptr;
-        copier = nullptr;
-        return;
+namespace {
+
+    constexpr int64_t validateBlockSize = 65536; // triangles
+
+    struct IndexStats {
+        unsigned    maxIndex = 0;
+        int64_t     nDegenerate = 0;
+    };
+
+#ifdef GUT_VERTEXDATA_SSE2
+    // Unsigned maximum, SSE2 only has signed comparison so the operands are offset by 2^31
+    inline __m128i maxOffsetU32(__m128i a, __m128i b)
+    {
+        __m128i greater = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
     }
+#endif
+
+    inline bool isDegenerate(const unsigned* t)
+    {
+        return t[0] == t[1] || t[1] == t[2] || t[2] == t[0];
+    }
+
+    // Maximum index and number of degenerate triangles in triangles [begin, end)
+    IndexStats indexStats(const unsigned* indices, int64_t begin, int64_t end, bool countDegenerate)
+    {
+        IndexStats stats;
+        int64_t t = begin;
+#ifdef GUT_VERTEXDATA_SSE2
+        if (end-begin >= 4) {
+            // Four triangles (three registers) per iteration
+            const __m128i offset = _mm_set1_epi32(INT32_MIN);
+            __m128i maxIndex = offset;
+            for (; t+4<=end; t+=4) {
+                const unsigned* p = indices + t*3;
+                auto* v = reinterpret_cast<const __m128i*>(p);
+                maxIndex = maxOffsetU32(maxIndex, _mm_xor_si128(_mm_loadu_si128(v), offset));
+                maxIndex = maxOffsetU32(maxIndex, _mm_xor_si128(_mm_loadu_si128(v+1), offset));
+                maxIndex = maxOffsetU32(maxIndex, _mm_xor_si128(_mm_loadu_si128(v+2), offset));
+                if (countDegenerate) {
+                    stats.nDegenerate += isDegenerate(p) + isDegenerate(p+3) +
+                        isDegenerate(p+6) + isDegenerate(p+9);
+                }
+            }
+            maxIndex = maxOffsetU32(maxIndex, _mm_shuffle_epi32(maxIndex, _MM_SHUFFLE(2, 3, 0, 1)));
+            maxIndex = maxOffsetU32(maxIndex, _mm_shuffle_epi32(maxIndex, _MM_SHUFFLE(1, 0, 3, 2)));
+            stats.maxIndex = (unsigned)_mm_cvtsi128_si32(maxIndex) ^ 0x80000000u;
+        }
+#endif
+        for (; t<end; ++t) {
+            const unsigned* p = indices + t*3;
+            stats.maxIndex = std::max({ stats.maxIndex, p[0], p[1], p[2] });
+            if (countDegenerate)
+                stats.nDegenerate += isDegenerate(p);
+        }
+        return stats;
+    }
+
+} // namespace
+
 
-    v = copier(other.v);
-}
 
 VertexData::Container::Container(VertexData::Container&& other) noexcept :
-    name    (std::move(other.name)),
-    type    (other.type),
-    size    (other.size),
-    v       (other.v),
-    deleter (other.deleter),
-    copier  (other.copier)
+    name            (std::move(other.name)),
+    type            (other.type),
+    _size           (other._size),
+    _v              (std::move(other._v)),
+    _copier         (other._copier),
+    _external       (other._external),
+    _externalOwner  (std::move(other._externalOwner)),
+    _resource       (other._resource)
 {
     other.name.clear();
-    other.v = nullptr;
-    other.deleter = nullptr;
-    other.copier = nullptr;
+    other._size = 0;
+    other._copier = nullptr;
+    other._external = nullptr;
+    other._resource = nullptr;
 }
 
-VertexData::Container& VertexData::Container::operator=(const VertexData::Container& other)
+VertexData::Container& VertexData::Container::operator=(VertexData::Container&& other) noexcept
 {
-    name = other.name;
-    type = other.type;
-    size = other.size;
-    v = nullptr;
-    deleter = other.deleter;
-    copier = other.copier;
-
-    // Check for corrupted object
-    if (deleter == nullptr || copier == nullptr) {
-        name = "";
-        size = 0;
-        deleter = nullptr;
-        copier = nullptr;
+    if (this == &other)
         return *this;
-    }
 
-    v = copier(other.v);
-    return *this;
-}
-
-VertexData::Container& VertexData::Container::operator=(VertexData::Container&& other) noexcept
-{
     name = std::move(other.name);
     type = other.type;
-    size = other.size;
-    v = other.v;
-    deleter = other.deleter;
-    copier = other.copier;
+    _size = other._size;
+    _v = std::move(other._v);
+    _copier = other._copier;
+    _external = other._external;
+    _externalOwner = std::move(other._externalOwner);
+    _resource = other._resource;
 
     other.name.clear();
-    other.size = 0;
-    other.v = nullptr;
-    other.deleter = nullptr;
-    other.copier = nullptr;
+    other._size = 0;
+    other._copier = nullptr;
+    other._external = nullptr;
+    other._resource = nullptr;
 
     return *this;
 }
 
+int64_t VertexData::Container::size() const noexcept
+{
+    return _size;
+}
+
+void* VertexData::Container::data()
+{
+    materialize();
+    return const_cast<void*>(static_cast<const Container*>(this)->data());
+}
+
+const void* VertexData::Container::data() const noexcept
+{
+    if (_external != nullptr)
+        return _external;
+
+    if (_v == nullptr)
+        return nullptr;
+
+    return dispatchMathType(type, [&](auto* p) -> const void* {
+        using T_Data = std::remove_pointer_t<decltype(p)>;
+        return static_cast<const Vector<T_Data>*>(_v.get())->data();
+    });
+}
+
+size_t VertexData::Container::elementSize() const noexcept
+{
+    return dispatchMathType(type, [](auto* p) {
+        return sizeof(*p);
+    });
+}
+
+bool VertexData::Container::isExternal() const noexcept
+{
+    return _external != nullptr;
+}
+
+bool VertexData::Container::isShared() const noexcept
+{
+    return _v != nullptr && _v.use_count() > 1;
+}
+
+void VertexData::Container::materialize()
+{
+    if (_copier == nullptr)
+        return;
+
+    if (_external == nullptr) {
+        // Unshared vector can be modified in place. Only this container references the
+        // vector, so the count cannot grow concurrently, and the fence orders the accesses
+        // of the released copies before the modifications.
+        if (_v == nullptr || _v.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return;
+        }
+
+        // Detach from the other copies
+        _v = _copier(_v.get());
+        return;
+    }
+
+    if (_resource != nullptr) {
+        // Resource-allocated data is writable, unshared data is modified in place and
+        // shared data is detached to a new allocation from the same resource
+        if (_externalOwner.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return;
+        }
+
+        dispatchMathType(type, [&](auto* p) {
+            using T_Data = std::remove_pointer_t<decltype(p)>;
+            auto owner = allocateShared(_resource, _size*sizeof(T_Data), alignof(T_Data));
+            std::copy_n(static_cast<const T_Data*>(_external), _size,
+                static_cast<T_Data*>(const_cast<void*>(owner.get())));
+            _external = owner.get();
+            _externalOwner = std::move(owner);
+        });
+        return;
+    }
+
+    dispatchMathType(type, [&](auto* p) {
+        using T_Data = std::remove_pointer_t<decltype(p)>;
+        auto* src = static_cast<const T_Data*>(_external);
+        _v = std::make_shared<Vector<T_Data>>(src, src+_size);
+    });
+
+    _external = nullptr;
+    _externalOwner.reset();
+}
+
+void VertexData::Container::gather(const unsigned* indices, int64_t n)
+{
+    if (_copier == nullptr)
+        return;
+
+    dispatchMathType(type, [&](auto* p) {
+        using T_Data = std::remove_pointer_t<decltype(p)>;
+        auto* src = static_cast<const T_Data*>(static_cast<const Container*>(this)->data());
+
+        // New storage (from the resource of resource-allocated data), the previous one may be shared
+        std::shared_ptr<Vector<T_Data>> vector;
+        std::shared_ptr<const void> owner;
+        T_Data* d;
+        if (_resource != nullptr) {
+            owner = allocateShared(_resource, n*sizeof(T_Data), alignof(T_Data));
+            d = static_cast<T_Data*>(const_cast<void*>(owner.get()));
+        }
+        else {
+            vector = std::make_shared<Vector<T_Data>>(n);
+            d = vector->data();
+        }
+        parallelFor(0, n, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                d[i] = src[indices[i]];
+        }, 16384);
+
+        _v = std::move(vector);
+        _external = owner.get();
+        _externalOwner = std::move(owner);
+    });
+
+    _size = n;
+}
 
 VertexData::VertexData() :
     _maxIndex   (0),
+    _indexType  (IndexType::U32),
     _valid      (false)
 {
 }
@@ -106,6 +268,48 @@ Vector<std::string> VertexData::getDataNames() const
     return names;
 }
 
+bool VertexData::addExternalData(const std::string& name, MathTypeEnum type, const void* data,
+    int64_t size, std::shared_ptr<const void> owner)
+{
+    // Check if container with same name exists
+    for (auto& c : _containers) {
+        if (c.name == name) {
+            fprintf(stderr, "ERROR: Vertex data container with name %s already exists\n",
+                name.c_str());
+            return false;
+        }
+    }
+
+    // No owned vector, data is referenced instead
+    dispatchMathType(type, [&](auto* p) {
+        _containers.emplace_back(name, p, false);
+    });
+
+    auto& c = _containers.back();
+    c._size = size;
+    c._external = data;
+    c._externalOwner = std::move(owner);
+
+    _valid = false;
+    _bounds = Bounds();
+
+    return true;
+}
+
+bool VertexData::removeData(const std::string& name)
+{
+    for (auto it = _containers.begin(); it != _containers.end(); ++it) {
+        if (it->name == name) {
+            if (name == "position")
+                _bounds = Bounds();
+            _containers.erase(it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 const VertexData::Container* VertexData::accessData(const std::string& name) const noexcept
 {
     for (auto& c : _containers)
@@ -126,45 +330,134 @@ VertexData::Container* VertexData::accessData(const std::string& name) noexcept
 
 void VertexData::setIndices(const Vector<unsigned>& indices)
 {
-    _indices = indices;
+    _indices = std::make_shared<const Vector<unsigned>>(indices);
+    _indexType = IndexType::U32;
     _valid = false;
+    _bounds = Bounds();
 }
 
 void VertexData::setIndices(Vector<unsigned>&& indices)
 {
-    _indices = indices;
+    _indices = std::make_shared<const Vector<unsigned>>(std::move(indices));
+    _indexType = IndexType::U32;
     _valid = false;
+    _bounds = Bounds();
 }
 
 const Vector<unsigned>& VertexData::getIndices() const noexcept
 {
-    return _indices;
+    static const Vector<unsigned> noIndices;
+    return _indices != nullptr ? *_indices : noIndices;
 }
 
-bool VertexData::validate()
+VertexData::IndexType VertexData::getIndexType() const noexcept
 {
+    return _indexType;
+}
+
+void VertexData::packIndices(void* dest) const
+{
+    packIndices(getIndices(), _indexType, dest);
+}
+
+void VertexData::packIndices(const Vector<unsigned>& indices, IndexType indexType, void* dest)
+{
+    auto pack = [&](auto* d) {
+        parallelFor(0, indices.size(), [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i)
+                d[i] = (std::remove_pointer_t<decltype(d)>)indices[i];
+        }, 65536);
+    };
+
+    switch (indexType) {
+        case IndexType::U8:     pack(static_cast<uint8_t*>(dest)); break;
+        case IndexType::U16:    pack(static_cast<uint16_t*>(dest)); break;
+        case IndexType::U32:    memcpy(dest, indices.data(), indices.size()*sizeof(unsigned)); break;
+    }
+}
+
+VertexData::IndexType VertexData::indexTypeFor(unsigned maxIndex) noexcept
+{
+    if (maxIndex <= 0xFFu)
+        return IndexType::U8;
+    if (maxIndex <= 0xFFFFu)
+        return IndexType::U16;
+    return IndexType::U32;
+}
+
+size_t VertexData::indexTypeSize(IndexType indexType) noexcept
+{
+    switch (indexType) {
+        case IndexType::U8:     return 1;
+        case IndexType::U16:    return 2;
+        case IndexType::U32:    return 4;
+    }
+    return 4;
+}
+
+bool VertexData::validate(int64_t* nDegenerateTriangles)
+{
+    const auto& indices = getIndices();
+    int64_t nTriangles = indices.size() / 3;
+    bool countDegenerate = nDegenerateTriangles != nullptr;
+    _valid = false; // set again only when all checks pass
+
+    // Maximum index and degenerate triangles in one pass, blocks of whole triangles
+    int nBlocks = parallelForBlocks(nTriangles, validateBlockSize);
+    Vector<IndexStats> blockStats(std::max(nBlocks, 1));
+    parallelFor(0, nTriangles, [&](int64_t begin, int64_t end, int blockId) {
+        blockStats[blockId] = indexStats(indices.data(), begin, end, countDegenerate);
+    }, validateBlockSize);
+
     _maxIndex = 0;
+    int64_t nDegenerate = 0;
+    for (auto& stats : blockStats) {
+        _maxIndex = std::max(_maxIndex, stats.maxIndex);
+        nDegenerate += stats.nDegenerate;
+    }
+    for (size_t i=nTriangles*3; i<indices.size(); ++i) // indices of an incomplete triangle
+        _maxIndex = std::max(_maxIndex, indices[i]);
+    _indexType = indexTypeFor(_maxIndex);
 
-    // Find maximum index
-    for (auto& i : _indices)
-        if (i > _maxIndex)
-            _maxIndex = i;
+    if (countDegenerate)
+        *nDegenerateTriangles = nDegenerate;
 
     // No indices, data not valid
-    if (_maxIndex < 0)
+    if (indices.empty())
         return false;
 
-    // Check that all data vectors are at least the size of maximum index
+    // Check that all data vectors contain the maximum index
     for (auto& c : _containers) {
-        if (c.size < _maxIndex)
+        if (c._size <= (int64_t)_maxIndex)
             return false;
     }
 
+    // Bounds of the positions (all of them, referenced or not)
+    const auto* positions = accessData("position");
+    if (positions != nullptr && positions->type == MathTypeEnum::VEC3F)
+        _bounds = computeBounds(static_cast<const Vec3f*>(positions->data()), positions->size());
+    else
+        _bounds = Bounds();
+
     _valid = true;
     return true;
 }
 
+const Bounds& VertexData::getBounds() const noexcept
+{
+    return _bounds;
+}
+
 bool VertexData::isValid() const noexcept
 {
     return _valid;
 }
+
+std::shared_ptr<const void> VertexData::allocateShared(std::pmr::memory_resource* resource,
+    size_t bytes, size_t alignment)
+{
+    void* data = resource->allocate(bytes, alignment);
+    return std::shared_ptr<const void>(data, [resource, bytes, alignment](const void* p) {
+        resource->deallocate(const_cast<void*>(p), bytes, alignment);
+    }, std::pmr::polymorphic_allocator<std::byte>(resource));
+}
@@ -0,0 +1,181 @@
+//
+// Project: GraphicsUtils
+// File: VertexPacking.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "VertexPacking.hpp"
+#include "VertexData.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Vertices per block, destination block of a typical vertex stays in L1 while
+    // the attributes are written one after another
+    constexpr int64_t packBlockSize = 1024;
+
+    using CopyFunction = void (*)(uint8_t* dest, const uint8_t* src, int64_t n, uint32_t stride);
+
+    // Element size is a compile-time constant so the copies compile to (vector) moves
+    template <size_t T_Size>
+    void copyStrided(uint8_t* dest, const uint8_t* src, int64_t n, uint32_t stride)
+    {
+        for (int64_t i=0; i<n; ++i, dest += stride, src += T_Size)
+            memcpy(dest, src, T_Size);
+    }
+
+    struct SourceAttribute {
+        const uint8_t*  data;
+        uint32_t        offset;
+        uint32_t        size;
+        CopyFunction    copy;
+    };
+
+    inline uint32_t alignUp(uint32_t offset, uint32_t alignment)
+    {
+        return (offset + alignment-1) / alignment * alignment;
+    }
+
+    // Resolve the source data of the layout attributes
+    void sourceAttributes(const VertexData& vertexData, const PackedVertexBuffer& layout,
+        Vector<SourceAttribute>& sources)
+    {
+        for (auto& attribute : layout.attributes) {
+            const auto* c = vertexData.accessData(attribute.name);
+            sources.push_back({ static_cast<const uint8_t*>(c->data()), attribute.offset, attribute.size,
+                dispatchMathType(c->type, [](auto* p) -> CopyFunction {
+                    return &copyStrided<sizeof(*p)>;
+                }) });
+        }
+    }
+
+    // Pack vertices to dest, blocks are assembled in a staging buffer first when
+    // sequentialWrites is set
+    void packBlocks(const Vector<SourceAttribute>& sources, int64_t nVertices, uint32_t stride,
+        uint8_t* dest, bool sequentialWrites)
+    {
+        // Zero the padding only if there is any, attributes cover the rest
+        uint32_t covered = 0;
+        for (auto& source : sources)
+            covered += source.size;
+        bool hasPadding = covered < stride;
+
+        int64_t nBlocks = (nVertices + packBlockSize-1) / packBlockSize;
+        parallelFor(0, nBlocks, [&](int64_t blockBegin, int64_t blockEnd, int) {
+            Vector<uint8_t> staging(sequentialWrites ? packBlockSize*stride : 0);
+            for (int64_t b=blockBegin; b<blockEnd; ++b) {
+                int64_t begin = b*packBlockSize;
+                int64_t n = std::min(packBlockSize, nVertices-begin);
+                uint8_t* block = sequentialWrites ? staging.data() : dest + begin*stride;
+
+                if (hasPadding)
+                    memset(block, 0, n*stride);
+
+                for (auto& source : sources)
+                    source.copy(block + source.offset, source.data + begin*source.size, n, stride);
+
+                if (sequentialWrites)
+                    memcpy(dest + begin*stride, block, n*stride);
+            }
+        }, 16);
+    }
+
+} // namespace
+
+
+const PackedAttribute* PackedVertexBuffer::findAttribute(const std::string& name) const noexcept
+{
+    for (auto& attribute : attributes)
+        if (attribute.name == name)
+            return &attribute;
+
+    return nullptr;
+}
+
+bool gut::packVertexData(const VertexData& vertexData, PackedVertexBuffer& dest,
+    const VertexPackingSettings& settings)
+{
+    if (!layoutVertexData(vertexData, dest, settings))
+        return false;
+
+    Vector<SourceAttribute> sources;
+    sourceAttributes(vertexData, dest, sources);
+
+    dest.data.resize(dest.nVertices*dest.stride);
+    packBlocks(sources, dest.nVertices, dest.stride, dest.data.data(), false);
+
+    return true;
+}
+
+bool gut::layoutVertexData(const VertexData& vertexData, PackedVertexBuffer& layout,
+    const VertexPackingSettings& settings)
+{
+    layout = PackedVertexBuffer();
+
+    if (settings.alignment == 0) {
+        fprintf(stderr, "ERROR: Vertex packing alignment must be positive\n"); // TODO logging
+        return false;
+    }
+
+    const Vector<std::string>& names = settings.attributes.empty() ?
+        vertexData.getDataNames() : settings.attributes;
+
+    // Lay out the vertex
+    uint32_t offset = 0;
+    int64_t nVertices = -1;
+    for (auto& name : names) {
+        const auto* c = vertexData.accessData(name);
+        if (c == nullptr) {
+            fprintf(stderr, "ERROR: Vertex data container %s does not exist\n", name.c_str()); // TODO logging
+            layout = PackedVertexBuffer();
+            return false;
+        }
+        if (nVertices >= 0 && c->size() != nVertices) {
+            fprintf(stderr, "ERROR: Vertex data containers are of different sizes\n"); // TODO logging
+            layout = PackedVertexBuffer();
+            return false;
+        }
+        nVertices = c->size();
+
+        auto size = (uint32_t)c->elementSize();
+        offset = alignUp(offset, settings.alignment);
+        layout.attributes.push_back({ name, c->type, offset, size });
+        offset += size;
+    }
+
+    uint32_t stride = alignUp(offset, settings.alignment);
+    if (settings.stride > 0) {
+        if (settings.stride < offset) {
+            fprintf(stderr, "ERROR: Vertex stride %u is smaller than vertex size %u\n",
+                settings.stride, offset); // TODO logging
+            layout = PackedVertexBuffer();
+            return false;
+        }
+        stride = settings.stride;
+    }
+
+    layout.stride = stride;
+    layout.nVertices = std::max(nVertices, (int64_t)0);
+
+    return true;
+}
+
+void gut::packVertexData(const VertexData& vertexData, const PackedVertexBuffer& layout, void* dest)
+{
+    Vector<SourceAttribute> sources;
+    sourceAttributes(vertexData, layout, sources);
+
+    packBlocks(sources, layout.nVertices, layout.stride, static_cast<uint8_t*>(dest), true);
+}
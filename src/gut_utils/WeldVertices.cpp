@@ -0,0 +1,239 @@
+//
+// Project: GraphicsUtils
+// File: WeldVertices.cpp
+//
+// Copyright (c) 2020 Miika 'Lehdari' Lehtimäki
+// You may use, distribute and modify this code under the terms
+// of the licence specified in file LICENSE which is distributed
+// with this source code package.
+//
+
+#include "WeldVertices.hpp"
+#include "VertexData.hpp"
+#include "Deduplicate.hpp"
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace gut;
+
+
+namespace {
+
+    // Type-erased view to a data container
+    struct Attribute {
+        const uint8_t*  data;
+        size_t          elementSize;
+        bool            (*nearEqual)(const uint8_t* a, const uint8_t* b, float epsilon);
+    };
+
+    template <typename T_Data>
+    bool nearEqual(const uint8_t* a, const uint8_t* b, float epsilon)
+    {
+        using Scalar = typename MathTypeScalar<T_Data>::type;
+        constexpr int nComponents = sizeof(T_Data) / sizeof(Scalar);
+
+        Scalar ca[nComponents], cb[nComponents];
+        memcpy(ca, a, sizeof(ca));
+        memcpy(cb, b, sizeof(cb));
+        for (int i=0; i<nComponents; ++i)
+            if (!(std::abs((double)ca[i] - (double)cb[i]) <= epsilon))
+                return false;
+
+        return true;
+    }
+
+    inline uint64_t mix64(uint64_t h)
+    {
+        h ^= h >> 31;
+        h *= 0x7FB5D329728EA185ull;
+        h ^= h >> 27;
+        h *= 0x81DADEF4BC2DD44Dull;
+        return h ^ (h >> 33);
+    }
+
+    uint64_t hashBytes(uint64_t h, const uint8_t* p, size_t size)
+    {
+        uint64_t w;
+        for (; size >= 8; size -= 8, p += 8) {
+            memcpy(&w, p, 8);
+            h = mix64(h ^ w);
+        }
+        if (size > 0) {
+            w = 0;
+            memcpy(&w, p, size);
+            h = mix64(h ^ w ^ (size << 56));
+        }
+        return h;
+    }
+
+    inline uint64_t hashCell(int64_t x, int64_t y, int64_t z)
+    {
+        return mix64((uint64_t)x*0x9E3779B97F4A7C15ull ^ (uint64_t)y*0xC2B2AE3D27D4EB4Full ^
+            (uint64_t)z*0x165667B19E3779F9ull);
+    }
+
+    // Representative (first near-equal vertex) for each vertex using spatial hashing
+    void findRepresentatives(const Vector<Attribute>& attributes, const Vec3f* positions,
+        int64_t nVertices, float epsilon, Vector<unsigned>& representatives)
+    {
+        // Cells of size 2*epsilon: neighbourhood of a vertex overlaps at most 2 cells per axis.
+        // Cell coordinates are clamped to stay representable for positions far from the origin
+        // (the clamped cells only get more crowded, near vertices still share or neighbour one)
+        const double cellSize = 2.0*epsilon;
+        constexpr double maxCell = 4503599627370496.0; // 2^52
+        auto cell = [&](float v) {
+            return (int64_t)std::clamp(std::floor(v / cellSize), -maxCell, maxCell);
+        };
+
+        // Vertices with non-finite positions are not near any vertex, they are left unwelded
+        Vector<std::pair<uint64_t, unsigned>> cells(nVertices);
+        parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                const Vec3f& p = positions[i];
+                cells[i] = { p.allFinite() ? hashCell(cell(p(0)), cell(p(1)), cell(p(2))) : 0,
+                    (unsigned)i };
+            }
+        }, 16384);
+        std::erase_if(cells, [&](const auto& c) { return !positions[c.second].allFinite(); });
+        std::sort(cells.begin(), cells.end());
+
+        auto isNear = [&](int64_t a, int64_t b) {
+            for (auto& attribute : attributes) {
+                if (!attribute.nearEqual(attribute.data + a*attribute.elementSize,
+                    attribute.data + b*attribute.elementSize, epsilon))
+                    return false;
+            }
+            return true;
+        };
+
+        representatives.resize(nVertices);
+        parallelFor(0, nVertices, [&](int64_t begin, int64_t end, int) {
+            for (int64_t i=begin; i<end; ++i) {
+                const Vec3f& p = positions[i];
+                representatives[i] = (unsigned)i;
+                if (!p.allFinite())
+                    continue;
+
+                int64_t x0 = cell(p(0)-epsilon), x1 = cell(p(0)+epsilon);
+                int64_t y0 = cell(p(1)-epsilon), y1 = cell(p(1)+epsilon);
+                int64_t z0 = cell(p(2)-epsilon), z1 = cell(p(2)+epsilon);
+
+                unsigned r = (unsigned)i;
+                for (int64_t z=z0; z<=z1; ++z) {
+                    for (int64_t y=y0; y<=y1; ++y) {
+                        for (int64_t x=x0; x<=x1; ++x) {
+                            auto range = std::equal_range(cells.begin(), cells.end(),
+                                std::pair<uint64_t, unsigned>(hashCell(x, y, z), 0),
+                                [](const auto& a, const auto& b) { return a.first < b.first; });
+                            // Entries of a cell are sorted by vertex index
+                            for (auto it = range.first; it != range.second && it->second < r; ++it) {
+                                if (isNear(it->second, i)) {
+                                    r = it->second;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+                representatives[i] = r;
+            }
+        }, 4096);
+
+        // Representatives precede the vertices, resolve chains in order
+        for (int64_t i=0; i<nVertices; ++i)
+            representatives[i] = representatives[representatives[i]];
+    }
+
+} // namespace
+
+
+int64_t gut::weldVertices(VertexData& vertexData, float epsilon)
+{
+    Vector<std::string> names = vertexData.getDataNames();
+    if (names.empty())
+        return 0;
+
+    Vector<Attribute> attributes;
+    int64_t nVertices = -1;
+    for (auto& name : names) {
+        const auto* c = static_cast<const VertexData&>(vertexData).accessData(name);
+        if (nVertices >= 0 && c->size() != nVertices) {
+            fprintf(stderr, "ERROR: Vertex data containers are of different sizes\n"); // TODO logging
+            return -1;
+        }
+        nVertices = c->size();
+        attributes.push_back({ static_cast<const uint8_t*>(c->data()), c->elementSize(),
+            dispatchMathType(c->type, [](auto* p) {
+                return &nearEqual<std::remove_pointer_t<decltype(p)>>;
+            }) });
+    }
+
+    Vector<unsigned> remap; // vertex index to welded vertex index
+    Vector<unsigned> unique; // welded vertex index to vertex index
+    if (epsilon <= 0.0f) {
+        deduplicate(nVertices,
+            [&](int64_t i) {
+                uint64_t h = 0;
+                for (auto& a : attributes)
+                    h = hashBytes(h, a.data + i*a.elementSize, a.elementSize);
+                return h;
+            },
+            [&](int64_t i, int64_t j) {
+                for (auto& a : attributes)
+                    if (memcmp(a.data + i*a.elementSize, a.data + j*a.elementSize, a.elementSize) != 0)
+                        return false;
+                return true;
+            },
+            remap, unique);
+    }
+    else {
+        if (!std::isfinite(epsilon)) {
+            fprintf(stderr, "ERROR: Welding epsilon must be finite\n"); // TODO logging
+            return -1;
+        }
+
+        const auto* positions = static_cast<const VertexData&>(vertexData).accessData("position");
+        if (positions == nullptr || positions->type != MathTypeEnum::VEC3F) {
+            fprintf(stderr, "ERROR: Welding with epsilon requires Vec3f position data\n"); // TODO logging
+            return -1;
+        }
+
+        Vector<unsigned> representatives;
+        findRepresentatives(attributes, static_cast<const Vec3f*>(positions->data()),
+            nVertices, epsilon, representatives);
+
+        remap.resize(nVertices);
+        for (int64_t i=0; i<nVertices; ++i) {
+            if (representatives[i] == (unsigned)i) {
+                remap[i] = (unsigned)unique.size();
+                unique.push_back((unsigned)i);
+            }
+            else
+                remap[i] = remap[representatives[i]];
+        }
+    }
+
+    if ((int64_t)unique.size() == nVertices)
+        return nVertices;
+
+    bool wasValid = vertexData.isValid();
+
+    for (auto& name : names)
+        vertexData.accessData(name)->gather(unique.data(), unique.size());
+
+    Vector<unsigned> indices = vertexData.getIndices();
+    parallelFor(0, indices.size(), [&](int64_t begin, int64_t end, int) {
+        for (int64_t i=begin; i<end; ++i)
+            indices[i] = indices[i] < nVertices ? remap[indices[i]] : indices[i];
+    }, 65536);
+    vertexData.setIndices(std::move(indices));
+    if (wasValid)
+        vertexData.validate();
+
+    return unique.size();
+}